@@ -0,0 +1,680 @@
+// alarm_bus.cpp
+
+#include "alarm_bus.h"
+
+#include "metrics.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using SocketHandle = SOCKET;
+constexpr SocketHandle kInvalidSocket = INVALID_SOCKET;
+inline void closeSocket(SocketHandle s) { closesocket(s); }
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+using SocketHandle = int;
+constexpr SocketHandle kInvalidSocket = -1;
+inline void closeSocket(SocketHandle s) { ::close(s); }
+#endif
+// Windows has no SIGPIPE; macOS lacks the flag and relies on SIG_IGN.
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace {
+
+std::atomic<AlarmBus*> g_activeBus{nullptr};
+
+void appendEscaped(std::string& out, const std::string& s) {
+    for (char c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+    }
+}
+
+// Same classes with the same diffs; boxes move between reports of one change.
+bool sameChanges(const AlarmEvent& a, const AlarmEvent& b) {
+    return std::equal(a.changes.begin(), a.changes.end(), b.changes.begin(), b.changes.end(),
+                      [](const AlarmChange& x, const AlarmChange& y) { return x.cls == y.cls && x.diff == y.diff; });
+}
+
+bool sendAll(SocketHandle s, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const auto n = ::send(s, data.data() + sent, static_cast<int>(data.size() - sent), MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+class ConsoleSink : public AlarmSink {
+public:
+    std::string describe() const override { return "console"; }
+
+    void deliver(const AlarmEvent& event) override {
+        // One write per event so concurrent output does not split the block.
+        std::ostringstream out;
+        out << "==================== ALERT ====================\n"
+            << "[ALARM] Session " << event.stream << " User=" << event.username << "\n";
+        for (const auto& change : event.changes) {
+            out << "  * " << (change.diff < 0 ? "MISSING " : "ADDED ") << change.cls << " ("
+                << (change.diff < 0 ? -change.diff : change.diff)
+                << (change.diff < 0 ? " removed)" : " new)") << "\n";
+        }
+        out << "================================================\n";
+        std::cout << out.str() << std::flush;
+    }
+};
+
+class FileSink : public AlarmSink {
+public:
+    explicit FileSink(std::string path) : path_(std::move(path)), out_(path_, std::ios::app) {}
+
+    bool ok() const { return static_cast<bool>(out_); }
+    std::string describe() const override { return "file " + path_; }
+
+    void deliver(const AlarmEvent& event) override {
+        out_ << alarmEventJson(event) << std::flush;
+        if (!out_ && !warned_) {
+            warned_ = true;
+            std::cerr << "[WARN] Alarm sink " << describe() << ": write failed.\n";
+        }
+    }
+
+private:
+    std::string path_;
+    std::ofstream out_;
+    bool warned_ = false;
+};
+
+// Bounds each blocking send so a receiver that stops reading cannot hold a
+// sink thread (or its shutdown) for longer than this.
+constexpr int kSocketTimeoutMs = 2000;
+
+void setSendTimeout(SocketHandle s) {
+#if defined(_WIN32)
+    const DWORD timeout = kSocketTimeoutMs;
+#else
+    const timeval timeout{kSocketTimeoutMs / 1000, (kSocketTimeoutMs % 1000) * 1000};
+#endif
+    ::setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+// A sink that sends from its own thread with a bounded backlog, so a
+// receiver that stalls the connect or the send delays only that sink, never
+// the console or the other sinks on the dispatcher thread. Subclasses call
+// start() at the end of their constructor and stop() first in their
+// destructor, so send() never runs on a partly built or destroyed object.
+class QueuedSink : public AlarmSink {
+public:
+    void deliver(const AlarmEvent& event) override {
+        std::string payload = format(event);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.size() >= kMaxBacklog) {
+                queue_.pop_front();   // the receiver is behind; newest events matter most
+                dropped_.inc();
+            }
+            queue_.push_back(std::move(payload));
+        }
+        ready_.notify_one();
+    }
+
+protected:
+    explicit QueuedSink(const std::string& kind)
+        : kind_(kind),
+          dropped_(metrics::counter("toolsdetect_alarm_sink_dropped_total",
+                                    "Alarm events a sink dropped because its backlog was full",
+                                    {{"sink", kind}})) {}
+
+    void start() {
+        thread_ = std::thread([this]() {
+            trace::setThreadName("alarm-" + kind_);
+            sendLoop();
+        });
+    }
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        ready_.notify_one();
+        thread_.join();   // sends what is queued; each send is bounded by kSocketTimeoutMs
+    }
+
+    // Called on the dispatcher thread.
+    virtual std::string format(const AlarmEvent& event) const = 0;
+    // Called on the sink's thread; false if the receiver did not take it.
+    virtual bool send(const std::string& payload) = 0;
+
+private:
+    static constexpr size_t kMaxBacklog = 256;
+
+    void sendLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            ready_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;   // stopping
+            }
+            const std::string payload = std::move(queue_.front());
+            queue_.pop_front();
+            lock.unlock();
+            const bool ok = send(payload);
+            if (!ok && !warned_) {
+                std::cerr << "[WARN] Alarm sink " << describe() << " is not reachable.\n";
+            }
+            warned_ = !ok;
+            lock.lock();
+        }
+    }
+
+    std::string kind_;
+    metrics::Counter& dropped_;
+    bool warned_ = false;   // send thread only
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<std::string> queue_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+#if !defined(_WIN32)
+// Connects lazily and reconnects after a failure, so the supervisory app
+// may start after us or restart.
+class UnixSocketSink : public QueuedSink {
+public:
+    explicit UnixSocketSink(std::string path) : QueuedSink("unix"), path_(std::move(path)) { start(); }
+    ~UnixSocketSink() override {
+        stop();
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    std::string describe() const override { return "unix socket " + path_; }
+
+private:
+    std::string format(const AlarmEvent& event) const override { return alarmEventJson(event); }
+
+    bool send(const std::string& line) override {
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            if (fd_ < 0 && !connectSocket()) {
+                return false;
+            }
+            if (sendAll(fd_, line)) {
+                return true;
+            }
+            // Peer went away or stopped reading; a timed-out send may have
+            // left half a line, so retry once on a new connection.
+            ::close(fd_);
+            fd_ = -1;
+        }
+        return false;
+    }
+
+    bool connectSocket() {
+        sockaddr_un addr{};
+        if (path_.size() >= sizeof(addr.sun_path)) {
+            return false;
+        }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path_.c_str(), path_.size() + 1);
+        fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd_ < 0) {
+            return false;
+        }
+        setSendTimeout(fd_);
+        if (::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        return true;
+    }
+
+    std::string path_;
+    int fd_ = -1;   // send thread only
+};
+
+// Named pipe, created if missing. Opening is non-blocking, so with no
+// reader attached (ENXIO) events are dropped instead of stalling the bus.
+class FifoSink : public AlarmSink {
+public:
+    explicit FifoSink(std::string path) : path_(std::move(path)) {
+        struct stat st {};
+        if (::stat(path_.c_str(), &st) != 0 && ::mkfifo(path_.c_str(), 0660) != 0) {
+            std::cerr << "[WARN] Cannot create named pipe " << path_ << ": " << std::strerror(errno) << "\n";
+        }
+        // A reader closing its end must not kill the process.
+        std::signal(SIGPIPE, SIG_IGN);
+    }
+    ~FifoSink() override {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    std::string describe() const override { return "named pipe " + path_; }
+
+    void deliver(const AlarmEvent& event) override {
+        if (fd_ < 0) {
+            fd_ = ::open(path_.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+            if (fd_ < 0) {
+                return;   // no reader right now
+            }
+        }
+        const std::string line = alarmEventJson(event);
+        // Lines are far below PIPE_BUF, so each write is atomic.
+        if (::write(fd_, line.data(), line.size()) != static_cast<ssize_t>(line.size())) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+private:
+    std::string path_;
+    int fd_ = -1;
+};
+#endif
+
+// Stand-in for a webhook: one HTTP/1.0 POST per event to a loopback port,
+// fire and forget. A real deployment would put a relay behind it.
+class WebhookSink : public QueuedSink {
+public:
+    WebhookSink(int port, std::string path) : QueuedSink("webhook"), port_(port), path_(std::move(path)) {
+#if defined(_WIN32)
+        WSADATA wsaData;
+        started_ = WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#endif
+        start();
+    }
+    ~WebhookSink() override {
+        stop();
+#if defined(_WIN32)
+        if (started_) WSACleanup();
+#endif
+    }
+
+    std::string describe() const override {
+        return "webhook http://127.0.0.1:" + std::to_string(port_) + path_;
+    }
+
+private:
+    std::string format(const AlarmEvent& event) const override {
+        const std::string body = alarmEventJson(event);
+        std::string request = "POST " + path_ + " HTTP/1.0\r\nHost: 127.0.0.1:" + std::to_string(port_) +
+                              "\r\nContent-Type: application/json\r\nContent-Length: " +
+                              std::to_string(body.size()) + "\r\n\r\n";
+        request += body;
+        return request;
+    }
+
+    bool send(const std::string& request) override {
+        SocketHandle s = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (s == kInvalidSocket) {
+            return false;
+        }
+        setSendTimeout(s);   // on Linux this also bounds connect()
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port_));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        const bool ok = ::connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 && sendAll(s, request);
+        closeSocket(s);
+        return ok;
+    }
+
+    int port_;
+    std::string path_;
+#if defined(_WIN32)
+    bool started_ = false;
+#endif
+};
+
+struct BusMetrics {
+    metrics::Counter& delivered;
+    metrics::Counter& deduplicated;
+    metrics::Counter& dropped;
+    metrics::Histogram& latency;
+};
+
+// Registered when the first bus is built, so the first alarm does not pay
+// for the registry lookups.
+BusMetrics& busMetrics() {
+    static const char* kHelp = "Alarm events by dispatch outcome";
+    static BusMetrics m{
+        metrics::counter("toolsdetect_alarm_events_total", kHelp, {{"outcome", "delivered"}}),
+        metrics::counter("toolsdetect_alarm_events_total", kHelp, {{"outcome", "deduplicated"}}),
+        metrics::counter("toolsdetect_alarm_events_total", kHelp, {{"outcome", "dropped"}}),
+        metrics::histogram("toolsdetect_alarm_dispatch_seconds", "Alarm publish to last sink delivered",
+                           {0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.1, 1.0}),
+    };
+    return m;
+}
+
+size_t roundUpPow2(size_t n) {
+    size_t p = 2;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+}  // namespace
+
+std::string alarmEventJson(const AlarmEvent& event) {
+    std::string out = "{\"stream\":\"";
+    appendEscaped(out, event.stream);
+    out += "\",\"user\":\"";
+    appendEscaped(out, event.username);
+    out += "\",\"changes\":[";
+    for (size_t i = 0; i < event.changes.size(); ++i) {
+        const AlarmChange& change = event.changes[i];
+        out += i == 0 ? "{\"class\":\"" : ",{\"class\":\"";
+        appendEscaped(out, change.cls);
+        out += "\",\"kind\":\"";
+        out += change.diff < 0 ? "missing" : "added";
+        out += "\",\"diff\":" + std::to_string(change.diff);
+        out += ",\"box\":[" + std::to_string(change.box.x) + "," + std::to_string(change.box.y) + "," +
+               std::to_string(change.box.width) + "," + std::to_string(change.box.height) + "]}";
+    }
+    out += "],\"time_ms\":" + std::to_string(event.wallTimeMs) + "}\n";
+    return out;
+}
+
+std::unique_ptr<AlarmSink> createAlarmSink(const std::string& spec) {
+    const auto colon = spec.find(':');
+    const std::string kind = spec.substr(0, colon);
+    const std::string arg = colon == std::string::npos ? std::string() : spec.substr(colon + 1);
+    if (kind == "console" && arg.empty()) {
+        return std::make_unique<ConsoleSink>();
+    }
+    if (arg.empty()) {
+        std::cerr << "[ERROR] Invalid alarm sink '" << spec
+                  << "' (expected console, file:<path>, unix:<path>, fifo:<path> or webhook:<port>)\n";
+        return nullptr;
+    }
+    if (kind == "file") {
+        auto sink = std::make_unique<FileSink>(arg);
+        if (!sink->ok()) {
+            std::cerr << "[ERROR] Cannot open alarm file " << arg << "\n";
+            return nullptr;
+        }
+        return sink;
+    }
+    if (kind == "unix" || kind == "fifo") {
+#if !defined(_WIN32)
+        if (kind == "unix") return std::make_unique<UnixSocketSink>(arg);
+        return std::make_unique<FifoSink>(arg);
+#else
+        std::cerr << "[ERROR] Alarm sink '" << kind << "' is not available on Windows; use webhook or file.\n";
+        return nullptr;
+#endif
+    }
+    if (kind == "webhook") {
+        const auto slash = arg.find('/');
+        const std::string portText = arg.substr(0, slash);
+        int port = 0;
+        try {
+            port = std::stoi(portText);
+        } catch (const std::exception&) {
+            port = 0;
+        }
+        if (port <= 0 || port > 65535) {
+            std::cerr << "[ERROR] Invalid webhook port in alarm sink '" << spec << "'\n";
+            return nullptr;
+        }
+        return std::make_unique<WebhookSink>(port, slash == std::string::npos ? "/" : arg.substr(slash));
+    }
+    std::cerr << "[ERROR] Unknown alarm sink kind '" << kind << "'\n";
+    return nullptr;
+}
+
+AlarmBus::AlarmBus(AlarmBusConfig config) : config_(config) {
+    busMetrics();
+    const size_t capacity = roundUpPow2(config_.capacity);
+    ring_ = std::make_unique<Slot[]>(capacity);
+    mask_ = capacity - 1;
+    for (size_t i = 0; i < capacity; ++i) {
+        ring_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+AlarmBus::~AlarmBus() {
+    AlarmBus* self = this;
+    g_activeBus.compare_exchange_strong(self, nullptr);
+    stop();
+}
+
+void AlarmBus::addSink(std::unique_ptr<AlarmSink> sink) {
+    if (sink) {
+        sinks_.push_back(std::move(sink));
+    }
+}
+
+void AlarmBus::start() {
+    if (thread_.joinable()) {
+        return;
+    }
+    stop_.store(false);
+    thread_ = std::thread([this]() {
+        trace::setThreadName("alarm-dispatch");
+        dispatchLoop();
+    });
+}
+
+void AlarmBus::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stop_.store(true);
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+// Bounded multi-producer ring (Vyukov): a producer claims a slot with one
+// CAS on enqueuePos_ and publishes it through the slot's sequence number.
+bool AlarmBus::publish(AlarmEvent event) {
+    event.publishedAt = std::chrono::steady_clock::now();
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    for (;;) {
+        slot = &ring_[pos & mask_];
+        const size_t seq = slot->sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            busMetrics().dropped.inc();
+            return false;   // full
+        } else {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+    slot->event = std::move(event);
+    // seq_cst pairs with the dispatcher's idle_ handshake below: either it
+    // sees this slot before sleeping or we see it idle and wake it.
+    slot->sequence.store(pos + 1, std::memory_order_seq_cst);
+    if (idle_.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        wake_.notify_one();
+    }
+    return true;
+}
+
+bool AlarmBus::pop(AlarmEvent& event) {
+    Slot& slot = ring_[dequeuePos_ & mask_];
+    if (slot.sequence.load(std::memory_order_seq_cst) != dequeuePos_ + 1) {
+        return false;
+    }
+    event = std::move(slot.event);
+    slot.sequence.store(dequeuePos_ + mask_ + 1, std::memory_order_release);
+    ++dequeuePos_;
+    return true;
+}
+
+void AlarmBus::dispatchLoop() {
+    using Clock = std::chrono::steady_clock;
+    for (;;) {
+        AlarmEvent event;
+        while (pop(event)) {
+            route(std::move(event), Clock::now());
+        }
+        flushHeld(Clock::now(), false);
+
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        idle_.store(true, std::memory_order_seq_cst);
+        const bool pending = ring_[dequeuePos_ & mask_].sequence.load(std::memory_order_seq_cst) ==
+                             dequeuePos_ + 1;
+        if (!pending && stop_.load()) {
+            idle_.store(false);
+            break;
+        }
+        if (!pending) {
+            // Sleep until woken by publish() or until the next held event is due.
+            auto deadline = Clock::now() + std::chrono::seconds(1);
+            for (const auto& kv : streams_) {
+                if (kv.second.held) {
+                    deadline = std::min(deadline, kv.second.deliveredAt + config_.debounce);
+                }
+            }
+            wake_.wait_until(lock, deadline);
+        }
+        idle_.store(false, std::memory_order_seq_cst);
+    }
+    flushHeld(Clock::now(), true);
+}
+
+void AlarmBus::route(AlarmEvent&& event, std::chrono::steady_clock::time_point now) {
+    auto it = streams_.find(event.stream);
+    if (it == streams_.end()) {
+        StreamState& state = streams_[event.stream];
+        deliver(event);
+        state.delivered = std::move(event);
+        state.deliveredAt = now;
+        return;
+    }
+    StreamState& state = it->second;
+    if (now - state.deliveredAt < config_.debounce) {
+        if (state.held) {
+            busMetrics().deduplicated.inc();   // superseded by the newer held event
+        }
+        state.pending = std::move(event);
+        state.held = true;
+        return;
+    }
+    if (sameChanges(event, state.delivered) && now - state.deliveredAt < config_.dedupeWindow) {
+        busMetrics().deduplicated.inc();
+        return;
+    }
+    deliver(event);
+    state.delivered = std::move(event);
+    state.deliveredAt = now;
+    state.held = false;
+}
+
+void AlarmBus::flushHeld(std::chrono::steady_clock::time_point now, bool all) {
+    for (auto it = streams_.begin(); it != streams_.end();) {
+        StreamState& state = it->second;
+        if (state.held && (all || now - state.deliveredAt >= config_.debounce)) {
+            state.held = false;
+            if (sameChanges(state.pending, state.delivered)) {
+                busMetrics().deduplicated.inc();
+            } else {
+                deliver(state.pending);
+                state.delivered = std::move(state.pending);
+                state.deliveredAt = now;
+            }
+        }
+        // Session ids never repeat; forget quiet keys once nothing can be
+        // debounced or de-duplicated against them.
+        if (!state.held && now - state.deliveredAt >= std::max(config_.debounce, config_.dedupeWindow)) {
+            it = streams_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void AlarmBus::deliver(const AlarmEvent& event) {
+    for (auto& sink : sinks_) {
+        sink->deliver(event);
+    }
+    busMetrics().delivered.inc();
+    busMetrics().latency.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - event.publishedAt).count());
+}
+
+bool publishInventoryAlarms(const InventoryDelta& delta,
+                            const std::string& stream,
+                            const std::string& username) {
+    AlarmBus* bus = activeAlarmBus();
+    if (!bus) {
+        return false;
+    }
+    AlarmEvent event;
+    event.stream = stream;
+    event.username = username;
+    event.wallTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+    for (const auto& kv : delta.classCountDiff) {   // std::map: sorted by class
+        if (kv.second == 0) {
+            continue;
+        }
+        AlarmChange change;
+        change.cls = kv.first;
+        change.diff = kv.second;
+        // Where the tool was seen: before for a missing one, after for an added one.
+        const DetectionResult& seen = kv.second < 0 ? delta.beforeDet : delta.afterDet;
+        float best = -1.0f;
+        for (const auto& obj : seen.objects) {
+            if (obj.cls == kv.first && obj.confidence > best) {
+                best = obj.confidence;
+                change.box = obj.bbox;
+            }
+        }
+        event.changes.push_back(std::move(change));
+    }
+    return event.changes.empty() || bus->publish(std::move(event));
+}
+
+void setActiveAlarmBus(AlarmBus* bus) {
+    g_activeBus.store(bus);
+}
+
+AlarmBus* activeAlarmBus() {
+    return g_activeBus.load();
+}
@@ -0,0 +1,144 @@
+// alarm_bus.h
+// Structured alarm events dispatched off the session thread to local sinks
+// (--alarm-sink). Publishing is a lock-free push into a bounded ring; one
+// dispatcher thread drains it, applies per-stream debouncing and
+// de-duplication, and hands each event to every sink.
+
+#pragma once
+
+#include "inventory_compare.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct AlarmChange {
+    std::string cls;
+    int diff = 0;         // after - before count; < 0 missing, > 0 added
+    cv::Rect box;         // most confident box of `cls` where it was seen
+};
+
+// One event per session (or settled video change), carrying every changed
+// class, so a sink sees one ALERT per session.
+struct AlarmEvent {
+    // Session id, or "video:<source>" for video mode. Debouncing and
+    // de-duplication are per stream.
+    std::string stream;
+    std::string username;
+    std::vector<AlarmChange> changes;                  // sorted by class
+    int64_t wallTimeMs = 0;                            // ms since the epoch
+    std::chrono::steady_clock::time_point publishedAt; // set by publish()
+};
+
+// One line of JSON, newline-terminated; what the socket, pipe, file and
+// webhook sinks send.
+std::string alarmEventJson(const AlarmEvent& event);
+
+class AlarmSink {
+public:
+    virtual ~AlarmSink() = default;
+    virtual std::string describe() const = 0;
+    // Called on the dispatcher thread only. Failures are reported by the
+    // sink and must not throw.
+    virtual void deliver(const AlarmEvent& event) = 0;
+};
+
+// Sink specs:
+//   console           the [ALARM] block on stdout
+//   file:<path>       appends JSON lines
+//   unix:<path>       JSON lines to a Unix stream socket, reconnecting;
+//                     sent from the sink's own thread
+//   fifo:<path>       JSON lines to a named pipe; dropped while no reader
+//   webhook:<port>[/path]  HTTP POST of each event to 127.0.0.1:<port>,
+//                     a stand-in for a real webhook receiver; posted from
+//                     the sink's own thread
+// Returns nullptr (after printing the reason) for a bad or unsupported spec.
+std::unique_ptr<AlarmSink> createAlarmSink(const std::string& spec);
+
+struct AlarmBusConfig {
+    size_t capacity = 1024;   // ring slots, rounded up to a power of two
+    // After an event for a stream is delivered, further events for it within
+    // this window are held; when the window closes the latest one is
+    // delivered if it differs. The first event is never delayed.
+    std::chrono::milliseconds debounce{300};
+    // An event equal (same classes and diffs) to the last one delivered for
+    // its stream is dropped within this window, e.g. the same change
+    // reported again by later video frames.
+    std::chrono::milliseconds dedupeWindow{5000};
+};
+
+class AlarmBus {
+public:
+    explicit AlarmBus(AlarmBusConfig config = AlarmBusConfig());
+    ~AlarmBus();
+
+    AlarmBus(const AlarmBus&) = delete;
+    AlarmBus& operator=(const AlarmBus&) = delete;
+
+    // Sinks are added before start().
+    void addSink(std::unique_ptr<AlarmSink> sink);
+    void start();
+    // Delivers whatever is queued or held, then joins the dispatcher.
+    void stop();
+
+    // Safe from any thread. The push itself is lock-free; only when the
+    // dispatcher is asleep does the publisher take a short mutex to wake it.
+    // Returns false (and counts a drop) if the ring is full.
+    bool publish(AlarmEvent event);
+
+    size_t sinkCount() const { return sinks_.size(); }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        AlarmEvent event;
+    };
+    struct StreamState {
+        AlarmEvent delivered;
+        std::chrono::steady_clock::time_point deliveredAt;
+        bool held = false;
+        AlarmEvent pending;
+    };
+
+    bool pop(AlarmEvent& event);
+    void dispatchLoop();
+    void route(AlarmEvent&& event, std::chrono::steady_clock::time_point now);
+    void flushHeld(std::chrono::steady_clock::time_point now, bool all);
+    void deliver(const AlarmEvent& event);
+
+    AlarmBusConfig config_;
+    std::vector<std::unique_ptr<AlarmSink>> sinks_;
+    std::unique_ptr<Slot[]> ring_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> enqueuePos_{0};
+    alignas(64) size_t dequeuePos_ = 0;   // dispatcher thread only
+
+    std::map<std::string, StreamState> streams_;   // dispatcher only
+
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;
+    std::atomic<bool> idle_{false};
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+// Publishes one event with every changed class of `delta` on the active bus
+// (nothing if no class changed). Returns false if no bus is active or its
+// queue is full, so the caller can fall back to the console.
+bool publishInventoryAlarms(const InventoryDelta& delta,
+                            const std::string& stream,
+                            const std::string& username);
+
+// Process-wide bus used by sessions and video mode; nullptr (default) keeps
+// the console-only raiseAlarmToConsole(). The caller keeps ownership.
+void setActiveAlarmBus(AlarmBus* bus);
+AlarmBus* activeAlarmBus();
@@ -41,7 +41,7 @@ inline AlarmInfo evaluateAlarm(const InventoryDelta& delta) {
 }
 
 // 实际触发报警（当前阶段 = 控制台输出+高亮标志）
-// 将来可以升级为蜂鸣器/弹窗/语音播报
+// 蜂鸣器 / 监控程序等本地输出见 alarm_bus.h（--alarm-sink），启用后报警由分发线程输出
 inline void raiseAlarmToConsole(const AlarmInfo& info,
                                 const std::string& sessionId,
                                 const std::string& username)
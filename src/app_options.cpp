@@ -0,0 +1,244 @@
+#include "app_options.h"
+
+#include "yolo_common.h"
+
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+bool readValue(int argc, char** argv, int& i, std::string& value) {
+    if (i + 1 >= argc) {
+        std::cerr << "[ERROR] Missing value for " << argv[i] << "\n";
+        return false;
+    }
+    value = argv[++i];
+    return true;
+}
+
+bool readInt(int argc, char** argv, int& i, int minValue, int& value) {
+    std::string text;
+    if (!readValue(argc, argv, i, text)) {
+        return false;
+    }
+    char* end = nullptr;
+    long parsed = std::strtol(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end != '\0' || parsed < minValue) {
+        std::cerr << "[ERROR] Invalid value for " << argv[i - 1] << ": " << text << "\n";
+        return false;
+    }
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+}  // namespace
+
+bool parseAppOptions(int argc, char** argv, AppOptions& out) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        bool ok = true;
+        if (arg == "-h" || arg == "--help") {
+            out.showHelp = true;
+        } else if (arg == "--watch") {
+            out.headless = true;
+            ok = readValue(argc, argv, i, out.watchDir);
+        } else if (arg == "--results") {
+            ok = readValue(argc, argv, i, out.resultsDir);
+        } else if (arg == "--log") {
+            ok = readValue(argc, argv, i, out.logPath);
+        } else if (arg == "--user") {
+            ok = readValue(argc, argv, i, out.username);
+        } else if (arg == "--workers") {
+            ok = readInt(argc, argv, i, 0, out.workers);
+        } else if (arg == "--poll-ms") {
+            ok = readInt(argc, argv, i, 10, out.pollIntervalMs);
+        } else if (arg == "--poll") {
+            out.forcePolling = true;
+        } else if (arg == "--once") {
+            out.exitWhenIdle = true;
+        } else if (arg == "--camera") {
+            ok = readValue(argc, argv, i, out.cameraSpec);
+        } else if (arg == "--cameras") {
+            ok = readValue(argc, argv, i, out.cameraRigPath);
+        } else if (arg == "--camera-window-ms") {
+            ok = readInt(argc, argv, i, 0, out.cameraWindowMs);
+        } else if (arg == "--slots") {
+            ok = readValue(argc, argv, i, out.slotsPath);
+        } else if (arg == "--slot-reference") {
+            ok = readValue(argc, argv, i, out.slotReference);
+        } else if (arg == "--slot-empty") {
+            ok = readValue(argc, argv, i, out.slotEmptyReference);
+        } else if (arg == "--server") {
+            ok = readValue(argc, argv, i, out.inferSocket);
+        } else if (arg == "--backend") {
+            ok = readValue(argc, argv, i, out.backend);
+        } else if (arg == "--precision") {
+            ok = readValue(argc, argv, i, out.precision);
+            if (ok && out.precision != "auto" && out.precision != "fp32" && out.precision != "int8") {
+                std::cerr << "[ERROR] Invalid value for --precision: " << out.precision << "\n";
+                ok = false;
+            }
+        } else if (arg == "--alarm-sink") {
+            std::string spec;
+            ok = readValue(argc, argv, i, spec);
+            if (ok) out.alarmSinks.push_back(spec);
+        } else if (arg == "--alarm-debounce-ms") {
+            ok = readInt(argc, argv, i, 0, out.alarmDebounceMs);
+        } else if (arg == "--archive-full") {
+            out.archiveFull = true;
+        } else if (arg == "--archive") {
+            ok = readValue(argc, argv, i, out.archiveDir);
+        } else if (arg == "--archive-segments") {
+            out.archiveSegments = true;
+        } else if (arg == "--archive-export") {
+            ok = readValue(argc, argv, i, out.archiveExport);
+        } else if (arg == "--state") {
+            ok = readValue(argc, argv, i, out.statePath);
+        } else if (arg == "--low-memory") {
+            out.lowMemory = true;
+        } else if (arg == "--model-reload-ms") {
+            ok = readInt(argc, argv, i, 0, out.modelReloadMs);
+        } else if (arg == "--lighting") {
+            ok = readValue(argc, argv, i, out.lighting);
+            LightingConfig lighting;
+            if (ok && !parseLightingSpec(out.lighting, lighting)) {
+                std::cerr << "[ERROR] Invalid value for --lighting: " << out.lighting << "\n";
+                ok = false;
+            }
+        } else if (arg == "--input-size") {
+            ok = readInt(argc, argv, i, 0, out.inputSize);
+            if (ok && out.inputSize % 32 != 0) {
+                std::cerr << "[ERROR] --input-size must be a multiple of 32: " << out.inputSize << "\n";
+                ok = false;
+            }
+        } else if (arg == "--video-budget-ms") {
+            int budget = 0;
+            ok = readInt(argc, argv, i, 0, budget);
+            out.videoBudgetMs = budget;
+        } else if (arg == "--track-stride") {
+            ok = readInt(argc, argv, i, 0, out.trackStride);
+        } else if (arg == "--audit") {
+            ok = readValue(argc, argv, i, out.auditVideo);
+        } else if (arg == "--audit-stride") {
+            ok = readInt(argc, argv, i, 1, out.auditStride);
+        } else if (arg == "--calibrate") {
+            ok = readValue(argc, argv, i, out.calibrateDir);
+        } else if (arg == "--calib-from") {
+            std::string source;
+            ok = readValue(argc, argv, i, source);
+            if (ok) out.calibSources.push_back(source);
+        } else if (arg == "--calib-samples") {
+            ok = readInt(argc, argv, i, 1, out.calibSamples);
+        } else if (arg == "--perf") {
+            out.perfEnabled = true;
+        } else if (arg == "--perf-interval") {
+            ok = readInt(argc, argv, i, 1, out.perfIntervalSec);
+        } else if (arg == "--trace") {
+            ok = readValue(argc, argv, i, out.tracePath);
+        } else if (arg == "--trace-ort") {
+            out.traceOrt = true;
+        } else if (arg == "--record") {
+            ok = readValue(argc, argv, i, out.recordPath);
+        } else if (arg == "--replay") {
+            ok = readValue(argc, argv, i, out.replayPath);
+        } else if (arg == "--metrics-port") {
+            ok = readInt(argc, argv, i, 0, out.metricsPort);
+            if (ok && out.metricsPort > 65535) {
+                std::cerr << "[ERROR] Invalid value for --metrics-port: " << out.metricsPort << "\n";
+                ok = false;
+            }
+        } else {
+            std::cerr << "[ERROR] Unknown option: " << arg << "\n";
+            ok = false;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void printAppUsage(const char* argv0) {
+    std::cout
+        << "Usage: " << argv0 << " [options]\n"
+        << "  (no options)         Interactive login + before/after or video mode\n"
+        << "  --watch <dir>        Headless daemon: process <id>_before.* / <id>_after.*\n"
+        << "                       image pairs dropped into <dir>; finished pairs move\n"
+        << "                       to <dir>/processed (undecodable: <dir>/failed)\n"
+        << "  --results <dir>      Output folder for annotated images (default: results)\n"
+        << "  --alarm-sink <spec>  Publish alarm events off the session thread to a sink:\n"
+        << "                       file:<path> | unix:<path> | fifo:<path> |\n"
+        << "                       webhook:<port>[/path] | console (repeatable;\n"
+        << "                       console is always included)\n"
+        << "  --alarm-debounce-ms <ms>  Hold repeated alarms per stream this long (default: 300)\n"
+        << "  --archive-full       Write annotated images at full resolution instead of\n"
+        << "                       preview size (1920x1080 fit)\n"
+        << "  --archive <dir>      Archive sessions instead of writing annotated JPEGs:\n"
+        << "                       each distinct raw snapshot once (content-addressed,\n"
+        << "                       with a thumbnail) plus a compact detection index;\n"
+        << "                       overlays are drawn when a session is exported\n"
+        << "  --archive-segments   Pack each day's archived snapshots into one file\n"
+        << "  --archive-export <session>  Render an archived session from --archive into\n"
+        << "                       the --results folder and exit\n"
+        << "  --state <file>       Keep the last committed inventory and the session\n"
+        << "                       counter in a crash-safe mapped file; a restart\n"
+        << "                       continues the ids and skips re-detecting an\n"
+        << "                       unchanged first before snapshot\n"
+        << "  --log <file>         Log file (default: log.txt)\n"
+        << "  --user <name>        User name recorded in INVENTORY lines (default: daemon)\n"
+        << "  --workers <n>        Concurrent sessions in headless mode (default: #cores)\n"
+        << "  --poll-ms <ms>       Poll / file-settle interval (default: 500)\n"
+        << "  --poll               Use directory polling even if inotify is available\n"
+        << "  --once               Process the pairs already present, then exit\n"
+        << "  --camera <src>       Capture sessions live instead of t1.jpg / t2.jpg:\n"
+        << "                       /dev/videoN (or N), or an image folder / video file\n"
+        << "                       replayed as a fake camera\n"
+        << "  --cameras <file>     Several cameras per cabinet: one line per view with\n"
+        << "                       its source and a homography onto the cabinet plane;\n"
+        << "                       views are detected as one batch and fused\n"
+        << "  --camera-window-ms <ms>  Pick the sharpest frame this long after each door\n"
+        << "                       event (default: 300)\n"
+        << "  --slots <file>       Shadow board: decide slots (data/tools_config.txt\n"
+        << "                       layout) from cheap signatures, YOLO only when unsure\n"
+        << "  --slot-reference <img>  Stocked board for --slots (default: data/template.jpg)\n"
+        << "  --slot-empty <img>   Optional photo of the empty board for --slots\n"
+        << "  --server <socket>    Send detections to a running toolsdetect_server\n"
+        << "  --backend <name>     In-process inference backend: ort | opencv\n"
+        << "  --precision <p>      Model precision: auto | fp32 | int8 (default: auto,\n"
+        << "                       which uses <model>.int8.onnx when it exists)\n"
+        << "  --low-memory         For 4 GB cabinet PCs: convert the model to .ort once\n"
+        << "                       and memory-map it (weights shared between processes),\n"
+        << "                       share and shrink ONNX Runtime's arena, report RSS\n"
+        << "                       per session\n"
+        << "  --model-reload-ms <ms>  Load the model at startup and check it every <ms>;\n"
+        << "                       a replaced model is loaded and warmed up in the\n"
+        << "                       background and swapped in without a restart\n"
+        << "                       (replace it with a rename; default: off)\n"
+        << "  --lighting <mode>    Normalize lighting while preprocessing: off (default) |\n"
+        << "                       grayworld | patch:x,y,w,h (a grey reference in 0..1\n"
+        << "                       image coordinates)\n"
+        << "  --input-size <n>     Model input size for sessions, e.g. 960 (dynamic-shape\n"
+        << "                       models only; default: the model's own size)\n"
+        << "  --video-budget-ms <ms>  Video mode: adapt the input size (320..960) to keep\n"
+        << "                       detection under <ms> per frame\n"
+        << "  --track-stride <n>   Video mode: run the model every n-th frame and track\n"
+        << "                       tools (stable ids and counts) in between\n"
+        << "  --audit <video>      Audit a recorded video offline and exit: decode and\n"
+        << "                       detect on --workers threads, write per-frame\n"
+        << "                       detections and a per-minute inventory timeline\n"
+        << "                       to the --results folder\n"
+        << "  --audit-stride <n>   Audit every n-th frame only (default: 1)\n"
+        << "  --calibrate <dir>    Write INT8 calibration tensors to <dir> and exit\n"
+        << "  --calib-from <path>  Image folder, --archive folder or .tdrec recording to\n"
+        << "                       sample from (repeatable; default: the --record file\n"
+        << "                       and the --archive folder)\n"
+        << "  --calib-samples <n>  Most calibration samples to keep (default: 300)\n"
+        << "  --perf               Record per-stage latency histograms (PERF log lines)\n"
+        << "  --perf-interval <s>  Seconds between PERF summaries (default: 60)\n"
+        << "  --trace <file.json>  Write a Chrome/Perfetto timeline of sessions and stages\n"
+        << "  --trace-ort          Also merge ONNX Runtime's profiler into the timeline\n"
+        << "  --metrics-port <n>   Serve Prometheus metrics on 127.0.0.1:<n>/metrics\n"
+        << "  --record <file>      Record session/frame inputs, detections and timings\n"
+        << "  --replay <file>      Replay a recording as fast as possible and compare\n"
+        << "  -h, --help           Show this help\n";
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Command-line configuration for toolsdetect_test. Without any flags the
+// program keeps its original interactive behaviour (login + mode menu).
+struct AppOptions {
+    bool showHelp = false;
+
+    // Headless watch-folder daemon (--watch <dir>).
+    bool headless = false;
+    std::string watchDir;
+    std::string resultsDir = "results";
+    std::string logPath = "log.txt";
+    std::string username = "daemon";
+    int workers = 0;             // 0 = pick from hardware_concurrency()
+    int pollIntervalMs = 500;    // polling fallback / file-settle interval
+    bool forcePolling = false;   // skip inotify even where available
+    bool exitWhenIdle = false;   // process existing pairs, then stop
+
+    // Live camera for before/after sessions (--camera <dev|dir|video>):
+    // V4L2 device, or an image folder / video file as a fake camera.
+    std::string cameraSpec;
+    int cameraWindowMs = 300;   // sharpest-frame window after a door event
+    // Several cameras per cabinet (--cameras <rig file>, see camera_rig.h);
+    // overrides --camera.
+    std::string cameraRigPath;
+
+    // Shadow-board slot cascade (--slots <layout>): per-slot signatures
+    // against a stocked (and optionally an empty) reference image, YOLO only
+    // for ambiguous slots.
+    std::string slotsPath;
+    std::string slotReference = "data/template.jpg";
+    std::string slotEmptyReference;
+
+    // Shared inference server socket (--server <path>); empty = in-process.
+    std::string inferSocket;
+
+    // In-process inference backend (--backend ort|opencv); empty = default.
+    std::string backend;
+    // Model precision (--precision auto|fp32|int8).
+    std::string precision = "auto";
+    // Alarm event sinks (--alarm-sink, repeatable); empty = console only,
+    // printed on the session thread.
+    std::vector<std::string> alarmSinks;
+    // Per-class alarm debounce window (--alarm-debounce-ms).
+    int alarmDebounceMs = 300;
+    // Annotated result images at full resolution instead of preview size
+    // (--archive-full).
+    bool archiveFull = false;
+    // Deduplicated session archive instead of annotated JPEGs (--archive
+    // <dir>), optionally packed into daily segment files
+    // (--archive-segments). --archive-export <session> renders one archived
+    // session into the results folder and exits.
+    std::string archiveDir;
+    bool archiveSegments = false;
+    std::string archiveExport;
+    // Persistent cabinet state for instant restarts (--state <file>): last
+    // committed inventory and session counter; empty = off.
+    std::string statePath;
+    // Low-memory inference configuration (--low-memory).
+    bool lowMemory = false;
+    // Model hot-reload poll interval (--model-reload-ms); 0 = off.
+    int modelReloadMs = 0;
+    // Lighting normalization fused into preprocessing (--lighting
+    // off|grayworld|patch:x,y,w,h).
+    std::string lighting = "off";
+    // Input size for still-image sessions (--input-size, dynamic-shape
+    // models only); 0 = model default.
+    int inputSize = 0;
+    // Video mode latency target (--video-budget-ms); > 0 adapts the input
+    // size per frame.
+    double videoBudgetMs = 0.0;
+    // Video mode: full inference every N-th frame, tracker in between
+    // (--track-stride); 0 = detect every frame.
+    int trackStride = 0;
+
+    // Offline audit of a recorded video (--audit <file>): parallel decode +
+    // detection on --workers threads, logs written to the results folder.
+    std::string auditVideo;
+    int auditStride = 1;
+
+    // Dump static-quantization calibration tensors (--calibrate <out dir>)
+    // from images / recordings / archives given with --calib-from (default:
+    // the --record file and the --archive folder, when set).
+    std::string calibrateDir;
+    std::vector<std::string> calibSources;
+    int calibSamples = 300;
+
+    // Per-stage latency histograms (--perf), dumped to the log periodically.
+    bool perfEnabled = false;
+    int perfIntervalSec = 60;
+
+    // Chrome trace output (--trace <file.json>), optionally with ORT's
+    // profiler merged in (--trace-ort).
+    std::string tracePath;
+    bool traceOrt = false;
+
+    // Prometheus endpoint on 127.0.0.1:<port>/metrics; 0 = disabled.
+    int metricsPort = 0;
+
+    // Record session/frame inputs (--record <file.tdrec>) or replay such a
+    // recording headlessly and compare the results (--replay <file.tdrec>).
+    std::string recordPath;
+    std::string replayPath;
+};
+
+// Parses argv into `out`. Returns false (after printing the reason) on an
+// unknown flag or a missing/invalid value.
+bool parseAppOptions(int argc, char** argv, AppOptions& out);
+
+void printAppUsage(const char* argv0);
@@ -0,0 +1,702 @@
+// bench_main.cpp
+// toolsdetect_bench: micro-benchmarks of the detection stack on synthetic
+// inputs (no model needed) plus, with --model, end-to-end inference and
+// before/after session benchmarks on testimg.jpg / t2.jpg. The inference
+// benchmark runs once per detector backend over the same image set, so
+// runtimes can be compared side by side. With --labels, the FP32 model and
+// its INT8 (QDQ) sibling are compared for mAP and speed on a labelled folder.
+// Results are written as JSON so runs from different builds can be diffed.
+
+#include "detection_eval.h"
+#include "detector.h"
+#include "detector_backend.h"
+#include "inventory_compare.h"
+#include "inventory_session.h"
+#include "logger.h"
+#include "perf_stats.h"
+#include "run_control.h"
+#include "vision_pipeline.h"
+#include "yolo_common.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+    std::string modelPath;     // empty = micro-benchmarks only
+    std::string backends = "all";  // comma-separated backend names, or "all"
+    std::string imagesDir;     // inference image set; empty = testimg.jpg + t2.jpg
+    std::string labelsDir;     // labelled folder for the FP32 vs INT8 comparison
+    double maxMapDrop = 0.01;  // accuracy target for the INT8 model (mAP@0.5 points)
+    std::string filter;        // substring match on benchmark names
+    std::string outPath;       // empty = stdout
+    double minTimeMs = 500.0;
+    int minIterations = 10;
+    int warmup = 3;
+};
+
+struct BenchResult {
+    std::string name;
+    std::string note;
+    size_t iterations = 0;
+    double meanUs = 0.0;
+    double p50Us = 0.0;
+    double p99Us = 0.0;
+    double minUs = 0.0;
+    double maxUs = 0.0;
+    std::vector<perf::StageSummary> stages;   // macro benchmarks only
+    std::vector<std::pair<std::string, double>> values;   // e.g. accuracy
+};
+
+void printUsage(const char* argv0) {
+    std::cout
+        << "Usage: " << argv0 << " [options]\n"
+        << "  --model <file.onnx>   Also run end-to-end inference/session benchmarks\n"
+        << "  --backend <list>      Inference backends to compare: ort,opencv or all (default: all)\n"
+        << "  --images <dir>        Image set for the inference benchmark (default: testimg.jpg, t2.jpg)\n"
+        << "  --labels <dir>        Compare FP32 vs <model>.int8.onnx: mAP and speed on YOLO-labelled images\n"
+        << "  --max-map-drop <x>    Exit with 4 if INT8 mAP@0.5 is more than x below FP32 (default: 0.01)\n"
+        << "  --filter <text>       Only run benchmarks whose name contains <text>\n"
+        << "  --min-time-ms <ms>    Minimum measuring time per benchmark (default: 500)\n"
+        << "  --min-iters <n>       Minimum iterations per benchmark (default: 10)\n"
+        << "  --warmup <n>          Unmeasured warm-up iterations (default: 3)\n"
+        << "  --out <file.json>     Write results to a file instead of stdout\n";
+}
+
+// Keeps the optimizer from discarding a benchmark's result.
+template <typename T>
+void keepAlive(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out += ' ';
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+// Silences std::cout (session/logger chatter) while benchmarks run.
+class CoutSilencer {
+public:
+    CoutSilencer() : saved_(std::cout.rdbuf(sink_.rdbuf())) {}
+    ~CoutSilencer() { std::cout.rdbuf(saved_); }
+
+private:
+    std::ostringstream sink_;
+    std::streambuf* saved_;
+};
+
+class BenchRunner {
+public:
+    explicit BenchRunner(const BenchOptions& options) : options_(options) {}
+
+    bool selected(const std::string& name) const {
+        return options_.filter.empty() || name.find(options_.filter) != std::string::npos;
+    }
+
+    // Times `fn` per iteration until both minTimeMs and minIterations are met.
+    // With `withStages`, the per-stage histograms of the measured iterations
+    // are attached to the result.
+    void run(const std::string& name, const std::function<void()>& fn,
+             const std::string& note = std::string(), bool withStages = false) {
+        if (!selected(name)) return;
+        std::cerr << "[INFO] Running " << name << "...\n";
+
+        for (int i = 0; i < options_.warmup; ++i) fn();
+        if (withStages) {
+            perf::reset();
+            perf::setEnabled(true);
+        }
+
+        std::vector<double> samplesUs;
+        const auto t_begin = Clock::now();
+        while (samplesUs.size() < static_cast<size_t>(options_.minIterations) ||
+               std::chrono::duration<double, std::milli>(Clock::now() - t_begin).count() <
+                   options_.minTimeMs) {
+            const auto t0 = Clock::now();
+            fn();
+            samplesUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+        }
+
+        BenchResult r;
+        r.name = name;
+        r.note = note;
+        if (withStages) {
+            perf::setEnabled(false);
+            r.stages = perf::snapshot();
+        }
+        std::sort(samplesUs.begin(), samplesUs.end());
+        r.iterations = samplesUs.size();
+        for (double v : samplesUs) r.meanUs += v;
+        r.meanUs /= static_cast<double>(samplesUs.size());
+        r.p50Us = percentile(samplesUs, 0.50);
+        r.p99Us = percentile(samplesUs, 0.99);
+        r.minUs = samplesUs.front();
+        r.maxUs = samplesUs.back();
+        results_.push_back(std::move(r));
+    }
+
+    // Latest result for `name`, or nullptr if it did not run.
+    const BenchResult* find(const std::string& name) const {
+        for (auto it = results_.rbegin(); it != results_.rend(); ++it) {
+            if (it->name == name) return &*it;
+        }
+        return nullptr;
+    }
+
+    void addValue(const std::string& name, const std::string& key, double value) {
+        for (auto it = results_.rbegin(); it != results_.rend(); ++it) {
+            if (it->name == name) {
+                it->values.emplace_back(key, value);
+                return;
+            }
+        }
+    }
+
+    void skip(const std::string& name, const std::string& reason) {
+        if (!selected(name)) return;
+        std::cerr << "[WARN] Skipping " << name << ": " << reason << "\n";
+        skipped_.push_back({name, reason});
+    }
+
+    void writeJson(std::ostream& out) const {
+        std::time_t now = std::time(nullptr);
+        std::tm tm{};
+#if defined(_WIN32)
+        gmtime_s(&tm, &now);
+#else
+        gmtime_r(&now, &tm);
+#endif
+        out << std::fixed << std::setprecision(3);
+        out << "{\n"
+            << "  \"tool\": \"toolsdetect_bench\",\n"
+            << "  \"timestamp\": \"" << std::put_time(&tm, "%Y-%m-%dT%H:%M:%SZ") << "\",\n"
+            << "  \"build\": {\"compiler\": \"" << jsonEscape(compilerName()) << "\", \"opencv\": \""
+            << CV_VERSION << "\", \"perf_scopes\": " << TOOLSDETECT_ENABLE_PERF << "},\n"
+            << "  \"min_time_ms\": " << options_.minTimeMs << ",\n"
+            << "  \"benchmarks\": [";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const BenchResult& r = results_[i];
+            out << (i ? ",\n" : "\n")
+                << "    {\"name\": \"" << r.name << "\""
+                << ", \"iterations\": " << r.iterations
+                << ", \"mean_us\": " << r.meanUs
+                << ", \"p50_us\": " << r.p50Us
+                << ", \"p99_us\": " << r.p99Us
+                << ", \"min_us\": " << r.minUs
+                << ", \"max_us\": " << r.maxUs;
+            if (!r.note.empty()) out << ", \"note\": \"" << jsonEscape(r.note) << "\"";
+            for (const auto& v : r.values) {
+                out << ", \"" << v.first << "\": " << std::setprecision(4) << v.second
+                    << std::setprecision(3);
+            }
+            if (!r.stages.empty()) {
+                out << ", \"stages\": [";
+                for (size_t j = 0; j < r.stages.size(); ++j) {
+                    const auto& s = r.stages[j];
+                    out << (j ? ", " : "")
+                        << "{\"name\": \"" << s.name << "\", \"count\": " << s.count
+                        << ", \"mean_ms\": " << s.meanMs << ", \"p99_ms\": " << s.p99Ms << "}";
+                }
+                out << "]";
+            }
+            out << "}";
+        }
+        out << "\n  ],\n  \"skipped\": [";
+        for (size_t i = 0; i < skipped_.size(); ++i) {
+            out << (i ? ", " : "") << "{\"name\": \"" << skipped_[i].first
+                << "\", \"reason\": \"" << jsonEscape(skipped_[i].second) << "\"}";
+        }
+        out << "]\n}\n";
+    }
+
+private:
+    static std::string compilerName() {
+#if defined(__clang__)
+        return "clang " __clang_version__;
+#elif defined(__GNUC__)
+        return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+        return "msvc " + std::to_string(_MSC_VER);
+#else
+        return "unknown";
+#endif
+    }
+
+    const BenchOptions& options_;
+    std::vector<BenchResult> results_;
+    std::vector<std::pair<std::string, std::string>> skipped_;
+};
+
+// ---------------- synthetic inputs ----------------
+
+cv::Mat makeSyntheticFrame(int width, int height, unsigned seed) {
+    cv::Mat img(height, width, CV_8UC3);
+    cv::theRNG().state = seed;
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+    cv::GaussianBlur(img, img, cv::Size(9, 9), 0);
+    return img;
+}
+
+// Raw YOLO output in the Ultralytics [4 + classes, anchors] layout: mostly
+// low scores plus `objects` confident candidates, each repeated a few times
+// with jitter so NMS has work to do.
+std::vector<float> makeSyntheticYoloOutput(size_t numClasses, int anchors, int objects,
+                                           std::mt19937& rng) {
+    const size_t attrs = 4 + numClasses;
+    std::vector<float> out(attrs * static_cast<size_t>(anchors));
+    std::uniform_real_distribution<float> lowScore(0.0f, 0.2f);
+    std::uniform_real_distribution<float> coord(40.0f, 600.0f);
+    std::uniform_real_distribution<float> size(20.0f, 160.0f);
+    for (int a = 0; a < anchors; ++a) {
+        out[0 * anchors + a] = coord(rng);
+        out[1 * anchors + a] = coord(rng);
+        out[2 * anchors + a] = size(rng);
+        out[3 * anchors + a] = size(rng);
+        for (size_t c = 0; c < numClasses; ++c) out[(4 + c) * anchors + a] = lowScore(rng);
+    }
+    std::uniform_int_distribution<int> anchorPick(0, anchors - 1);
+    std::uniform_int_distribution<int> classPick(0, static_cast<int>(numClasses) - 1);
+    std::normal_distribution<float> jitter(0.0f, 3.0f);
+    for (int o = 0; o < objects; ++o) {
+        const float cx = coord(rng), cy = coord(rng), w = size(rng), h = size(rng);
+        const int cls = classPick(rng);
+        for (int k = 0; k < 5; ++k) {
+            const int a = anchorPick(rng);
+            out[0 * anchors + a] = cx + jitter(rng);
+            out[1 * anchors + a] = cy + jitter(rng);
+            out[2 * anchors + a] = w + jitter(rng);
+            out[3 * anchors + a] = h + jitter(rng);
+            out[(4 + cls) * anchors + a] = 0.6f + 0.05f * static_cast<float>(k);
+        }
+    }
+    return out;
+}
+
+DetectionResult makeSyntheticDetections(const std::vector<std::string>& classNames,
+                                        int count, std::mt19937& rng) {
+    DetectionResult det;
+    std::uniform_int_distribution<int> classPick(0, static_cast<int>(classNames.size()) - 1);
+    std::uniform_int_distribution<int> pos(0, 1200);
+    for (int i = 0; i < count; ++i) {
+        DetectedObject obj;
+        obj.cls = classNames[classPick(rng)];
+        obj.confidence = 0.8f;
+        obj.bbox = cv::Rect(pos(rng), pos(rng), 80, 40);
+        det.objects.push_back(obj);
+    }
+    return det;
+}
+
+// ---------------- benchmarks ----------------
+
+void runMicroBenchmarks(BenchRunner& runner, const fs::path& tempDir) {
+    std::mt19937 rng(1234);
+    const std::vector<std::string> classNames = getDefaultToolClassNames();
+
+    const cv::Mat frame = makeSyntheticFrame(1920, 1080, 1);
+    std::vector<float> tensor;
+    runner.run("micro/preprocess_1920x1080", [&]() {
+        preprocess(frame, tensor, kYoloInputWidth, kYoloInputHeight);
+        keepAlive(tensor);
+    });
+    LightingConfig grayWorld;
+    grayWorld.mode = LightingMode::GrayWorld;
+    setLightingNormalization(grayWorld);
+    runner.run("micro/preprocess_grayworld_1920x1080", [&]() {
+        preprocess(frame, tensor, kYoloInputWidth, kYoloInputHeight);
+        keepAlive(tensor);
+    });
+    setLightingNormalization(LightingConfig());
+    std::vector<uint8_t> bytes(3 * static_cast<size_t>(kYoloInputWidth) * kYoloInputHeight);
+    runner.run("micro/preprocess_u8_nchw_1920x1080", [&]() {
+        preprocessLetterboxU8(frame, bytes.data(), kYoloInputWidth, kYoloInputHeight,
+                              TensorLayout::NCHW);
+        keepAlive(bytes);
+    });
+    runner.run("micro/preprocess_u8_nhwc_1920x1080", [&]() {
+        preprocessLetterboxU8(frame, bytes.data(), kYoloInputWidth, kYoloInputHeight,
+                              TensorLayout::NHWC);
+        keepAlive(bytes);
+    });
+
+    const int anchors = 8400;
+    const std::vector<float> raw = makeSyntheticYoloOutput(classNames.size(), anchors, 40, rng);
+    const int64_t attrs = static_cast<int64_t>(4 + classNames.size());
+    runner.run("micro/decode_8400_anchors", [&]() {
+        auto dets = decodeYoloOutput(raw.data(), attrs, anchors, classNames.size(),
+                                     kYoloConfidenceThreshold, 1920, 1080,
+                                     kYoloInputWidth, kYoloInputHeight);
+        keepAlive(dets);
+    });
+
+    const std::vector<YoloResult> candidates =
+        decodeYoloOutput(raw.data(), attrs, anchors, classNames.size(), 0.3f, 1920, 1080,
+                         kYoloInputWidth, kYoloInputHeight);
+    runner.run("micro/nms", [&]() {
+        auto kept = nms(candidates, kYoloNmsThreshold);
+        keepAlive(kept);
+    }, std::to_string(candidates.size()) + " candidates");
+
+    // Same candidates as rotated boxes at random angles.
+    std::vector<YoloResult> rotated = candidates;
+    std::uniform_real_distribution<float> angle(-45.0f, 135.0f);
+    for (auto& r : rotated) {
+        r.oriented = true;
+        r.obb = cv::RotatedRect(cv::Point2f(r.box.x + r.box.width * 0.5f, r.box.y + r.box.height * 0.5f),
+                                cv::Size2f(static_cast<float>(r.box.width), static_cast<float>(r.box.height)),
+                                angle(rng));
+    }
+    runner.run("micro/nms_rotated", [&]() {
+        auto kept = nmsRotated(rotated, kYoloNmsThreshold);
+        keepAlive(kept);
+    }, std::to_string(rotated.size()) + " candidates");
+
+    const DetectionResult before = makeSyntheticDetections(classNames, 40, rng);
+    const DetectionResult after = makeSyntheticDetections(classNames, 38, rng);
+    runner.run("micro/compare_inventory_40", [&]() {
+        InventoryDelta delta = compareInventory(before, after);
+        keepAlive(delta);
+    });
+
+    cv::Mat diffBefore = makeSyntheticFrame(1280, 720, 2);
+    cv::Mat diffAfter = diffBefore.clone();
+    cv::rectangle(diffAfter, cv::Rect(200, 150, 180, 60), cv::Scalar(20, 20, 220), cv::FILLED);
+    cv::rectangle(diffAfter, cv::Rect(700, 400, 90, 220), cv::Scalar(220, 220, 20), cv::FILLED);
+    runner.run("micro/detect_tool_changes_1280x720", [&]() {
+        cv::Mat debugBinary;
+        cv::Mat debugVis;
+        auto blobs = detectToolChanges(diffBefore, diffAfter, debugBinary, debugVis);
+        keepAlive(blobs);
+    });
+
+    const fs::path logPath = tempDir / "bench_log.txt";
+    Logger logger(logPath.string());
+    const InventoryDelta delta = compareInventory(before, after);
+    const AlarmInfo alarm = evaluateAlarm(delta);
+    runner.run("micro/logger_inventory_delta", [&]() {
+        logger.logInventoryDelta("bench", delta, "2000-01-01#1", 42, alarm);
+    }, "includes file open/append per line");
+    std::error_code ec;
+    fs::remove(logPath, ec);
+}
+
+fs::path findDataFile(const std::string& name) {
+    for (fs::path dir = fs::current_path(); !dir.empty(); dir = dir.parent_path()) {
+        if (fs::exists(dir / name)) return dir / name;
+        if (dir == dir.parent_path()) break;
+    }
+    return name;
+}
+
+std::vector<cv::Mat> loadImageSet(const BenchOptions& options) {
+    std::vector<cv::Mat> images;
+    if (options.imagesDir.empty()) {
+        for (const char* name : {"testimg.jpg", "t2.jpg"}) {
+            cv::Mat img = cv::imread(findDataFile(name).string());
+            if (!img.empty()) images.push_back(img);
+        }
+        return images;
+    }
+    std::error_code ec;
+    std::vector<fs::path> paths;
+    for (const auto& entry : fs::directory_iterator(options.imagesDir, ec)) {
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    for (const auto& path : paths) {
+        cv::Mat img = cv::imread(path.string());
+        if (!img.empty()) images.push_back(img);
+    }
+    return images;
+}
+
+std::vector<std::string> requestedBackends(const std::string& list) {
+    if (list == "all") return availableDetectorBackends();
+    std::vector<std::string> names;
+    std::stringstream ss(list);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        if (!name.empty()) names.push_back(name);
+    }
+    return names;
+}
+
+// One macro/infer/<backend> benchmark per backend. Each iteration runs the
+// whole image set, so every backend sees exactly the same inputs.
+void runBackendBenchmarks(BenchRunner& runner, const BenchOptions& options) {
+    const std::vector<cv::Mat> images = loadImageSet(options);
+    const std::vector<std::string> backends = requestedBackends(options.backends);
+    if (images.empty()) {
+        runner.skip("macro/infer/", "no images found");
+        return;
+    }
+    if (backends.empty()) {
+        runner.skip("macro/infer/", "no detector backend compiled in");
+        return;
+    }
+
+    DetectorConfig config;
+    config.modelPath = utf8ToWide(options.modelPath);
+    const std::string note = std::to_string(images.size()) + " images per iteration";
+
+    std::vector<std::pair<std::string, size_t>> ran;   // backend, detections on the set
+    for (const auto& name : backends) {
+        const std::string benchName = "macro/infer/" + name;
+        if (!runner.selected(benchName)) continue;
+        try {
+            std::unique_ptr<DetectorBackend> backend = createDetectorBackend(name, config);
+            size_t detections = 0;
+            for (const auto& img : images) detections += backend->infer(img).size();
+            runner.run(benchName, [&]() {
+                for (const auto& img : images) {
+                    auto dets = backend->infer(img);
+                    keepAlive(dets);
+                }
+            }, note, true);
+            ran.emplace_back(name, detections);
+        } catch (const std::exception& ex) {
+            runner.skip(benchName, ex.what());
+        }
+    }
+    if (ran.empty()) return;
+
+    // Side-by-side summary on stderr (stdout may carry the JSON).
+    const double perImage = static_cast<double>(images.size());
+    std::cerr << "\n[RESULT] Inference latency per image (" << images.size() << " images)\n"
+              << std::left << std::setw(10) << "backend" << std::right
+              << std::setw(12) << "mean ms" << std::setw(12) << "p50 ms"
+              << std::setw(12) << "p99 ms" << std::setw(12) << "img/s"
+              << std::setw(12) << "dets" << "\n";
+    std::cerr << std::fixed << std::setprecision(2);
+    for (const auto& entry : ran) {
+        const BenchResult* r = runner.find("macro/infer/" + entry.first);
+        if (!r) continue;
+        const double meanMs = r->meanUs / 1000.0 / perImage;
+        std::cerr << std::left << std::setw(10) << entry.first << std::right
+                  << std::setw(12) << meanMs
+                  << std::setw(12) << r->p50Us / 1000.0 / perImage
+                  << std::setw(12) << r->p99Us / 1000.0 / perImage
+                  << std::setw(12) << (meanMs > 0.0 ? 1000.0 / meanMs : 0.0)
+                  << std::setw(12) << entry.second << "\n";
+    }
+    std::cerr.unsetf(std::ios::floatfield);
+}
+
+// FP32 model vs its INT8 sibling on a labelled folder: mAP of both and the
+// speedup. Returns false if the INT8 model misses the accuracy target.
+bool runQuantComparison(BenchRunner& runner, const BenchOptions& options) {
+    const std::vector<LabelledImage> labelled = loadLabelledFolder(options.labelsDir);
+    if (labelled.empty()) {
+        runner.skip("macro/quant/", "no labelled images in " + options.labelsDir);
+        return true;
+    }
+    std::vector<cv::Mat> images;
+    for (const auto& item : labelled) images.push_back(cv::imread(item.imagePath));
+
+    // ORT is where QDQ models are accelerated; fall back to whatever exists.
+    const auto available = availableDetectorBackends();
+    if (available.empty()) {
+        runner.skip("macro/quant/", "no detector backend compiled in");
+        return true;
+    }
+    const std::string backendName =
+        std::find(available.begin(), available.end(), "ort") != available.end() ? "ort" : available.front();
+
+    struct Variant {
+        const char* name;
+        ModelPrecision precision;
+        double map50 = -1.0;
+        double map5095 = -1.0;
+        double meanMsPerImage = 0.0;
+    };
+    Variant variants[] = {{"fp32", ModelPrecision::Fp32}, {"int8", ModelPrecision::Int8}};
+    const std::string note = std::to_string(images.size()) + " labelled images per iteration, " +
+                             backendName + " backend";
+
+    for (auto& variant : variants) {
+        const std::string benchName = std::string("macro/quant/") + variant.name;
+        if (!runner.selected(benchName)) continue;
+        DetectorConfig config;
+        config.modelPath = utf8ToWide(options.modelPath);
+        config.precision = variant.precision;
+        config.confThreshold = 0.01f;   // full PR curve for mAP; same for both variants
+        try {
+            std::unique_ptr<DetectorBackend> backend = createDetectorBackend(backendName, config);
+            std::vector<EvalSample> samples(images.size());
+            for (size_t i = 0; i < images.size(); ++i) {
+                samples[i].truth = labelled[i].truth;
+                samples[i].predictions = backend->infer(images[i]);
+            }
+            variant.map50 = meanAveragePrecision(samples, 0.5f);
+            variant.map5095 = meanAveragePrecision50To95(samples);
+            runner.run(benchName, [&]() {
+                for (const auto& img : images) {
+                    auto dets = backend->infer(img);
+                    keepAlive(dets);
+                }
+            }, note, true);
+            runner.addValue(benchName, "map50", variant.map50);
+            runner.addValue(benchName, "map50_95", variant.map5095);
+            if (const BenchResult* r = runner.find(benchName)) {
+                variant.meanMsPerImage = r->meanUs / 1000.0 / static_cast<double>(images.size());
+            }
+        } catch (const std::exception& ex) {
+            runner.skip(benchName, ex.what());
+        }
+    }
+
+    const Variant& fp32 = variants[0];
+    const Variant& int8 = variants[1];
+    if (fp32.map50 < 0.0 || int8.map50 < 0.0) return true;
+
+    const double drop = fp32.map50 - int8.map50;
+    const bool ok = drop <= options.maxMapDrop;
+    std::cerr << std::fixed << std::setprecision(4)
+              << "\n[RESULT] INT8 vs FP32 on " << images.size() << " labelled images (" << backendName << ")\n"
+              << "  mAP@0.5       fp32 " << fp32.map50 << "  int8 " << int8.map50
+              << "  delta " << -drop << "\n"
+              << "  mAP@0.5:0.95  fp32 " << fp32.map5095 << "  int8 " << int8.map5095
+              << "  delta " << int8.map5095 - fp32.map5095 << "\n"
+              << std::setprecision(2)
+              << "  latency/img   fp32 " << fp32.meanMsPerImage << " ms  int8 " << int8.meanMsPerImage
+              << " ms  speedup "
+              << (int8.meanMsPerImage > 0.0 ? fp32.meanMsPerImage / int8.meanMsPerImage : 0.0) << "x\n"
+              << (ok ? "  within" : "  [WARN] exceeds") << " accuracy target (max mAP@0.5 drop "
+              << options.maxMapDrop << ")\n";
+    std::cerr.unsetf(std::ios::floatfield);
+    return ok;
+}
+
+void runMacroBenchmarks(BenchRunner& runner, const BenchOptions& options, const fs::path& tempDir) {
+    runBackendBenchmarks(runner, options);
+
+    const cv::Mat imgBefore = cv::imread(findDataFile("testimg.jpg").string());
+    const cv::Mat imgAfter = cv::imread(findDataFile("t2.jpg").string());
+    if (imgBefore.empty() || imgAfter.empty()) {
+        runner.skip("macro/session_testimg_t2", "testimg.jpg / t2.jpg not found");
+        return;
+    }
+
+    setLocalModelPath(options.modelPath);
+    const fs::path resultsDir = tempDir / "results";
+    std::error_code ec;
+    fs::create_directories(resultsDir, ec);
+    Logger logger((tempDir / "bench_session_log.txt").string());
+    int sessionCounter = 0;
+    runner.run("macro/session_testimg_t2", [&]() {
+        auto result = processInventorySession(imgBefore, imgAfter,
+                                              "bench#" + std::to_string(++sessionCounter),
+                                              "bench", logger, resultsDir.string());
+        keepAlive(result);
+    }, "detect x2 + compare + log + draw + imwrite", true);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--model" && hasValue) {
+            options.modelPath = argv[++i];
+        } else if (arg == "--backend" && hasValue) {
+            options.backends = argv[++i];
+        } else if (arg == "--images" && hasValue) {
+            options.imagesDir = argv[++i];
+        } else if (arg == "--labels" && hasValue) {
+            options.labelsDir = argv[++i];
+        } else if (arg == "--max-map-drop" && hasValue) {
+            options.maxMapDrop = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--filter" && hasValue) {
+            options.filter = argv[++i];
+        } else if (arg == "--out" && hasValue) {
+            options.outPath = argv[++i];
+        } else if (arg == "--min-time-ms" && hasValue) {
+            options.minTimeMs = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--min-iters" && hasValue) {
+            options.minIterations = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--warmup" && hasValue) {
+            options.warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "[ERROR] Unknown or incomplete option: " << arg << "\n";
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::error_code ec;
+    const fs::path tempDir = fs::temp_directory_path(ec) / "toolsdetect_bench";
+    fs::create_directories(tempDir, ec);
+
+    BenchRunner runner(options);
+    bool accuracyOk = true;
+    {
+        CoutSilencer quiet;
+        runMicroBenchmarks(runner, tempDir);
+        if (!options.modelPath.empty()) {
+            runMacroBenchmarks(runner, options, tempDir);
+            if (!options.labelsDir.empty()) {
+                accuracyOk = runQuantComparison(runner, options);
+            }
+        } else {
+            runner.skip("macro/", "no --model given");
+        }
+    }
+    fs::remove_all(tempDir, ec);
+
+    if (options.outPath.empty()) {
+        runner.writeJson(std::cout);
+    } else {
+        std::ofstream out(options.outPath);
+        if (!out.is_open()) {
+            std::cerr << "[ERROR] Cannot write " << options.outPath << "\n";
+            return 1;
+        }
+        runner.writeJson(out);
+        std::cerr << "[INFO] Results written to " << options.outPath << "\n";
+    }
+    return accuracyOk ? 0 : 4;
+}
@@ -0,0 +1,319 @@
+#include "cabinet_state.h"
+
+#include "detection_codec.h"
+#include "metrics.h"
+#include "perf_stats.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[4] = {'T', 'D', 'C', 'S'};
+constexpr uint32_t kVersion = 1;
+// Header and slots are page-aligned so a slot flush never touches the other.
+constexpr size_t kHeaderBytes = 4096;
+constexpr size_t kSlotBytes = 64 * 1024;
+constexpr size_t kSlotHeaderBytes = sizeof(uint64_t) + 2 * sizeof(uint32_t);
+constexpr size_t kFileBytes = kHeaderBytes + 2 * kSlotBytes;
+
+std::atomic<CabinetStateStore*> g_activeState{nullptr};
+
+uint32_t crc32(const char* data, size_t size, uint32_t crc = 0) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+std::vector<char> encodeState(const CabinetState& s, bool withSignature) {
+    ByteWriter w;
+    w.str(s.day);
+    w.pod(static_cast<int32_t>(s.dailyCounter));
+    w.str(s.sessionId);
+    w.pod(static_cast<int64_t>(s.wallTimeMs));
+    w.pod(static_cast<uint32_t>(s.counts.size()));
+    for (const auto& [cls, count] : s.counts) {
+        w.str(cls);
+        w.pod(static_cast<int32_t>(count));
+    }
+    writeDetections(w, s.afterDet);
+    w.pod(static_cast<int32_t>(s.afterSize.width));
+    w.pod(static_cast<int32_t>(s.afterSize.height));
+    if (withSignature && !s.afterSignature.empty() && s.afterSignature.isContinuous()) {
+        w.bytes(s.afterSignature.data, s.afterSignature.total());
+    } else {
+        w.bytes(nullptr, 0);
+    }
+    return w.buffer();
+}
+
+bool decodeState(const char* data, size_t size, CabinetState& s) {
+    ByteReader r(data, size);
+    int32_t counter = 0;
+    int64_t wallMs = 0;
+    uint32_t n = 0;
+    if (!r.str(s.day) || !r.pod(counter) || !r.str(s.sessionId) || !r.pod(wallMs) || !r.pod(n)) {
+        return false;
+    }
+    s.dailyCounter = counter;
+    s.wallTimeMs = wallMs;
+    s.counts.clear();
+    for (uint32_t i = 0; i < n; ++i) {
+        std::string cls;
+        int32_t count = 0;
+        if (!r.str(cls) || !r.pod(count)) return false;
+        s.counts[cls] = count;
+    }
+    int32_t width = 0, height = 0;
+    std::vector<uint8_t> signature;
+    if (!readDetections(r, s.afterDet) || !r.pod(width) || !r.pod(height) || !r.bytes(signature)) {
+        return false;
+    }
+    s.afterSize = cv::Size(width, height);
+    s.afterSignature.release();
+    if (signature.size() == static_cast<size_t>(kSignatureSize.area())) {
+        s.afterSignature = cv::Mat(kSignatureSize, CV_8UC1, signature.data()).clone();
+    }
+    return true;
+}
+
+// Orders "<day>#<n>" ids; false if `id` is not one.
+bool parseSessionId(const std::string& id, std::string& day, long& n) {
+    const size_t hash = id.rfind('#');
+    if (hash == std::string::npos || hash + 1 == id.size() ||
+        id.find_first_not_of("0123456789", hash + 1) != std::string::npos) {
+        return false;
+    }
+    day = id.substr(0, hash);
+    n = std::strtol(id.c_str() + hash + 1, nullptr, 10);
+    return true;
+}
+
+// True unless both ids are "<day>#<n>" and `id` does not come after
+// `committed`. Other ids (sessions named by the caller) commit in arrival
+// order.
+bool newerSession(const std::string& id, const std::string& committed) {
+    std::string day, committedDay;
+    long n = 0, committedN = 0;
+    if (!parseSessionId(id, day, n) || !parseSessionId(committed, committedDay, committedN)) {
+        return true;
+    }
+    return day != committedDay ? day > committedDay : n > committedN;
+}
+
+int64_t wallClockMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+}  // namespace
+
+bool CabinetStateStore::open(const std::string& path) {
+    const auto t0 = std::chrono::steady_clock::now();
+    path_ = path;
+
+    // Never clobber a file that is not ours (e.g. a mistyped --state): the
+    // magic is checked once the file is locked, the rest of the header below
+    // from the mapping.
+    if (!file_.openWritable(path, kFileBytes, std::string(kMagic, sizeof(kMagic)))) {
+        return false;
+    }
+    char* base = static_cast<char*>(file_.mutableData());
+    uint32_t version = 0;
+    uint32_t slotBytes = 0;
+    std::memcpy(&version, base + 4, sizeof(version));
+    std::memcpy(&slotBytes, base + 8, sizeof(slotBytes));
+    if (std::memcmp(base, kMagic, sizeof(kMagic)) != 0 || version != kVersion || slotBytes != kSlotBytes) {
+        if (std::memcmp(base, kMagic, sizeof(kMagic)) == 0) {
+            std::cerr << "[WARN] " << path << " has state format " << version
+                      << "; starting with an empty cabinet state.\n";
+        }
+        std::memset(base, 0, kFileBytes);
+        std::memcpy(base, kMagic, sizeof(kMagic));
+        std::memcpy(base + 4, &kVersion, sizeof(kVersion));
+        const uint32_t slot = kSlotBytes;
+        std::memcpy(base + 8, &slot, sizeof(slot));
+        if (!file_.flush(0, kFileBytes)) {
+            std::cerr << "[ERROR] Cannot write " << path << "\n";
+            file_.close();
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    restored_ = load();
+    const double us =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    if (restored_) {
+        int tools = 0;
+        for (const auto& entry : state_.counts) tools += entry.second;
+        std::cout << "[INFO] Restored cabinet state from " << path << ": last session "
+                  << state_.sessionId << ", " << tools << " tools, counter " << state_.day << "#"
+                  << state_.dailyCounter << " (" << static_cast<long long>(us) << " us)\n";
+    } else {
+        std::cout << "[INFO] Cabinet state: " << path << " (no committed state yet)\n";
+    }
+    return true;
+}
+
+bool CabinetStateStore::load() {
+    const char* base = static_cast<const char*>(file_.data());
+    bool found = false;
+    for (int slot = 0; slot < 2; ++slot) {
+        const char* p = base + kHeaderBytes + slot * kSlotBytes;
+        uint64_t sequence = 0;
+        uint32_t bytes = 0;
+        uint32_t crc = 0;
+        std::memcpy(&sequence, p, sizeof(sequence));
+        std::memcpy(&bytes, p + 8, sizeof(bytes));
+        std::memcpy(&crc, p + 12, sizeof(crc));
+        if (sequence == 0 || bytes > kSlotBytes - kSlotHeaderBytes ||
+            (found && sequence <= sequence_)) {
+            continue;
+        }
+        uint32_t expect = crc32(p, 12);
+        expect = crc32(p + kSlotHeaderBytes, bytes, expect);
+        CabinetState state;
+        if (expect != crc || !decodeState(p + kSlotHeaderBytes, bytes, state)) {
+            std::cerr << "[WARN] Cabinet state slot " << slot << " in " << path_
+                      << " is damaged; ignoring it.\n";
+            continue;
+        }
+        state_ = std::move(state);
+        sequence_ = sequence;
+        found = true;
+    }
+    return found;
+}
+
+void CabinetStateStore::persistLocked() {
+    TD_PERF_SCOPE("state.commit");
+    std::vector<char> payload = encodeState(state_, true);
+    if (payload.size() > kSlotBytes - kSlotHeaderBytes) {
+        payload = encodeState(state_, false);
+    }
+    if (payload.size() > kSlotBytes - kSlotHeaderBytes) {
+        std::cerr << "[WARN] Cabinet state (" << payload.size() << " bytes) does not fit a "
+                  << kSlotBytes << "-byte slot; not persisted.\n";
+        return;
+    }
+
+    // The slot not holding the newest state; its CRC only matches once the
+    // whole slot is written.
+    const uint64_t sequence = sequence_ + 1;
+    const size_t offset = kHeaderBytes + (sequence % 2) * kSlotBytes;
+    char* p = static_cast<char*>(file_.mutableData()) + offset;
+    const uint32_t bytes = static_cast<uint32_t>(payload.size());
+    std::memcpy(p, &sequence, sizeof(sequence));
+    std::memcpy(p + 8, &bytes, sizeof(bytes));
+    std::memcpy(p + kSlotHeaderBytes, payload.data(), payload.size());
+    uint32_t crc = crc32(p, 12);
+    crc = crc32(payload.data(), payload.size(), crc);
+    std::memcpy(p + 12, &crc, sizeof(crc));
+    if (!file_.flush(offset, kSlotHeaderBytes + payload.size())) {
+        std::cerr << "[WARN] Cannot flush cabinet state to " << path_ << "\n";
+    }
+    sequence_ = sequence;
+}
+
+std::string CabinetStateStore::nextSessionId(const std::string& today) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (today != state_.day) {
+        state_.day = today;
+        state_.dailyCounter = 1;
+    } else {
+        state_.dailyCounter += 1;
+    }
+    return state_.day + "#" + std::to_string(state_.dailyCounter);
+}
+
+void CabinetStateStore::commitSession(const std::string& sessionId,
+                                      const DetectionResult& afterDet,
+                                      const cv::Mat& afterImage) {
+    cv::Mat signature = coarseSignature(afterImage);
+    std::map<std::string, int> counts;
+    for (const auto& obj : afterDet.objects) {
+        counts[obj.cls] += 1;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Pipelined sessions can finish out of order; a late one must not roll
+    // the committed cabinet back.
+    if (!newerSession(sessionId, state_.sessionId)) {
+        std::cout << "[INFO] Session " << sessionId << " finished after " << state_.sessionId
+                  << "; keeping the newer cabinet state.\n";
+        return;
+    }
+    state_.sessionId = sessionId;
+    state_.wallTimeMs = wallClockMs();
+    state_.counts = std::move(counts);
+    state_.afterDet = afterDet;
+    state_.afterSize = afterImage.size();
+    state_.afterSignature = signature;
+    if (file_.isOpen()) {
+        persistLocked();
+    }
+}
+
+bool CabinetStateStore::reuseBefore(const cv::Mat& before, DetectionResult& out) {
+    static metrics::Counter& reused = metrics::counter(
+        "toolsdetect_state_before_reused_total",
+        "First sessions after a restart that reused the persisted after detections");
+
+    CabinetState state;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (reuseAsked_ || !restored_) {
+            reuseAsked_ = true;
+            return false;
+        }
+        reuseAsked_ = true;
+        if (state_.afterSignature.empty() || state_.afterSize != before.size()) {
+            return false;
+        }
+        state = state_;
+    }
+    const cv::Mat coarse = coarseSignature(before);
+    if (coarse.empty() || cv::norm(coarse, state.afterSignature, cv::NORM_INF) > kNearDuplicateMaxDiff) {
+        std::cout << "[INFO] Cabinet changed since session " << state.sessionId
+                  << "; detecting the before snapshot.\n";
+        return false;
+    }
+    out = std::move(state.afterDet);
+    reused.inc();
+    std::cout << "[INFO] Before snapshot matches session " << state.sessionId
+              << "; reusing its committed detections.\n";
+    return true;
+}
+
+CabinetState CabinetStateStore::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return state_;
+}
+
+void setActiveCabinetState(CabinetStateStore* store) {
+    g_activeState.store(store);
+}
+
+CabinetStateStore* activeCabinetState() {
+    return g_activeState.load();
+}
@@ -0,0 +1,102 @@
+// cabinet_state.h
+// Persistent cabinet state (--state <file>) for an instant restart.
+//
+// After every session the last committed inventory is written to a small
+// memory-mapped file: the fused "after" detections, the per-class counts, a
+// coarse signature of the after snapshot and the session counter with its
+// day. On start-up the file is mapped and validated in microseconds, so
+// session ids continue ("2025-11-16#7" after "#6", never a second "#1") and
+// the first session after a restart does not need to re-detect its "before"
+// snapshot when the cabinet still looks like the last committed "after".
+//
+// The file has a fixed size and two slots; a commit writes the slot that
+// does not hold the newest state and flushes it, so a crash or power loss
+// mid-write leaves the previous state intact. Layout, little-endian:
+//
+//   header (kHeaderBytes): "TDCS" u32 version u32 slot_bytes
+//   slot * 2 (slot_bytes each):
+//       u64 sequence u32 payload_bytes u32 crc32(sequence..payload) payload
+//   payload := str day, i32 daily_counter, str session, i64 wall_ms,
+//              u32 n, (str cls, i32 count)*n, detections after,
+//              i32 width, i32 height, u32 bytes, signature bytes
+//   detections := as in detection_codec.h
+//   str := u32 bytes, utf-8 bytes
+
+#pragma once
+
+#include "detector.h"
+#include "mapped_file.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+struct CabinetState {
+    std::string day;            // YYYY-MM-DD of the session counter
+    int dailyCounter = 0;       // last session number handed out on `day`
+    std::string sessionId;      // last committed session
+    int64_t wallTimeMs = 0;     // when it was committed
+    std::map<std::string, int> counts;   // per-class counts of afterDet
+    DetectionResult afterDet;
+    cv::Size afterSize;         // size of the after snapshot
+    cv::Mat afterSignature;     // coarse grey signature; empty for multi-view sessions
+};
+
+class CabinetStateStore {
+public:
+    CabinetStateStore() = default;
+
+    CabinetStateStore(const CabinetStateStore&) = delete;
+    CabinetStateStore& operator=(const CabinetStateStore&) = delete;
+
+    // Maps `path` (created if missing), locked against other processes, and
+    // restores the newest valid slot. Returns false (after printing why) if
+    // the file cannot be used or another process holds it; a file that is
+    // not a state file is left untouched.
+    bool open(const std::string& path);
+
+    // Next "<today>#<n>" session id; the counter restarts at 1 on a new day.
+    // The counter is persisted by the session's commit, which comes before
+    // its INVENTORY line, so each session costs one flush and a logged id is
+    // never handed out twice; the id of a session that died before its
+    // commit is handed out again after a restart.
+    std::string nextSessionId(const std::string& today);
+
+    // Records the result of a finished session and flushes it. A session
+    // older than the committed one ("<day>#<n>" ids) is ignored. `afterImage`
+    // may be empty (multi-view sessions); then the next "before" is always
+    // detected.
+    void commitSession(const std::string& sessionId,
+                       const DetectionResult& afterDet,
+                       const cv::Mat& afterImage);
+
+    // If `before` shows the cabinet as it was committed last (same size, no
+    // signature cell off by more than sensor noise), copies the committed
+    // detections into `out` and returns true. Only the first session after
+    // open() asks; later "before" snapshots are detected as usual.
+    bool reuseBefore(const cv::Mat& before, DetectionResult& out);
+
+    CabinetState snapshot() const;
+
+private:
+    bool load();
+    void persistLocked();
+
+    std::string path_;
+    MappedFile file_;
+    mutable std::mutex mutex_;   // state below and the slot writes
+    CabinetState state_;
+    uint64_t sequence_ = 0;      // sequence of the newest slot
+    bool restored_ = false;      // state came from the file
+    bool reuseAsked_ = false;
+};
+
+// Process-wide state store used by runBeforeAfterSessions() for session ids
+// and by processInventorySession() / processMultiViewSession() to commit
+// results; nullptr (default) keeps everything in memory. The caller keeps
+// ownership.
+void setActiveCabinetState(CabinetStateStore* store);
+CabinetStateStore* activeCabinetState();
@@ -0,0 +1,191 @@
+#include "calibration.h"
+
+#include "result_archive.h"
+#include "session_recording.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// Called once per candidate image, in a stable order. `decode` loads the
+// pixels on demand so the selection pass can skip most of the work.
+using ImageVisitor = std::function<void(const std::string& label,
+                                        const std::function<cv::Mat()>& decode)>;
+
+bool isImageFile(const fs::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp";
+}
+
+// A --archive folder: raw snapshots keyed from an index folder.
+bool isResultArchive(const std::string& dir) {
+    std::error_code ec;
+    return fs::is_directory(fs::path(dir) / "index", ec) &&
+           (fs::is_directory(fs::path(dir) / "objects", ec) || fs::is_directory(fs::path(dir) / "segments", ec));
+}
+
+void visitSources(const std::vector<std::string>& sources, const ImageVisitor& visit) {
+    for (const auto& source : sources) {
+        std::error_code ec;
+        if (isResultArchive(source)) {
+            for (const auto& key : listArchivedSnapshots(source)) {
+                visit(source + "#" + key, [&source, &key]() { return loadArchivedSnapshot(source, key); });
+            }
+            continue;
+        }
+        if (fs::is_directory(source, ec)) {
+            std::vector<fs::path> paths;
+            for (const auto& entry : fs::directory_iterator(source, ec)) {
+                if (entry.is_regular_file() && isImageFile(entry.path())) {
+                    paths.push_back(entry.path());
+                }
+            }
+            std::sort(paths.begin(), paths.end());
+            for (const auto& path : paths) {
+                visit(path.string(), [&path]() { return cv::imread(path.string()); });
+            }
+            continue;
+        }
+
+        RecordingReader reader;
+        if (!reader.open(source)) {
+            std::cerr << "[WARN] Skipping calibration source " << source
+                      << " (not a folder or readable recording).\n";
+            continue;
+        }
+        RecordedEntry entry;
+        size_t index = 0;
+        while (reader.next(entry)) {
+            for (size_t i = 0; i < entry.images.size(); ++i) {
+                const auto& bytes = entry.images[i];
+                visit(source + "#" + std::to_string(index) + "/" + std::to_string(i),
+                      [&bytes]() { return cv::imdecode(bytes, cv::IMREAD_COLOR); });
+            }
+            ++index;
+        }
+    }
+}
+
+cv::Mat thumbnail(const cv::Mat& img) {
+    cv::Mat gray;
+    cv::Mat small;
+    cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
+    cv::resize(gray, small, cv::Size(32, 32), 0, 0, cv::INTER_AREA);
+    return small;
+}
+
+// NPY v1.0: magic, version, u16 header length, python-dict header padded
+// with spaces to a multiple of 64 bytes, then raw little-endian data.
+bool writeNpy(const std::string& path, const float* data, const std::vector<int>& shape) {
+    std::ostringstream header;
+    header << "{'descr': '<f4', 'fortran_order': False, 'shape': (";
+    size_t count = 1;
+    for (size_t i = 0; i < shape.size(); ++i) {
+        header << (i ? ", " : "") << shape[i];
+        count *= static_cast<size_t>(shape[i]);
+    }
+    header << "), }";
+    std::string text = header.str();
+    const size_t unpadded = 10 + text.size() + 1;
+    text.append((64 - unpadded % 64) % 64, ' ');
+    text += '\n';
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) return false;
+    const char magic[] = {'\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0};
+    out.write(magic, sizeof(magic));
+    const uint16_t headerLen = static_cast<uint16_t>(text.size());
+    const char lenBytes[] = {static_cast<char>(headerLen & 0xff), static_cast<char>(headerLen >> 8)};
+    out.write(lenBytes, 2);
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(count * sizeof(float)));
+    return static_cast<bool>(out);
+}
+
+}  // namespace
+
+int runCalibrationDump(const CalibrationOptions& options) {
+    std::error_code ec;
+    fs::create_directories(options.outDir, ec);
+    if (!fs::is_directory(options.outDir, ec)) {
+        std::cerr << "[ERROR] Cannot create calibration folder " << options.outDir << "\n";
+        return 1;
+    }
+
+    // Pass 1: drop near-duplicates, remember which candidates are distinct.
+    std::vector<size_t> distinct;
+    size_t total = 0;
+    cv::Mat lastThumb;
+    visitSources(options.sources, [&](const std::string&, const std::function<cv::Mat()>& decode) {
+        const size_t index = total++;
+        cv::Mat img = decode();
+        if (img.empty()) return;
+        cv::Mat thumb = thumbnail(img);
+        if (!lastThumb.empty() && cv::norm(thumb, lastThumb, cv::NORM_L1) / thumb.total() <
+                                      options.duplicateThreshold) {
+            return;
+        }
+        lastThumb = thumb;
+        distinct.push_back(index);
+    });
+    if (distinct.empty()) {
+        std::cerr << "[ERROR] No usable calibration images found.\n";
+        return 1;
+    }
+
+    // Evenly spaced subset, so every part of the history is represented.
+    std::vector<size_t> chosen;
+    const size_t keep = std::min(distinct.size(), static_cast<size_t>(options.maxSamples));
+    for (size_t i = 0; i < keep; ++i) {
+        chosen.push_back(distinct[i * distinct.size() / keep]);
+    }
+
+    // Pass 2: preprocess exactly like inference and write the tensors.
+    std::ofstream manifest((fs::path(options.outDir) / "manifest.txt").string());
+    manifest << "# input " << options.inputWidth << "x" << options.inputHeight
+             << " letterbox RGB 0..1, float32 [1,3,H,W]\n";
+    const std::vector<int> shape = {1, 3, options.inputHeight, options.inputWidth};
+    std::vector<float> tensor;
+    size_t index = 0;
+    size_t next = 0;
+    size_t written = 0;
+    bool ok = true;
+    visitSources(options.sources, [&](const std::string& label, const std::function<cv::Mat()>& decode) {
+        const size_t current = index++;
+        if (!ok || next >= chosen.size() || chosen[next] != current) return;
+        ++next;
+        cv::Mat img = decode();
+        if (img.empty()) return;
+        preprocess(img, tensor, options.inputWidth, options.inputHeight);
+        std::ostringstream name;
+        name << "calib_" << std::setw(5) << std::setfill('0') << written << ".npy";
+        if (!writeNpy((fs::path(options.outDir) / name.str()).string(), tensor.data(), shape)) {
+            std::cerr << "[ERROR] Failed to write " << name.str() << "\n";
+            ok = false;
+            return;
+        }
+        manifest << name.str() << " " << label << "\n";
+        ++written;
+    });
+    if (!ok) return 1;
+
+    std::cout << "[INFO] Calibration: " << total << " images scanned, " << distinct.size()
+              << " distinct, " << written << " samples written to " << options.outDir << "\n"
+              << "[INFO] Next: python tools/quantize_int8.py --model <model.onnx> --calib "
+              << options.outDir << "\n";
+    return written > 0 ? 0 : 1;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "yolo_common.h"
+
+#include <string>
+#include <vector>
+
+// On-site calibration data for static INT8 quantization (--calibrate).
+//
+// Frames are gathered from raw inputs: .tdrec recordings, --archive folders
+// (the stored snapshots carry no overlays) and image folders such as a watch
+// folder's processed/ pairs. The annotated JPEGs in the results folder are
+// not suitable: the drawn boxes and labels would skew the activation ranges.
+// Near-duplicates (a cabinet that did not change between sessions) are
+// dropped, and an evenly spaced subset is run through the same letterbox
+// preprocessing as inference. Each sample is written as a
+// float32 [1,3,H,W] .npy file plus manifest.txt, which
+// tools/quantize_int8.py feeds to onnxruntime.quantization.
+struct CalibrationOptions {
+    std::vector<std::string> sources;   // folders, archive folders and/or .tdrec files
+    std::string outDir;
+    int maxSamples = 300;
+    int inputWidth = kYoloInputWidth;
+    int inputHeight = kYoloInputHeight;
+    // Mean absolute difference (0..255) of a 32x32 grey thumbnail below which
+    // a frame counts as a duplicate of the previous kept one.
+    double duplicateThreshold = 3.0;
+};
+
+// Returns 0 on success, 1 if nothing usable was found or writing failed.
+int runCalibrationDump(const CalibrationOptions& options);
@@ -0,0 +1,349 @@
+#include "camera_capture.h"
+
+#include "metrics.h"
+#include "opencv_config.h"
+#include "perf_stats.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <utility>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// Sleeps so a fake camera delivers frames at roughly `fps`.
+class FramePacer {
+public:
+    explicit FramePacer(double fps)
+        : period_(std::chrono::duration_cast<CaptureClock::duration>(
+              std::chrono::duration<double>(1.0 / std::max(1.0, fps)))) {}
+
+    void wait() {
+        const auto now = CaptureClock::now();
+        if (next_ > now) {
+            std::this_thread::sleep_until(next_);
+        }
+        next_ = std::max(next_, now) + period_;
+    }
+
+private:
+    CaptureClock::duration period_;
+    CaptureClock::time_point next_{};
+};
+
+bool isImageFile(const fs::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp";
+}
+
+// Fake camera over an image folder. The images are decoded once at open();
+// read() copies the next one into the caller's buffer, so steady state does
+// no decoding and no allocation, like a real camera.
+class ImageFolderSource : public FrameSource {
+public:
+    ImageFolderSource(std::string dir, double fps) : dir_(std::move(dir)), pacer_(fps) {}
+
+    std::string describe() const override { return "image folder " + dir_; }
+
+    bool open() override {
+        std::vector<fs::path> paths;
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(dir_, ec)) {
+            if (entry.is_regular_file() && isImageFile(entry.path())) {
+                paths.push_back(entry.path());
+            }
+        }
+        std::sort(paths.begin(), paths.end());
+        for (const auto& path : paths) {
+            cv::Mat img = cv::imread(path.string());
+            if (!img.empty()) {
+                images_.push_back(std::move(img));
+            }
+        }
+        return !images_.empty();
+    }
+
+    bool read(cv::Mat& frame) override {
+        pacer_.wait();
+        images_[next_].copyTo(frame);
+        next_ = (next_ + 1) % images_.size();
+        return true;
+    }
+
+private:
+    std::string dir_;
+    FramePacer pacer_;
+    std::vector<cv::Mat> images_;
+    size_t next_ = 0;
+};
+
+#if TOOLSDETECT_HAS_VIDEOIO
+class VideoCaptureSource : public FrameSource {
+public:
+    // Camera device.
+    VideoCaptureSource(int device, const CameraConfig& config)
+        : device_(device), config_(config), pacer_(config.fps) {}
+    // Video file replayed (looped) as a fake camera.
+    VideoCaptureSource(std::string file, const CameraConfig& config)
+        : file_(std::move(file)), config_(config), pacer_(config.fps) {}
+
+    std::string describe() const override {
+        return file_.empty() ? "camera " + std::to_string(device_) : "video file " + file_;
+    }
+
+    bool open() override {
+        if (!file_.empty()) {
+            return cap_.open(file_);
+        }
+#if defined(__linux__)
+        const int api = cv::CAP_V4L2;
+#else
+        const int api = cv::CAP_ANY;
+#endif
+        if (!cap_.open(device_, api)) {
+            return false;
+        }
+        if (config_.width > 0 && config_.height > 0) {
+            cap_.set(cv::CAP_PROP_FRAME_WIDTH, config_.width);
+            cap_.set(cv::CAP_PROP_FRAME_HEIGHT, config_.height);
+        }
+        cap_.set(cv::CAP_PROP_FPS, config_.fps);
+        // Keep the driver queue short: the grabber drains it continuously and
+        // stale queued frames would carry the wrong timestamps.
+        cap_.set(cv::CAP_PROP_BUFFERSIZE, 1);
+        return true;
+    }
+
+    bool read(cv::Mat& frame) override {
+        if (file_.empty()) {
+            return cap_.read(frame);
+        }
+        pacer_.wait();
+        if (cap_.read(frame)) {
+            return true;
+        }
+        cap_.set(cv::CAP_PROP_POS_FRAMES, 0);   // loop
+        return cap_.read(frame);
+    }
+
+private:
+    int device_ = -1;
+    std::string file_;
+    CameraConfig config_;
+    FramePacer pacer_;
+    cv::VideoCapture cap_;
+};
+
+bool parseDeviceIndex(const std::string& spec, int& index) {
+    std::string digits = spec;
+    const std::string prefix = "/dev/video";
+    if (digits.compare(0, prefix.size(), prefix) == 0) {
+        digits = digits.substr(prefix.size());
+    }
+    if (digits.empty() || !std::all_of(digits.begin(), digits.end(),
+                                       [](unsigned char c) { return std::isdigit(c) != 0; })) {
+        return false;
+    }
+    index = std::stoi(digits);
+    return true;
+}
+#endif
+
+}  // namespace
+
+std::unique_ptr<FrameSource> openFrameSource(const std::string& spec, const CameraConfig& config) {
+    std::error_code ec;
+    if (fs::is_directory(spec, ec)) {
+        return std::make_unique<ImageFolderSource>(spec, config.fps);
+    }
+#if TOOLSDETECT_HAS_VIDEOIO
+    int device = 0;
+    if (parseDeviceIndex(spec, device)) {
+        return std::make_unique<VideoCaptureSource>(device, config);
+    }
+    if (fs::is_regular_file(spec, ec)) {
+        return std::make_unique<VideoCaptureSource>(spec, config);
+    }
+    std::cerr << "[ERROR] Camera not found: " << spec << "\n";
+#else
+    std::cerr << "[ERROR] Camera capture needs OpenCV videoio; only image folders work in "
+                 "this build: " << spec << "\n";
+#endif
+    return nullptr;
+}
+
+CameraGrabber::CameraGrabber(std::unique_ptr<FrameSource> source, CameraConfig config)
+    : source_(std::move(source)), config_(std::move(config)) {
+    const int ringSize = std::max(2, config_.ringSize);
+    for (int i = 0; i < ringSize; ++i) {
+        slots_.push_back(std::make_shared<CapturedFrame>());
+    }
+}
+
+CameraGrabber::~CameraGrabber() { stop(); }
+
+bool CameraGrabber::start() {
+    if (!source_ || thread_.joinable()) {
+        return false;
+    }
+    if (!source_->open()) {
+        std::cerr << "[ERROR] Failed to open " << source_->describe() << "\n";
+        return false;
+    }
+    std::cout << "[INFO] Capturing from " << source_->describe() << " (" << slots_.size()
+              << " frame ring)\n";
+    stop_.store(false);
+    thread_ = std::thread([this]() {
+        trace::setThreadName("camera-grabber");
+        grabLoop();
+    });
+    return true;
+}
+
+void CameraGrabber::stop() {
+    stop_.store(true);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    frameArrived_.notify_all();
+}
+
+int CameraGrabber::acquireSlot() {
+    // Oldest first: start after the slot written last and take the first one
+    // nobody holds a handle to.
+    for (size_t n = 0; n < slots_.size(); ++n) {
+        const size_t i = (nextSlot_ + n) % slots_.size();
+        if (slots_[i].use_count() == 1) {
+            nextSlot_ = (i + 1) % slots_.size();
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void CameraGrabber::grabLoop() {
+    static metrics::Counter& framesTotal = metrics::counter(
+        "toolsdetect_camera_frames_total", "Frames captured by the camera grabber");
+    static metrics::Counter& droppedTotal = metrics::counter(
+        "toolsdetect_camera_frames_dropped_total",
+        "Camera frames discarded because every ring slot was in use");
+
+    int consecutiveErrors = 0;
+    while (!stop_.load()) {
+        int slot = -1;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            slot = acquireSlot();
+            writing_ = slot;
+        }
+        // Handles only come out under mutex_ and skip writing_, so the slot
+        // can be filled without holding the lock.
+        cv::Mat& target = slot >= 0 ? slots_[slot]->image : overflow_;
+        bool ok = false;
+        {
+            TD_PERF_SCOPE("camera.read");
+            ok = source_->read(target);
+        }
+        const auto timestamp = CaptureClock::now();
+        if (!ok || target.empty()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                writing_ = -1;
+            }
+            if (++consecutiveErrors == 10) {
+                std::cerr << "[WARN] " << source_->describe() << " keeps failing to deliver frames.\n";
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            continue;
+        }
+        consecutiveErrors = 0;
+        if (slot < 0) {
+            dropped_.fetch_add(1);
+            droppedTotal.inc();
+            continue;
+        }
+
+        double sharpness = 0.0;
+        {
+            TD_PERF_SCOPE("camera.sharpness");
+            cv::cvtColor(target, gray_, cv::COLOR_BGR2GRAY);
+            cv::resize(gray_, small_, cv::Size(), 0.5, 0.5, cv::INTER_AREA);
+            cv::Laplacian(small_, laplacian_, CV_64F);
+            cv::Scalar mean;
+            cv::Scalar stddev;
+            cv::meanStdDev(laplacian_, mean, stddev);
+            sharpness = stddev[0] * stddev[0];
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            CapturedFrame& frame = *slots_[slot];
+            frame.timestamp = timestamp;
+            frame.sequence = ++sequence_;
+            frame.sharpness = sharpness;
+            writing_ = -1;
+        }
+        captured_.fetch_add(1);
+        framesTotal.inc();
+        frameArrived_.notify_all();
+    }
+}
+
+FrameHandle CameraGrabber::latest() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int best = -1;
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        if (static_cast<int>(i) == writing_ || slots_[i]->sequence == 0) {
+            continue;
+        }
+        if (best < 0 || slots_[i]->sequence > slots_[best]->sequence) {
+            best = static_cast<int>(i);
+        }
+    }
+    return best < 0 ? nullptr : FrameHandle(slots_[best]);
+}
+
+FrameHandle CameraGrabber::sharpestAfter(CaptureClock::time_point event,
+                                         std::chrono::milliseconds timeout) {
+    TD_PERF_SCOPE("camera.select");
+    const auto windowEnd = event + config_.selectWindow;
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto usable = [this](size_t i) {
+        return static_cast<int>(i) != writing_ && slots_[i]->sequence != 0;
+    };
+    // The window is complete once a frame newer than its end exists.
+    frameArrived_.wait_until(lock, event + timeout, [&]() {
+        if (stop_.load()) {
+            return true;
+        }
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            if (usable(i) && slots_[i]->timestamp > windowEnd) {
+                return true;
+            }
+        }
+        return false;
+    });
+
+    int best = -1;       // sharpest inside the window
+    int earliest = -1;   // first frame after the event
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        if (!usable(i) || slots_[i]->timestamp < event) {
+            continue;
+        }
+        const CapturedFrame& frame = *slots_[i];
+        if (frame.timestamp <= windowEnd && (best < 0 || frame.sharpness > slots_[best]->sharpness)) {
+            best = static_cast<int>(i);
+        }
+        if (earliest < 0 || frame.sequence < slots_[earliest]->sequence) {
+            earliest = static_cast<int>(i);
+        }
+    }
+    const int chosen = best >= 0 ? best : earliest;
+    return chosen < 0 ? nullptr : FrameHandle(slots_[chosen]);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Live capture for before/after sessions (--camera).
+//
+// A grabber thread reads the camera continuously into a fixed ring of frame
+// buffers that is allocated once: decoding into a slot whose size already
+// matches does not reallocate. Each frame is timestamped and scored for
+// sharpness (variance of the Laplacian at half resolution) as it arrives.
+// On a door event the session asks for the sharpest frame in a short window
+// after the event, which skips the motion blur of the door swinging. The
+// returned handle pins its slot, so the frame goes straight into detection
+// without a copy and the grabber leaves that slot alone until it is released.
+
+using CaptureClock = std::chrono::steady_clock;
+
+struct CapturedFrame {
+    cv::Mat image;                    // BGR, owned by the ring slot
+    CaptureClock::time_point timestamp;
+    uint64_t sequence = 0;            // 1, 2, ...; 0 = slot not filled yet
+    double sharpness = 0.0;
+};
+
+// Shared, read-only view of a ring slot; the slot is reused after the last
+// handle is dropped.
+using FrameHandle = std::shared_ptr<const CapturedFrame>;
+
+// Where frames come from: a real camera or a fake one for tests.
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+    virtual std::string describe() const = 0;
+    virtual bool open() = 0;
+    // Blocks until the next frame and writes it into `frame`, reusing its
+    // buffer when the size matches. Returns false on a read error.
+    virtual bool read(cv::Mat& frame) = 0;
+};
+
+struct CameraConfig {
+    int width = 0;                  // 0 = camera default
+    int height = 0;
+    double fps = 30.0;              // requested rate; pacing rate for fakes
+    int ringSize = 16;              // must cover fps * selectWindow plus pinned frames
+    std::chrono::milliseconds selectWindow{300};
+};
+
+// "/dev/videoN" or a bare index opens a V4L2 camera (the platform default
+// backend elsewhere). An image folder (sorted by name, looped) or a video
+// file (looped) is replayed as a fake camera at `config.fps`.
+std::unique_ptr<FrameSource> openFrameSource(const std::string& spec, const CameraConfig& config);
+
+class CameraGrabber {
+public:
+    CameraGrabber(std::unique_ptr<FrameSource> source, CameraConfig config = CameraConfig());
+    ~CameraGrabber();
+
+    CameraGrabber(const CameraGrabber&) = delete;
+    CameraGrabber& operator=(const CameraGrabber&) = delete;
+
+    // Opens the source and starts the grabber thread.
+    bool start();
+    void stop();
+
+    // Newest complete frame, or null before the first one.
+    FrameHandle latest() const;
+
+    // Sharpest frame captured within `config.selectWindow` after `event`.
+    // Waits until the window has passed (at most `timeout`); falls back to
+    // the first frame after the event when the window holds none. Null if no
+    // frame arrived in time.
+    FrameHandle sharpestAfter(CaptureClock::time_point event,
+                              std::chrono::milliseconds timeout = std::chrono::milliseconds(2000));
+
+    uint64_t framesCaptured() const { return captured_.load(); }
+    uint64_t framesDropped() const { return dropped_.load(); }
+
+private:
+    void grabLoop();
+    int acquireSlot();   // call with mutex_ held; -1 if every slot is pinned
+
+    std::unique_ptr<FrameSource> source_;
+    CameraConfig config_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable frameArrived_;
+    std::vector<std::shared_ptr<CapturedFrame>> slots_;
+    int writing_ = -1;         // slot being filled; never handed out
+    size_t nextSlot_ = 0;
+    uint64_t sequence_ = 0;
+
+    cv::Mat overflow_;         // frame sink when every slot is pinned
+    cv::Mat gray_;             // sharpness scratch buffers, reused
+    cv::Mat small_;
+    cv::Mat laplacian_;
+
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> captured_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::thread thread_;
+};
@@ -0,0 +1,136 @@
+#include "camera_rig.h"
+
+#include "perf_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+struct PlaneBox {
+    const DetectedObject* obj;
+    size_t view;
+    cv::Rect2d box;
+};
+
+cv::Point2d project(const std::array<double, 9>& h, double x, double y) {
+    const double w = h[6] * x + h[7] * y + h[8];
+    const double s = std::abs(w) > 1e-12 ? 1.0 / w : 0.0;
+    return {(h[0] * x + h[1] * y + h[2]) * s, (h[3] * x + h[4] * y + h[5]) * s};
+}
+
+// Axis-aligned bounds of the projected box corners.
+cv::Rect2d projectBox(const std::array<double, 9>& h, const cv::Rect& r) {
+    const cv::Point2d corners[4] = {
+        project(h, r.x, r.y),
+        project(h, r.x + r.width, r.y),
+        project(h, r.x, r.y + r.height),
+        project(h, r.x + r.width, r.y + r.height),
+    };
+    double x1 = corners[0].x, y1 = corners[0].y, x2 = x1, y2 = y1;
+    for (const auto& c : corners) {
+        x1 = std::min(x1, c.x);
+        y1 = std::min(y1, c.y);
+        x2 = std::max(x2, c.x);
+        y2 = std::max(y2, c.y);
+    }
+    return {x1, y1, x2 - x1, y2 - y1};
+}
+
+double iou(const cv::Rect2d& a, const cv::Rect2d& b) {
+    const double x1 = std::max(a.x, b.x);
+    const double y1 = std::max(a.y, b.y);
+    const double x2 = std::min(a.x + a.width, b.x + b.width);
+    const double y2 = std::min(a.y + a.height, b.y + b.height);
+    const double inter = std::max(0.0, x2 - x1) * std::max(0.0, y2 - y1);
+    const double uni = a.width * a.height + b.width * b.height - inter;
+    return uni > 0.0 ? inter / uni : 0.0;
+}
+
+}  // namespace
+
+bool loadCameraRig(const std::string& path, CameraRig& rig) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "[ERROR] Cannot open camera rig file: " << path << "\n";
+        return false;
+    }
+    rig.views.clear();
+    std::string line;
+    for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+        const auto hash = line.find('#');
+        if (hash != std::string::npos) {
+            line.erase(hash);
+        }
+        std::istringstream fields(line);
+        CameraView view;
+        if (!(fields >> view.name)) {
+            continue;   // blank or comment
+        }
+        if (!(fields >> view.source)) {
+            std::cerr << "[ERROR] " << path << ":" << lineNo << ": missing camera source\n";
+            return false;
+        }
+        double value = 0.0;
+        size_t count = 0;
+        std::array<double, 9> h{};
+        while (count < h.size() && fields >> value) {
+            h[count++] = value;
+        }
+        if (count == h.size()) {
+            view.toCabinet = h;
+        } else if (count != 0 || !fields.eof()) {
+            std::cerr << "[ERROR] " << path << ":" << lineNo
+                      << ": expected 9 homography values after the source\n";
+            return false;
+        }
+        rig.views.push_back(view);
+    }
+    if (rig.views.empty()) {
+        std::cerr << "[ERROR] Camera rig file defines no views: " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+DetectionResult fuseViews(const std::vector<DetectionResult>& perView, const CameraRig& rig) {
+    TD_PERF_SCOPE("session.fuse");
+    std::vector<PlaneBox> boxes;
+    for (size_t v = 0; v < perView.size() && v < rig.views.size(); ++v) {
+        for (const auto& obj : perView[v].objects) {
+            boxes.push_back({&obj, v, projectBox(rig.views[v].toCabinet, obj.bbox)});
+        }
+    }
+    std::stable_sort(boxes.begin(), boxes.end(), [](const PlaneBox& a, const PlaneBox& b) {
+        return a.obj->confidence > b.obj->confidence;
+    });
+
+    // Greedy cross-view suppression. Boxes from the same view never suppress
+    // each other: NMS already ran per view, and two adjacent tools of the
+    // same kind must both count.
+    std::vector<const PlaneBox*> kept;
+    for (const auto& candidate : boxes) {
+        const bool duplicate = std::any_of(kept.begin(), kept.end(), [&](const PlaneBox* k) {
+            return k->view != candidate.view && k->obj->cls == candidate.obj->cls &&
+                   iou(k->box, candidate.box) >= rig.dedupeIou;
+        });
+        if (!duplicate) {
+            kept.push_back(&candidate);
+        }
+    }
+
+    DetectionResult fused;
+    for (const PlaneBox* k : kept) {
+        DetectedObject obj = *k->obj;
+        obj.bbox = cv::Rect(static_cast<int>(std::lround(k->box.x)),
+                            static_cast<int>(std::lround(k->box.y)),
+                            static_cast<int>(std::lround(k->box.width)),
+                            static_cast<int>(std::lround(k->box.height)));
+        obj.oriented = false;   // the rotated box is in view pixels, not plane units
+        fused.objects.push_back(obj);
+    }
+    return fused;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "detector.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+// Several cameras looking at one cabinet (--cameras <rig file>).
+//
+// Each view has a homography that maps its image pixels onto a shared
+// cabinet plane (e.g. the back wall, in millimetres or in the pixels of a
+// reference shot). Detections from all views are mapped onto that plane and
+// a tool seen by two overlapping cameras is counted once, so
+// compareInventory() gets a single fused DetectionResult per snapshot.
+//
+// Rig file: one view per line, whitespace separated, '#' starts a comment:
+//   <name> <camera source> <h11 h12 h13 h21 h22 h23 h31 h32 h33>
+// The camera source takes the same values as --camera. Lines may end after
+// the source, which means the identity homography.
+struct CameraView {
+    std::string name;
+    std::string source;
+    std::array<double, 9> toCabinet{1, 0, 0, 0, 1, 0, 0, 0, 1};   // row-major 3x3
+};
+
+struct CameraRig {
+    std::vector<CameraView> views;
+    // Same-class boxes from different views overlapping at least this much
+    // on the cabinet plane are the same tool.
+    float dedupeIou = 0.3f;
+};
+
+// Returns false (after printing the reason) if the file cannot be read, a
+// line is malformed or it defines no view.
+bool loadCameraRig(const std::string& path, CameraRig& rig);
+
+// Maps every view's detections onto the cabinet plane and removes
+// cross-view duplicates, keeping the most confident box. `perView` is in the
+// order of `rig.views`. Boxes of the result are in cabinet-plane units.
+DetectionResult fuseViews(const std::vector<DetectionResult>& perView, const CameraRig& rig);
@@ -0,0 +1,63 @@
+// detection_codec.cpp
+
+#include "detection_codec.h"
+
+void writeDetections(ByteWriter& w, const DetectionResult& det) {
+    w.pod(static_cast<uint32_t>(det.objects.size()));
+    for (const auto& obj : det.objects) {
+        w.str(obj.cls);
+        w.pod(obj.confidence);
+        w.pod(static_cast<int32_t>(obj.bbox.x));
+        w.pod(static_cast<int32_t>(obj.bbox.y));
+        w.pod(static_cast<int32_t>(obj.bbox.width));
+        w.pod(static_cast<int32_t>(obj.bbox.height));
+        w.pod(static_cast<uint8_t>(obj.oriented ? 1 : 0));
+        if (obj.oriented) {
+            w.pod(obj.obb.center.x);
+            w.pod(obj.obb.center.y);
+            w.pod(obj.obb.size.width);
+            w.pod(obj.obb.size.height);
+            w.pod(obj.obb.angle);
+        }
+    }
+}
+
+bool readDetections(ByteReader& r, DetectionResult& det) {
+    uint32_t n = 0;
+    if (!r.pod(n)) return false;
+    det.objects.clear();
+    for (uint32_t i = 0; i < n; ++i) {
+        DetectedObject obj;
+        int32_t x = 0, y = 0, w = 0, h = 0;
+        uint8_t oriented = 0;
+        if (!r.str(obj.cls) || !r.pod(obj.confidence) || !r.pod(x) || !r.pod(y) ||
+            !r.pod(w) || !r.pod(h) || !r.pod(oriented)) {
+            return false;
+        }
+        obj.bbox = cv::Rect(x, y, w, h);
+        obj.oriented = oriented != 0;
+        if (obj.oriented &&
+            !(r.pod(obj.obb.center.x) && r.pod(obj.obb.center.y) && r.pod(obj.obb.size.width) &&
+              r.pod(obj.obb.size.height) && r.pod(obj.obb.angle))) {
+            return false;
+        }
+        det.objects.push_back(obj);
+    }
+    return true;
+}
+
+cv::Mat coarseSignature(const cv::Mat& image) {
+    if (image.empty() || image.type() != CV_8UC3) {
+        return cv::Mat();
+    }
+    cv::Mat small;
+    cv::Mat coarse;
+    cv::resize(image, small, kSignatureSize, 0, 0, cv::INTER_AREA);
+    cv::cvtColor(small, coarse, cv::COLOR_BGR2GRAY);
+    return coarse;
+}
+
+bool nearDuplicate(const cv::Mat& a, const cv::Size& aSize, const cv::Mat& b, const cv::Size& bSize) {
+    return !a.empty() && !b.empty() && aSize == bSize && a.size() == b.size() &&
+           cv::norm(a, b, cv::NORM_INF) <= kNearDuplicateMaxDiff;
+}
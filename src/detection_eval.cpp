@@ -0,0 +1,196 @@
+// detection_eval.cpp
+
+#include "detection_eval.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+float iou(const cv::Rect2f& a, const cv::Rect2f& b) {
+    const float x1 = std::max(a.x, b.x);
+    const float y1 = std::max(a.y, b.y);
+    const float x2 = std::min(a.x + a.width, b.x + b.width);
+    const float y2 = std::min(a.y + a.height, b.y + b.height);
+    const float inter = std::max(0.0f, x2 - x1) * std::max(0.0f, y2 - y1);
+    const float uni = a.width * a.height + b.width * b.height - inter;
+    return uni > 0.0f ? inter / uni : 0.0f;
+}
+
+bool isImageFile(const fs::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp";
+}
+
+fs::path labelPathFor(const fs::path& imagePath) {
+    fs::path sibling = imagePath;
+    sibling.replace_extension(".txt");
+    if (fs::exists(sibling)) return sibling;
+    fs::path inLabels = imagePath.parent_path() / "labels" / imagePath.filename();
+    inLabels.replace_extension(".txt");
+    if (fs::exists(inLabels)) return inLabels;
+    return {};
+}
+
+// All-point interpolated AP of one class.
+double averagePrecision(std::vector<std::pair<float, bool>>& scored, size_t numTruth) {
+    if (numTruth == 0) return 0.0;
+    std::sort(scored.begin(), scored.end(),
+              [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    std::vector<double> precision;
+    std::vector<double> recall;
+    precision.reserve(scored.size());
+    recall.reserve(scored.size());
+    size_t tp = 0;
+    for (size_t i = 0; i < scored.size(); ++i) {
+        if (scored[i].second) ++tp;
+        precision.push_back(static_cast<double>(tp) / static_cast<double>(i + 1));
+        recall.push_back(static_cast<double>(tp) / static_cast<double>(numTruth));
+    }
+    // Precision envelope, then area under the step curve.
+    for (size_t i = precision.size(); i-- > 1;) {
+        precision[i - 1] = std::max(precision[i - 1], precision[i]);
+    }
+    double ap = 0.0;
+    double prevRecall = 0.0;
+    for (size_t i = 0; i < precision.size(); ++i) {
+        ap += (recall[i] - prevRecall) * precision[i];
+        prevRecall = recall[i];
+    }
+    return ap;
+}
+
+}  // namespace
+
+bool readYoloLabels(const std::string& imagePath,
+                    int imageWidth,
+                    int imageHeight,
+                    std::vector<LabelledBox>& out) {
+    out.clear();
+    const fs::path labelPath = labelPathFor(imagePath);
+    if (labelPath.empty()) return false;
+    std::ifstream in(labelPath);
+    if (!in.is_open()) return false;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        LabelledBox box;
+        float cx = 0, cy = 0, w = 0, h = 0;
+        if (!(ss >> box.class_id >> cx >> cy >> w >> h)) continue;
+        box.box = cv::Rect2f((cx - w / 2) * imageWidth, (cy - h / 2) * imageHeight,
+                             w * imageWidth, h * imageHeight);
+        out.push_back(box);
+    }
+    return true;
+}
+
+std::vector<LabelledImage> loadLabelledFolder(const std::string& dir) {
+    std::vector<fs::path> paths;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        if (entry.is_regular_file() && isImageFile(entry.path()) &&
+            !labelPathFor(entry.path()).empty()) {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<LabelledImage> images;
+    for (const auto& path : paths) {
+        // Only the header is needed for the size, but imread is what every
+        // other tool here uses and the folder is small.
+        cv::Mat img = cv::imread(path.string());
+        if (img.empty()) continue;
+        LabelledImage item;
+        item.imagePath = path.string();
+        readYoloLabels(item.imagePath, img.cols, img.rows, item.truth);
+        images.push_back(std::move(item));
+    }
+    return images;
+}
+
+std::vector<int> matchPredictions(const EvalSample& sample, float iouThreshold) {
+    // Greedy matching in descending confidence, one prediction per truth box.
+    std::vector<size_t> order(sample.predictions.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return sample.predictions[a].score > sample.predictions[b].score;
+    });
+    std::vector<int> matches(sample.predictions.size(), -1);
+    std::vector<bool> matched(sample.truth.size(), false);
+    for (size_t idx : order) {
+        const YoloResult& p = sample.predictions[idx];
+        const cv::Rect2f pbox(p.box);
+        float bestIou = iouThreshold;
+        int best = -1;
+        for (size_t t = 0; t < sample.truth.size(); ++t) {
+            if (matched[t] || sample.truth[t].class_id != p.class_id) continue;
+            const float v = iou(pbox, sample.truth[t].box);
+            if (v >= bestIou) {
+                bestIou = v;
+                best = static_cast<int>(t);
+            }
+        }
+        if (best >= 0) matched[best] = true;
+        matches[idx] = best;
+    }
+    return matches;
+}
+
+std::map<int, ClassMatchCounts> classMatchCounts(const std::vector<EvalSample>& samples,
+                                                 float iouThreshold) {
+    std::map<int, ClassMatchCounts> counts;
+    for (const auto& sample : samples) {
+        for (const auto& t : sample.truth) ++counts[t.class_id].falseNegatives;
+        const std::vector<int> matches = matchPredictions(sample, iouThreshold);
+        for (size_t i = 0; i < matches.size(); ++i) {
+            ClassMatchCounts& c = counts[sample.predictions[i].class_id];
+            if (matches[i] >= 0) {
+                ++c.truePositives;
+                --counts[sample.truth[matches[i]].class_id].falseNegatives;
+            } else {
+                ++c.falsePositives;
+            }
+        }
+    }
+    return counts;
+}
+
+double meanAveragePrecision(const std::vector<EvalSample>& samples, float iouThreshold) {
+    std::map<int, size_t> truthPerClass;
+    std::map<int, std::vector<std::pair<float, bool>>> scoredPerClass;
+
+    for (const auto& sample : samples) {
+        for (const auto& t : sample.truth) ++truthPerClass[t.class_id];
+        const std::vector<int> matches = matchPredictions(sample, iouThreshold);
+        for (size_t i = 0; i < matches.size(); ++i) {
+            const YoloResult& p = sample.predictions[i];
+            scoredPerClass[p.class_id].emplace_back(p.score, matches[i] >= 0);
+        }
+    }
+
+    if (truthPerClass.empty()) return 0.0;
+    double sum = 0.0;
+    for (const auto& entry : truthPerClass) {
+        sum += averagePrecision(scoredPerClass[entry.first], entry.second);
+    }
+    return sum / static_cast<double>(truthPerClass.size());
+}
+
+double meanAveragePrecision50To95(const std::vector<EvalSample>& samples) {
+    double sum = 0.0;
+    for (int i = 0; i < 10; ++i) {
+        sum += meanAveragePrecision(samples, 0.50f + 0.05f * static_cast<float>(i));
+    }
+    return sum / 10.0;
+}
@@ -0,0 +1,75 @@
+// detection_eval.h
+// Accuracy evaluation of detector output against a labelled image folder.
+//
+// Labels use the YOLO/Ultralytics text format next to each image
+// (img.jpg -> img.txt, or labels/img.txt): one "class cx cy w h" line per
+// object with coordinates normalized to 0..1. Average precision is computed
+// per class with all-point interpolation (VOC 2010+/COCO style) and averaged
+// over the classes that occur in the ground truth.
+
+#pragma once
+
+#include "yolo_common.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+struct LabelledBox {
+    int class_id = -1;
+    cv::Rect2f box;   // pixels
+};
+
+struct LabelledImage {
+    std::string imagePath;
+    std::vector<LabelledBox> truth;
+};
+
+struct EvalSample {
+    std::vector<LabelledBox> truth;
+    std::vector<YoloResult> predictions;   // any confidence; lower thresholds give a fuller PR curve
+};
+
+// Reads the YOLO label file for `imagePath` (see above) and converts it to
+// pixel boxes for an image of imageWidth x imageHeight. Returns false if no
+// label file exists; an empty label file is a valid "no objects" image.
+bool readYoloLabels(const std::string& imagePath,
+                    int imageWidth,
+                    int imageHeight,
+                    std::vector<LabelledBox>& out);
+
+// Lists images (jpg/jpeg/png/bmp) in `dir` that have a label file, sorted by
+// name. Ground truth is loaded here, so each image is decoded once.
+std::vector<LabelledImage> loadLabelledFolder(const std::string& dir);
+
+// For each prediction of `sample`, the index of the truth box it matches at
+// `iouThreshold` (same class, greedy in descending confidence), or -1.
+std::vector<int> matchPredictions(const EvalSample& sample, float iouThreshold);
+
+struct ClassMatchCounts {
+    size_t truePositives = 0;
+    size_t falsePositives = 0;
+    size_t falseNegatives = 0;
+
+    double precision() const {
+        const size_t n = truePositives + falsePositives;
+        return n > 0 ? static_cast<double>(truePositives) / static_cast<double>(n) : 0.0;
+    }
+    double recall() const {
+        const size_t n = truePositives + falseNegatives;
+        return n > 0 ? static_cast<double>(truePositives) / static_cast<double>(n) : 0.0;
+    }
+};
+
+// Per-class TP/FP/FN at one IoU threshold, keyed by class id. Classes that
+// occur only in the predictions are included (all false positives).
+std::map<int, ClassMatchCounts> classMatchCounts(const std::vector<EvalSample>& samples,
+                                                 float iouThreshold);
+
+// mAP at one IoU threshold (e.g. 0.5 for mAP@0.5).
+double meanAveragePrecision(const std::vector<EvalSample>& samples, float iouThreshold);
+
+// COCO-style mAP averaged over IoU 0.50:0.05:0.95.
+double meanAveragePrecision50To95(const std::vector<EvalSample>& samples);
@@ -1,53 +1,461 @@
 #include "detector.h"
 
-#include "yoloinfer.h"
+#include "detector_backend.h"
+#include "infer_client.h"
+#include "metrics.h"
+#include "perf_stats.h"
+#include "trace.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
 #include <exception>
+#include <filesystem>
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <stdexcept>
+#include <thread>
 
 namespace {
 
-YoloInfer* getSharedInfer() {
-    static std::unique_ptr<YoloInfer> infer;
-    static std::once_flag init_flag;
+std::mutex g_endpointMutex;
+std::string g_remoteEndpoint;
+bool g_endpointInitialized = false;
+std::string g_localModelPath;   // empty = kDefaultModelPath, guarded by g_endpointMutex
+std::string g_backendName;      // empty = defaultDetectorBackend(), guarded by g_endpointMutex
+ModelPrecision g_precision = ModelPrecision::Auto;   // guarded by g_endpointMutex
+bool g_lowMemory = false;                            // guarded by g_endpointMutex
+float g_scoreFloor = kYoloConfidenceThreshold;      // guarded by g_endpointMutex
+std::atomic<int> g_defaultInputSize{0};
 
-    std::call_once(init_flag, [&]() {
+std::string currentRemoteEndpoint() {
+    std::lock_guard<std::mutex> lock(g_endpointMutex);
+    if (!g_endpointInitialized) {
+        if (const char* env = std::getenv("TOOLSDETECT_INFER_SOCKET")) {
+            g_remoteEndpoint = env;
+        }
+        g_endpointInitialized = true;
+    }
+    return g_remoteEndpoint;
+}
+
+std::string toolClassName(int class_id) {
+    static const std::vector<std::string> names = getDefaultToolClassNames();
+    if (class_id >= 0 && class_id < static_cast<int>(names.size())) {
+        return names[class_id];
+    }
+    return "class_" + std::to_string(class_id);
+}
+
+// One server connection per calling thread, so concurrent sessions (daemon
+// workers) each get their own shared-memory segment.
+bool tryRemoteDetect(const std::string& endpoint,
+                     const cv::Mat& img,
+                     DetectionResult& result) {
+    thread_local InferClient client;
+    thread_local std::string connectedTo;
+    if (!client.connected() || connectedTo != endpoint) {
+        connectedTo.clear();
+        if (!client.connect(endpoint)) {
+            return false;
+        }
+        connectedTo = endpoint;
+    }
+
+    bool ok = false;
+    auto detections = client.detect(img, &ok);
+    if (!ok) {
+        return false;
+    }
+    for (const auto& det : detections) {
+        DetectedObject obj;
+        obj.cls = toolClassName(det.class_id);
+        obj.confidence = det.score;
+        obj.bbox = det.box;
+        obj.oriented = det.oriented;
+        obj.obb = det.obb;
+        result.objects.push_back(obj);
+    }
+    return true;
+}
+
+// The configured backend name, model, precision and memory mode. Throws
+// if no backend is compiled in.
+DetectorConfig configuredDetector(std::string& name) {
+    std::string modelPath;
+    DetectorConfig config;
+    {
+        std::lock_guard<std::mutex> lock(g_endpointMutex);
+        modelPath = g_localModelPath;
+        name = g_backendName;
+        config.precision = g_precision;
+        config.lowMemory = g_lowMemory;
+        config.confThreshold = std::min(config.confThreshold, g_scoreFloor);
+    }
+    if (name.empty()) name = defaultDetectorBackend();
+    if (name.empty()) {
+        throw std::runtime_error("no detector backend compiled in (need ONNX Runtime or opencv_dnn)");
+    }
+    if (!modelPath.empty()) {
+        config.modelPath = utf8ToWide(modelPath);
+    }
+    return config;
+}
+
+// Builds a backend from configuredDetector(). Throws like
+// createDetectorBackend().
+std::shared_ptr<DetectorBackend> createConfiguredBackend() {
+    std::string name;
+    const DetectorConfig config = configuredDetector(name);
+    return createDetectorBackend(name, config);
+}
+
+// The file createConfiguredBackend() loads right now, e.g. the INT8 sibling
+// of the configured model.
+std::filesystem::path configuredModelPath() {
+    std::string name;
+    std::wstring path;
+    try {
+        const DetectorConfig config = configuredDetector(name);
         try {
-            infer = std::make_unique<YoloInfer>();
+            path = resolvedModelPath(name, config);
+        } catch (const std::exception&) {
+            path = config.modelPath;   // a required INT8 model is missing: watch the configured one
+        }
+    } catch (const std::exception&) {
+        path = kDefaultModelPath;
+    }
+    return std::filesystem::u8path(wideToUtf8(path));
+}
+
+// The shared backend is replaced as a whole (RCU-style): callers take a
+// reference with acquireBackend() and keep using that instance until they
+// drop it, while a reload publishes a new one with atomic_store.
+std::shared_ptr<DetectorBackend> g_backend;
+std::once_flag g_backendOnce;
+
+std::shared_ptr<DetectorBackend> acquireBackend() {
+    std::shared_ptr<DetectorBackend> backend = std::atomic_load(&g_backend);
+    if (backend) return backend;
+    std::call_once(g_backendOnce, []() {
+        try {
+            std::shared_ptr<DetectorBackend> created = createConfiguredBackend();
+            std::cerr << "[INFO] Detector backend: " << created->name() << "\n";
+            std::atomic_store(&g_backend, std::move(created));
         } catch (const std::exception& ex) {
-            std::cerr << "[ERROR] Failed to initialize YoloInfer: "
-                      << ex.what() << "\n";
+            std::cerr << "[ERROR] Failed to initialize detector backend: " << ex.what() << "\n";
         }
     });
+    return std::atomic_load(&g_backend);
+}
 
-    return infer.get();
+// Runs one inference on a grey frame: loads lazily initialized state before
+// the instance sees real traffic and rejects models that fail to run or
+// return class ids outside their class list.
+bool warmUpBackend(DetectorBackend& backend, std::string& error) {
+    try {
+        const cv::Mat frame(kYoloInputHeight, kYoloInputWidth, CV_8UC3, cv::Scalar(114, 114, 114));
+        const int classCount = static_cast<int>(backend.classNames().size());
+        if (classCount == 0) {
+            error = "model has no classes";
+            return false;
+        }
+        for (const auto& det : backend.infer(frame)) {
+            if (det.class_id < 0 || det.class_id >= classCount) {
+                error = "class id " + std::to_string(det.class_id) + " outside the " +
+                        std::to_string(classCount) + " known classes";
+                return false;
+            }
+        }
+    } catch (const std::exception& ex) {
+        error = ex.what();
+        return false;
+    }
+    return true;
 }
 
-}  // namespace
+// Background thread behind setModelHotReload(): loads the backend eagerly,
+// then polls the model file and swaps in a rebuilt, warmed-up backend once
+// a change has settled. The replaced instance is released on this thread
+// after the last in-flight inference has dropped it.
+class ModelReloader {
+public:
+    ~ModelReloader() { stop(); }
 
-DetectionResult runYoloDetect(const cv::Mat& img) {
-    DetectionResult result;
-    if (img.empty()) {
-        std::cerr << "[WARN] runYoloDetect got empty image.\n";
-        return result;
+    void start(std::chrono::milliseconds interval) {
+        stop();
+        interval_ = interval;
+        stop_ = false;
+        thread_ = std::thread([this]() { run(); });
     }
 
-    YoloInfer* infer = getSharedInfer();
-    if (!infer) {
-        std::cerr << "[ERROR] YoloInfer unavailable. Check ONNX configuration.\n";
-        return result;
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        if (thread_.joinable()) thread_.join();
     }
 
-    auto detections = infer->infer(img);
+private:
+    struct FileStamp {
+        std::filesystem::path path;
+        std::filesystem::file_time_type mtime;
+        uintmax_t size = 0;
+        bool exists = false;
+
+        bool operator==(const FileStamp& other) const {
+            return path == other.path && exists == other.exists && size == other.size && mtime == other.mtime;
+        }
+        bool operator!=(const FileStamp& other) const { return !(*this == other); }
+    };
+
+    static FileStamp stampOf(const std::filesystem::path& path) {
+        FileStamp stamp;
+        stamp.path = path;
+        std::error_code ec;
+        stamp.mtime = std::filesystem::last_write_time(path, ec);
+        if (ec) return stamp;
+        stamp.size = std::filesystem::file_size(path, ec);
+        stamp.exists = !ec;
+        return stamp;
+    }
+
+    // Returns false when asked to stop.
+    bool sleep(std::chrono::milliseconds duration) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return !wake_.wait_for(lock, duration, [this]() { return stop_; });
+    }
+
+    void run() {
+        static metrics::Counter& swapped = metrics::counter(
+            "toolsdetect_model_reloads_total", "Model hot-reload attempts", {{"outcome", "swapped"}});
+        static metrics::Counter& rejected = metrics::counter(
+            "toolsdetect_model_reloads_total", "Model hot-reload attempts", {{"outcome", "rejected"}});
+        trace::setThreadName("model-reload");
+
+        FileStamp loaded = stampOf(configuredModelPath());
+        acquireBackend();   // the first session no longer pays for the load
+        FileStamp pending = loaded;
+        std::shared_ptr<DetectorBackend> retired;
+
+        while (sleep(interval_)) {
+            if (retired && retired.use_count() == 1) {
+                retired.reset();
+                std::cerr << "[INFO] Previous model released\n";
+            }
+            // Resolved on every poll: an INT8 sibling appearing next to the
+            // model (or being removed) switches what is loaded.
+            const FileStamp current = stampOf(configuredModelPath());
+            if (current == loaded || !current.exists) {
+                pending = loaded;
+                continue;
+            }
+            // A copy in progress keeps changing: wait until one full interval
+            // passes without a change.
+            if (current != pending) {
+                pending = current;
+                continue;
+            }
+
+            loaded = current;
+            const auto started = std::chrono::steady_clock::now();
+            std::shared_ptr<DetectorBackend> fresh;
+            std::string error;
+            try {
+                fresh = createConfiguredBackend();
+            } catch (const std::exception& ex) {
+                error = ex.what();
+            }
+            if (!fresh || !warmUpBackend(*fresh, error)) {
+                rejected.inc();
+                std::cerr << "[ERROR] Model reload rejected, keeping the current model: " << error << "\n";
+                continue;
+            }
+            // Readers that loaded the old pointer keep it alive until they
+            // return; everyone after the store sees the new model.
+            // A second reload before the previous instance drained: its last
+            // reader frees it.
+            retired.reset();
+            retired = std::atomic_exchange(&g_backend, std::move(fresh));
+            swapped.inc();
+            const double ms = std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - started).count();
+            std::cerr << "[INFO] Model reloaded from " << current.path.u8string() << " (" << static_cast<int>(ms)
+                      << " ms, warmed up)\n";
+        }
+    }
+
+    std::chrono::milliseconds interval_{2000};
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;   // guarded by mutex_
+    std::thread thread_;
+};
+
+// Declared after g_backend, so it is destroyed (and joined) before it.
+ModelReloader g_reloader;
+
+void appendDetections(const DetectorBackend& infer,
+                      const std::vector<YoloResult>& detections,
+                      DetectionResult& result) {
     for (const auto& det : detections) {
         DetectedObject obj;
-        obj.cls = infer->classNameOrDefault(det.class_id);
+        obj.cls = infer.classNameOrDefault(det.class_id);
         obj.confidence = det.score;
         obj.bbox = det.box;
+        obj.oriented = det.oriented;
+        obj.obb = det.obb;
         result.objects.push_back(obj);
     }
+}
+
+// The backend may run below kYoloConfidenceThreshold (setDetectionScoreFloor),
+// so every public entry point filters to its own threshold. Greedy NMS keeps
+// higher-scored boxes regardless of weaker ones, so filtering afterwards gives
+// the same boxes as running at the higher threshold.
+void dropBelow(float minConfidence, DetectionResult& result) {
+    auto& objects = result.objects;
+    objects.erase(std::remove_if(objects.begin(), objects.end(),
+                                 [minConfidence](const DetectedObject& obj) {
+                                     return obj.confidence < minConfidence;
+                                 }),
+                  objects.end());
+}
+
+DetectionResult detectAtSize(const cv::Mat& img, int inputSize) {
+    TD_PERF_SCOPE("detect.total");
+    DetectionResult result;
+    if (img.empty()) {
+        std::cerr << "[WARN] runYoloDetect got empty image.\n";
+        return result;
+    }
+
+    const std::string endpoint = currentRemoteEndpoint();
+    if (!endpoint.empty()) {
+        if (tryRemoteDetect(endpoint, img, result)) {
+            return result;
+        }
+        std::cerr << "[WARN] Inference server " << endpoint
+                  << " unavailable, falling back to in-process inference.\n";
+    }
+
+    // Held until the end of this call, so a concurrent reload cannot free it.
+    const std::shared_ptr<DetectorBackend> infer = acquireBackend();
+    if (!infer) {
+        std::cerr << "[ERROR] Detector backend unavailable. Check model / runtime configuration.\n";
+        return result;
+    }
+
+    const bool resized = inputSize > 0 && infer->supportsDynamicInputSize();
+    result.inputSize = resized ? inputSize : infer->defaultInputSize();
+    auto detections = resized ? infer->inferAtSize(img, inputSize) : infer->infer(img);
+    appendDetections(*infer, detections, result);
+
+    return result;
+}
+
+}  // namespace
+
+DetectionResult runYoloDetect(const cv::Mat& img) {
+    return runYoloDetect(img, g_defaultInputSize.load(std::memory_order_relaxed));
+}
+
+DetectionResult runYoloDetect(const cv::Mat& img, int inputSize) {
+    DetectionResult result = detectAtSize(img, inputSize);
+    dropBelow(kYoloConfidenceThreshold, result);
+    return result;
+}
 
+DetectionResult runYoloDetect(const cv::Mat& img, int inputSize, float minConfidence) {
+    if (inputSize <= 0) inputSize = g_defaultInputSize.load(std::memory_order_relaxed);
+    DetectionResult result = detectAtSize(img, inputSize);
+    dropBelow(minConfidence, result);
     return result;
 }
+
+std::vector<DetectionResult> runYoloDetectBatch(const std::vector<cv::Mat>& images) {
+    TD_PERF_SCOPE("detect.batch");
+    std::vector<DetectionResult> results(images.size());
+    if (images.empty()) {
+        return results;
+    }
+
+    const std::string endpoint = currentRemoteEndpoint();
+    const std::shared_ptr<DetectorBackend> infer = endpoint.empty() ? acquireBackend() : nullptr;
+    if (!infer) {
+        // The server protocol is one image per request; it batches across
+        // clients on its side.
+        for (size_t i = 0; i < images.size(); ++i) {
+            results[i] = runYoloDetect(images[i]);
+        }
+        return results;
+    }
+
+    const int inputSize = g_defaultInputSize.load(std::memory_order_relaxed);
+    const bool resized = inputSize > 0 && infer->supportsDynamicInputSize();
+    auto detections = resized ? infer->inferBatchAtSize(images, inputSize) : infer->inferBatch(images);
+    for (size_t i = 0; i < images.size() && i < detections.size(); ++i) {
+        results[i].inputSize = resized ? inputSize : infer->defaultInputSize();
+        appendDetections(*infer, detections[i], results[i]);
+        dropBelow(kYoloConfidenceThreshold, results[i]);
+    }
+    return results;
+}
+
+void setRemoteInferEndpoint(const std::string& socketPath) {
+    std::lock_guard<std::mutex> lock(g_endpointMutex);
+    g_remoteEndpoint = socketPath;
+    g_endpointInitialized = true;
+}
+
+void setLocalModelPath(const std::string& modelPath) {
+    std::lock_guard<std::mutex> lock(g_endpointMutex);
+    g_localModelPath = modelPath;
+}
+
+void setDetectorBackend(const std::string& backendName) {
+    std::lock_guard<std::mutex> lock(g_endpointMutex);
+    g_backendName = backendName;
+}
+
+bool setModelPrecision(const std::string& precision) {
+    ModelPrecision parsed;
+    if (!parseModelPrecision(precision, parsed)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(g_endpointMutex);
+    g_precision = parsed;
+    return true;
+}
+
+void setLowMemoryMode(bool enabled) {
+    std::lock_guard<std::mutex> lock(g_endpointMutex);
+    g_lowMemory = enabled;
+}
+
+void setDetectionScoreFloor(float minConfidence) {
+    std::lock_guard<std::mutex> lock(g_endpointMutex);
+    g_scoreFloor = minConfidence;
+}
+
+bool detectorSupportsDynamicInputSize() {
+    const std::shared_ptr<DetectorBackend> backend = acquireBackend();
+    return backend && backend->supportsDynamicInputSize();
+}
+
+void setDefaultInputSize(int inputSize) {
+    g_defaultInputSize.store(inputSize, std::memory_order_relaxed);
+}
+
+void setModelHotReload(int pollMs) {
+    if (pollMs > 0) {
+        g_reloader.start(std::chrono::milliseconds(pollMs));
+    } else {
+        g_reloader.stop();
+    }
+}
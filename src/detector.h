@@ -8,13 +8,71 @@ struct DetectedObject {
     std::string cls;   // 类别，比如 "pliers", "screwdriver", "wrench"
     float confidence;  // 置信度 0~1
     cv::Rect bbox;     // 边界框 (x,y,w,h)
+    int trackId = -1;  // 视频跟踪模式下的轨迹编号（-1 = 未跟踪）
+    bool oriented = false;   // 旋转框模型（YOLO-OBB）时为 true，此时 obb 有效
+    cv::RotatedRect obb;     // 旋转框；bbox 为其外接矩形
 };
 
 // 检测结果的打包
 struct DetectionResult {
     std::vector<DetectedObject> objects;
+    int inputSize = 0;   // 本次推理实际使用的模型输入边长（0 = 未知，例如远程推理）
 };
 
 // 这是占位接口：给一张图像，返回检测到的目标列表。
 // 现在我们会用“假数据”来模拟输出，以后你把里面的实现替换成真正的 YOLO 推理即可。
 DetectionResult runYoloDetect(const cv::Mat& img);
+
+// 指定模型输入边长（320/480/640/960 ...，32 的倍数）推理；0 = 默认尺寸。
+// 只有动态 H/W 的模型才会真正改变尺寸，否则按默认尺寸推理。远程推理忽略该参数。
+DetectionResult runYoloDetect(const cv::Mat& img, int inputSize);
+
+// 同上，但返回置信度 >= minConfidence 的目标（视频跟踪的低分关联阶段用）。
+// 本进程后端只保留 setDetectionScoreFloor() 以上的目标；inputSize <= 0 时使用
+// setDefaultInputSize() 的尺寸。远程推理只能拿到服务端阈值以上的目标。
+DetectionResult runYoloDetect(const cv::Mat& img, int inputSize, float minConfidence);
+
+// 多张图一次推理（多相机会话）：本进程后端支持动态 batch 时合并为一次模型调用，
+// 否则逐张推理；结果与输入顺序一致。远程推理时逐张发送。
+std::vector<DetectionResult> runYoloDetectBatch(const std::vector<cv::Mat>& images);
+
+// 本进程推理后端是否支持动态输入尺寸（会触发模型加载）。
+bool detectorSupportsDynamicInputSize();
+
+// 可选：runYoloDetect(img) 使用的默认输入边长（静态图片会话可以用更大的尺寸）。0 = 模型默认。
+void setDefaultInputSize(int inputSize);
+
+// 可选：把推理交给本机的 toolsdetect_server（Unix socket + 共享内存），
+// 多个柜子进程共用一份模型。传空串恢复本进程内推理。
+// 也可以通过环境变量 TOOLSDETECT_INFER_SOCKET 设置。
+void setRemoteInferEndpoint(const std::string& socketPath);
+
+// 可选：本进程内推理使用的模型文件（默认 kDefaultModelPath）。
+// 需在第一次 runYoloDetect() 之前调用，之后修改不再生效。
+void setLocalModelPath(const std::string& modelPath);
+
+// 可选：本进程内推理使用的后端（"ort" / "opencv"，见 detector_backend.h）。
+// 传空串使用 defaultDetectorBackend()。同样需在第一次 runYoloDetect() 之前调用。
+void setDetectorBackend(const std::string& backendName);
+
+// 可选：模型精度 "auto" / "fp32" / "int8"。auto 时若存在 tools/quantize_int8.py
+// 生成的 <模型>.int8.onnx 则自动使用。非法值返回 false。
+bool setModelPrecision(const std::string& precision);
+
+// 可选：低内存模式（见 DetectorConfig::lowMemory），用于 4 GB 内存的柜机。
+// 同样需在第一次 runYoloDetect() 之前调用。
+void setLowMemoryMode(bool enabled);
+
+// 可选：本进程后端保留的最低置信度（默认 kYoloConfidenceThreshold）。视频跟踪模式把它降到
+// TrackerConfig::lowThreshold。只影响三参数的 runYoloDetect()，其余接口仍按
+// kYoloConfidenceThreshold 过滤，结果不变。同样需在第一次 runYoloDetect() 之前调用。
+void setDetectionScoreFloor(float minConfidence);
+
+// 可选：模型热更新。pollMs > 0 时后台线程立即加载模型（不再等到第一个会话），
+// 之后每 pollMs 毫秒检查实际加载的模型文件（如 INT8 同名模型，每次检查时重新解析）；
+// 文件变化且稳定一个周期后，在后台构建并预热新后端，
+// 成功才原子替换（RCU）：正在进行的推理在旧实例上完成，旧实例在最后一个使用者
+// 释放后才销毁。加载或预热失败的模型不会替换正在使用的模型。
+// 请用“复制到临时文件再 rename”的方式替换模型（低内存模式下模型是内存映射的）。
+// pollMs <= 0 停止监视。
+void setModelHotReload(int pollMs);
@@ -0,0 +1,165 @@
+// detector_backend.cpp
+// Backend registry / factory.
+
+#include "detector_backend.h"
+
+#include "opencv_dnn_backend.h"
+
+#if TOOLSDETECT_HAS_ONNXRUNTIME
+#include "yoloinfer.h"
+#endif
+
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+bool isInt8ModelPath(const std::wstring& path) {
+    const std::wstring suffix = L".int8.onnx";
+    return path.size() >= suffix.size() &&
+           path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::wstring resolveModelPath(const DetectorConfig& config, bool preferInt8) {
+    if (config.precision == ModelPrecision::Fp32 || isInt8ModelPath(config.modelPath)) {
+        return config.modelPath;
+    }
+    const std::wstring int8Path = int8ModelPathFor(config.modelPath);
+    std::error_code ec;
+    const bool haveInt8 = std::filesystem::exists(std::filesystem::u8path(wideToUtf8(int8Path)), ec);
+    if (config.precision == ModelPrecision::Int8) {
+        if (!haveInt8) {
+            throw std::runtime_error("INT8 model not found: " +
+                                     wideToUtf8(int8Path) +
+                                     " (run tools/quantize_int8.py first)");
+        }
+        return int8Path;
+    }
+    if (preferInt8 && haveInt8) {
+        return int8Path;
+    }
+    return config.modelPath;
+}
+
+bool isBuiltinBackendName(const std::string& name) {
+    return name == "ort" || name == "onnxruntime" || name == "opencv" || name == "dnn";
+}
+
+struct CustomBackends {
+    std::mutex mutex;
+    std::vector<std::pair<std::string, DetectorBackendFactory>> factories;   // registration order
+};
+
+CustomBackends& customBackends() {
+    static CustomBackends backends;
+    return backends;
+}
+
+}  // namespace
+
+bool parseModelPrecision(const std::string& text, ModelPrecision& out) {
+    if (text == "auto") {
+        out = ModelPrecision::Auto;
+    } else if (text == "fp32") {
+        out = ModelPrecision::Fp32;
+    } else if (text == "int8") {
+        out = ModelPrecision::Int8;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::wstring int8ModelPathFor(const std::wstring& modelPath) {
+    std::wstring base = modelPath;
+    const std::wstring ext = L".onnx";
+    if (base.size() >= ext.size() && base.compare(base.size() - ext.size(), ext.size(), ext) == 0) {
+        base.resize(base.size() - ext.size());
+    }
+    return base + L".int8.onnx";
+}
+
+bool registerDetectorBackend(const std::string& name, DetectorBackendFactory factory) {
+    if (name.empty() || isBuiltinBackendName(name) || !factory) {
+        return false;
+    }
+    CustomBackends& custom = customBackends();
+    std::lock_guard<std::mutex> lock(custom.mutex);
+    for (auto& entry : custom.factories) {
+        if (entry.first == name) {
+            entry.second = std::move(factory);
+            return true;
+        }
+    }
+    custom.factories.emplace_back(name, std::move(factory));
+    return true;
+}
+
+std::vector<std::string> availableDetectorBackends() {
+    std::vector<std::string> names;
+#if TOOLSDETECT_HAS_ONNXRUNTIME
+    names.push_back("ort");
+#endif
+#if TOOLSDETECT_HAS_DNN
+    names.push_back("opencv");
+#endif
+    CustomBackends& custom = customBackends();
+    std::lock_guard<std::mutex> lock(custom.mutex);
+    for (const auto& entry : custom.factories) names.push_back(entry.first);
+    return names;
+}
+
+std::string defaultDetectorBackend() {
+    const auto names = availableDetectorBackends();
+    return names.empty() ? std::string() : names.front();
+}
+
+std::unique_ptr<DetectorBackend> createDetectorBackend(const std::string& name,
+                                                       const DetectorConfig& config) {
+    if (name == "ort" || name == "onnxruntime") {
+#if TOOLSDETECT_HAS_ONNXRUNTIME
+        const std::wstring modelPath = resolveModelPath(config, true);
+        if (modelPath != config.modelPath) {
+            std::cerr << "[INFO] Using INT8 model " << wideToUtf8(modelPath) << "\n";
+        }
+        return std::make_unique<YoloInfer>(modelPath, config.inputWidth, config.inputHeight,
+                                           config.confThreshold, config.nmsThreshold,
+                                           config.classNames, config.lowMemory);
+#else
+        throw std::runtime_error("backend 'ort' is not available (built without ONNX Runtime)");
+#endif
+    }
+    if (name == "opencv" || name == "dnn") {
+#if TOOLSDETECT_HAS_DNN
+        // OpenCV's QDQ support is partial, so Auto stays on FP32 here.
+        DetectorConfig resolved = config;
+        resolved.modelPath = resolveModelPath(config, false);
+        return std::make_unique<OpenCvDnnBackend>(resolved);
+#else
+        throw std::runtime_error("backend 'opencv' is not available (built without opencv_dnn)");
+#endif
+    }
+    DetectorBackendFactory factory;
+    {
+        CustomBackends& custom = customBackends();
+        std::lock_guard<std::mutex> lock(custom.mutex);
+        for (const auto& entry : custom.factories) {
+            if (entry.first == name) factory = entry.second;
+        }
+    }
+    if (factory) {
+        DetectorConfig resolved = config;
+        resolved.modelPath = resolveModelPath(config, false);
+        std::unique_ptr<DetectorBackend> backend = factory(resolved);
+        if (!backend) throw std::runtime_error("backend '" + name + "' failed to load");
+        return backend;
+    }
+    throw std::runtime_error("unknown detector backend '" + name + "'");
+}
+
+std::wstring resolvedModelPath(const std::string& name, const DetectorConfig& config) {
+    return resolveModelPath(config, name == "ort" || name == "onnxruntime");
+}
@@ -0,0 +1,137 @@
+// detector_backend.h
+// Runtime-selectable YOLO inference backends. Every backend shares the
+// letterbox preprocessing, output decoding and NMS in yolo_common.h, so
+// results only differ by what the runtime itself computes.
+//
+//   ort     ONNX Runtime (YoloInfer), needs TOOLSDETECT_HAS_ONNXRUNTIME
+//   opencv  cv::dnn::readNetFromONNX on OpenCV's CPU path, needs opencv_dnn
+//
+// This header does not include any runtime headers, so callers build on
+// machines without ONNX Runtime.
+//
+// INT8: tools/quantize_int8.py writes a QDQ model next to the FP32 one
+// ("best.onnx" -> "best.int8.onnx"). With ModelPrecision::Auto the ort
+// backend loads it instead of the FP32 model when it exists; inputs and
+// outputs stay float, so nothing else changes.
+
+#pragma once
+
+#include "yolo_common.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Set by CMake when ONNX Runtime was found and linked.
+#ifndef TOOLSDETECT_HAS_ONNXRUNTIME
+#define TOOLSDETECT_HAS_ONNXRUNTIME 0
+#endif
+
+enum class ModelPrecision {
+    Auto,   // INT8 sibling if present (ort only), else the model as given
+    Fp32,   // always the model as given
+    Int8,   // the INT8 sibling; an error if it does not exist
+};
+
+// Parses "auto" / "fp32" / "int8".
+bool parseModelPrecision(const std::string& text, ModelPrecision& out);
+
+// "dir/best.onnx" -> "dir/best.int8.onnx"
+std::wstring int8ModelPathFor(const std::wstring& modelPath);
+
+struct DetectorConfig {
+    std::wstring modelPath = kDefaultModelPath;
+    ModelPrecision precision = ModelPrecision::Auto;
+    int inputWidth = kYoloInputWidth;
+    int inputHeight = kYoloInputHeight;
+    float confThreshold = kYoloConfidenceThreshold;
+    float nmsThreshold = kYoloNmsThreshold;
+    std::vector<std::string> classNames = getDefaultToolClassNames();
+    // Low-memory mode (ort only, --low-memory): the model is memory-mapped
+    // instead of read into the heap. A .onnx model is first converted once to
+    // a sibling .ort file, because ORT only uses the weights in place (shared
+    // between processes through the page cache) for ORT-format models; sessions
+    // share one arena allocator registered on the process-wide Ort::Env, and
+    // the arena releases unused chunks after every run.
+    bool lowMemory = false;
+};
+
+class DetectorBackend {
+public:
+    virtual ~DetectorBackend() = default;
+
+    // Short identifier ("ort", "opencv").
+    virtual const char* name() const = 0;
+
+    // Runs several images; results are returned in input order and empty
+    // images get an empty result. Must be safe to call from several threads.
+    virtual std::vector<std::vector<YoloResult>> inferBatch(const std::vector<cv::Mat>& images) = 0;
+
+    // True if inferBatch() runs a whole batch in one model invocation.
+    virtual bool supportsDynamicBatch() const { return false; }
+
+    // True if the model has symbolic H/W dims, so inferBatchAtSize() can run
+    // other square input sizes (multiples of 32) than the configured one.
+    virtual bool supportsDynamicInputSize() const { return false; }
+
+    // Side of the configured (or model-fixed) input, in pixels.
+    virtual int defaultInputSize() const { return kYoloInputWidth; }
+
+    // inferBatch() at an input size of `inputSize` x `inputSize`; 0 or an
+    // unsupported size falls back to the configured size.
+    virtual std::vector<std::vector<YoloResult>> inferBatchAtSize(const std::vector<cv::Mat>& images,
+                                                                  int inputSize) {
+        (void)inputSize;
+        return inferBatch(images);
+    }
+
+    virtual const std::vector<std::string>& classNames() const = 0;
+
+    std::vector<YoloResult> infer(const cv::Mat& image) {
+        if (image.empty()) return {};
+        return inferBatch({image}).front();
+    }
+
+    std::vector<YoloResult> inferAtSize(const cv::Mat& image, int inputSize) {
+        if (image.empty()) return {};
+        return inferBatchAtSize({image}, inputSize).front();
+    }
+
+    std::string classNameOrDefault(int class_id) const {
+        const auto& names = classNames();
+        if (class_id >= 0 && class_id < static_cast<int>(names.size())) {
+            return names[class_id];
+        }
+        return "class_" + std::to_string(class_id);
+    }
+};
+
+// Factory for an out-of-tree backend (a vendor runtime, or a fake in tests).
+// It receives the config with the model path already resolved; throws like
+// createDetectorBackend() on failure.
+using DetectorBackendFactory = std::function<std::unique_ptr<DetectorBackend>(const DetectorConfig&)>;
+
+// Makes `name` available to createDetectorBackend(). Built-in names cannot be
+// replaced; registering an existing custom name replaces its factory.
+// Returns false for an empty or built-in name.
+bool registerDetectorBackend(const std::string& name, DetectorBackendFactory factory);
+
+// Backends compiled into this build, preferred first, then registered ones in
+// registration order.
+std::vector<std::string> availableDetectorBackends();
+
+// The backend used when none is requested: the first available one.
+std::string defaultDetectorBackend();
+
+// Creates backend `name` ("ort", "opencv" or a registered one). Throws std::runtime_error if the
+// name is unknown, the backend is not compiled in, or the model fails to load.
+std::unique_ptr<DetectorBackend> createDetectorBackend(const std::string& name,
+                                                       const DetectorConfig& config = DetectorConfig());
+
+// The model file createDetectorBackend(name, config) loads: the INT8 sibling
+// when the precision asks for it (see above), otherwise config.modelPath.
+// Throws std::runtime_error if an INT8 model is required but missing.
+std::wstring resolvedModelPath(const std::string& name, const DetectorConfig& config = DetectorConfig());
@@ -0,0 +1,349 @@
+// eval_main.cpp
+// toolsdetect_eval: accuracy of the model on a YOLO-labelled folder across
+// a grid of confidence and NMS IoU thresholds. Every image is run through
+// the model once, on a pool of worker threads, with the confidence floor
+// lowered to --min-conf and NMS disabled; the raw candidates are cached in a
+// compact binary file next to the ground truth. Each threshold setting is
+// then a score cut plus NMS over the cache, so a full sweep takes
+// milliseconds per setting instead of one model run per setting.
+//
+// Reported per setting: precision, recall and F1 over all boxes, mAP at
+// --match-iou, the share of images whose per-class counts are right, and the
+// share of sessions whose inventory delta (after - before count per class)
+// is right. Sessions are the <id>_before / <id>_after pairs of the folder
+// (the --watch naming); a folder without such pairs is read as a sequence
+// and every two neighbouring images form a session.
+
+#include "detection_eval.h"
+#include "detector_backend.h"
+#include "eval_sweep.h"
+#include "trace.h"
+#include "yolo_common.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct EvalOptions {
+    std::string modelPath;        // needed unless the cache is reused
+    std::string labelsDir;
+    std::string cachePath = "eval_cache.tdeval";
+    bool rebuild = false;
+    std::string backend;          // empty = default backend
+    int workers = 0;              // 0 = #cores
+    float minConf = 0.05f;        // candidate floor stored in the cache
+    std::string lighting = "off"; // --lighting of the inference run, for A/B
+    Range conf{0.10f, 0.90f, 0.05f};
+    Range iou{0.30f, 0.70f, 0.05f};
+    float matchIou = 0.5f;        // prediction/truth match threshold
+    std::string outPath;          // CSV of the sweep; empty = none
+};
+
+void printUsage(const char* argv0) {
+    std::cout
+        << "Usage: " << argv0 << " --labels <dir> [options]\n"
+        << "  --labels <dir>        YOLO-labelled image folder (img.jpg + img.txt or labels/img.txt)\n"
+        << "  --model <file.onnx>   Model to evaluate; not needed when --cache is reused\n"
+        << "  --cache <file>        Candidate cache (default: eval_cache.tdeval). Reused when it\n"
+        << "                        matches --labels, --min-conf, --lighting and the --model\n"
+        << "                        file (path, size, mtime), otherwise rebuilt\n"
+        << "  --rebuild             Run the model even if the cache could be reused\n"
+        << "  --backend <name>      Inference backend: ort | opencv (default: first available)\n"
+        << "  --workers <n>         Inference threads (default: #cores)\n"
+        << "  --min-conf <x>        Lowest confidence kept in the cache (default: 0.05)\n"
+        << "  --lighting <mode>     Lighting normalization for the run: off | grayworld |\n"
+        << "                        patch:x,y,w,h (default: off); part of the cache key\n"
+        << "  --conf <from:to:step> Confidence thresholds to sweep (default: 0.10:0.90:0.05)\n"
+        << "  --iou <from:to:step>  NMS IoU thresholds to sweep (default: 0.30:0.70:0.05)\n"
+        << "  --match-iou <x>       IoU for a prediction to count as a hit (default: 0.5)\n"
+        << "  --out <file.csv>      Also write every setting of the sweep as CSV\n"
+        << "  -h, --help            Show this help\n";
+}
+
+std::string backendName(const EvalOptions& options) {
+    return options.backend.empty() ? defaultDetectorBackend() : options.backend;
+}
+
+// Stamp of the model file the backend loads for --model (e.g. its INT8
+// sibling), for the cache key.
+bool modelStamp(const EvalOptions& options, ModelStamp& out) {
+    DetectorConfig config;
+    config.modelPath = utf8ToWide(options.modelPath);
+    try {
+        return stampModelFile(wideToUtf8(resolvedModelPath(backendName(options), config)), out);
+    } catch (const std::exception&) {
+        return false;   // a required model is missing; building the cache reports it
+    }
+}
+
+// Runs every labelled image through `backend` once on `workers` threads.
+// The backend is shared; DetectorBackend::inferBatch() is thread-safe.
+bool buildCache(const EvalOptions& options, CandidateCache& cache) {
+    const std::vector<LabelledImage> labelled = loadLabelledFolder(options.labelsDir);
+    if (labelled.empty()) {
+        std::cerr << "[ERROR] No labelled images in " << options.labelsDir << "\n";
+        return false;
+    }
+
+    DetectorConfig config;
+    config.modelPath = utf8ToWide(options.modelPath);
+    config.confThreshold = options.minConf;
+    config.nmsThreshold = 1.0f;   // IoU never exceeds 1: nothing is suppressed
+    std::unique_ptr<DetectorBackend> backend;
+    try {
+        backend = createDetectorBackend(backendName(options), config);
+    } catch (const std::exception& ex) {
+        std::cerr << "[ERROR] " << ex.what() << "\n";
+        return false;
+    }
+
+    cache.labelsDir = options.labelsDir;
+    modelStamp(options, cache.model);
+    cache.minConf = options.minConf;
+    cache.lighting = options.lighting;
+    cache.classNames = backend->classNames();
+    cache.images.assign(labelled.size(), CachedImage());
+
+    int workers = options.workers;
+    if (workers <= 0) {
+        workers = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    workers = std::min<int>(workers, static_cast<int>(labelled.size()));
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    std::mutex progressMutex;
+    const auto start = Clock::now();
+    auto work = [&](int index) {
+        trace::setThreadName("eval-worker-" + std::to_string(index));
+        for (size_t i = next++; i < labelled.size(); i = next++) {
+            CachedImage& image = cache.images[i];
+            image.imagePath = labelled[i].imagePath;
+            image.truth = labelled[i].truth;
+            const cv::Mat img = cv::imread(image.imagePath);
+            if (img.empty()) {
+                std::lock_guard<std::mutex> lock(progressMutex);
+                std::cerr << "[WARN] Cannot read " << image.imagePath << "\n";
+            } else {
+                image.width = img.cols;
+                image.height = img.rows;
+                image.candidates = backend->infer(img);
+                std::sort(image.candidates.begin(), image.candidates.end(),
+                          [](const YoloResult& a, const YoloResult& b) { return a.score > b.score; });
+            }
+            const size_t finished = ++done;
+            if (finished % 50 == 0 || finished == labelled.size()) {
+                std::lock_guard<std::mutex> lock(progressMutex);
+                std::cerr << "[INFO] Inference " << finished << "/" << labelled.size() << "\n";
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int w = 1; w < workers; ++w) pool.emplace_back(work, w);
+    work(0);
+    for (auto& t : pool) t.join();
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    size_t candidates = 0;
+    for (const auto& image : cache.images) candidates += image.candidates.size();
+    std::cerr << std::fixed << std::setprecision(2) << "[INFO] " << labelled.size() << " images on "
+              << workers << " worker(s) (" << backend->name() << ") in " << seconds << " s, "
+              << candidates << " candidates >= " << options.minConf << "\n";
+    std::cerr.unsetf(std::ios::floatfield);
+    return true;
+}
+
+std::string className(const CandidateCache& cache, int id) {
+    if (id >= 0 && id < static_cast<int>(cache.classNames.size())) return cache.classNames[id];
+    return "class_" + std::to_string(id);
+}
+
+void printPerClass(const CandidateCache& cache, const SweepResult& r, const char* title) {
+    std::cout << "\n" << title << " (conf " << r.conf << ", NMS IoU " << r.iou << ")\n"
+              << std::left << std::setw(20) << "class" << std::right << std::setw(8) << "TP"
+              << std::setw(8) << "FP" << std::setw(8) << "FN" << std::setw(11) << "precision"
+              << std::setw(9) << "recall" << "\n";
+    for (const auto& entry : r.perClass) {
+        const ClassMatchCounts& c = entry.second;
+        std::cout << std::left << std::setw(20) << className(cache, entry.first) << std::right
+                  << std::setw(8) << c.truePositives << std::setw(8) << c.falsePositives
+                  << std::setw(8) << c.falseNegatives << std::setw(11) << c.precision()
+                  << std::setw(9) << c.recall() << "\n";
+    }
+}
+
+bool writeCsv(const std::string& path, const std::vector<SweepResult>& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+    out << "conf,nms_iou,precision,recall,f1,map,count_rate,delta_rate,ms\n";
+    out << std::fixed << std::setprecision(4);
+    for (const auto& r : results) {
+        out << r.conf << ',' << r.iou << ',' << r.precision << ',' << r.recall << ',' << r.f1 << ','
+            << r.map << ',' << r.countRate << ',' << r.deltaRate << ',' << r.ms << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    EvalOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--model" && hasValue) {
+            options.modelPath = argv[++i];
+        } else if (arg == "--labels" && hasValue) {
+            options.labelsDir = argv[++i];
+        } else if (arg == "--cache" && hasValue) {
+            options.cachePath = argv[++i];
+        } else if (arg == "--rebuild") {
+            options.rebuild = true;
+        } else if (arg == "--backend" && hasValue) {
+            options.backend = argv[++i];
+        } else if (arg == "--workers" && hasValue) {
+            options.workers = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--min-conf" && hasValue) {
+            options.minConf = std::min(1.0f, std::max(0.0f, static_cast<float>(std::atof(argv[++i]))));
+        } else if (arg == "--lighting" && hasValue) {
+            LightingConfig lighting;
+            options.lighting = argv[++i];
+            if (!parseLightingSpec(options.lighting, lighting)) {
+                std::cerr << "[ERROR] Invalid value for --lighting: " << options.lighting << "\n";
+                return 2;
+            }
+            setLightingNormalization(lighting);
+            options.lighting = describeLighting(lighting);
+        } else if ((arg == "--conf" || arg == "--iou") && hasValue) {
+            const std::string text = argv[++i];
+            if (!parseRange(text, arg == "--conf" ? options.conf : options.iou)) {
+                std::cerr << "[ERROR] Invalid value for " << arg << ": " << text << "\n";
+                return 2;
+            }
+        } else if (arg == "--match-iou" && hasValue) {
+            options.matchIou = std::min(1.0f, std::max(0.0f, static_cast<float>(std::atof(argv[++i]))));
+        } else if (arg == "--out" && hasValue) {
+            options.outPath = argv[++i];
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "[ERROR] Unknown or incomplete option: " << arg << "\n";
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.labelsDir.empty()) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    CandidateCache cache;
+    bool haveCache = false;
+    if (!options.rebuild && readCandidateCache(options.cachePath, cache)) {
+        // Without --model the cache is taken as is; with it, the model file
+        // has to be the one the cache was built with.
+        ModelStamp model = cache.model;
+        const bool sameModel = options.modelPath.empty() || (modelStamp(options, model) && model == cache.model);
+        if (cache.labelsDir != options.labelsDir || cache.minConf > options.minConf ||
+            cache.lighting != options.lighting) {
+            std::cerr << "[INFO] " << options.cachePath << " was built for " << cache.labelsDir
+                      << " at --min-conf " << cache.minConf << ", --lighting " << cache.lighting
+                      << "; rebuilding\n";
+        } else if (!sameModel) {
+            std::cerr << "[INFO] " << options.cachePath << " was built with " << cache.model.path
+                      << " (" << cache.model.size << " bytes), not the current model; rebuilding\n";
+        } else {
+            haveCache = true;
+            std::cerr << "[INFO] Reusing " << options.cachePath << " (" << cache.images.size()
+                      << " images)\n";
+        }
+    }
+    if (!haveCache) {
+        if (options.modelPath.empty()) {
+            std::cerr << "[ERROR] --model is required to build " << options.cachePath << "\n";
+            return 2;
+        }
+        cache = CandidateCache();
+        if (!buildCache(options, cache)) return 1;
+        if (!writeCandidateCache(options.cachePath, cache)) {
+            std::cerr << "[WARN] Cannot write " << options.cachePath << "; the sweep still runs\n";
+        }
+    }
+    if (options.conf.from < cache.minConf) {
+        std::cerr << "[WARN] Confidence thresholds below the cache floor " << cache.minConf
+                  << " see only candidates >= " << cache.minConf << "\n";
+    }
+
+    const auto sessions = findSessions(cache.images);
+    std::vector<ClassCounts> truthCounts;
+    truthCounts.reserve(cache.images.size());
+    for (const auto& image : cache.images) truthCounts.push_back(countPerClass(image.truth));
+
+    std::vector<SweepResult> results;
+    for (float conf : options.conf.values()) {
+        for (float iou : options.iou.values()) {
+            results.push_back(evaluateSetting(cache, sessions, truthCounts, conf, iou, options.matchIou));
+        }
+    }
+    if (results.empty()) return 0;
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "[RESULT] " << cache.images.size() << " images, " << sessions.size()
+              << " sessions, match IoU " << options.matchIou << ", lighting " << cache.lighting << "\n"
+              << std::setw(6) << "conf" << std::setw(8) << "nms" << std::setw(11) << "precision"
+              << std::setw(9) << "recall" << std::setw(8) << "F1" << std::setw(8) << "mAP"
+              << std::setw(9) << "counts" << std::setw(9) << "deltas" << std::setw(9) << "ms" << "\n";
+    const SweepResult* best = &results.front();
+    const SweepResult* current = nullptr;
+    double totalMs = 0.0;
+    for (const auto& r : results) {
+        std::cout << std::setw(6) << r.conf << std::setw(8) << r.iou << std::setw(11) << r.precision
+                  << std::setw(9) << r.recall << std::setw(8) << r.f1 << std::setw(8) << r.map
+                  << std::setw(9) << r.countRate << std::setw(9) << r.deltaRate << std::setw(9)
+                  << r.ms << "\n";
+        totalMs += r.ms;
+        // The inventory delta is what raises alarms, so it ranks first.
+        if (r.deltaRate > best->deltaRate || (r.deltaRate == best->deltaRate && r.f1 > best->f1)) {
+            best = &r;
+        }
+        if (std::fabs(r.conf - kYoloConfidenceThreshold) < 1e-4f && std::fabs(r.iou - kYoloNmsThreshold) < 1e-4f) {
+            current = &r;
+        }
+    }
+    std::cout << std::setprecision(2) << results.size() << " settings in " << totalMs << " ms ("
+              << totalMs / static_cast<double>(results.size()) << " ms each)\n"
+              << std::setprecision(3);
+
+    printPerClass(cache, *best, "[RESULT] Best setting by inventory delta rate, then F1");
+    if (current && current != best) {
+        printPerClass(cache, *current, "[RESULT] Compiled-in defaults");
+    }
+    std::cout.unsetf(std::ios::floatfield);
+
+    if (!options.outPath.empty()) {
+        if (!writeCsv(options.outPath, results)) {
+            std::cerr << "[ERROR] Cannot write " << options.outPath << "\n";
+            return 1;
+        }
+        std::cerr << "[INFO] Sweep written to " << options.outPath << "\n";
+    }
+    return 0;
+}
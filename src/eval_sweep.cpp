@@ -0,0 +1,317 @@
+// eval_sweep.cpp
+
+#include "eval_sweep.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace {
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+// File layout (native byte order; the cache is a local scratch file):
+//   "TDEVAL\0\0" u32 version, labelsDir, model path, u64 model size,
+//   i64 model mtime, f32 minConf, lighting,
+//   u32 #classes, class names, u32 #images, then per image:
+//   path, i32 width, i32 height, u32 #truth, TruthRecord..., u32 #candidates,
+//   CandidateRecord... with an ObbRecord after each oriented candidate.
+// Strings are a u32 length followed by the bytes.
+constexpr char kCacheMagic[8] = {'T', 'D', 'E', 'V', 'A', 'L', 0, 0};
+constexpr uint32_t kCacheVersion = 3;   // 3: model stamp
+
+#pragma pack(push, 1)
+struct TruthRecord {
+    int32_t classId;
+    float x, y, w, h;
+};
+struct CandidateRecord {
+    int16_t classId;
+    uint8_t oriented;
+    uint8_t reserved;
+    float score;
+    int32_t x, y, w, h;
+};
+struct ObbRecord {
+    float cx, cy, w, h, angle;
+};
+#pragma pack(pop)
+static_assert(sizeof(CandidateRecord) == 24, "cache record layout");
+
+template <typename T>
+void writePod(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readPod(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+void writeString(std::ostream& out, const std::string& s) {
+    writePod(out, static_cast<uint32_t>(s.size()));
+    out.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+
+bool readString(std::istream& in, std::string& s) {
+    uint32_t size = 0;
+    if (!readPod(in, size) || size > (1u << 20)) return false;
+    s.resize(size);
+    return size == 0 || static_cast<bool>(in.read(&s[0], size));
+}
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() &&
+           text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+}  // namespace
+
+std::vector<float> Range::values() const {
+    std::vector<float> out;
+    if (step <= 0.0f) {
+        out.push_back(from);
+        return out;
+    }
+    // Integer stepping so 0.05 increments do not drift past `to`.
+    const int n = static_cast<int>(std::floor((to - from) / step + 1e-4f));
+    for (int i = 0; i <= n; ++i) out.push_back(from + step * static_cast<float>(i));
+    return out;
+}
+
+bool parseRange(const std::string& text, Range& out) {
+    Range r;
+    char c1 = 0, c2 = 0;
+    std::istringstream ss(text);
+    if (ss >> r.from) {
+        if (ss >> c1) {
+            if (c1 != ':' || !(ss >> r.to >> c2 >> r.step) || c2 != ':') return false;
+        } else {
+            r.to = r.from;
+        }
+    } else {
+        return false;
+    }
+    if (r.from < 0.0f || r.to > 1.0f || r.to < r.from || r.step < 0.0f) return false;
+    out = r;
+    return true;
+}
+
+bool stampModelFile(const std::string& path, ModelStamp& out) {
+    std::error_code ec;
+    const fs::path file = fs::absolute(fs::u8path(path), ec);
+    if (ec) return false;
+    const uintmax_t size = fs::file_size(file, ec);
+    if (ec) return false;
+    const fs::file_time_type mtime = fs::last_write_time(file, ec);
+    if (ec) return false;
+    out.path = file.lexically_normal().u8string();
+    out.size = static_cast<uint64_t>(size);
+    out.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+    return true;
+}
+
+bool writeCandidateCache(const std::string& path, const CandidateCache& cache) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+    out.write(kCacheMagic, sizeof(kCacheMagic));
+    writePod(out, kCacheVersion);
+    writeString(out, cache.labelsDir);
+    writeString(out, cache.model.path);
+    writePod(out, cache.model.size);
+    writePod(out, cache.model.mtime);
+    writePod(out, cache.minConf);
+    writeString(out, cache.lighting);
+    writePod(out, static_cast<uint32_t>(cache.classNames.size()));
+    for (const auto& name : cache.classNames) writeString(out, name);
+    writePod(out, static_cast<uint32_t>(cache.images.size()));
+    for (const auto& image : cache.images) {
+        writeString(out, image.imagePath);
+        writePod(out, static_cast<int32_t>(image.width));
+        writePod(out, static_cast<int32_t>(image.height));
+        writePod(out, static_cast<uint32_t>(image.truth.size()));
+        for (const auto& t : image.truth) {
+            writePod(out, TruthRecord{t.class_id, t.box.x, t.box.y, t.box.width, t.box.height});
+        }
+        writePod(out, static_cast<uint32_t>(image.candidates.size()));
+        for (const auto& c : image.candidates) {
+            CandidateRecord rec{static_cast<int16_t>(c.class_id), static_cast<uint8_t>(c.oriented ? 1 : 0), 0,
+                                c.score, c.box.x, c.box.y, c.box.width, c.box.height};
+            writePod(out, rec);
+            if (c.oriented) {
+                writePod(out, ObbRecord{c.obb.center.x, c.obb.center.y, c.obb.size.width,
+                                        c.obb.size.height, c.obb.angle});
+            }
+        }
+    }
+    return static_cast<bool>(out);
+}
+
+bool readCandidateCache(const std::string& path, CandidateCache& cache) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) return false;
+    char magic[sizeof(kCacheMagic)] = {};
+    uint32_t version = 0;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kCacheMagic, sizeof(magic)) != 0 ||
+        !readPod(in, version) || version != kCacheVersion) {
+        return false;
+    }
+    uint32_t classCount = 0;
+    uint32_t imageCount = 0;
+    if (!readString(in, cache.labelsDir) || !readString(in, cache.model.path) ||
+        !readPod(in, cache.model.size) || !readPod(in, cache.model.mtime) || !readPod(in, cache.minConf) ||
+        !readString(in, cache.lighting) || !readPod(in, classCount)) {
+        return false;
+    }
+    cache.classNames.resize(classCount);
+    for (auto& name : cache.classNames) {
+        if (!readString(in, name)) return false;
+    }
+    if (!readPod(in, imageCount)) return false;
+    cache.images.clear();
+    cache.images.reserve(imageCount);
+    for (uint32_t i = 0; i < imageCount; ++i) {
+        CachedImage image;
+        int32_t width = 0, height = 0;
+        uint32_t truthCount = 0, candidateCount = 0;
+        if (!readString(in, image.imagePath) || !readPod(in, width) || !readPod(in, height) ||
+            !readPod(in, truthCount)) {
+            return false;
+        }
+        image.width = width;
+        image.height = height;
+        image.truth.resize(truthCount);
+        for (auto& t : image.truth) {
+            TruthRecord rec{};
+            if (!readPod(in, rec)) return false;
+            t.class_id = rec.classId;
+            t.box = cv::Rect2f(rec.x, rec.y, rec.w, rec.h);
+        }
+        if (!readPod(in, candidateCount)) return false;
+        image.candidates.resize(candidateCount);
+        for (auto& c : image.candidates) {
+            CandidateRecord rec{};
+            if (!readPod(in, rec)) return false;
+            c.class_id = rec.classId;
+            c.score = rec.score;
+            c.box = cv::Rect(rec.x, rec.y, rec.w, rec.h);
+            c.oriented = rec.oriented != 0;
+            if (c.oriented) {
+                ObbRecord obb{};
+                if (!readPod(in, obb)) return false;
+                c.obb = cv::RotatedRect(cv::Point2f(obb.cx, obb.cy), cv::Size2f(obb.w, obb.h), obb.angle);
+            }
+        }
+        cache.images.push_back(std::move(image));
+    }
+    return true;
+}
+
+ClassCounts countPerClass(const std::vector<LabelledBox>& boxes) {
+    ClassCounts counts;
+    for (const auto& b : boxes) ++counts[b.class_id];
+    return counts;
+}
+
+ClassCounts countPerClass(const std::vector<YoloResult>& boxes) {
+    ClassCounts counts;
+    for (const auto& b : boxes) ++counts[b.class_id];
+    return counts;
+}
+
+ClassCounts countDelta(const ClassCounts& before, const ClassCounts& after) {
+    ClassCounts delta;
+    for (const auto& entry : before) delta[entry.first] -= entry.second;
+    for (const auto& entry : after) delta[entry.first] += entry.second;
+    for (auto it = delta.begin(); it != delta.end();) {
+        it = it->second == 0 ? delta.erase(it) : std::next(it);
+    }
+    return delta;
+}
+
+std::vector<std::pair<size_t, size_t>> findSessions(const std::vector<CachedImage>& images) {
+    std::map<std::string, std::pair<int, int>> byId;
+    for (size_t i = 0; i < images.size(); ++i) {
+        const std::string stem = fs::path(images[i].imagePath).stem().string();
+        if (endsWith(stem, "_before")) {
+            byId[stem.substr(0, stem.size() - 7)].first = static_cast<int>(i) + 1;
+        } else if (endsWith(stem, "_after")) {
+            byId[stem.substr(0, stem.size() - 6)].second = static_cast<int>(i) + 1;
+        }
+    }
+    std::vector<std::pair<size_t, size_t>> sessions;
+    for (const auto& entry : byId) {
+        if (entry.second.first > 0 && entry.second.second > 0) {
+            sessions.emplace_back(entry.second.first - 1, entry.second.second - 1);
+        }
+    }
+    if (sessions.empty()) {
+        for (size_t i = 1; i < images.size(); ++i) sessions.emplace_back(i - 1, i);
+    }
+    return sessions;
+}
+
+std::vector<YoloResult> applyThresholds(const std::vector<YoloResult>& candidates, float conf, float iou) {
+    const auto end = std::find_if(candidates.begin(), candidates.end(),
+                                  [conf](const YoloResult& r) { return r.score < conf; });
+    const std::vector<YoloResult> kept(candidates.begin(), end);
+    const bool oriented = !kept.empty() && kept.front().oriented;
+    const std::vector<int> keep = oriented ? nmsRotated(kept, iou) : nms(kept, iou);
+    std::vector<YoloResult> out;
+    out.reserve(keep.size());
+    for (int idx : keep) out.push_back(kept[idx]);
+    return out;
+}
+
+SweepResult evaluateSetting(const CandidateCache& cache,
+                            const std::vector<std::pair<size_t, size_t>>& sessions,
+                            const std::vector<ClassCounts>& truthCounts,
+                            float conf,
+                            float iou,
+                            float matchIou) {
+    const auto start = Clock::now();
+    SweepResult result;
+    result.conf = conf;
+    result.iou = iou;
+
+    std::vector<EvalSample> samples(cache.images.size());
+    std::vector<ClassCounts> predictedCounts(cache.images.size());
+    size_t countsRight = 0;
+    for (size_t i = 0; i < cache.images.size(); ++i) {
+        samples[i].truth = cache.images[i].truth;
+        samples[i].predictions = applyThresholds(cache.images[i].candidates, conf, iou);
+        predictedCounts[i] = countPerClass(samples[i].predictions);
+        if (predictedCounts[i] == truthCounts[i]) ++countsRight;
+    }
+    size_t deltasRight = 0;
+    for (const auto& session : sessions) {
+        if (countDelta(predictedCounts[session.first], predictedCounts[session.second]) ==
+            countDelta(truthCounts[session.first], truthCounts[session.second])) {
+            ++deltasRight;
+        }
+    }
+
+    result.perClass = classMatchCounts(samples, matchIou);
+    ClassMatchCounts total;
+    for (const auto& entry : result.perClass) {
+        total.truePositives += entry.second.truePositives;
+        total.falsePositives += entry.second.falsePositives;
+        total.falseNegatives += entry.second.falseNegatives;
+    }
+    result.precision = total.precision();
+    result.recall = total.recall();
+    result.f1 = result.precision + result.recall > 0.0
+                    ? 2.0 * result.precision * result.recall / (result.precision + result.recall)
+                    : 0.0;
+    result.map = meanAveragePrecision(samples, matchIou);
+    result.countRate = samples.empty() ? 0.0 : static_cast<double>(countsRight) / samples.size();
+    result.deltaRate = sessions.empty() ? 0.0 : static_cast<double>(deltasRight) / sessions.size();
+    result.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return result;
+}
@@ -0,0 +1,112 @@
+// eval_sweep.h
+// Threshold sweep of toolsdetect_eval: the candidate cache (raw model output
+// per labelled image, stored once) and the per-setting evaluation over it.
+// A setting is a score cut plus NMS of the cached candidates, so a sweep
+// never runs the model.
+
+#pragma once
+
+#include "detection_eval.h"
+#include "yolo_common.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// An inclusive from:to:step range of thresholds.
+struct Range {
+    float from = 0.0f;
+    float to = 0.0f;
+    float step = 0.0f;
+
+    std::vector<float> values() const;
+};
+
+// Parses "from:to:step" or a single value, all within 0..1.
+bool parseRange(const std::string& text, Range& out);
+
+// ---------------------------------------------------------------------------
+// Candidate cache
+// ---------------------------------------------------------------------------
+
+// Identifies the model file a cache was built with, so a retrained or
+// re-quantized model at the same path is not evaluated from stale output.
+struct ModelStamp {
+    std::string path;        // absolute, UTF-8
+    uint64_t size = 0;
+    int64_t mtime = 0;       // file clock ticks
+
+    bool operator==(const ModelStamp& o) const {
+        return path == o.path && size == o.size && mtime == o.mtime;
+    }
+    bool operator!=(const ModelStamp& o) const { return !(*this == o); }
+};
+
+// Stamps `path` (UTF-8); returns false if it cannot be read.
+bool stampModelFile(const std::string& path, ModelStamp& out);
+
+struct CachedImage {
+    std::string imagePath;
+    int width = 0;
+    int height = 0;
+    std::vector<LabelledBox> truth;
+    std::vector<YoloResult> candidates;   // descending score, before NMS
+};
+
+struct CandidateCache {
+    std::string labelsDir;
+    ModelStamp model;
+    float minConf = 0.0f;
+    std::string lighting;
+    std::vector<std::string> classNames;
+    std::vector<CachedImage> images;
+};
+
+// Returns false on an I/O error, or when reading a file of another format or
+// version; the caller then rebuilds the cache.
+bool writeCandidateCache(const std::string& path, const CandidateCache& cache);
+bool readCandidateCache(const std::string& path, CandidateCache& cache);
+
+// ---------------------------------------------------------------------------
+// Sweep
+// ---------------------------------------------------------------------------
+
+using ClassCounts = std::map<int, int>;
+
+ClassCounts countPerClass(const std::vector<LabelledBox>& boxes);
+ClassCounts countPerClass(const std::vector<YoloResult>& boxes);
+// after - before per class; classes without a change are left out.
+ClassCounts countDelta(const ClassCounts& before, const ClassCounts& after);
+
+// Index pairs (before, after) of the sessions in the cache: the
+// <id>_before / <id>_after images (the --watch naming), or, in a folder
+// without such pairs, every two neighbouring images.
+std::vector<std::pair<size_t, size_t>> findSessions(const std::vector<CachedImage>& images);
+
+struct SweepResult {
+    float conf = 0.0f;
+    float iou = 0.0f;
+    std::map<int, ClassMatchCounts> perClass;
+    double precision = 0.0;
+    double recall = 0.0;
+    double f1 = 0.0;
+    double map = 0.0;
+    double countRate = 0.0;   // images with every class count right
+    double deltaRate = 0.0;   // sessions with the right inventory delta
+    double ms = 0.0;
+};
+
+// Score cut + NMS of the cached candidates, as the detector would return
+// them at (conf, iou).
+std::vector<YoloResult> applyThresholds(const std::vector<YoloResult>& candidates, float conf, float iou);
+
+// `truthCounts` is countPerClass() of each image's truth, computed once per
+// sweep.
+SweepResult evaluateSetting(const CandidateCache& cache,
+                            const std::vector<std::pair<size_t, size_t>>& sessions,
+                            const std::vector<ClassCounts>& truthCounts,
+                            float conf,
+                            float iou,
+                            float matchIou);
@@ -0,0 +1,226 @@
+// infer_client.cpp
+// Unix-socket + shared-memory client for toolsdetect_server.
+
+#include "infer_client.h"
+
+#include "infer_protocol.h"
+
+#include <cstring>
+#include <iostream>
+
+#if TOOLSDETECT_HAS_INFER_SERVER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#endif
+
+InferClient::~InferClient() {
+    disconnect();
+}
+
+#if TOOLSDETECT_HAS_INFER_SERVER
+
+namespace {
+
+std::atomic<unsigned> g_segmentCounter{0};
+
+}  // namespace
+
+bool InferClient::connect(const std::string& socketPath) {
+    disconnect();
+
+    sockaddr_un addr{};
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "[ERROR] Inference socket path too long: " << socketPath << "\n";
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::cerr << "[ERROR] socket() failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::cerr << "[ERROR] Cannot connect to inference server at " << socketPath
+                  << ": " << std::strerror(errno) << "\n";
+        ::close(fd);
+        return false;
+    }
+    fd_ = fd;
+    return true;
+}
+
+void InferClient::disconnect() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    releaseSegment();
+}
+
+void InferClient::releaseSegment() {
+    if (shmData_) {
+        ::munmap(shmData_, shmSize_);
+        shmData_ = nullptr;
+    }
+    if (!shmName_.empty()) {
+        ::shm_unlink(shmName_.c_str());
+        shmName_.clear();
+    }
+    shmSize_ = 0;
+}
+
+bool InferClient::ensureSegment(size_t bytes) {
+    if (shmData_ && bytes <= shmSize_) {
+        return true;
+    }
+    releaseSegment();
+
+    // Round up to whole MiB so small size changes do not re-create it.
+    const size_t size = (bytes + (1u << 20) - 1) & ~static_cast<size_t>((1u << 20) - 1);
+    const std::string name = "/toolsdetect-" + std::to_string(::getpid()) + "-" +
+                             std::to_string(g_segmentCounter.fetch_add(1));
+    int shmFd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (shmFd < 0) {
+        std::cerr << "[ERROR] shm_open(" << name << ") failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    if (::ftruncate(shmFd, static_cast<off_t>(size)) != 0) {
+        std::cerr << "[ERROR] ftruncate on " << name << " failed: " << std::strerror(errno) << "\n";
+        ::close(shmFd);
+        ::shm_unlink(name.c_str());
+        return false;
+    }
+    void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    ::close(shmFd);
+    if (data == MAP_FAILED) {
+        std::cerr << "[ERROR] mmap on " << name << " failed: " << std::strerror(errno) << "\n";
+        ::shm_unlink(name.c_str());
+        return false;
+    }
+    shmName_ = name;
+    shmData_ = data;
+    shmSize_ = size;
+
+    InferRequestHeader hello;
+    hello.type = static_cast<uint32_t>(InferMessageType::Hello);
+    hello.requestId = nextRequestId_++;
+    std::strncpy(hello.shmName, shmName_.c_str(), sizeof(hello.shmName) - 1);
+    hello.shmSize = shmSize_;
+    InferResponseHeader ack;
+    if (!inferSendAll(fd_, &hello, sizeof(hello)) ||
+        !inferRecvAll(fd_, &ack, sizeof(ack)) ||
+        ack.magic != kInferProtocolMagic ||
+        ack.status != static_cast<int32_t>(InferStatus::Ok)) {
+        std::cerr << "[ERROR] Inference server rejected shared-memory segment " << shmName_ << "\n";
+        return false;
+    }
+
+    // Both sides have it mapped now; drop the name so a crash cannot leak it.
+    ::shm_unlink(shmName_.c_str());
+    shmName_.clear();
+    return true;
+}
+
+std::vector<YoloResult> InferClient::detect(const cv::Mat& image,
+                                            bool* ok,
+                                            InferServerTiming* timing) {
+    if (ok) *ok = false;
+    if (fd_ < 0 || image.empty() || image.type() != CV_8UC3) {
+        return {};
+    }
+
+    const size_t rowBytes = static_cast<size_t>(image.cols) * image.elemSize();
+    const size_t bytes = rowBytes * static_cast<size_t>(image.rows);
+    if (!ensureSegment(bytes)) {
+        disconnect();
+        return {};
+    }
+
+    // The only pixel copy on the client side: straight into the segment the
+    // server reads from.
+    cv::Mat shared(image.rows, image.cols, CV_8UC3, shmData_, rowBytes);
+    image.copyTo(shared);
+
+    InferRequestHeader req;
+    req.type = static_cast<uint32_t>(InferMessageType::Detect);
+    req.requestId = nextRequestId_++;
+    req.rows = image.rows;
+    req.cols = image.cols;
+    req.cvType = CV_8UC3;
+    req.step = static_cast<uint32_t>(rowBytes);
+
+    InferResponseHeader resp;
+    if (!inferSendAll(fd_, &req, sizeof(req)) ||
+        !inferRecvAll(fd_, &resp, sizeof(resp)) ||
+        resp.magic != kInferProtocolMagic ||
+        resp.requestId != req.requestId ||
+        resp.count > kInferMaxDetections) {
+        std::cerr << "[ERROR] Lost connection to inference server.\n";
+        disconnect();
+        return {};
+    }
+
+    std::vector<WireDetection> wire(resp.count);
+    if (resp.count > 0 &&
+        !inferRecvAll(fd_, wire.data(), wire.size() * sizeof(WireDetection))) {
+        std::cerr << "[ERROR] Truncated response from inference server.\n";
+        disconnect();
+        return {};
+    }
+    if (resp.status != static_cast<int32_t>(InferStatus::Ok)) {
+        std::cerr << "[WARN] Inference server returned status " << resp.status << "\n";
+        return {};
+    }
+
+    std::vector<YoloResult> results;
+    results.reserve(wire.size());
+    for (const auto& w : wire) {
+        YoloResult r;
+        r.class_id = w.classId;
+        r.score = w.score;
+        r.box = cv::Rect(w.x, w.y, w.width, w.height);
+        r.oriented = w.oriented != 0;
+        if (r.oriented) {
+            r.obb = cv::RotatedRect(cv::Point2f(w.obbCx, w.obbCy), cv::Size2f(w.obbWidth, w.obbHeight),
+                                    w.obbAngle);
+        }
+        results.push_back(r);
+    }
+    if (timing) {
+        timing->queueMs = resp.queueMs;
+        timing->inferMs = resp.inferMs;
+        timing->batchSize = resp.batchSize;
+    }
+    if (ok) *ok = true;
+    return results;
+}
+
+#else  // !TOOLSDETECT_HAS_INFER_SERVER
+
+bool InferClient::connect(const std::string& socketPath) {
+    std::cerr << "[ERROR] The shared inference server is not supported on this platform ("
+              << socketPath << ").\n";
+    return false;
+}
+
+void InferClient::disconnect() {}
+
+void InferClient::releaseSegment() {}
+
+bool InferClient::ensureSegment(size_t) {
+    return false;
+}
+
+std::vector<YoloResult> InferClient::detect(const cv::Mat&, bool* ok, InferServerTiming*) {
+    if (ok) *ok = false;
+    return {};
+}
+
+#endif
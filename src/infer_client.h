@@ -0,0 +1,51 @@
+// infer_client.h
+// Client side of the shared inference server (see infer_protocol.h).
+
+#pragma once
+
+#include "yolo_common.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Per-request timing reported by the server.
+struct InferServerTiming {
+    float queueMs = 0.0f;
+    float inferMs = 0.0f;
+    uint32_t batchSize = 0;
+};
+
+// One connection + one shared-memory segment. Not thread-safe: use one
+// client per thread (runYoloDetect keeps a thread_local instance).
+class InferClient {
+public:
+    InferClient() = default;
+    ~InferClient();
+    InferClient(const InferClient&) = delete;
+    InferClient& operator=(const InferClient&) = delete;
+
+    // Connects to the server socket. Returns false (and logs) on failure.
+    bool connect(const std::string& socketPath);
+    bool connected() const { return fd_ >= 0; }
+    void disconnect();
+
+    // Copies the image into shared memory and waits for the detections.
+    // On any transport error the connection is dropped and `ok` is false.
+    std::vector<YoloResult> detect(const cv::Mat& image,
+                                   bool* ok = nullptr,
+                                   InferServerTiming* timing = nullptr);
+
+private:
+    bool ensureSegment(size_t bytes);
+    void releaseSegment();
+
+    int fd_ = -1;
+    uint32_t nextRequestId_ = 1;
+
+    std::string shmName_;
+    void* shmData_ = nullptr;
+    size_t shmSize_ = 0;
+};
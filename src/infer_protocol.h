@@ -0,0 +1,119 @@
+// infer_protocol.h
+// Wire format shared by toolsdetect_server and InferClient.
+//
+// Transport: one SOCK_STREAM Unix domain socket connection per client
+// thread. Pixels never travel over the socket: each client owns a POSIX
+// shared-memory segment, announces it once with a Hello message, and then
+// writes every image into it before sending a small Detect header. The
+// server wraps the mapped pixels in a cv::Mat without copying. A connection
+// has at most one request in flight, so the segment is reused safely.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/types.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#define TOOLSDETECT_HAS_INFER_SERVER 1
+#else
+// The server relies on POSIX shared memory (shm_open/mmap).
+#define TOOLSDETECT_HAS_INFER_SERVER 0
+#endif
+
+inline constexpr uint32_t kInferProtocolMagic   = 0x46494454u;  // "TDIF"
+inline constexpr uint32_t kInferProtocolVersion = 2;   // 2: WireDetection carries the rotated box
+inline constexpr const char* kDefaultInferSocketPath = "/tmp/toolsdetect.sock";
+inline constexpr uint32_t kInferMaxDetections = 1024;
+
+enum class InferMessageType : uint32_t {
+    Hello  = 1,   // attach (or re-attach after growth) the client's segment
+    Detect = 2,   // run detection on the image currently in the segment
+};
+
+enum class InferStatus : int32_t {
+    Ok           = 0,
+    BadRequest   = 1,
+    NoSharedMem  = 2,
+    ServerError  = 3,
+};
+
+#pragma pack(push, 1)
+
+struct InferRequestHeader {
+    uint32_t magic = kInferProtocolMagic;
+    uint32_t version = kInferProtocolVersion;
+    uint32_t type = 0;              // InferMessageType
+    uint32_t requestId = 0;
+
+    // Hello: segment name (NUL-terminated) and mapped size.
+    char shmName[64] = {};
+    uint64_t shmSize = 0;
+
+    // Detect: image geometry inside the segment (offset 0).
+    int32_t rows = 0;
+    int32_t cols = 0;
+    int32_t cvType = 0;             // CV_8UC3 expected
+    uint32_t step = 0;              // bytes per row
+};
+
+struct InferResponseHeader {
+    uint32_t magic = kInferProtocolMagic;
+    uint32_t requestId = 0;
+    int32_t status = 0;             // InferStatus
+    uint32_t count = 0;             // number of WireDetection records that follow
+    float queueMs = 0.0f;           // time spent waiting for a batch slot
+    float inferMs = 0.0f;           // batch Session::Run + postprocess time
+    uint32_t batchSize = 0;         // size of the batch this request ran in
+};
+
+struct WireDetection {
+    int32_t classId = -1;
+    float score = 0.0f;
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+    // OBB models: the rotated box (x/y/width/height are its bounds).
+    uint32_t oriented = 0;
+    float obbCx = 0.0f;
+    float obbCy = 0.0f;
+    float obbWidth = 0.0f;
+    float obbHeight = 0.0f;
+    float obbAngle = 0.0f;          // degrees, as cv::RotatedRect
+};
+
+#pragma pack(pop)
+
+#if TOOLSDETECT_HAS_INFER_SERVER
+// Blocking helpers that loop over short reads/writes. Return false on EOF or
+// error.
+inline bool inferSendAll(int fd, const void* data, size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t n = ::send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+inline bool inferRecvAll(int fd, void* data, size_t len) {
+    char* p = static_cast<char*>(data);
+    while (len > 0) {
+        ssize_t n = ::recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+#endif
@@ -0,0 +1,380 @@
+// infer_server.cpp
+// Unix-socket front end + dynamic batcher around a single DetectorBackend.
+
+#include "infer_server.h"
+
+#include "detector_backend.h"
+#include "infer_protocol.h"
+#include "metrics.h"
+#include "run_control.h"
+
+#include <iostream>
+
+#if TOOLSDETECT_HAS_INFER_SERVER
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BatchOutcome {
+    std::vector<YoloResult> detections;
+    bool ok = false;
+    float queueMs = 0.0f;
+    float inferMs = 0.0f;
+    uint32_t batchSize = 0;
+};
+
+struct PendingRequest {
+    cv::Mat image;               // view onto the client's shared memory
+    Clock::time_point enqueuedAt;
+    std::promise<BatchOutcome> promise;
+};
+
+// Collects requests from all connections and runs them through the model in
+// batches of up to maxBatchSize, waiting at most maxQueueDelayMs for the
+// batch to fill.
+class DynamicBatcher {
+public:
+    DynamicBatcher(DetectorBackend& infer, int maxBatchSize, double maxQueueDelayMs)
+        : infer_(infer),
+          maxBatchSize_(std::max(1, maxBatchSize)),
+          maxDelay_(std::chrono::duration_cast<Clock::duration>(
+              std::chrono::duration<double, std::milli>(maxQueueDelayMs))),
+          queueDepth_(metrics::gauge("toolsdetect_infer_queue_depth",
+                                     "Requests waiting for the dynamic batcher")),
+          batchSize_(metrics::histogram("toolsdetect_infer_batch_size",
+                                        "Images per inference batch",
+                                        {1, 2, 4, 8, 16, 32})) {
+        thread_ = std::thread([this]() { loop(); });
+    }
+
+    ~DynamicBatcher() { stop(); }
+
+    std::future<BatchOutcome> submit(const cv::Mat& image) {
+        auto req = std::make_unique<PendingRequest>();
+        req->image = image;
+        req->enqueuedAt = Clock::now();
+        std::future<BatchOutcome> fut = req->promise.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(std::move(req));
+            queueDepth_.set(static_cast<double>(queue_.size()));
+        }
+        cv_.notify_one();
+        return fut;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) return;
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    void printStats() const {
+        const double mean = batches_ ? static_cast<double>(requests_) / batches_ : 0.0;
+        std::cout << "[INFO] Batcher served " << requests_ << " request(s) in "
+                  << batches_ << " batch(es), mean batch size " << mean << "\n";
+    }
+
+private:
+    void loop() {
+        while (true) {
+            std::vector<std::unique_ptr<PendingRequest>> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+
+                // The oldest request sets the deadline for the whole batch.
+                const auto deadline = queue_.front()->enqueuedAt + maxDelay_;
+                cv_.wait_until(lock, deadline, [this]() {
+                    return stopping_ || static_cast<int>(queue_.size()) >= maxBatchSize_;
+                });
+
+                const size_t take = std::min(queue_.size(), static_cast<size_t>(maxBatchSize_));
+                for (size_t i = 0; i < take; ++i) {
+                    batch.push_back(std::move(queue_.front()));
+                    queue_.pop_front();
+                }
+                queueDepth_.set(static_cast<double>(queue_.size()));
+            }
+            runBatch(batch);
+        }
+    }
+
+    void runBatch(std::vector<std::unique_ptr<PendingRequest>>& batch) {
+        const auto t_start = Clock::now();
+        std::vector<cv::Mat> images;
+        images.reserve(batch.size());
+        for (const auto& req : batch) images.push_back(req->image);
+
+        std::vector<std::vector<YoloResult>> results;
+        bool ok = true;
+        try {
+            results = infer_.inferBatch(images);
+        } catch (const std::exception& ex) {
+            std::cerr << "[ERROR] Batch inference failed: " << ex.what() << "\n";
+            ok = false;
+        }
+        const auto t_end = Clock::now();
+        const float inferMs =
+            std::chrono::duration<float, std::milli>(t_end - t_start).count();
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            BatchOutcome out;
+            out.ok = ok && i < results.size();
+            if (out.ok) out.detections = std::move(results[i]);
+            out.queueMs = std::chrono::duration<float, std::milli>(
+                t_start - batch[i]->enqueuedAt).count();
+            out.inferMs = inferMs;
+            out.batchSize = static_cast<uint32_t>(batch.size());
+            batch[i]->promise.set_value(std::move(out));
+        }
+        ++batches_;
+        requests_ += batch.size();
+        batchSize_.observe(static_cast<double>(batch.size()));
+    }
+
+    DetectorBackend& infer_;
+    const int maxBatchSize_;
+    const Clock::duration maxDelay_;
+    metrics::Gauge& queueDepth_;
+    metrics::Histogram& batchSize_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::unique_ptr<PendingRequest>> queue_;
+    bool stopping_ = false;
+    std::thread thread_;
+
+    size_t batches_ = 0;     // only touched by the batcher thread
+    size_t requests_ = 0;
+};
+
+// Client shared-memory segment mapped into the server.
+struct MappedSegment {
+    void* data = nullptr;
+    size_t size = 0;
+
+    ~MappedSegment() { reset(); }
+
+    void reset() {
+        if (data) ::munmap(data, size);
+        data = nullptr;
+        size = 0;
+    }
+
+    bool attach(const char* name, size_t expectedSize) {
+        reset();
+        int fd = ::shm_open(name, O_RDWR, 0);
+        if (fd < 0) {
+            std::cerr << "[WARN] shm_open(" << name << ") failed: " << std::strerror(errno) << "\n";
+            return false;
+        }
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < expectedSize) {
+            ::close(fd);
+            return false;
+        }
+        void* p = ::mmap(nullptr, expectedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        data = p;
+        size = expectedSize;
+        return true;
+    }
+};
+
+void serveConnection(int fd, DynamicBatcher& batcher) {
+    MappedSegment segment;
+    InferRequestHeader req;
+    while (inferRecvAll(fd, &req, sizeof(req))) {
+        InferResponseHeader resp;
+        resp.requestId = req.requestId;
+        std::vector<WireDetection> wire;
+
+        if (req.magic != kInferProtocolMagic || req.version != kInferProtocolVersion) {
+            std::cerr << "[WARN] Dropping client with bad protocol header.\n";
+            break;
+        }
+
+        if (req.type == static_cast<uint32_t>(InferMessageType::Hello)) {
+            req.shmName[sizeof(req.shmName) - 1] = '\0';
+            const bool attached = req.shmSize > 0 &&
+                                  req.shmSize <= (1ull << 30) &&
+                                  segment.attach(req.shmName, static_cast<size_t>(req.shmSize));
+            resp.status = static_cast<int32_t>(attached ? InferStatus::Ok : InferStatus::NoSharedMem);
+        } else if (req.type == static_cast<uint32_t>(InferMessageType::Detect)) {
+            const size_t needed = static_cast<size_t>(req.step) * static_cast<size_t>(std::max(0, req.rows));
+            if (!segment.data) {
+                resp.status = static_cast<int32_t>(InferStatus::NoSharedMem);
+            } else if (req.cvType != CV_8UC3 || req.rows <= 0 || req.cols <= 0 ||
+                       req.step < static_cast<uint32_t>(req.cols) * 3u ||
+                       needed > segment.size) {
+                resp.status = static_cast<int32_t>(InferStatus::BadRequest);
+            } else {
+                // Zero-copy: the Mat header points straight at the client's pixels.
+                cv::Mat image(req.rows, req.cols, CV_8UC3, segment.data, req.step);
+                BatchOutcome out = batcher.submit(image).get();
+                resp.status = static_cast<int32_t>(out.ok ? InferStatus::Ok : InferStatus::ServerError);
+                resp.queueMs = out.queueMs;
+                resp.inferMs = out.inferMs;
+                resp.batchSize = out.batchSize;
+                const size_t n = std::min<size_t>(out.detections.size(), kInferMaxDetections);
+                wire.reserve(n);
+                for (size_t i = 0; i < n; ++i) {
+                    const YoloResult& r = out.detections[i];
+                    WireDetection w;
+                    w.classId = r.class_id;
+                    w.score = r.score;
+                    w.x = r.box.x;
+                    w.y = r.box.y;
+                    w.width = r.box.width;
+                    w.height = r.box.height;
+                    w.oriented = r.oriented ? 1u : 0u;
+                    w.obbCx = r.obb.center.x;
+                    w.obbCy = r.obb.center.y;
+                    w.obbWidth = r.obb.size.width;
+                    w.obbHeight = r.obb.size.height;
+                    w.obbAngle = r.obb.angle;
+                    wire.push_back(w);
+                }
+            }
+        } else {
+            resp.status = static_cast<int32_t>(InferStatus::BadRequest);
+        }
+
+        resp.count = static_cast<uint32_t>(wire.size());
+        if (!inferSendAll(fd, &resp, sizeof(resp)) ||
+            (!wire.empty() && !inferSendAll(fd, wire.data(), wire.size() * sizeof(WireDetection)))) {
+            break;
+        }
+    }
+}
+
+int openListeningSocket(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "[FATAL] Socket path too long: " << path << "\n";
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::cerr << "[FATAL] socket() failed: " << std::strerror(errno) << "\n";
+        return -1;
+    }
+    ::unlink(path.c_str());  // stale socket from a previous run
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(fd, 64) != 0) {
+        std::cerr << "[FATAL] Cannot listen on " << path << ": " << std::strerror(errno) << "\n";
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+}  // namespace
+
+int runInferServer(const InferServerOptions& options) {
+    std::unique_ptr<DetectorBackend> infer;
+    const std::string backendName = options.backend.empty() ? defaultDetectorBackend() : options.backend;
+    const auto t_load = Clock::now();
+    try {
+        DetectorConfig config;
+        config.modelPath = options.modelPath;
+        config.precision = options.precision;
+        infer = createDetectorBackend(backendName, config);
+    } catch (const std::exception& ex) {
+        std::cerr << "[FATAL] Failed to load model: " << ex.what() << "\n";
+        return 1;
+    }
+    std::cout << "[INFO] Model loaded in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - t_load).count()
+              << " ms (backend: " << infer->name()
+              << ", dynamic batch: " << (infer->supportsDynamicBatch() ? "yes" : "no") << ")\n";
+
+    int listenFd = openListeningSocket(options.socketPath);
+    if (listenFd < 0) return 1;
+
+    StopSignalScope stopSignals;
+
+    DynamicBatcher batcher(*infer, options.maxBatchSize, options.maxQueueDelayMs);
+    std::cout << "[INFO] Inference server listening on " << options.socketPath
+              << " (max batch " << options.maxBatchSize
+              << ", max queue delay " << options.maxQueueDelayMs << " ms)\n";
+
+    // Connection threads are detached; the set tracks live sockets so they can
+    // be woken at shutdown, and the condition variable waits for them to exit.
+    std::mutex connMutex;
+    std::condition_variable connDone;
+    std::set<int> openConnections;
+
+    while (!StopSignalScope::stopRequested()) {
+        pollfd pfd{listenFd, POLLIN, 0};
+        if (::poll(&pfd, 1, 200) <= 0) continue;
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+        {
+            std::lock_guard<std::mutex> lock(connMutex);
+            openConnections.insert(fd);
+        }
+        std::thread([fd, &batcher, &connMutex, &connDone, &openConnections]() {
+            serveConnection(fd, batcher);
+            std::lock_guard<std::mutex> lock(connMutex);
+            openConnections.erase(fd);
+            ::close(fd);
+            connDone.notify_all();
+        }).detach();
+    }
+
+    std::cout << "[INFO] Shutting down inference server...\n";
+    ::close(listenFd);
+    ::unlink(options.socketPath.c_str());
+    {
+        // Wake connection threads blocked in recv(); they close their own fd.
+        std::unique_lock<std::mutex> lock(connMutex);
+        for (int fd : openConnections) ::shutdown(fd, SHUT_RDWR);
+        connDone.wait(lock, [&openConnections]() { return openConnections.empty(); });
+    }
+    batcher.stop();
+    batcher.printStats();
+    return 0;
+}
+
+#else  // !TOOLSDETECT_HAS_INFER_SERVER
+
+int runInferServer(const InferServerOptions& options) {
+    (void)options;
+    std::cerr << "[FATAL] toolsdetect_server needs POSIX shared memory and Unix sockets; "
+                 "not available on this platform.\n";
+    return 1;
+}
+
+#endif
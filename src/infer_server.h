@@ -0,0 +1,23 @@
+// infer_server.h
+// Shared inference server: one model instance serving many cabinet clients.
+
+#pragma once
+
+#include "detector_backend.h"
+
+#include <string>
+
+struct InferServerOptions {
+    std::string socketPath;
+    std::wstring modelPath;
+    std::string backend;          // "ort" / "opencv"; empty = defaultDetectorBackend()
+    ModelPrecision precision = ModelPrecision::Auto;
+    int maxBatchSize = 8;         // upper bound of one Session::Run
+    double maxQueueDelayMs = 2.0; // how long the first request may wait for company
+};
+
+// Loads the model once, listens on `socketPath` and serves Detect requests
+// until SIGINT/SIGTERM. Concurrent requests are grouped into dynamic batches:
+// a batch is dispatched as soon as it reaches maxBatchSize or its oldest
+// request has waited maxQueueDelayMs. Returns a process exit code.
+int runInferServer(const InferServerOptions& options);
@@ -1,5 +1,7 @@
 #include "inventory_compare.h"
 
+#include "perf_stats.h"
+
 #include <unordered_map>
 
 static std::unordered_map<std::string, int> countByClass(
@@ -16,6 +18,7 @@ InventoryDelta compareInventory(
     const DetectionResult& beforeDet,
     const DetectionResult& afterDet
 ) {
+    TD_PERF_SCOPE("inventory.compare");
     InventoryDelta delta;
     delta.beforeDet = beforeDet;
     delta.afterDet  = afterDet;
@@ -0,0 +1,367 @@
+#include "inventory_session.h"
+
+#include "alarm_bus.h"
+#include "cabinet_state.h"
+#include "logger.h"
+#include "metrics.h"
+#include "overlay.h"
+#include "perf_stats.h"
+#include "result_archive.h"
+#include "slot_cascade.h"
+#include "sysinfo.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+std::atomic<bool> g_fullResolutionArchive{false};
+
+void saveVisualization(const std::string& path, const cv::Mat& image) {
+    TD_PERF_SCOPE("session.imwrite");
+    if (cv::imwrite(path, image)) {
+        std::cout << "[INFO] Saved detection visualization to " << path << "\n";
+    } else {
+        std::cerr << "[ERROR] Failed to write detection visualization to "
+                  << path << "\n";
+    }
+}
+
+// Splits a session into consecutive named stages ("lap" timing).
+class StageClock {
+public:
+    explicit StageClock(StageTimings& out)
+        : out_(out), last_(std::chrono::steady_clock::now()) {}
+
+    void lap(const char* name) {
+        const auto now = std::chrono::steady_clock::now();
+        out_.emplace_back(name, std::chrono::duration<double, std::milli>(now - last_).count());
+        last_ = now;
+    }
+
+private:
+    StageTimings& out_;
+    std::chrono::steady_clock::time_point last_;
+};
+
+// Alarm counters per (class, kind), resolved once per class so an alarm
+// does not take the metrics registry lock (which scrapes also hold).
+struct AlarmCounters {
+    metrics::Counter* missing = nullptr;
+    metrics::Counter* added = nullptr;
+};
+
+const AlarmCounters& alarmCountersFor(const std::string& cls) {
+    static std::mutex mutex;
+    static std::map<std::string, AlarmCounters> cache;   // nodes never move
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(cls);
+    if (it == cache.end()) {
+        static const char* kHelp = "Alarmed tool count changes by class and kind";
+        AlarmCounters counters;
+        counters.missing = &metrics::counter("toolsdetect_alarms_total", kHelp,
+                                             {{"class", cls}, {"kind", "missing"}});
+        counters.added = &metrics::counter("toolsdetect_alarms_total", kHelp,
+                                           {{"class", cls}, {"kind", "added"}});
+        it = cache.emplace(cls, counters).first;
+    }
+    return it->second;
+}
+
+// Session count/latency and the per-class alarm counters.
+void recordSessionMetrics(const InventorySessionResult& result) {
+    static metrics::Counter& sessions = metrics::counter(
+        "toolsdetect_sessions_total", "Inventory sessions processed");
+    static metrics::Counter& alarmSessions = metrics::counter(
+        "toolsdetect_alarm_sessions_total", "Inventory sessions that raised an alarm");
+    static metrics::Histogram& latency = metrics::histogram(
+        "toolsdetect_session_latency_seconds",
+        "Session latency from capture/ready to logged result");
+
+    sessions.inc();
+    latency.observe(static_cast<double>(result.durationMs) / 1000.0);
+    if (!result.alarm.triggered) {
+        return;
+    }
+    alarmSessions.inc();
+    for (const auto& kv : result.delta.classCountDiff) {
+        if (kv.second == 0) continue;
+        const AlarmCounters& counters = alarmCountersFor(kv.first);
+        if (kv.second < 0) {
+            counters.missing->inc(static_cast<uint64_t>(-kv.second));
+        } else {
+            counters.added->inc(static_cast<uint64_t>(kv.second));
+        }
+    }
+}
+
+// Shared by the single- and multi-camera sessions once both detections are
+// in: compare, alarm, metrics, the state commit and the INVENTORY log line.
+// `afterImage` is what the state store matches the next "before" against;
+// empty for multi-view sessions.
+void compareAndLog(InventorySessionResult& result,
+                   StageClock& clock,
+                   const std::string& sessionId,
+                   const std::string& username,
+                   Logger& logger,
+                   std::chrono::steady_clock::time_point startedAt,
+                   const cv::Mat& afterImage) {
+    result.delta = compareInventory(result.beforeDet, result.afterDet);
+    // Straight onto the alarm bus, before any message formatting; the
+    // console block then comes from the bus's dispatcher thread.
+    const bool published = publishInventoryAlarms(result.delta, sessionId, username);
+    result.alarm = evaluateAlarm(result.delta);
+    if (!published || !result.alarm.triggered) {
+        raiseAlarmToConsole(result.alarm, sessionId, username);
+    }
+
+    // Build the delta summary in one string so concurrent sessions do not
+    // interleave their lines on stdout.
+    std::ostringstream deltaText;
+    deltaText << "[INFO] Delta (after - before) for session " << sessionId << ":\n";
+    for (const auto& kv : result.delta.classCountDiff) {
+        deltaText << "  " << kv.first << " -> " << kv.second << "\n";
+    }
+    std::cout << deltaText.str();
+    clock.lap("compare");
+
+    auto t_end = std::chrono::steady_clock::now();
+    result.durationMs =
+        std::chrono::duration_cast<std::chrono::milliseconds>(t_end - startedAt).count();
+
+    std::cout << "[PERF] Session " << sessionId
+              << " took " << result.durationMs << " ms, RSS " << currentRssBytes() / (1024 * 1024)
+              << " MiB, peak " << peakRssBytes() / (1024 * 1024) << " MiB\n";
+    recordSessionMetrics(result);
+
+    // Committed before the id is logged: the flush also persists the session
+    // counter, so an id in the log is never handed out again after a crash.
+    if (CabinetStateStore* state = activeCabinetState()) {
+        state->commitSession(sessionId, result.afterDet, afterImage);
+        clock.lap("state");
+    }
+
+    {
+        TD_PERF_SCOPE("session.log");
+        logger.logInventoryDelta(username, result.delta, sessionId,
+                                 result.durationMs, result.alarm);
+    }
+    clock.lap("log");
+}
+
+// Annotated views side by side at the height of the first one, for the
+// interactive preview.
+cv::Mat mosaic(const std::vector<cv::Mat>& views) {
+    if (views.size() == 1) {
+        return views.front();
+    }
+    const int height = views.front().rows;
+    std::vector<cv::Mat> scaled;
+    for (const auto& view : views) {
+        if (view.rows == height) {
+            scaled.push_back(view);
+        } else {
+            cv::Mat resized;
+            cv::resize(view, resized, cv::Size(), static_cast<double>(height) / view.rows,
+                       static_cast<double>(height) / view.rows, cv::INTER_AREA);
+            scaled.push_back(resized);
+        }
+    }
+    cv::Mat out;
+    cv::hconcat(scaled, out);
+    return out;
+}
+
+}  // namespace
+
+InventorySessionResult processInventorySession(
+    const cv::Mat& imgBefore,
+    const cv::Mat& imgAfter,
+    const std::string& sessionId,
+    const std::string& username,
+    Logger& logger,
+    const std::string& resultsDir,
+    std::chrono::steady_clock::time_point startedAt) {
+    TD_PERF_SCOPE("session.process");
+    trace::Span sessionSpan("session", sessionId);
+    InventorySessionResult result;
+    StageClock clock(result.stages);
+
+    CabinetStateStore* state = activeCabinetState();
+    // First session after a restart: the cabinet as last committed needs no
+    // second detection.
+    const bool beforeRestored = state && state->reuseBefore(imgBefore, result.beforeDet);
+    if (beforeRestored) {
+        clock.lap("before_restored");
+    }
+    if (const SlotCascade* slots = activeSlotCascade()) {
+        // Shadow board: per-slot signatures, YOLO only for ambiguous slots.
+        if (!beforeRestored) {
+            result.beforeDet = slots->read(imgBefore).detections;
+            clock.lap("slots_before");
+        }
+        result.afterDet = slots->read(imgAfter).detections;
+        clock.lap("slots_after");
+    } else {
+        if (!beforeRestored) {
+            result.beforeDet = runYoloDetect(imgBefore);
+            clock.lap("detect_before");
+        }
+        result.afterDet  = runYoloDetect(imgAfter);
+        clock.lap("detect_after");
+    }
+
+    compareAndLog(result, clock, sessionId, username, logger, startedAt, imgAfter);
+
+    const double beforeDiag = computeImageDiagonal(imgBefore);
+    const double afterDiag = computeImageDiagonal(imgAfter);
+    const double relativeAfterScale =
+        (beforeDiag > 0.0) ? (afterDiag / beforeDiag) : 1.0;
+
+    {
+        TD_PERF_SCOPE("session.draw");
+        result.visBefore = renderDetectionsFitted(imgBefore, result.beforeDet, kPreviewSize, 1.0);
+        result.visAfter = renderDetectionsFitted(imgAfter, result.afterDet, kPreviewSize, relativeAfterScale);
+    }
+    clock.lap("draw");
+
+    if (ResultArchive* archive = activeResultArchive()) {
+        // Raw snapshots (deduplicated) plus detections; overlays are drawn
+        // when the session is read back.
+        ArchivedSession archived;
+        archived.sessionId = sessionId;
+        archived.username = username;
+        archived.views.resize(1);
+        archived.views[0].beforeDet = result.beforeDet;
+        archived.views[0].afterDet = result.afterDet;
+        archive->addSession(std::move(archived), {imgBefore}, {imgAfter});
+        clock.lap("archive");
+    } else {
+        cv::Mat archiveBefore = result.visBefore;
+        cv::Mat archiveAfter = result.visAfter;
+        if (fullResolutionArchive()) {
+            TD_PERF_SCOPE("session.draw_full");
+            archiveBefore = imgBefore.clone();
+            archiveAfter = imgAfter.clone();
+            drawDetections(archiveBefore, result.beforeDet, makeOverlayStyle(1.0));
+            drawDetections(archiveAfter, result.afterDet, makeOverlayStyle(relativeAfterScale));
+            clock.lap("draw_full");
+        }
+
+        saveVisualization(resultsDir + "/" + sessionId + "_before.jpg", archiveBefore);
+        saveVisualization(resultsDir + "/" + sessionId + "_after.jpg", archiveAfter);
+        clock.lap("imwrite");
+    }
+
+    if (SessionRecorder* recorder = activeRecorder()) {
+        recorder->recordSession(sessionId, username, imgBefore, imgAfter,
+                                result.beforeDet, result.afterDet, result.stages);
+    }
+
+    return result;
+}
+
+InventorySessionResult processMultiViewSession(
+    const std::vector<cv::Mat>& viewsBefore,
+    const std::vector<cv::Mat>& viewsAfter,
+    const CameraRig& rig,
+    const std::string& sessionId,
+    const std::string& username,
+    Logger& logger,
+    const std::string& resultsDir,
+    std::chrono::steady_clock::time_point startedAt) {
+    TD_PERF_SCOPE("session.process");
+    trace::Span sessionSpan("session", sessionId);
+    InventorySessionResult result;
+    StageClock clock(result.stages);
+
+    // Every view of both snapshots in one batch: with a dynamic-batch model
+    // this is a single model call, so N cameras cost about one detection.
+    std::vector<cv::Mat> batch(viewsBefore);
+    batch.insert(batch.end(), viewsAfter.begin(), viewsAfter.end());
+    const std::vector<DetectionResult> perImage = runYoloDetectBatch(batch);
+    const std::vector<DetectionResult> perViewBefore(perImage.begin(),
+                                                     perImage.begin() + viewsBefore.size());
+    const std::vector<DetectionResult> perViewAfter(perImage.begin() + viewsBefore.size(),
+                                                    perImage.end());
+    clock.lap("detect");
+    result.beforeDet = fuseViews(perViewBefore, rig);
+    result.afterDet = fuseViews(perViewAfter, rig);
+    clock.lap("fuse");
+
+    // Fused detections only: no single snapshot to match the next one against.
+    compareAndLog(result, clock, sessionId, username, logger, startedAt, cv::Mat());
+
+    // Each view gets an equal share of the preview width.
+    const cv::Size viewTarget(kPreviewSize.width / static_cast<int>(std::max<size_t>(1, viewsBefore.size())),
+                              kPreviewSize.height);
+    std::vector<cv::Mat> visBefore;
+    std::vector<cv::Mat> visAfter;
+    {
+        TD_PERF_SCOPE("session.draw");
+        for (size_t v = 0; v < viewsBefore.size(); ++v) {
+            visBefore.push_back(renderDetectionsFitted(viewsBefore[v], perViewBefore[v], viewTarget));
+        }
+        for (size_t v = 0; v < viewsAfter.size(); ++v) {
+            visAfter.push_back(renderDetectionsFitted(viewsAfter[v], perViewAfter[v], viewTarget));
+        }
+        result.visBefore = mosaic(visBefore);
+        result.visAfter = mosaic(visAfter);
+    }
+    clock.lap("draw");
+
+    if (ResultArchive* archive = activeResultArchive()) {
+        ArchivedSession archived;
+        archived.sessionId = sessionId;
+        archived.username = username;
+        for (size_t v = 0; v < viewsBefore.size() && v < rig.views.size(); ++v) {
+            ArchivedView view;
+            view.name = rig.views[v].name;
+            view.beforeDet = perViewBefore[v];
+            if (v < perViewAfter.size()) view.afterDet = perViewAfter[v];
+            archived.views.push_back(std::move(view));
+        }
+        archive->addSession(std::move(archived), viewsBefore, viewsAfter);
+        clock.lap("archive");
+        return result;
+    }
+
+    if (fullResolutionArchive()) {
+        TD_PERF_SCOPE("session.draw_full");
+        const DrawOverlayStyle style = makeOverlayStyle(1.0);
+        for (size_t v = 0; v < viewsBefore.size(); ++v) {
+            visBefore[v] = viewsBefore[v].clone();
+            drawDetections(visBefore[v], perViewBefore[v], style);
+        }
+        for (size_t v = 0; v < viewsAfter.size(); ++v) {
+            visAfter[v] = viewsAfter[v].clone();
+            drawDetections(visAfter[v], perViewAfter[v], style);
+        }
+        clock.lap("draw_full");
+    }
+
+    for (size_t v = 0; v < visBefore.size() && v < rig.views.size(); ++v) {
+        const std::string prefix = resultsDir + "/" + sessionId + "_" + rig.views[v].name;
+        saveVisualization(prefix + "_before.jpg", visBefore[v]);
+        if (v < visAfter.size()) {
+            saveVisualization(prefix + "_after.jpg", visAfter[v]);
+        }
+    }
+    clock.lap("imwrite");
+
+    // Not recorded: .tdrec holds one before/after pair per session.
+    return result;
+}
+
+void setFullResolutionArchive(bool enabled) {
+    g_fullResolutionArchive.store(enabled);
+}
+
+bool fullResolutionArchive() {
+    return g_fullResolutionArchive.load();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "alert.h"
+#include "camera_rig.h"
+#include "detector.h"
+#include "inventory_compare.h"
+#include "session_recording.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+class Logger;
+
+// Everything one before/after inventory check produced. The annotated images
+// are rendered at display size (fitted into kPreviewSize) so interactive
+// callers can show them without re-drawing or rescaling.
+struct InventorySessionResult {
+    DetectionResult beforeDet;
+    DetectionResult afterDet;
+    InventoryDelta delta;
+    AlarmInfo alarm;
+    long long durationMs = 0;
+    // detect_before, detect_after (slot cascade: slots_before, slots_after;
+    // multi-view: detect, fuse; restored state: before_restored instead of
+    // the before detection), compare, log, [state,] draw, [draw_full,] imwrite
+    StageTimings stages;
+    cv::Mat visBefore;
+    cv::Mat visAfter;
+};
+
+// Annotated images in the results folder are preview-sized by default; with
+// full-resolution archival (--archive-full) they are drawn on the original
+// snapshots, which is only worth its cost when the files are archived.
+void setFullResolutionArchive(bool enabled);
+bool fullResolutionArchive();
+
+// Runs detection on a captured before/after pair, compares the inventories,
+// raises/logs the alarm and writes "<resultsDir>/<sessionId>_{before,after}.jpg".
+// `startedAt` is the moment the session began (e.g. before capture) so the
+// reported duration covers the whole check. With an active slot cascade
+// (setActiveSlotCascade) the cascade replaces plain detection. Safe to call
+// from several threads at once as long as the Logger is shared. When a
+// recorder is active (setActiveRecorder) the inputs, detections and stage
+// timings are recorded. With an active cabinet state (setActiveCabinetState)
+// the result is committed to it, and the first session after a restart
+// reuses the committed detections for an unchanged "before" snapshot.
+InventorySessionResult processInventorySession(
+    const cv::Mat& imgBefore,
+    const cv::Mat& imgAfter,
+    const std::string& sessionId,
+    const std::string& username,
+    Logger& logger,
+    const std::string& resultsDir,
+    std::chrono::steady_clock::time_point startedAt =
+        std::chrono::steady_clock::now());
+
+// Same for a cabinet seen by several cameras: `viewsBefore` / `viewsAfter`
+// hold one image per rig view, in rig order. All views of both snapshots run
+// as one detection batch, each snapshot's views are fused onto the cabinet
+// plane (fuseViews) and the fused results are compared. Writes
+// "<resultsDir>/<sessionId>_<view>_{before,after}.jpg"; visBefore/visAfter
+// are the annotated views side by side. Sessions are not recorded; the fused
+// result is committed to an active cabinet state.
+InventorySessionResult processMultiViewSession(
+    const std::vector<cv::Mat>& viewsBefore,
+    const std::vector<cv::Mat>& viewsAfter,
+    const CameraRig& rig,
+    const std::string& sessionId,
+    const std::string& username,
+    Logger& logger,
+    const std::string& resultsDir,
+    std::chrono::steady_clock::time_point startedAt =
+        std::chrono::steady_clock::now());
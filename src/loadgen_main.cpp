@@ -0,0 +1,142 @@
+// loadgen_main.cpp
+// toolsdetect_loadgen: drives toolsdetect_server with N concurrent clients
+// and reports throughput and latency percentiles.
+
+#include "infer_client.h"
+#include "infer_protocol.h"
+#include "run_control.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void printUsage(const char* argv0) {
+    std::cout
+        << "Usage: " << argv0 << " [options]\n"
+        << "  --socket <path>     Server socket (default: " << kDefaultInferSocketPath << ")\n"
+        << "  --image <file>      Request payload (default: testimg.jpg)\n"
+        << "  --clients <n>       Concurrent clients (default: 4)\n"
+        << "  --requests <n>      Requests per client (default: 100)\n"
+        << "  --rate <hz>         Per-client request rate, 0 = closed loop (default: 0)\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string socketPath = kDefaultInferSocketPath;
+    std::string imagePath = "testimg.jpg";
+    int clients = 4;
+    int requests = 100;
+    double rateHz = 0.0;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--socket" && hasValue) {
+            socketPath = argv[++i];
+        } else if (arg == "--image" && hasValue) {
+            imagePath = argv[++i];
+        } else if (arg == "--clients" && hasValue) {
+            clients = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--requests" && hasValue) {
+            requests = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--rate" && hasValue) {
+            rateHz = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "[ERROR] Unknown or incomplete option: " << arg << "\n";
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    cv::Mat image = cv::imread(imagePath);
+    if (image.empty()) {
+        std::cerr << "[FATAL] Cannot read " << imagePath << "\n";
+        return 1;
+    }
+
+    std::mutex mutex;
+    std::vector<double> latencies;
+    std::vector<double> queueDelays;
+    double batchSum = 0.0;
+    std::atomic<int> failures{0};
+
+    const auto t_start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back([&]() {
+            InferClient client;
+            if (!client.connect(socketPath)) {
+                failures += requests;
+                return;
+            }
+            std::vector<double> local;
+            std::vector<double> localQueue;
+            double localBatch = 0.0;
+            local.reserve(static_cast<size_t>(requests));
+            const auto interval = rateHz > 0.0
+                ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rateHz))
+                : Clock::duration::zero();
+            auto next = Clock::now();
+            for (int r = 0; r < requests; ++r) {
+                if (rateHz > 0.0) {
+                    std::this_thread::sleep_until(next);
+                    next += interval;
+                }
+                bool ok = false;
+                InferServerTiming timing;
+                const auto t0 = Clock::now();
+                client.detect(image, &ok, &timing);
+                const auto t1 = Clock::now();
+                if (!ok) {
+                    ++failures;
+                    if (!client.connected()) break;
+                    continue;
+                }
+                local.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+                localQueue.push_back(timing.queueMs);
+                localBatch += timing.batchSize;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            latencies.insert(latencies.end(), local.begin(), local.end());
+            queueDelays.insert(queueDelays.end(), localQueue.begin(), localQueue.end());
+            batchSum += localBatch;
+        });
+    }
+    for (auto& t : threads) t.join();
+    const double elapsed = std::chrono::duration<double>(Clock::now() - t_start).count();
+
+    std::sort(latencies.begin(), latencies.end());
+    std::sort(queueDelays.begin(), queueDelays.end());
+    const double throughput = elapsed > 0.0 ? latencies.size() / elapsed : 0.0;
+    const double meanBatch = latencies.empty() ? 0.0 : batchSum / latencies.size();
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "[RESULT] clients=" << clients
+              << " ok=" << latencies.size()
+              << " failed=" << failures.load()
+              << " elapsed_s=" << elapsed
+              << " throughput_rps=" << throughput
+              << " p50_ms=" << percentile(latencies, 0.50)
+              << " p99_ms=" << percentile(latencies, 0.99)
+              << " max_ms=" << (latencies.empty() ? 0.0 : latencies.back())
+              << " queue_p50_ms=" << percentile(queueDelays, 0.50)
+              << " mean_batch=" << meanBatch << "\n";
+    return failures.load() == 0 ? 0 : 1;
+}
@@ -7,10 +7,12 @@
 #include <chrono>
 #include <ctime>
 #include <iomanip>
+#include <mutex>
 
 #include "vision_pipeline.h"
 #include "inventory_compare.h"
 #include "alert.h" // <-- 新增
+#include "perf_stats.h"
 
 class Logger {
 public:
@@ -99,8 +101,22 @@ public:
         std::cout << oss.str() << "\n";
     }
 
+    // 性能汇总行，例如守护进程退出时的吞吐/延迟统计
+    //   [时间] PERF scope="daemon" sessions=12 ... p99=850.0
+    void logPerfSummary(const std::string& scope, const std::string& fields) {
+        std::ostringstream oss;
+        oss << timestamp()
+            << " PERF"
+            << " scope=\"" << scope << "\""
+            << " " << fields;
+        appendLine(oss.str());
+        std::cout << oss.str() << "\n";
+    }
+
 private:
     std::string logPath_;
+    // 守护进程模式下多个工作线程会同时写日志，串行化文件追加
+    mutable std::mutex fileMutex_;
 
     std::string timestamp() const {
         auto now = std::chrono::system_clock::now();
@@ -118,6 +134,8 @@ private:
     }
 
     void appendLine(const std::string& line) const {
+        TD_PERF_SCOPE("logger.append");
+        std::lock_guard<std::mutex> lock(fileMutex_);
         std::ofstream fout(logPath_, std::ios::app);
         if (!fout.is_open()) {
             std::cerr << "[ERROR] Cannot open log file: " << logPath_ << "\n";
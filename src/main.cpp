@@ -1,15 +1,263 @@
 #include "opencv_config.h"
 
+#include <filesystem>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "alarm_bus.h"
+#include "app_options.h"
 #include "auth.h"
+#include "cabinet_state.h"
+#include "calibration.h"
+#include "camera_capture.h"
+#include "camera_rig.h"
+#include "detector.h"
+#include "inventory_session.h"
 #include "logger.h"
+#include "metrics.h"
+#include "perf_stats.h"
+#include "result_archive.h"
+#include "session_recording.h"
+#include "session_replay.h"
 #include "session_runner.h"
+#include "slot_cascade.h"
+#include "trace.h"
+#include "tracker.h"
+#include "video_audit.h"
+#include "watch_daemon.h"
+#include "yolo_common.h"
+
+namespace {
+
+// Installs the --record recorder for the lifetime of main().
+class RecordingGuard {
+public:
+    explicit RecordingGuard(const std::string& path) {
+        if (!path.empty() && recorder_.open(path)) {
+            setActiveRecorder(&recorder_);
+        }
+    }
+    ~RecordingGuard() {
+        if (activeRecorder() == &recorder_) {
+            setActiveRecorder(nullptr);
+            std::cout << "[INFO] Recording closed (" << recorder_.entriesWritten() << " entries).\n";
+        }
+    }
+    RecordingGuard(const RecordingGuard&) = delete;
+    RecordingGuard& operator=(const RecordingGuard&) = delete;
+
+private:
+    SessionRecorder recorder_;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    AppOptions options;
+    if (!parseAppOptions(argc, argv, options)) {
+        printAppUsage(argv[0]);
+        return 2;
+    }
+    if (options.showHelp) {
+        printAppUsage(argv[0]);
+        return 0;
+    }
 
-int main() {
     std::cout << "=== ToolsDetect System (Week 3 baseline with ALARM) ===\n";
 
+    if (options.traceOrt && options.tracePath.empty()) {
+        std::cerr << "[WARN] --trace-ort has no effect without --trace <file>.\n";
+    }
+    trace::ScopedTrace traceSession(options.tracePath, options.traceOrt);
+    trace::setThreadName("main");
+
+    if (options.metricsPort > 0) {
+        metrics::registerProcessMetrics();
+    }
+    metrics::ScopedHttpServer metricsServer(options.metricsPort);
+
+    perf::setEnabled(options.perfEnabled);
+    const std::chrono::seconds perfInterval(options.perfIntervalSec);
+
+    if (!options.inferSocket.empty()) {
+        setRemoteInferEndpoint(options.inferSocket);
+        std::cout << "[INFO] Using inference server at " << options.inferSocket << "\n";
+    }
+    if (!options.backend.empty()) {
+        setDetectorBackend(options.backend);
+    }
+    setModelPrecision(options.precision);
+    setLowMemoryMode(options.lowMemory);
+    if (options.trackStride > 0) {
+        // Keyframes hand the tracker's low-score stage its candidates.
+        setDetectionScoreFloor(TrackerConfig().lowThreshold);
+    }
+    LightingConfig lighting;
+    if (parseLightingSpec(options.lighting, lighting) && lighting.mode != LightingMode::Off) {
+        setLightingNormalization(lighting);
+        std::cout << "[INFO] Lighting normalization: " << describeLighting(lighting) << "\n";
+    }
+    setFullResolutionArchive(options.archiveFull);
+    setDefaultInputSize(options.inputSize);
+    if (options.inferSocket.empty()) {
+        setModelHotReload(options.modelReloadMs);
+    }
+
+    if (!options.archiveExport.empty()) {
+        if (options.archiveDir.empty()) {
+            std::cerr << "[ERROR] --archive-export needs --archive <dir>\n";
+            return 2;
+        }
+        return runArchiveExport(options.archiveDir, options.archiveExport, options.resultsDir);
+    }
+
+    std::unique_ptr<ResultArchive> resultArchive;
+    if (!options.archiveDir.empty()) {
+        ResultArchiveConfig archiveConfig;
+        archiveConfig.dir = options.archiveDir;
+        archiveConfig.segments = options.archiveSegments;
+        resultArchive = std::make_unique<ResultArchive>(archiveConfig);
+        if (!resultArchive->open()) {
+            return 1;
+        }
+        setActiveResultArchive(resultArchive.get());
+    }
+
+    std::unique_ptr<AlarmBus> alarmBus;
+    if (!options.alarmSinks.empty()) {
+        AlarmBusConfig busConfig;
+        busConfig.debounce = std::chrono::milliseconds(options.alarmDebounceMs);
+        alarmBus = std::make_unique<AlarmBus>(busConfig);
+        bool haveConsole = false;
+        for (const auto& spec : options.alarmSinks) {
+            std::unique_ptr<AlarmSink> sink = createAlarmSink(spec);
+            if (!sink) {
+                return 1;
+            }
+            haveConsole = haveConsole || spec == "console";
+            std::cout << "[INFO] Alarm sink: " << sink->describe() << "\n";
+            alarmBus->addSink(std::move(sink));
+        }
+        if (!haveConsole) {
+            alarmBus->addSink(createAlarmSink("console"));
+        }
+        alarmBus->start();
+        setActiveAlarmBus(alarmBus.get());
+    }
+
+    std::unique_ptr<SlotCascade> slotCascade;
+    if (!options.slotsPath.empty()) {
+        std::vector<ToolSlot> slots;
+        if (!loadToolSlots(options.slotsPath, slots)) {
+            return 1;
+        }
+        const cv::Mat stocked = cv::imread(options.slotReference);
+        const cv::Mat empty = options.slotEmptyReference.empty()
+                                  ? cv::Mat()
+                                  : cv::imread(options.slotEmptyReference);
+        if (!options.slotEmptyReference.empty() && empty.empty()) {
+            std::cerr << "[WARN] Cannot read " << options.slotEmptyReference
+                      << "; deciding slots from the stocked reference only.\n";
+        }
+        slotCascade = std::make_unique<SlotCascade>(slots);
+        if (!slotCascade->enroll(stocked, empty)) {
+            std::cerr << "[FATAL] Slot enrollment failed (reference: " << options.slotReference << ").\n";
+            return 1;
+        }
+        setActiveSlotCascade(slotCascade.get());
+        std::cout << "[INFO] Slot cascade: " << slots.size() << " slots from " << options.slotsPath << "\n";
+    }
+
+    if (!options.calibrateDir.empty()) {
+        // Offline step for tools/quantize_int8.py; needs no model.
+        CalibrationOptions calib;
+        calib.outDir = options.calibrateDir;
+        calib.sources = options.calibSources;
+        if (calib.sources.empty()) {
+            // Raw inputs only: the results folder holds annotated JPEGs.
+            std::error_code ec;
+            if (!options.recordPath.empty() && std::filesystem::exists(options.recordPath, ec)) {
+                calib.sources.push_back(options.recordPath);
+            }
+            if (!options.archiveDir.empty()) {
+                calib.sources.push_back(options.archiveDir);
+            }
+            if (calib.sources.empty()) {
+                std::cerr << "[FATAL] No calibration source: pass --calib-from <recording, archive or "
+                          << "image folder>, or --record / --archive of earlier runs.\n";
+                return 1;
+            }
+        }
+        for (const auto& source : calib.sources) {
+            std::error_code ec;
+            if (std::filesystem::equivalent(source, options.resultsDir, ec)) {
+                std::cerr << "[WARN] " << source << " is the results folder; its images carry the drawn "
+                          << "result boxes. Recordings (--record) or --archive snapshots give clean frames.\n";
+            }
+        }
+        calib.maxSamples = options.calibSamples;
+        return runCalibrationDump(calib);
+    }
+
+    if (!options.auditVideo.empty()) {
+        // Offline footage audit: headless, no login, nothing recorded.
+        Logger logger(options.logPath);
+        perf::ScopedReporter perfReporter(logger, perfInterval, options.perfEnabled);
+        VideoAuditOptions audit;
+        audit.videoPath = options.auditVideo;
+        audit.outDir = options.resultsDir;
+        audit.workers = options.workers;
+        audit.frameStride = options.auditStride;
+        return runVideoAudit(audit);
+    }
+
+    if (!options.replayPath.empty()) {
+        // Regression replay: headless, no login, nothing recorded.
+        Logger logger(options.logPath);
+        perf::ScopedReporter perfReporter(logger, perfInterval, options.perfEnabled);
+        if (!ensureDirectoryExists(options.resultsDir)) {
+            std::cerr << "[WARN] Failed to create/access results directory.\n";
+        }
+        int rc = runReplay(options.replayPath, logger, options.username, options.resultsDir);
+        std::cout << "[INFO] System shutdown.\n";
+        return rc;
+    }
+
+    // Live sessions only: replays and audits must not see or move it.
+    std::unique_ptr<CabinetStateStore> cabinetState;
+    if (!options.statePath.empty()) {
+        cabinetState = std::make_unique<CabinetStateStore>();
+        if (!cabinetState->open(options.statePath)) {
+            return 1;
+        }
+        setActiveCabinetState(cabinetState.get());
+    }
+
+    RecordingGuard recording(options.recordPath);
+
+    if (options.headless) {
+        // Unattended cabinets: no login, no menu, no highgui windows.
+        Logger logger(options.logPath);
+        perf::ScopedReporter perfReporter(logger, perfInterval, options.perfEnabled);
+        if (!ensureDirectoryExists(options.resultsDir)) {
+            std::cerr << "[WARN] Failed to create/access results directory.\n";
+        }
+
+        WatchDaemonOptions daemonOptions;
+        daemonOptions.watchDir = options.watchDir;
+        daemonOptions.resultsDir = options.resultsDir;
+        daemonOptions.username = options.username;
+        daemonOptions.workers = options.workers;
+        daemonOptions.pollIntervalMs = options.pollIntervalMs;
+        daemonOptions.forcePolling = options.forcePolling;
+        daemonOptions.exitWhenIdle = options.exitWhenIdle;
+        int rc = runWatchDaemon(daemonOptions, logger);
+        std::cout << "[INFO] System shutdown.\n";
+        return rc;
+    }
+
     AuthManager auth;
     if (!auth.loadUsers("users.txt")) {
         std::cerr << "[FATAL] Failed to load users.txt. Exiting.\n";
@@ -55,10 +303,11 @@ int main() {
 
     std::cout << "[INFO] Login success. Welcome, " << username << "!\n";
 
-    Logger logger("log.txt");
+    Logger logger(options.logPath);
     logger.logLogin(username);
+    perf::ScopedReporter perfReporter(logger, perfInterval, options.perfEnabled);
 
-    const std::string resultsDir = "results";
+    const std::string resultsDir = options.resultsDir;
     if (!ensureDirectoryExists(resultsDir)) {
         std::cerr << "[WARN] Failed to create/access results directory.\n";
     }
@@ -107,7 +356,10 @@ int main() {
                 std::cout << "[INFO] Using default video path: " << videoPath << "\n";
             }
 
-            if (runVideoDetection(videoPath)) {
+            VideoRunOptions videoOptions;
+            videoOptions.latencyBudgetMs = options.videoBudgetMs;
+            videoOptions.trackerStride = options.trackStride;
+            if (runVideoDetection(videoPath, videoOptions)) {
                 break;
             }
 
@@ -127,7 +379,36 @@ int main() {
         return 0;
     }
 
-    runBeforeAfterSessions(logger, username, resultsDir);
+    SessionRunOptions sessionOptions;
+    CameraRig rig;
+    std::vector<std::string> cameraSources;
+    if (!options.cameraRigPath.empty()) {
+        if (!loadCameraRig(options.cameraRigPath, rig)) {
+            return 1;
+        }
+        for (const auto& view : rig.views) cameraSources.push_back(view.source);
+        sessionOptions.rig = &rig;
+    } else if (!options.cameraSpec.empty()) {
+        cameraSources.push_back(options.cameraSpec);
+    }
+    std::vector<std::unique_ptr<CameraGrabber>> cameras;
+    for (const auto& source : cameraSources) {
+        CameraConfig cameraConfig;
+        cameraConfig.selectWindow = std::chrono::milliseconds(options.cameraWindowMs);
+        cameras.push_back(std::make_unique<CameraGrabber>(openFrameSource(source, cameraConfig),
+                                                          cameraConfig));
+        if (!cameras.back()->start()) {
+            std::cerr << "[FATAL] Camera unavailable: " << source << "\n";
+            return 1;
+        }
+        sessionOptions.cameras.push_back(cameras.back().get());
+    }
+    runBeforeAfterSessions(logger, username, resultsDir, sessionOptions);
+    for (size_t i = 0; i < cameras.size(); ++i) {
+        cameras[i]->stop();
+        std::cout << "[INFO] Camera " << cameraSources[i] << ": " << cameras[i]->framesCaptured()
+                  << " frames captured, " << cameras[i]->framesDropped() << " dropped.\n";
+    }
 
     std::cout << "[INFO] System shutdown.\n";
     return 0;
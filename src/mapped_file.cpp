@@ -0,0 +1,234 @@
+// mapped_file.cpp
+
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <iostream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+namespace {
+
+// Paths are UTF-8; the ANSI file APIs would mangle anything outside the
+// system code page.
+std::wstring widePath(const std::string& path) {
+    const int n = MultiByteToWideChar(CP_UTF8, 0, path.data(), static_cast<int>(path.size()), nullptr, 0);
+    std::wstring wide(static_cast<size_t>(n), L'\0');
+    if (n > 0) {
+        MultiByteToWideChar(CP_UTF8, 0, path.data(), static_cast<int>(path.size()), &wide[0], n);
+    }
+    return wide;
+}
+
+}  // namespace
+#endif
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::open(const std::string& path) {
+    close();
+#if defined(_WIN32)
+    HANDLE file = CreateFileW(widePath(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "[ERROR] Cannot open " << path << " for mapping (error " << GetLastError() << ")\n";
+        return false;
+    }
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        std::cerr << "[ERROR] Cannot map empty or unreadable file " << path << "\n";
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);   // the mapping object keeps the file open
+    if (!mapping) {
+        std::cerr << "[ERROR] CreateFileMapping on " << path << " failed (error " << GetLastError() << ")\n";
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        std::cerr << "[ERROR] MapViewOfFile on " << path << " failed (error " << GetLastError() << ")\n";
+        CloseHandle(mapping);
+        return false;
+    }
+    mapping_ = mapping;
+    data_ = view;
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "[ERROR] Cannot open " << path << " for mapping: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        std::cerr << "[ERROR] Cannot map empty or unreadable file " << path << "\n";
+        ::close(fd);
+        return false;
+    }
+    void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);   // the mapping keeps its own reference
+    if (p == MAP_FAILED) {
+        std::cerr << "[ERROR] mmap on " << path << " failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    data_ = p;
+    size_ = static_cast<size_t>(st.st_size);
+#endif
+    return true;
+}
+
+bool MappedFile::openWritable(const std::string& path, size_t size, const std::string& magic) {
+    close();
+    if (size == 0) {
+        std::cerr << "[ERROR] Cannot map " << path << " with size 0\n";
+        return false;
+    }
+#if defined(_WIN32)
+    HANDLE file = CreateFileW(widePath(path).c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        const DWORD error = GetLastError();
+        // The share mode admits readers only, so a second writer lands here.
+        if (error == ERROR_SHARING_VIOLATION) {
+            std::cerr << "[ERROR] " << path << " is in use by another process\n";
+        } else {
+            std::cerr << "[ERROR] Cannot open " << path << " for writing (error " << error << ")\n";
+        }
+        return false;
+    }
+    LARGE_INTEGER existing{};
+    if (!magic.empty() && GetFileSizeEx(file, &existing) && existing.QuadPart > 0) {
+        std::string head(magic.size(), '\0');
+        DWORD got = 0;
+        if (!ReadFile(file, &head[0], static_cast<DWORD>(head.size()), &got, nullptr) || got != head.size() ||
+            head != magic) {
+            std::cerr << "[ERROR] " << path << " is not the expected kind of file; not overwriting it.\n";
+            CloseHandle(file);
+            return false;
+        }
+    }
+    LARGE_INTEGER want{};
+    want.QuadPart = static_cast<LONGLONG>(size);
+    if (!SetFilePointerEx(file, want, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+        std::cerr << "[ERROR] Cannot resize " << path << " (error " << GetLastError() << ")\n";
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    if (!mapping) {
+        std::cerr << "[ERROR] CreateFileMapping on " << path << " failed (error " << GetLastError() << ")\n";
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+    if (!view) {
+        std::cerr << "[ERROR] MapViewOfFile on " << path << " failed (error " << GetLastError() << ")\n";
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    file_ = file;   // FlushFileBuffers needs it
+    mapping_ = mapping;
+    data_ = view;
+#else
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "[ERROR] Cannot open " << path << " for writing: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    // Held until close(): a second writer would resize and overwrite the
+    // file under this mapping.
+    if (::flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        if (errno == EWOULDBLOCK) {
+            std::cerr << "[ERROR] " << path << " is in use by another process\n";
+        } else {
+            std::cerr << "[ERROR] Cannot lock " << path << ": " << std::strerror(errno) << "\n";
+        }
+        ::close(fd);
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        std::cerr << "[ERROR] Cannot stat " << path << ": " << std::strerror(errno) << "\n";
+        ::close(fd);
+        return false;
+    }
+    if (!magic.empty() && st.st_size > 0) {
+        std::string head(magic.size(), '\0');
+        if (::pread(fd, &head[0], head.size(), 0) != static_cast<ssize_t>(head.size()) || head != magic) {
+            std::cerr << "[ERROR] " << path << " is not the expected kind of file; not overwriting it.\n";
+            ::close(fd);
+            return false;
+        }
+    }
+    if (static_cast<size_t>(st.st_size) != size && ::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        std::cerr << "[ERROR] Cannot resize " << path << ": " << std::strerror(errno) << "\n";
+        ::close(fd);
+        return false;
+    }
+    void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        std::cerr << "[ERROR] mmap on " << path << " failed: " << std::strerror(errno) << "\n";
+        ::close(fd);
+        return false;
+    }
+    fd_ = fd;
+    data_ = p;
+#endif
+    size_ = size;
+    writable_ = true;
+    return true;
+}
+
+bool MappedFile::flush(size_t offset, size_t length) {
+    if (!writable_ || offset >= size_) {
+        return false;
+    }
+    length = std::min(length, size_ - offset);
+    char* base = static_cast<char*>(data_);
+#if defined(_WIN32)
+    return FlushViewOfFile(base + offset, length) && FlushFileBuffers(static_cast<HANDLE>(file_));
+#else
+    // msync wants a page-aligned start.
+    const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const size_t aligned = offset - offset % page;
+    return ::msync(base + aligned, length + (offset - aligned), MS_SYNC) == 0;
+#endif
+}
+
+void MappedFile::close() {
+    if (!data_) {
+        return;
+    }
+#if defined(_WIN32)
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+    if (file_) {
+        CloseHandle(static_cast<HANDLE>(file_));
+        file_ = nullptr;
+    }
+#else
+    ::munmap(data_, size_);
+    if (fd_ >= 0) {
+        ::close(fd_);   // releases the lock
+        fd_ = -1;
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    writable_ = false;
+}
@@ -0,0 +1,51 @@
+// mapped_file.h
+// Memory mapping of a whole file. Pages come from the OS page cache, so
+// several processes mapping the same file share one physical copy. Mappings
+// are read-only unless opened with openWritable().
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps `path` (UTF-8); prints the reason and returns false on failure. An
+    // empty file cannot be mapped.
+    bool open(const std::string& path);
+    // Maps `path` read-write, creating it or resizing it to `size` bytes
+    // first (new bytes are zero). Stores through mutableData() reach the file
+    // via the page cache; flush() makes a range durable. The file stays
+    // locked against other writers until close(); opening a file another
+    // process (or mapping) holds fails. With a `magic`, an existing non-empty
+    // file must start with it; that is checked under the lock, before the
+    // resize, and a file that does not is left untouched.
+    bool openWritable(const std::string& path, size_t size, const std::string& magic = std::string());
+    void close();
+
+    // Writes [offset, offset + length) of a writable mapping to disk and
+    // waits for it.
+    bool flush(size_t offset, size_t length);
+
+    const void* data() const { return data_; }
+    void* mutableData() { return writable_ ? data_ : nullptr; }
+    size_t size() const { return size_; }
+    bool isOpen() const { return data_ != nullptr; }
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+    bool writable_ = false;
+#if defined(_WIN32)
+    void* mapping_ = nullptr;   // HANDLE of the file mapping object
+    void* file_ = nullptr;      // HANDLE of the file, kept open by writable mappings
+#else
+    int fd_ = -1;               // writable mappings: holds the flock
+#endif
+};
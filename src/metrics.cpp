@@ -0,0 +1,439 @@
+// metrics.cpp
+// Metric registry, Prometheus text rendering and the localhost HTTP listener.
+
+#include "metrics.h"
+
+#include "sysinfo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using SocketHandle = SOCKET;
+constexpr SocketHandle kInvalidSocket = INVALID_SOCKET;
+inline void closeSocket(SocketHandle s) { closesocket(s); }
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using SocketHandle = int;
+constexpr SocketHandle kInvalidSocket = -1;
+inline void closeSocket(SocketHandle s) { ::close(s); }
+#endif
+// A scraper hanging up mid-response must not SIGPIPE the process. Windows
+// has no SIGPIPE; macOS lacks the flag and sets SO_NOSIGPIPE per socket.
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace metrics {
+namespace {
+
+enum class Type { Counter, Gauge, Histogram };
+
+struct Series {
+    Labels labels;
+    std::unique_ptr<Counter> counter;
+    std::unique_ptr<Gauge> gauge;
+    std::unique_ptr<Histogram> histogram;
+    std::function<double()> callback;
+};
+
+struct Family {
+    std::string name;
+    std::string help;
+    Type type = Type::Counter;
+    std::vector<std::unique_ptr<Series>> series;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Family>> families;   // registration order
+    std::map<std::string, Family*> byName;
+};
+
+Registry& registry() {
+    static Registry* r = new Registry();   // leaked on purpose: metrics are used until exit
+    return *r;
+}
+
+// Finds or creates the series (name, labels). Caller holds the registry lock.
+// Returns nullptr when `name` is already registered with another type.
+Series* findSeries(Registry& r, const std::string& name, const std::string& help,
+                   Type type, const Labels& labels) {
+    Family* family = nullptr;
+    auto it = r.byName.find(name);
+    if (it == r.byName.end()) {
+        r.families.push_back(std::make_unique<Family>());
+        family = r.families.back().get();
+        family->name = name;
+        family->help = help;
+        family->type = type;
+        r.byName[name] = family;
+    } else {
+        family = it->second;
+        if (family->type != type) {
+            std::cerr << "[WARN] Metric " << name << " registered with two different types.\n";
+            return nullptr;
+        }
+    }
+    for (auto& s : family->series) {
+        if (s->labels == labels) return s.get();
+    }
+    family->series.push_back(std::make_unique<Series>());
+    family->series.back()->labels = labels;
+    return family->series.back().get();
+}
+
+void appendLabelValue(std::ostringstream& out, const std::string& value) {
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            out << '\\' << c;
+        } else if (c == '\n') {
+            out << "\\n";
+        } else {
+            out << c;
+        }
+    }
+}
+
+// `extra` is an additional label (e.g. le="0.5") appended after `labels`.
+void appendLabels(std::ostringstream& out, const Labels& labels, const std::string& extra = {}) {
+    if (labels.empty() && extra.empty()) return;
+    out << '{';
+    bool first = true;
+    for (const auto& kv : labels) {
+        if (!first) out << ',';
+        out << kv.first << "=\"";
+        appendLabelValue(out, kv.second);
+        out << '"';
+        first = false;
+    }
+    if (!extra.empty()) {
+        if (!first) out << ',';
+        out << extra;
+    }
+    out << '}';
+}
+
+void appendNumber(std::ostringstream& out, double v) {
+    if (std::isnan(v)) {
+        out << "NaN";
+    } else if (std::isinf(v)) {
+        out << (v > 0 ? "+Inf" : "-Inf");
+    } else {
+        out << v;
+    }
+}
+
+struct HttpServer {
+    std::mutex mutex;
+    std::thread thread;
+    std::atomic<bool> stopping{false};
+    SocketHandle listenSocket = kInvalidSocket;
+};
+
+HttpServer& httpServer() {
+    static HttpServer s;
+    return s;
+}
+
+void sendAll(SocketHandle s, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const auto n = ::send(s, data.data() + sent, static_cast<int>(data.size() - sent), MSG_NOSIGNAL);
+        if (n <= 0) return;
+        sent += static_cast<size_t>(n);
+    }
+}
+
+// Reads the request head and answers with the metrics page (or 404). One
+// request per connection; scrapes are infrequent.
+void serveClient(SocketHandle client) {
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(client, &readSet);
+        timeval tv{2, 0};
+        if (::select(static_cast<int>(client) + 1, &readSet, nullptr, nullptr, &tv) <= 0) break;
+        const auto n = ::recv(client, buffer, sizeof(buffer), 0);
+        if (n <= 0) break;
+        request.append(buffer, static_cast<size_t>(n));
+    }
+
+    const bool isGet = request.compare(0, 4, "GET ") == 0;
+    const size_t pathEnd = request.find(' ', 4);
+    const std::string path = isGet && pathEnd != std::string::npos
+                                 ? request.substr(4, pathEnd - 4)
+                                 : std::string();
+
+    std::string status = "200 OK";
+    std::string body;
+    std::string contentType = "text/plain; version=0.0.4; charset=utf-8";
+    if (path == "/metrics" || path == "/") {
+        body = renderPrometheus();
+    } else {
+        status = isGet ? "404 Not Found" : "405 Method Not Allowed";
+        body = "Try GET /metrics\n";
+        contentType = "text/plain; charset=utf-8";
+    }
+
+    std::ostringstream head;
+    head << "HTTP/1.1 " << status << "\r\n"
+         << "Content-Type: " << contentType << "\r\n"
+         << "Content-Length: " << body.size() << "\r\n"
+         << "Connection: close\r\n\r\n";
+    sendAll(client, head.str());
+    sendAll(client, body);
+}
+
+}  // namespace
+
+Histogram::Histogram(std::vector<double> upperBounds)
+    : bounds_(std::move(upperBounds)) {
+    std::sort(bounds_.begin(), bounds_.end());
+    bounds_.erase(std::unique(bounds_.begin(), bounds_.end()), bounds_.end());
+    buckets_.reset(new std::atomic<uint64_t>[bounds_.size() + 1]);
+    for (size_t i = 0; i <= bounds_.size(); ++i) buckets_[i].store(0);
+}
+
+void Histogram::observe(double value) {
+    const size_t idx = static_cast<size_t>(
+        std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin());
+    buckets_[idx].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sumMicros_.fetch_add(static_cast<uint64_t>(std::max(0.0, value) * 1e6),
+                         std::memory_order_relaxed);
+}
+
+std::vector<uint64_t> Histogram::bucketCounts() const {
+    std::vector<uint64_t> out(bounds_.size() + 1);
+    for (size_t i = 0; i < out.size(); ++i) out[i] = buckets_[i].load(std::memory_order_relaxed);
+    return out;
+}
+
+const std::vector<double>& defaultLatencyBuckets() {
+    static const std::vector<double> buckets{0.005, 0.01, 0.025, 0.05, 0.1, 0.25,
+                                             0.5,   1.0,  2.5,   5.0,  10.0};
+    return buckets;
+}
+
+Counter& counter(const std::string& name, const std::string& help, const Labels& labels) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    Series* s = findSeries(r, name, help, Type::Counter, labels);
+    if (!s) {
+        static Counter dummy;
+        return dummy;
+    }
+    if (!s->counter) s->counter = std::make_unique<Counter>();
+    return *s->counter;
+}
+
+Gauge& gauge(const std::string& name, const std::string& help, const Labels& labels) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    Series* s = findSeries(r, name, help, Type::Gauge, labels);
+    if (!s) {
+        static Gauge dummy;
+        return dummy;
+    }
+    if (!s->gauge) s->gauge = std::make_unique<Gauge>();
+    return *s->gauge;
+}
+
+Histogram& histogram(const std::string& name, const std::string& help,
+                     const std::vector<double>& upperBounds, const Labels& labels) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    Series* s = findSeries(r, name, help, Type::Histogram, labels);
+    if (!s) {
+        static Histogram dummy(defaultLatencyBuckets());
+        return dummy;
+    }
+    if (!s->histogram) s->histogram = std::make_unique<Histogram>(upperBounds);
+    return *s->histogram;
+}
+
+void callbackGauge(const std::string& name, const std::string& help, std::function<double()> fn) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (Series* s = findSeries(r, name, help, Type::Gauge, {})) {
+        s->callback = std::move(fn);
+    }
+}
+
+void registerProcessMetrics() {
+    callbackGauge("toolsdetect_process_resident_memory_bytes", "Resident set size",
+                  []() { return static_cast<double>(currentRssBytes()); });
+    callbackGauge("toolsdetect_process_peak_resident_memory_bytes", "Peak resident set size",
+                  []() { return static_cast<double>(peakRssBytes()); });
+}
+
+std::string renderPrometheus() {
+    // Copy the series list under the lock, then read values and run gauge
+    // callbacks (which may take locks of their own) without it, so a slow
+    // callback never blocks metric registration on the detection threads.
+    // Metric objects are never freed, so the pointers stay valid.
+    struct SeriesView {
+        Labels labels;
+        const Counter* counter = nullptr;
+        const Gauge* gauge = nullptr;
+        const Histogram* histogram = nullptr;
+        std::function<double()> callback;
+    };
+    struct FamilyView {
+        std::string name;
+        std::string help;
+        Type type = Type::Counter;
+        std::vector<SeriesView> series;
+    };
+    std::vector<FamilyView> families;
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        families.reserve(r.families.size());
+        for (const auto& family : r.families) {
+            FamilyView view{family->name, family->help, family->type, {}};
+            view.series.reserve(family->series.size());
+            for (const auto& s : family->series) {
+                view.series.push_back({s->labels, s->counter.get(), s->gauge.get(),
+                                       s->histogram.get(), s->callback});
+            }
+            families.push_back(std::move(view));
+        }
+    }
+
+    std::ostringstream out;
+    out << std::setprecision(10);
+    for (const auto& family : families) {
+        static const char* kTypeNames[] = {"counter", "gauge", "histogram"};
+        out << "# HELP " << family.name << ' ' << family.help << '\n'
+            << "# TYPE " << family.name << ' ' << kTypeNames[static_cast<int>(family.type)] << '\n';
+
+        for (const auto& s : family.series) {
+            if (s.counter) {
+                out << family.name;
+                appendLabels(out, s.labels);
+                out << ' ' << s.counter->value() << '\n';
+            } else if (s.gauge || s.callback) {
+                out << family.name;
+                appendLabels(out, s.labels);
+                out << ' ';
+                appendNumber(out, s.callback ? s.callback() : s.gauge->value());
+                out << '\n';
+            } else if (s.histogram) {
+                const Histogram& h = *s.histogram;
+                const std::vector<uint64_t> counts = h.bucketCounts();
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i < counts.size(); ++i) {
+                    cumulative += counts[i];
+                    std::ostringstream le;
+                    le << std::setprecision(10) << "le=\"";
+                    if (i < h.upperBounds().size()) {
+                        le << h.upperBounds()[i];
+                    } else {
+                        le << "+Inf";
+                    }
+                    le << '"';
+                    out << family.name << "_bucket";
+                    appendLabels(out, s.labels, le.str());
+                    out << ' ' << cumulative << '\n';
+                }
+                out << family.name << "_sum";
+                appendLabels(out, s.labels);
+                out << ' ' << h.sum() << '\n';
+                out << family.name << "_count";
+                appendLabels(out, s.labels);
+                out << ' ' << cumulative << '\n';
+            }
+        }
+    }
+    return out.str();
+}
+
+bool startHttpServer(int port) {
+    HttpServer& server = httpServer();
+    std::lock_guard<std::mutex> lock(server.mutex);
+    if (server.thread.joinable()) return false;
+
+#if defined(_WIN32)
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        std::cerr << "[ERROR] WSAStartup failed; metrics endpoint disabled.\n";
+        return false;
+    }
+#endif
+
+    SocketHandle s = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (s == kInvalidSocket) {
+        std::cerr << "[ERROR] Cannot create metrics socket.\n";
+        return false;
+    }
+    int reuse = 1;
+    ::setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    // Loopback only: the scraper runs on the cabinet PC (or tunnels in).
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(s, 8) != 0) {
+        std::cerr << "[ERROR] Cannot listen on 127.0.0.1:" << port << " for metrics.\n";
+        closeSocket(s);
+        return false;
+    }
+
+    server.listenSocket = s;
+    server.stopping.store(false);
+    server.thread = std::thread([&server]() {
+        while (!server.stopping.load()) {
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(server.listenSocket, &readSet);
+            timeval tv{0, 200 * 1000};
+            if (::select(static_cast<int>(server.listenSocket) + 1, &readSet,
+                         nullptr, nullptr, &tv) <= 0) {
+                continue;
+            }
+            SocketHandle client = ::accept(server.listenSocket, nullptr, nullptr);
+            if (client == kInvalidSocket) continue;
+#if defined(SO_NOSIGPIPE)
+            const int one = 1;
+            ::setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+            serveClient(client);
+            closeSocket(client);
+        }
+    });
+    std::cout << "[INFO] Metrics endpoint: http://127.0.0.1:" << port << "/metrics\n";
+    return true;
+}
+
+void stopHttpServer() {
+    HttpServer& server = httpServer();
+    std::lock_guard<std::mutex> lock(server.mutex);
+    if (!server.thread.joinable()) return;
+    server.stopping.store(true);
+    server.thread.join();
+    closeSocket(server.listenSocket);
+    server.listenSocket = kInvalidSocket;
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+}
+
+}  // namespace metrics
@@ -0,0 +1,113 @@
+// metrics.h
+// Process-wide counters, gauges and histograms exposed in Prometheus text
+// format by a small embedded HTTP listener (--metrics-port):
+//
+//   static metrics::Counter& frames =
+//       metrics::counter("toolsdetect_video_frames_total", "Video frames processed");
+//   frames.inc();
+//
+// Registration takes a lock and should happen once per call site (keep the
+// returned reference in a function-local static). Updating a metric is a
+// single relaxed atomic operation, and rendering runs on the listener
+// thread, so scrapes never block the detection threads.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace metrics {
+
+// name="value" pairs appended to the metric name, e.g. {{"class", "pliers"}}.
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+class Counter {
+public:
+    void inc(uint64_t by = 1) { value_.fetch_add(by, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+class Gauge {
+public:
+    void set(double v) { value_.store(v, std::memory_order_relaxed); }
+    void add(double by) {
+        double cur = value_.load(std::memory_order_relaxed);
+        while (!value_.compare_exchange_weak(cur, cur + by, std::memory_order_relaxed)) {
+        }
+    }
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{0.0};
+};
+
+// Fixed-bucket histogram (Prometheus "le" buckets). Latencies are observed
+// in seconds, following the Prometheus naming conventions.
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> upperBounds);
+
+    void observe(double value);
+
+    const std::vector<double>& upperBounds() const { return bounds_; }
+    // Per-bucket (non-cumulative) counts; the last entry is +Inf.
+    std::vector<uint64_t> bucketCounts() const;
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    double sum() const { return static_cast<double>(sumMicros_.load(std::memory_order_relaxed)) / 1e6; }
+
+private:
+    std::vector<double> bounds_;
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets_;
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sumMicros_{0};
+};
+
+// Default latency buckets: 5 ms .. 10 s.
+const std::vector<double>& defaultLatencyBuckets();
+
+// Returns the metric registered under (name, labels), creating it on first
+// use. References stay valid for the life of the process. Registering the
+// same name with a different type returns a detached dummy and logs a warning.
+Counter& counter(const std::string& name, const std::string& help, const Labels& labels = {});
+Gauge& gauge(const std::string& name, const std::string& help, const Labels& labels = {});
+Histogram& histogram(const std::string& name, const std::string& help,
+                     const std::vector<double>& upperBounds = defaultLatencyBuckets(),
+                     const Labels& labels = {});
+
+// A gauge whose value is computed at scrape time (e.g. RSS). The callback
+// runs on the scraping thread, outside the registry lock.
+void callbackGauge(const std::string& name, const std::string& help, std::function<double()> fn);
+
+// Prometheus text exposition format (version 0.0.4).
+std::string renderPrometheus();
+
+// Serves GET /metrics on 127.0.0.1:<port> from a background thread.
+bool startHttpServer(int port);
+void stopHttpServer();
+
+// Registers process-level gauges (resident / peak memory).
+void registerProcessMetrics();
+
+// Runs the HTTP listener for the lifetime of the object (port 0 = disabled).
+class ScopedHttpServer {
+public:
+    explicit ScopedHttpServer(int port) : active_(port > 0 && startHttpServer(port)) {}
+    ~ScopedHttpServer() {
+        if (active_) stopHttpServer();
+    }
+    ScopedHttpServer(const ScopedHttpServer&) = delete;
+    ScopedHttpServer& operator=(const ScopedHttpServer&) = delete;
+
+private:
+    bool active_;
+};
+
+}  // namespace metrics
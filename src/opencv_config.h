@@ -27,3 +27,19 @@
 #ifndef TOOLSDETECT_HAS_HIGHGUI
 #define TOOLSDETECT_HAS_HIGHGUI 0
 #endif
+
+// CMake sets TOOLSDETECT_HAS_DNN from whether opencv_dnn can be linked;
+// the header check is only a fallback for other build setups.
+#ifndef TOOLSDETECT_HAS_DNN
+#  if defined(__has_include)
+#    if __has_include(<opencv2/dnn.hpp>)
+#      define TOOLSDETECT_HAS_DNN 1
+#    endif
+#  endif
+#endif
+#ifndef TOOLSDETECT_HAS_DNN
+#define TOOLSDETECT_HAS_DNN 0
+#endif
+#if TOOLSDETECT_HAS_DNN
+#include <opencv2/dnn.hpp>
+#endif
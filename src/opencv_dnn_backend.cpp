@@ -0,0 +1,82 @@
+// opencv_dnn_backend.cpp
+
+#include "opencv_dnn_backend.h"
+
+#if TOOLSDETECT_HAS_DNN
+
+#include "perf_stats.h"
+
+#include <iostream>
+#include <stdexcept>
+
+OpenCvDnnBackend::OpenCvDnnBackend(const DetectorConfig& config)
+    : config_(config) {
+    const std::string path = wideToUtf8(config_.modelPath);
+    try {
+        net_ = cv::dnn::readNetFromONNX(path);
+    } catch (const cv::Exception& ex) {
+        throw std::runtime_error("OpenCV DNN failed to load " + path + ": " + ex.what());
+    }
+    if (net_.empty()) {
+        throw std::runtime_error("OpenCV DNN failed to load " + path);
+    }
+    // OpenCV has no metadata API; read the Ultralytics task from the file.
+    std::string task;
+    if (readOnnxMetadata(path, "task", task) && task == "obb") {
+        head_ = YoloHead::Obb;
+        std::cerr << "[INFO] Model is an oriented-box (OBB) export\n";
+    }
+    net_.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net_.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+}
+
+std::vector<std::vector<YoloResult>> OpenCvDnnBackend::inferBatch(const std::vector<cv::Mat>& images) {
+    std::vector<std::vector<YoloResult>> results(images.size());
+    const int w = config_.inputWidth;
+    const int h = config_.inputHeight;
+    const size_t per_image = 3 * static_cast<size_t>(w) * static_cast<size_t>(h);
+
+    std::lock_guard<std::mutex> lock(netMutex_);
+    inputBuffer_.resize(per_image);
+    for (size_t i = 0; i < images.size(); ++i) {
+        const cv::Mat& image = images[i];
+        if (image.empty()) continue;
+
+        {
+            TD_PERF_SCOPE("yolo.preprocess");
+            preprocessLetterbox(image, inputBuffer_.data(), w, h);
+        }
+        const int blob_shape[] = {1, 3, h, w};
+        cv::Mat blob(4, blob_shape, CV_32F, inputBuffer_.data());
+
+        cv::Mat out;
+        {
+            TD_PERF_SCOPE("yolo.session_run");
+            net_.setInput(blob);
+            out = net_.forward();
+        }
+
+        // [1, attrs, anchors] (Ultralytics) or [1, anchors, attrs]; the
+        // decoder accepts both.
+        int64_t rows = 0;
+        int64_t cols = 0;
+        if (out.dims == 3) {
+            rows = out.size[1];
+            cols = out.size[2];
+        } else if (out.dims == 2) {
+            rows = out.rows;
+            cols = out.cols;
+        } else {
+            throw std::runtime_error("Unexpected OpenCV DNN output rank (expected 3).");
+        }
+        if (!out.isContinuous()) out = out.clone();
+
+        results[i] = postprocessYoloOutput(out.ptr<float>(), rows, cols,
+                                           config_.classNames.size(),
+                                           config_.confThreshold, config_.nmsThreshold,
+                                           image.cols, image.rows, w, h, head_);
+    }
+    return results;
+}
+
+#endif  // TOOLSDETECT_HAS_DNN
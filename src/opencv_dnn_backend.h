@@ -0,0 +1,32 @@
+// opencv_dnn_backend.h
+// YOLO inference through OpenCV's DNN module on the CPU (no ONNX Runtime).
+
+#pragma once
+
+#include "detector_backend.h"
+#include "opencv_config.h"
+
+#if TOOLSDETECT_HAS_DNN
+
+#include <mutex>
+
+class OpenCvDnnBackend : public DetectorBackend {
+public:
+    // Throws std::runtime_error if the model cannot be loaded.
+    explicit OpenCvDnnBackend(const DetectorConfig& config = DetectorConfig());
+
+    const char* name() const override { return "opencv"; }
+    std::vector<std::vector<YoloResult>> inferBatch(const std::vector<cv::Mat>& images) override;
+    const std::vector<std::string>& classNames() const override { return config_.classNames; }
+    int defaultInputSize() const override { return config_.inputWidth; }
+
+private:
+    DetectorConfig config_;
+    cv::dnn::Net net_;
+    // cv::dnn::Net::forward() is not re-entrant; concurrent sessions take turns.
+    std::mutex netMutex_;
+    std::vector<float> inputBuffer_;   // guarded by netMutex_
+    YoloHead head_ = YoloHead::Detect;
+};
+
+#endif  // TOOLSDETECT_HAS_DNN
@@ -0,0 +1,191 @@
+#include "overlay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+namespace {
+
+constexpr int kFont = cv::FONT_HERSHEY_SIMPLEX;
+// Class names plus characters at a handful of font sizes stay far below
+// this; it only guards against callers passing ever-changing strings.
+constexpr size_t kMaxCachedGlyphs = 1024;
+
+struct Glyph {
+    cv::Mat mask;      // CV_8UC1, 255 where the text is inked
+    cv::Point origin;  // baseline start inside `mask`
+    int advance = 0;   // pen advance in pixels
+};
+
+class GlyphCache {
+public:
+    // Rasterizes `text` on first use per (font scale, thickness). The
+    // returned mask is shared and never written again.
+    Glyph get(const std::string& text, double fontScale, int thickness) {
+        // Quantize so nearly equal scales (diagonal ratios) share entries.
+        const int scaleKey = std::max(1, static_cast<int>(std::lround(fontScale * 100.0)));
+        const Key key{text, scaleKey, thickness};
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto it = glyphs_.find(key);
+            if (it != glyphs_.end()) {
+                return it->second;
+            }
+        }
+        const Glyph glyph = render(text, scaleKey / 100.0, thickness);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (glyphs_.size() < kMaxCachedGlyphs) {
+            glyphs_.emplace(key, glyph);
+        }
+        return glyph;
+    }
+
+private:
+    using Key = std::tuple<std::string, int, int>;
+
+    static Glyph render(const std::string& text, double fontScale, int thickness) {
+        int baseline = 0;
+        const cv::Size size = cv::getTextSize(text, kFont, fontScale, thickness, &baseline);
+        const int pad = thickness;   // strokes reach past the nominal box
+        Glyph glyph;
+        glyph.mask = cv::Mat::zeros(size.height + baseline + 2 * pad, size.width + 2 * pad, CV_8UC1);
+        glyph.origin = cv::Point(pad, pad + size.height);
+        // getTextSize adds the stroke thickness once per string; putText
+        // moves the pen by the Hershey glyph widths alone.
+        glyph.advance = size.width - thickness;
+        cv::putText(glyph.mask, text, glyph.origin, kFont, fontScale, cv::Scalar(255), thickness);
+        return glyph;
+    }
+
+    std::mutex mutex_;
+    std::map<Key, Glyph> glyphs_;
+};
+
+GlyphCache& glyphCache() {
+    static GlyphCache cache;
+    return cache;
+}
+
+// Paints `glyph` in `color` with its baseline start at `origin`; returns the
+// pen position after it.
+cv::Point blitGlyph(cv::Mat& image, const Glyph& glyph, cv::Point origin, const cv::Scalar& color) {
+    const cv::Rect placed(origin.x - glyph.origin.x, origin.y - glyph.origin.y,
+                          glyph.mask.cols, glyph.mask.rows);
+    const cv::Rect visible = placed & cv::Rect(0, 0, image.cols, image.rows);
+    if (visible.area() > 0) {
+        const cv::Rect inMask(visible.x - placed.x, visible.y - placed.y, visible.width, visible.height);
+        image(visible).setTo(color, glyph.mask(inMask));
+    }
+    return cv::Point(origin.x + glyph.advance, origin.y);
+}
+
+}  // namespace
+
+DrawOverlayStyle makeOverlayStyle(double relativeScale) {
+    DrawOverlayStyle style;
+    style.rectThickness =
+        std::max(1, static_cast<int>(std::round(4.0 * relativeScale)));
+    style.fontScale = 2.5 * relativeScale;
+    style.textThickness =
+        std::max(1, static_cast<int>(std::round(5.0 * relativeScale)));
+    return style;
+}
+
+double computeImageDiagonal(const cv::Mat& image) {
+    if (image.empty()) {
+        return 0.0;
+    }
+    return std::hypot(static_cast<double>(image.cols),
+                      static_cast<double>(image.rows));
+}
+
+void drawStatusText(cv::Mat& image,
+                    const std::string& text,
+                    const DrawOverlayStyle& style) {
+    const double fontScale = std::max(0.5, style.fontScale * 0.6);
+    const int thickness = std::max(1, style.textThickness / 2);
+    int baseline = 0;
+    const cv::Size size = cv::getTextSize(text, cv::FONT_HERSHEY_SIMPLEX, fontScale, thickness, &baseline);
+    const int pad = 6;
+    cv::rectangle(image, cv::Rect(0, 0, size.width + 2 * pad, size.height + baseline + 2 * pad),
+                  cv::Scalar(0, 0, 0), cv::FILLED);
+    cv::putText(image, text, cv::Point(pad, pad + size.height), cv::FONT_HERSHEY_SIMPLEX,
+                fontScale, cv::Scalar(255, 255, 255), thickness);
+}
+
+void drawDetections(cv::Mat& image,
+                    const DetectionResult& detections,
+                    const DrawOverlayStyle& style) {
+    for (const auto& obj : detections.objects) {
+        if (obj.oriented) {
+            cv::Point2f corners[4];
+            obj.obb.points(corners);
+            for (int i = 0; i < 4; ++i) {
+                cv::line(image, corners[i], corners[(i + 1) % 4], style.color, style.rectThickness);
+            }
+        } else {
+            cv::rectangle(image, obj.bbox, style.color, style.rectThickness);
+        }
+        // "#<track> <class> 0.87": the class name is one cached glyph, the
+        // rest is drawn from per-character glyphs.
+        cv::Point pen(obj.bbox.x, obj.bbox.y - 5);
+        if (obj.trackId >= 0) {
+            pen = drawCachedText(image, "#" + std::to_string(obj.trackId) + " ", pen, style.fontScale,
+                                 style.textThickness, style.color);
+        }
+        pen = blitGlyph(image, glyphCache().get(obj.cls, style.fontScale, style.textThickness), pen,
+                        style.color);
+        drawCachedText(image, " " + std::to_string(obj.confidence).substr(0, 4), pen, style.fontScale,
+                       style.textThickness, style.color);
+    }
+}
+
+cv::Point drawCachedText(cv::Mat& image,
+                         const std::string& text,
+                         cv::Point origin,
+                         double fontScale,
+                         int thickness,
+                         const cv::Scalar& color) {
+    GlyphCache& cache = glyphCache();
+    for (char c : text) {
+        origin = blitGlyph(image, cache.get(std::string(1, c), fontScale, thickness), origin, color);
+    }
+    return origin;
+}
+
+cv::Mat renderDetectionsFitted(const cv::Mat& image,
+                               const DetectionResult& detections,
+                               cv::Size target,
+                               double relativeScale) {
+    if (image.empty()) {
+        return cv::Mat();
+    }
+    const double scale = std::min({1.0, static_cast<double>(target.width) / image.cols,
+                                   static_cast<double>(target.height) / image.rows});
+    cv::Mat canvas;
+    if (scale < 1.0) {
+        const cv::Size size(std::max(1, static_cast<int>(std::lround(image.cols * scale))),
+                            std::max(1, static_cast<int>(std::lround(image.rows * scale))));
+        cv::resize(image, canvas, size, 0, 0, cv::INTER_AREA);
+    } else {
+        canvas = image.clone();
+    }
+
+    DetectionResult scaled = detections;
+    for (auto& obj : scaled.objects) {
+        obj.bbox = cv::Rect(static_cast<int>(std::lround(obj.bbox.x * scale)),
+                            static_cast<int>(std::lround(obj.bbox.y * scale)),
+                            static_cast<int>(std::lround(obj.bbox.width * scale)),
+                            static_cast<int>(std::lround(obj.bbox.height * scale)));
+        obj.obb = cv::RotatedRect(cv::Point2f(static_cast<float>(obj.obb.center.x * scale),
+                                              static_cast<float>(obj.obb.center.y * scale)),
+                                  cv::Size2f(static_cast<float>(obj.obb.size.width * scale),
+                                             static_cast<float>(obj.obb.size.height * scale)),
+                                  obj.obb.angle);
+    }
+    drawDetections(canvas, scaled, makeOverlayStyle(relativeScale * scale));
+    return canvas;
+}
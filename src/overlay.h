@@ -0,0 +1,58 @@
+#pragma once
+
+#include "detector.h"
+
+#include <opencv2/opencv.hpp>
+
+// Drawing helpers shared by the interactive session loop, video mode and the
+// headless daemon. Only depends on imgproc, never on highgui.
+struct DrawOverlayStyle {
+    cv::Scalar color{0, 255, 0};
+    int rectThickness = 2;
+    double fontScale = 1.0;
+    int textThickness = 2;
+};
+
+// Builds a style whose stroke/text sizes scale with the image size relative to
+// the reference (before) snapshot.
+DrawOverlayStyle makeOverlayStyle(double relativeScale);
+
+// Returns the pixel diagonal of the image, or 0 for an empty image.
+double computeImageDiagonal(const cv::Mat& image);
+
+// Draws a status line (input size, fps, ...) in the top-left corner on a
+// dark box so it stays readable on any background.
+void drawStatusText(cv::Mat& image,
+                    const std::string& text,
+                    const DrawOverlayStyle& style);
+
+// Draws each detection box with its "class confidence" label. Label text
+// comes from a process-wide glyph cache: each class name is rasterized once
+// per font size, digits and punctuation once per character.
+void drawDetections(cv::Mat& image,
+                    const DetectionResult& detections,
+                    const DrawOverlayStyle& style);
+
+// Draws `text` with its baseline starting at `origin`, like cv::putText with
+// FONT_HERSHEY_SIMPLEX, from cached per-character glyphs. Returns the pen
+// position after the text.
+cv::Point drawCachedText(cv::Mat& image,
+                         const std::string& text,
+                         cv::Point origin,
+                         double fontScale,
+                         int thickness,
+                         const cv::Scalar& color);
+
+// Size the interactive before/after windows show and preview images are
+// rendered at.
+inline const cv::Size kPreviewSize{1920, 1080};
+
+// Display-resolution rendering: shrinks `image` to fit `target` (never
+// enlarges) and then draws the detections, with scaled coordinates and a
+// makeOverlayStyle(relativeScale) style scaled by the same factor, on the
+// small copy. The result looks like the full-resolution overlay shown in a
+// `target` window, at a fraction of the pixels touched.
+cv::Mat renderDetectionsFitted(const cv::Mat& image,
+                               const DetectionResult& detections,
+                               cv::Size target,
+                               double relativeScale = 1.0);
@@ -0,0 +1,302 @@
+// perf_stats.cpp
+// Per-thread log-linear histograms and the periodic PERF log reporter.
+
+#include "perf_stats.h"
+
+#include "logger.h"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace perf {
+namespace {
+
+// Log-linear bucketing: values below 64 ns get one bucket each, above that
+// every power of two is split into 32 sub-buckets (≈3% resolution).
+// 37 magnitudes cover up to 2^40 ns (~18 minutes); larger values clamp.
+constexpr int kSubBits = 5;
+constexpr uint64_t kSubCount = 1ull << kSubBits;
+constexpr int kBuckets = 37 * static_cast<int>(kSubCount);
+
+int msb(uint64_t v) {
+    int n = 0;
+    while (v >>= 1) ++n;
+    return n;
+}
+
+int bucketIndex(uint64_t v) {
+    if (v < 2 * kSubCount) return static_cast<int>(v);
+    const int shift = msb(v) - kSubBits;
+    const int idx = (shift + 1) * static_cast<int>(kSubCount) +
+                    static_cast<int>((v >> shift) - kSubCount);
+    return std::min(idx, kBuckets - 1);
+}
+
+// Representative (midpoint) value of a bucket.
+double bucketValue(int idx) {
+    if (idx < static_cast<int>(2 * kSubCount)) return static_cast<double>(idx);
+    const int shift = idx / static_cast<int>(kSubCount) - 1;
+    const uint64_t sub = static_cast<uint64_t>(idx % kSubCount) + kSubCount;
+    const double lo = static_cast<double>(sub << shift);
+    return lo + static_cast<double>(1ull << shift) * 0.5;
+}
+
+// Written by exactly one thread, read by the reporter: relaxed load+store is
+// enough and avoids locked read-modify-write instructions on the hot path.
+struct StageHistogram {
+    std::array<std::atomic<uint64_t>, kBuckets> counts{};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sumNanos{0};
+    std::atomic<uint64_t> maxNanos{0};
+
+    static void bump(std::atomic<uint64_t>& a, uint64_t by) {
+        a.store(a.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    void add(uint64_t nanos) {
+        bump(counts[bucketIndex(nanos)], 1);
+        bump(total, 1);
+        bump(sumNanos, nanos);
+        if (nanos > maxNanos.load(std::memory_order_relaxed)) {
+            maxNanos.store(nanos, std::memory_order_relaxed);
+        }
+    }
+};
+
+// Plain (non-atomic) accumulator used when merging.
+struct MergedHistogram {
+    std::array<uint64_t, kBuckets> counts{};
+    uint64_t total = 0;
+    uint64_t sumNanos = 0;
+    uint64_t maxNanos = 0;
+
+    void merge(const StageHistogram& h) {
+        for (int i = 0; i < kBuckets; ++i) counts[i] += h.counts[i].load(std::memory_order_relaxed);
+        total += h.total.load(std::memory_order_relaxed);
+        sumNanos += h.sumNanos.load(std::memory_order_relaxed);
+        maxNanos = std::max(maxNanos, h.maxNanos.load(std::memory_order_relaxed));
+    }
+
+    void merge(const MergedHistogram& h) {
+        for (int i = 0; i < kBuckets; ++i) counts[i] += h.counts[i];
+        total += h.total;
+        sumNanos += h.sumNanos;
+        maxNanos = std::max(maxNanos, h.maxNanos);
+    }
+
+    double percentileNanos(double p) const {
+        if (total == 0) return 0.0;
+        const uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(total - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::min(bucketValue(i), static_cast<double>(maxNanos));
+            }
+        }
+        return static_cast<double>(maxNanos);
+    }
+};
+
+// One per thread; stage histograms are allocated on first use.
+struct ThreadBlock {
+    std::array<std::atomic<StageHistogram*>, kMaxStages> stages{};
+
+    ~ThreadBlock() {
+        for (auto& s : stages) delete s.load();
+    }
+
+    StageHistogram& stage(int id) {
+        StageHistogram* h = stages[id].load(std::memory_order_acquire);
+        if (!h) {
+            h = new StageHistogram();
+            stages[id].store(h, std::memory_order_release);
+        }
+        return *h;
+    }
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::string> stageNames;
+    std::vector<ThreadBlock*> liveThreads;
+    std::array<MergedHistogram, kMaxStages> retired{};   // from exited threads
+};
+
+Registry& registry() {
+    static Registry* r = new Registry();   // intentionally leaked: outlives thread exits
+    return *r;
+}
+
+std::atomic<bool> g_enabled{false};
+
+// Registers the calling thread on first record and folds its data into the
+// retired totals when the thread exits.
+struct ThreadBlockHolder {
+    ThreadBlock* block = nullptr;
+
+    ThreadBlock& get() {
+        if (!block) {
+            block = new ThreadBlock();
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.liveThreads.push_back(block);
+        }
+        return *block;
+    }
+
+    ~ThreadBlockHolder() {
+        if (!block) return;
+        Registry& r = registry();
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            for (int i = 0; i < kMaxStages; ++i) {
+                if (StageHistogram* h = block->stages[i].load()) r.retired[i].merge(*h);
+            }
+            r.liveThreads.erase(std::remove(r.liveThreads.begin(), r.liveThreads.end(), block),
+                                r.liveThreads.end());
+        }
+        delete block;
+    }
+};
+
+thread_local ThreadBlockHolder t_block;
+
+struct Reporter {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread thread;
+    bool stopping = false;
+    Logger* logger = nullptr;
+};
+
+Reporter& reporter() {
+    static Reporter r;
+    return r;
+}
+
+}  // namespace
+
+int registerStage(const char* name) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (size_t i = 0; i < r.stageNames.size(); ++i) {
+        if (r.stageNames[i] == name) return static_cast<int>(i);
+    }
+    if (static_cast<int>(r.stageNames.size()) >= kMaxStages) return -1;
+    r.stageNames.emplace_back(name);
+    return static_cast<int>(r.stageNames.size()) - 1;
+}
+
+void setEnabled(bool on) {
+    g_enabled.store(on, std::memory_order_relaxed);
+}
+
+bool enabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void record(int stageId, uint64_t nanos) {
+    if (stageId < 0 || stageId >= kMaxStages) return;
+    t_block.get().stage(stageId).add(nanos);
+}
+
+std::vector<StageSummary> snapshot() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    std::vector<StageSummary> out;
+    for (size_t id = 0; id < r.stageNames.size(); ++id) {
+        MergedHistogram merged;
+        merged.merge(r.retired[id]);
+        for (ThreadBlock* block : r.liveThreads) {
+            if (StageHistogram* h = block->stages[id].load(std::memory_order_acquire)) {
+                merged.merge(*h);
+            }
+        }
+        if (merged.total == 0) continue;
+
+        StageSummary s;
+        s.name = r.stageNames[id];
+        s.count = merged.total;
+        s.meanMs = static_cast<double>(merged.sumNanos) / merged.total / 1e6;
+        s.p50Ms = merged.percentileNanos(0.50) / 1e6;
+        s.p95Ms = merged.percentileNanos(0.95) / 1e6;
+        s.p99Ms = merged.percentileNanos(0.99) / 1e6;
+        s.maxMs = static_cast<double>(merged.maxNanos) / 1e6;
+        out.push_back(s);
+    }
+    return out;
+}
+
+void reset() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (auto& h : r.retired) h = MergedHistogram{};
+    for (ThreadBlock* block : r.liveThreads) {
+        for (auto& slot : block->stages) {
+            if (StageHistogram* h = slot.load(std::memory_order_acquire)) {
+                // Racy against a concurrent add(); acceptable for a stats reset.
+                for (auto& c : h->counts) c.store(0, std::memory_order_relaxed);
+                h->total.store(0, std::memory_order_relaxed);
+                h->sumNanos.store(0, std::memory_order_relaxed);
+                h->maxNanos.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+void logSummary(Logger& logger) {
+    for (const auto& s : snapshot()) {
+        std::ostringstream fields;
+        fields << std::fixed << std::setprecision(3)
+               << "count=" << s.count
+               << " mean_ms=" << s.meanMs
+               << " p50_ms=" << s.p50Ms
+               << " p95_ms=" << s.p95Ms
+               << " p99_ms=" << s.p99Ms
+               << " max_ms=" << s.maxMs;
+        logger.logPerfSummary("stage:" + s.name, fields.str());
+    }
+}
+
+void startReporter(Logger& logger, std::chrono::seconds interval) {
+    Reporter& rep = reporter();
+    std::lock_guard<std::mutex> lock(rep.mutex);
+    if (rep.thread.joinable()) return;
+    rep.stopping = false;
+    rep.logger = &logger;
+    rep.thread = std::thread([&rep, interval]() {
+        std::unique_lock<std::mutex> lk(rep.mutex);
+        while (!rep.cv.wait_for(lk, interval, [&rep]() { return rep.stopping; })) {
+            Logger* target = rep.logger;
+            lk.unlock();
+            logSummary(*target);
+            lk.lock();
+        }
+    });
+}
+
+void stopReporter() {
+    Reporter& rep = reporter();
+    Logger* target = nullptr;
+    std::thread worker;
+    {
+        std::lock_guard<std::mutex> lock(rep.mutex);
+        if (!rep.thread.joinable()) return;
+        rep.stopping = true;
+        target = rep.logger;
+        worker = std::move(rep.thread);
+    }
+    rep.cv.notify_all();
+    worker.join();
+    if (target) logSummary(*target);
+}
+
+}  // namespace perf
@@ -0,0 +1,137 @@
+// perf_stats.h
+// Lightweight per-stage latency instrumentation.
+//
+//   void foo() {
+//       TD_PERF_SCOPE("yolo.preprocess");
+//       ...
+//   }
+//
+// Each scope records its duration into a per-thread, log-linear ("HDR
+// style", ~3% relative precision) histogram for that stage, so the hot path
+// never takes a lock or shares a cache line with other threads. When
+// recording and tracing are both disabled at runtime a scope costs two
+// relaxed atomic loads; building with TOOLSDETECT_ENABLE_PERF=0 removes the
+// scopes entirely. While tracing (trace.h) is on, each scope is also
+// emitted as a timeline span.
+
+#pragma once
+
+#include "trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifndef TOOLSDETECT_ENABLE_PERF
+#define TOOLSDETECT_ENABLE_PERF 1
+#endif
+
+class Logger;
+
+namespace perf {
+
+inline constexpr int kMaxStages = 64;
+
+// Aggregated view of one stage across all threads (durations in ms).
+struct StageSummary {
+    std::string name;
+    uint64_t count = 0;
+    double meanMs = 0.0;
+    double p50Ms = 0.0;
+    double p95Ms = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+};
+
+// Returns a stable id for `name`, registering it on first use. Ids are
+// shared by all threads. Returns -1 once kMaxStages is exhausted.
+int registerStage(const char* name);
+
+void setEnabled(bool enabled);
+bool enabled();
+
+// Records one sample for `stageId` on the calling thread.
+void record(int stageId, uint64_t nanos);
+
+// Merges all threads' histograms (live and exited) into per-stage summaries,
+// in registration order, skipping stages with no samples.
+std::vector<StageSummary> snapshot();
+
+// Clears every histogram.
+void reset();
+
+// Writes one PERF line per stage ("stage:<name> count=.. p50=..") to the log.
+void logSummary(Logger& logger);
+
+// Starts a background thread that calls logSummary() every `interval`.
+// stopReporter() stops it and writes a final summary.
+void startReporter(Logger& logger, std::chrono::seconds interval);
+void stopReporter();
+
+// Runs the reporter for the lifetime of the object when `active` is set.
+class ScopedReporter {
+public:
+    ScopedReporter(Logger& logger, std::chrono::seconds interval, bool active)
+        : active_(active) {
+        if (active_) startReporter(logger, interval);
+    }
+    ~ScopedReporter() {
+        if (active_) stopReporter();
+    }
+    ScopedReporter(const ScopedReporter&) = delete;
+    ScopedReporter& operator=(const ScopedReporter&) = delete;
+
+private:
+    bool active_;
+};
+
+// RAII timer behind TD_PERF_SCOPE. `name` must be a string literal.
+class ScopedTimer {
+public:
+    ScopedTimer(int stageId, const char* name)
+        : stageId_(stageId),
+          name_(name),
+          recording_(stageId >= 0 && enabled()),
+          tracing_(trace::enabled()) {
+        if (recording_) start_ = std::chrono::steady_clock::now();
+        if (tracing_) traceStartUs_ = trace::nowMicros();
+    }
+    ~ScopedTimer() {
+        if (recording_) {
+            auto d = std::chrono::steady_clock::now() - start_;
+            record(stageId_, static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()));
+        }
+        if (tracing_) {
+            trace::emitComplete(name_, nullptr, traceStartUs_,
+                                trace::nowMicros() - traceStartUs_);
+        }
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    int stageId_;
+    const char* name_;
+    bool recording_;
+    bool tracing_;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t traceStartUs_ = 0;
+};
+
+}  // namespace perf
+
+#define TD_PERF_CONCAT_INNER(a, b) a##b
+#define TD_PERF_CONCAT(a, b) TD_PERF_CONCAT_INNER(a, b)
+
+#if TOOLSDETECT_ENABLE_PERF
+#define TD_PERF_SCOPE(name)                                                   \
+    static const int TD_PERF_CONCAT(td_perf_stage_, __LINE__) =               \
+        ::perf::registerStage(name);                                          \
+    ::perf::ScopedTimer TD_PERF_CONCAT(td_perf_scope_, __LINE__)(             \
+        TD_PERF_CONCAT(td_perf_stage_, __LINE__), name)
+#else
+#define TD_PERF_SCOPE(name) do {} while (0)
+#endif
@@ -0,0 +1,57 @@
+// resolution_controller.cpp
+
+#include "resolution_controller.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+ResolutionController::ResolutionController(ResolutionControllerConfig config)
+    : config_(std::move(config)) {
+    if (config_.sizes.empty()) config_.sizes.push_back(640);
+    std::sort(config_.sizes.begin(), config_.sizes.end());
+    // Start at the configured size, or the closest one on the ladder.
+    size_t best = 0;
+    for (size_t i = 1; i < config_.sizes.size(); ++i) {
+        if (std::abs(config_.sizes[i] - config_.initialSize) <
+            std::abs(config_.sizes[best] - config_.initialSize)) {
+            best = i;
+        }
+    }
+    index_ = best;
+    framesSinceSwitch_ = config_.cooldownFrames;
+}
+
+bool ResolutionController::report(double latencyMs) {
+    if (!haveSample_) {
+        ewmaMs_ = latencyMs;
+        haveSample_ = true;
+    } else {
+        ewmaMs_ += config_.ewmaAlpha * (latencyMs - ewmaMs_);
+    }
+    ++framesSinceSwitch_;
+    if (framesSinceSwitch_ < config_.cooldownFrames) return false;
+
+    if (ewmaMs_ > config_.budgetMs && index_ > 0) {
+        switchTo(index_ - 1);
+        return true;
+    }
+    if (index_ + 1 < config_.sizes.size()) {
+        const double ratio = static_cast<double>(config_.sizes[index_ + 1]) / config_.sizes[index_];
+        if (ewmaMs_ * ratio * ratio < config_.budgetMs * config_.upHeadroom) {
+            switchTo(index_ + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ResolutionController::switchTo(size_t index) {
+    // Latency is roughly proportional to pixel count; rescale the estimate so
+    // the next decision does not act on the old size's numbers.
+    const double ratio = static_cast<double>(config_.sizes[index]) / config_.sizes[index_];
+    ewmaMs_ *= ratio * ratio;
+    index_ = index;
+    framesSinceSwitch_ = 0;
+    ++switches_;
+}
@@ -0,0 +1,48 @@
+// resolution_controller.h
+// Picks the model input size per video frame from a latency budget.
+//
+// The measured detect latency is smoothed with an EWMA. The controller steps
+// down one size as soon as the smoothed latency exceeds the budget, and steps
+// up only when the latency predicted for the next size (scaled by pixel area)
+// stays below `upHeadroom` of the budget. Each step also has to wait out a
+// cooldown. The gap between the two thresholds plus the cooldown keeps it from
+// flapping between two sizes.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+struct ResolutionControllerConfig {
+    std::vector<int> sizes{320, 480, 640, 960};   // ascending, multiples of 32
+    int initialSize = 640;
+    double budgetMs = 100.0;     // target detect latency per frame
+    double ewmaAlpha = 0.2;      // weight of the newest sample
+    double upHeadroom = 0.75;    // step up if predicted latency < budget * upHeadroom
+    int cooldownFrames = 15;     // frames to wait after a switch before the next one
+};
+
+class ResolutionController {
+public:
+    explicit ResolutionController(ResolutionControllerConfig config = ResolutionControllerConfig());
+
+    // Input size to use for the next frame.
+    int currentSize() const { return config_.sizes[index_]; }
+
+    // Feeds the latency measured for a frame run at currentSize(). Returns
+    // true if the size changed.
+    bool report(double latencyMs);
+
+    double smoothedLatencyMs() const { return ewmaMs_; }
+    int switches() const { return switches_; }
+
+private:
+    void switchTo(size_t index);
+
+    ResolutionControllerConfig config_;
+    size_t index_ = 0;
+    double ewmaMs_ = 0.0;
+    bool haveSample_ = false;
+    int framesSinceSwitch_ = 0;
+    int switches_ = 0;
+};
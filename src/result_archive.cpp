@@ -0,0 +1,499 @@
+// result_archive.cpp
+
+#include "result_archive.h"
+
+#include "detection_codec.h"
+#include "overlay.h"
+#include "perf_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr char kSegmentMagic[4] = {'T', 'D', 'S', 'G'};
+constexpr char kIndexMagic[4] = {'T', 'D', 'A', 'X'};
+constexpr uint32_t kArchiveVersion = 1;
+constexpr uint32_t kMaxPayloadBytes = 64u * 1024u * 1024u;   // sanity limit
+
+constexpr uint8_t kKindSnapshot = 0;
+constexpr uint8_t kKindThumbnail = 1;
+
+std::atomic<ResultArchive*> g_activeArchive{nullptr};
+
+std::string dayString(int64_t wallTimeMs) {
+    const std::time_t t = static_cast<std::time_t>(wallTimeMs / 1000);
+    std::tm tm{};
+#if defined(_WIN32)
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
+    std::ostringstream oss;
+    oss << std::put_time(&tm, "%Y-%m-%d");
+    return oss.str();
+}
+
+fs::path loosePath(const std::string& dir, const std::string& key, uint8_t kind) {
+    return fs::path(dir) / "objects" / key.substr(0, 2) /
+           (key + (kind == kKindThumbnail ? ".thumb.jpg" : ".jpg"));
+}
+
+// Files of `sub` with extension `ext`, newest day (name) first.
+std::vector<fs::path> listDays(const std::string& dir, const char* sub, const char* ext) {
+    std::vector<fs::path> files;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(fs::path(dir) / sub, ec)) {
+        if (entry.is_regular_file() && entry.path().extension() == ext) files.push_back(entry.path());
+    }
+    std::sort(files.rbegin(), files.rend());
+    return files;
+}
+
+constexpr uint64_t kHeaderBytes = 4 + sizeof(kArchiveVersion);
+
+// Visits every complete object header of a segment file; `visit(key, kind,
+// bytes)` returns true to read that object's bytes into `data` and stop.
+// `validBytes`, if given, receives the length of the file up to the end of
+// the last complete object.
+template <typename Visit>
+bool scanSegment(const fs::path& path, Visit visit, std::vector<uint8_t>* data, uint64_t* validBytes = nullptr) {
+    if (validBytes) *validBytes = 0;
+    std::error_code ec;
+    const uint64_t fileSize = fs::file_size(path, ec);
+    std::ifstream in(path, std::ios::binary);
+    char magic[4] = {};
+    uint32_t version = 0;
+    if (ec || !in.read(magic, 4) || std::memcmp(magic, kSegmentMagic, 4) != 0 ||
+        !in.read(reinterpret_cast<char*>(&version), sizeof(version)) || version != kArchiveVersion) {
+        return false;
+    }
+    uint64_t end = kHeaderBytes;
+    while (true) {
+        if (validBytes) *validBytes = end;
+        uint32_t keySize = 0;
+        if (!in.read(reinterpret_cast<char*>(&keySize), sizeof(keySize)) || keySize > 64) return false;
+        std::string key(keySize, '\0');
+        uint8_t kind = 0;
+        uint32_t bytes = 0;
+        if (!in.read(&key[0], keySize) || !in.read(reinterpret_cast<char*>(&kind), 1) ||
+            !in.read(reinterpret_cast<char*>(&bytes), sizeof(bytes))) {
+            return false;   // end of file, or a torn tail after a crash
+        }
+        end += sizeof(keySize) + keySize + 1 + sizeof(bytes) + bytes;
+        if (end > fileSize) return false;   // torn object body
+        if (visit(key, kind, bytes) && data) {
+            data->resize(bytes);
+            return static_cast<bool>(in.read(reinterpret_cast<char*>(data->data()), bytes));
+        }
+        in.seekg(bytes, std::ios::cur);
+    }
+}
+
+// Visits every complete session record of one index file in write order;
+// `visit(session)` returns true to stop. Returns false if the file is not a
+// readable index. `validBytes` is as for scanSegment().
+template <typename Visit>
+bool scanIndex(const fs::path& path, Visit visit, uint64_t* validBytes = nullptr) {
+    if (validBytes) *validBytes = 0;
+    std::ifstream in(path, std::ios::binary);
+    char magic[4] = {};
+    uint32_t version = 0;
+    if (!in.read(magic, 4) || std::memcmp(magic, kIndexMagic, 4) != 0 ||
+        !in.read(reinterpret_cast<char*>(&version), sizeof(version)) || version != kArchiveVersion) {
+        return false;
+    }
+    uint64_t end = kHeaderBytes;
+    uint32_t size = 0;
+    std::vector<char> payload;
+    while (true) {
+        if (validBytes) *validBytes = end;
+        if (!in.read(reinterpret_cast<char*>(&size), sizeof(size)) || size > kMaxPayloadBytes) break;
+        payload.resize(size);
+        if (!in.read(payload.data(), size)) break;
+        end += sizeof(size) + size;
+        ByteReader r(payload);
+        ArchivedSession session;
+        uint32_t views = 0;
+        if (!r.str(session.sessionId) || !r.str(session.username) || !r.pod(session.wallTimeMs) ||
+            !r.pod(views)) {
+            continue;
+        }
+        bool ok = true;
+        for (uint32_t v = 0; v < views && ok; ++v) {
+            ArchivedView view;
+            ok = r.str(view.name) && r.str(view.beforeKey) && r.str(view.afterKey) &&
+                 readDetections(r, view.beforeDet) && readDetections(r, view.afterDet);
+            session.views.push_back(std::move(view));
+        }
+        if (ok && visit(std::move(session))) break;
+    }
+    return true;
+}
+
+// Cuts a crash's half-written tail off an append-only archive file, so the
+// next append does not land behind bytes no reader gets past. A file whose
+// header is unreadable is only cut when it is shorter than a header (torn
+// while being created); anything else is not ours to touch.
+void truncateTornTail(const fs::path& path, bool readable, uint64_t validBytes) {
+    std::error_code ec;
+    const uint64_t size = fs::file_size(path, ec);
+    if (ec || size <= validBytes || (!readable && validBytes == 0 && size >= kHeaderBytes)) return;
+    fs::resize_file(path, validBytes, ec);
+    if (ec) {
+        std::cerr << "[WARN] Cannot truncate torn archive file " << path.string() << ": " << ec.message() << "\n";
+        return;
+    }
+    std::cerr << "[WARN] Dropped a torn tail of " << size - validBytes << " bytes from " << path.string() << "\n";
+}
+
+}  // namespace
+
+std::string snapshotKey(const cv::Mat& image) {
+    // Four independent multiply-xorshift lanes over 8-byte words keep the
+    // hash near memory speed (a few ms for a 1080p frame).
+    uint64_t lanes[4] = {0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full,
+                         0x165667B19E3779F9ull, 0x27D4EB2F165667C5ull};
+    auto mix = [](uint64_t h, uint64_t v) {
+        h ^= v;
+        h *= 0xFF51AFD7ED558CCDull;
+        return h ^ (h >> 29);
+    };
+    const size_t rowBytes = image.cols * image.elemSize();
+    for (int y = 0; y < image.rows; ++y) {
+        const uint8_t* p = image.ptr<uint8_t>(y);
+        size_t i = 0;
+        for (; i + 32 <= rowBytes; i += 32) {
+            uint64_t v[4];
+            std::memcpy(v, p + i, 32);
+            for (int l = 0; l < 4; ++l) lanes[l] = mix(lanes[l], v[l]);
+        }
+        for (; i < rowBytes; ++i) lanes[0] = mix(lanes[0], p[i]);
+    }
+    uint64_t h = mix(mix(lanes[0], lanes[1]), mix(lanes[2], lanes[3]));
+    h = mix(h, (static_cast<uint64_t>(image.cols) << 32) | static_cast<uint32_t>(image.rows));
+    h = mix(h, static_cast<uint64_t>(image.type()));
+    std::ostringstream oss;
+    oss << std::hex << std::setw(16) << std::setfill('0') << h;
+    return oss.str();
+}
+
+ResultArchive::ResultArchive(ResultArchiveConfig config) : config_(std::move(config)) {}
+
+ResultArchive::~ResultArchive() {
+    const Stats s = stats();
+    if (s.sessions == 0) return;
+    std::cout << "[INFO] Archive: " << s.sessions << " sessions, " << s.snapshotsStored
+              << " snapshots stored, " << s.snapshotsReused << " reused, "
+              << s.bytesWritten / (1024 * 1024) << " MiB written\n";
+}
+
+bool ResultArchive::open() {
+    std::error_code ec;
+    const char* store = config_.segments ? "segments" : "objects";
+    for (const char* sub : {store, "index"}) {
+        fs::create_directories(fs::path(config_.dir) / sub, ec);
+        if (ec) {
+            std::cerr << "[ERROR] Cannot create archive folder " << (fs::path(config_.dir) / sub).string()
+                      << ": " << ec.message() << "\n";
+            return false;
+        }
+    }
+    if (config_.segments) {
+        for (const auto& path : listDays(config_.dir, "segments", ".seg")) {
+            uint64_t validBytes = 0;
+            std::unordered_set<std::string> keys;
+            scanSegment(path, [&keys](const std::string& key, uint8_t kind, uint32_t) {
+                if (kind == kKindSnapshot) keys.insert(key);
+                return false;
+            }, nullptr, &validBytes);
+            truncateTornTail(path, validBytes > 0, validBytes);
+            segmentKeys_.insert(keys.begin(), keys.end());
+        }
+    }
+    for (const auto& path : listDays(config_.dir, "index", ".tdx")) {
+        uint64_t validBytes = 0;
+        const bool readable = scanIndex(path, [](ArchivedSession&&) { return false; }, &validBytes);
+        truncateTornTail(path, readable, validBytes);
+    }
+    std::cout << "[INFO] Archiving sessions to " << config_.dir
+              << (config_.segments ? " (daily segment files)" : "") << "\n";
+    return true;
+}
+
+bool ResultArchive::writeObject(const std::string& key, int kind, const std::vector<uint8_t>& bytes) {
+    if (!config_.segments) {
+        const fs::path path = loosePath(config_.dir, key, static_cast<uint8_t>(kind));
+        std::error_code ec;
+        fs::create_directories(path.parent_path(), ec);
+        // Written under a temporary name so a reader never sees half a file.
+        const fs::path tmp = path.string() + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            if (!out) return false;
+        }
+        fs::rename(tmp, path, ec);
+        return !ec;
+    }
+
+    const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::system_clock::now().time_since_epoch()).count();
+    const fs::path path = fs::path(config_.dir) / "segments" / (dayString(now) + ".seg");
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    std::error_code ec;
+    const bool fresh = !fs::exists(path, ec) || fs::file_size(path, ec) == 0;
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    if (fresh) {
+        out.write(kSegmentMagic, 4);
+        out.write(reinterpret_cast<const char*>(&kArchiveVersion), sizeof(kArchiveVersion));
+    }
+    const uint32_t keySize = static_cast<uint32_t>(key.size());
+    const uint8_t kindByte = static_cast<uint8_t>(kind);
+    const uint32_t size = static_cast<uint32_t>(bytes.size());
+    out.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
+    out.write(key.data(), keySize);
+    out.write(reinterpret_cast<const char*>(&kindByte), 1);
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.write(reinterpret_cast<const char*>(bytes.data()), size);
+    return static_cast<bool>(out);
+}
+
+ResultArchive::Signature ResultArchive::storeSnapshot(const cv::Mat& image, const Signature* previous) {
+    TD_PERF_SCOPE("archive.snapshot");
+    Signature sig{snapshotKey(image), image.size(), coarseSignature(image)};
+    const std::string key = sig.key;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::error_code ec;
+        // A key being written by a concurrent session counts as stored.
+        bool reuse = storing_.count(key) > 0 ||
+                     (config_.segments ? segmentKeys_.count(key) > 0
+                                       : fs::exists(loosePath(config_.dir, key, kKindSnapshot), ec));
+        // Near-duplicates only of the previous session's after: see
+        // kNearDuplicateMaxDiff.
+        if (!reuse && previous && nearDuplicate(previous->coarse, previous->size, sig.coarse, sig.size)) {
+            sig.key = previous->key;
+            reuse = true;
+        }
+        if (reuse) {
+            ++stats_.snapshotsReused;
+            return sig;
+        }
+        storing_.insert(key);
+    }
+
+    std::vector<uint8_t> jpeg;
+    std::vector<uint8_t> thumb;
+    cv::imencode(".jpg", image, jpeg, {cv::IMWRITE_JPEG_QUALITY, config_.jpegQuality});
+    if (config_.thumbnailWidth > 0 && image.cols > 0) {
+        const double scale = std::min(1.0, static_cast<double>(config_.thumbnailWidth) / image.cols);
+        cv::Mat thumbnail;
+        cv::resize(image, thumbnail, cv::Size(), scale, scale, cv::INTER_AREA);
+        cv::imencode(".jpg", thumbnail, thumb, {cv::IMWRITE_JPEG_QUALITY, 80});
+    }
+    const bool ok = writeObject(key, kKindSnapshot, jpeg) && (thumb.empty() || writeObject(key, kKindThumbnail, thumb));
+    if (!ok) {
+        std::cerr << "[ERROR] Failed to archive snapshot " << key << "\n";
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    storing_.erase(key);
+    // Only a snapshot that made it to disk is reused; a failed one is
+    // written again by the next session that sees it.
+    if (ok && config_.segments) segmentKeys_.insert(key);
+    ++stats_.snapshotsStored;
+    stats_.bytesWritten += jpeg.size() + thumb.size();
+    return sig;
+}
+
+bool ResultArchive::appendIndex(const std::vector<char>& payload) {
+    const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::system_clock::now().time_since_epoch()).count();
+    const fs::path path = fs::path(config_.dir) / "index" / (dayString(now) + ".tdx");
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    std::error_code ec;
+    const bool fresh = !fs::exists(path, ec) || fs::file_size(path, ec) == 0;
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    if (fresh) {
+        out.write(kIndexMagic, 4);
+        out.write(reinterpret_cast<const char*>(&kArchiveVersion), sizeof(kArchiveVersion));
+    }
+    const uint32_t size = static_cast<uint32_t>(payload.size());
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    return static_cast<bool>(out);
+}
+
+bool ResultArchive::addSession(ArchivedSession session,
+                               const std::vector<cv::Mat>& before,
+                               const std::vector<cv::Mat>& after) {
+    TD_PERF_SCOPE("archive.session");
+    if (session.wallTimeMs == 0) {
+        session.wallTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                 std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    // Before first: it is usually the previous session's after of the same
+    // view, the only snapshot it may be a near-duplicate of.
+    for (size_t v = 0; v < session.views.size(); ++v) {
+        if (v >= before.size() || before[v].empty()) continue;
+        Signature previous;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto it = lastAfter_.find(session.views[v].name);
+            if (it != lastAfter_.end()) previous = it->second;
+        }
+        session.views[v].beforeKey = storeSnapshot(before[v], previous.key.empty() ? nullptr : &previous).key;
+    }
+    for (size_t v = 0; v < session.views.size(); ++v) {
+        if (v >= after.size() || after[v].empty()) continue;
+        Signature sig = storeSnapshot(after[v], nullptr);
+        session.views[v].afterKey = sig.key;
+        std::lock_guard<std::mutex> lock(mutex_);
+        lastAfter_[session.views[v].name] = std::move(sig);
+    }
+
+    ByteWriter w;
+    w.str(session.sessionId);
+    w.str(session.username);
+    w.pod(session.wallTimeMs);
+    w.pod(static_cast<uint32_t>(session.views.size()));
+    for (const auto& view : session.views) {
+        w.str(view.name);
+        w.str(view.beforeKey);
+        w.str(view.afterKey);
+        writeDetections(w, view.beforeDet);
+        writeDetections(w, view.afterDet);
+    }
+    const bool ok = appendIndex(w.buffer());
+    if (!ok) {
+        std::cerr << "[ERROR] Failed to append session " << session.sessionId << " to the archive index\n";
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.sessions;
+    stats_.bytesWritten += w.buffer().size() + sizeof(uint32_t);
+    return ok;
+}
+
+ResultArchive::Stats ResultArchive::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+bool findArchivedSession(const std::string& dir, const std::string& sessionId, ArchivedSession& out) {
+    for (const auto& path : listDays(dir, "index", ".tdx")) {
+        bool found = false;
+        // Later records win, so a re-run session id resolves to its last run.
+        const bool readable = scanIndex(path, [&](ArchivedSession&& session) {
+            if (session.sessionId == sessionId) {
+                out = std::move(session);
+                found = true;
+            }
+            return false;
+        });
+        if (!readable) {
+            std::cerr << "[WARN] Skipping unreadable archive index " << path.string() << "\n";
+        }
+        if (found) return true;
+    }
+    return false;
+}
+
+std::vector<std::string> listArchivedSnapshots(const std::string& dir) {
+    std::vector<std::string> keys;
+    std::unordered_set<std::string> seen;
+    std::vector<fs::path> days = listDays(dir, "index", ".tdx");
+    std::reverse(days.begin(), days.end());
+    for (const auto& path : days) {
+        scanIndex(path, [&](ArchivedSession&& session) {
+            for (const auto& view : session.views) {
+                for (const std::string* key : {&view.beforeKey, &view.afterKey}) {
+                    if (!key->empty() && seen.insert(*key).second) keys.push_back(*key);
+                }
+            }
+            return false;
+        });
+    }
+    return keys;
+}
+
+cv::Mat loadArchivedSnapshot(const std::string& dir, const std::string& key, bool thumbnail) {
+    const uint8_t kind = thumbnail ? kKindThumbnail : kKindSnapshot;
+    const fs::path loose = loosePath(dir, key, kind);
+    std::error_code ec;
+    if (fs::exists(loose, ec)) {
+        return cv::imread(loose.string());
+    }
+    std::vector<uint8_t> bytes;
+    for (const auto& path : listDays(dir, "segments", ".seg")) {
+        const bool found = scanSegment(path, [&](const std::string& k, uint8_t kd, uint32_t) {
+            return k == key && kd == kind;
+        }, &bytes);
+        if (found) return cv::imdecode(bytes, cv::IMREAD_COLOR);
+    }
+    return cv::Mat();
+}
+
+bool renderArchivedSession(const std::string& dir,
+                           const ArchivedSession& session,
+                           std::vector<cv::Mat>& visBefore,
+                           std::vector<cv::Mat>& visAfter) {
+    visBefore.clear();
+    visAfter.clear();
+    bool ok = true;
+    const DrawOverlayStyle style = makeOverlayStyle(1.0);
+    for (const auto& view : session.views) {
+        cv::Mat before = loadArchivedSnapshot(dir, view.beforeKey);
+        cv::Mat after = loadArchivedSnapshot(dir, view.afterKey);
+        ok = ok && !before.empty() && !after.empty();
+        if (!before.empty()) drawDetections(before, view.beforeDet, style);
+        if (!after.empty()) drawDetections(after, view.afterDet, style);
+        visBefore.push_back(before);
+        visAfter.push_back(after);
+    }
+    return ok;
+}
+
+int runArchiveExport(const std::string& dir, const std::string& sessionId, const std::string& outDir) {
+    ArchivedSession session;
+    if (!findArchivedSession(dir, sessionId, session)) {
+        std::cerr << "[ERROR] Session " << sessionId << " is not in the archive " << dir << "\n";
+        return 1;
+    }
+    std::vector<cv::Mat> visBefore;
+    std::vector<cv::Mat> visAfter;
+    const bool complete = renderArchivedSession(dir, session, visBefore, visAfter);
+    std::error_code ec;
+    fs::create_directories(outDir, ec);
+    int written = 0;
+    for (size_t v = 0; v < session.views.size(); ++v) {
+        const std::string& name = session.views[v].name;
+        const std::string prefix = outDir + "/" + sessionId + (name.empty() ? "" : "_" + name);
+        if (!visBefore[v].empty() && cv::imwrite(prefix + "_before.jpg", visBefore[v])) ++written;
+        if (!visAfter[v].empty() && cv::imwrite(prefix + "_after.jpg", visAfter[v])) ++written;
+    }
+    std::cout << "[INFO] Exported " << written << " image(s) of session " << sessionId << " to " << outDir
+              << "\n";
+    if (!complete) {
+        std::cerr << "[WARN] Some snapshots of session " << sessionId << " are missing from the archive\n";
+    }
+    return complete ? 0 : 1;
+}
+
+void setActiveResultArchive(ResultArchive* archive) {
+    g_activeArchive.store(archive);
+}
+
+ResultArchive* activeResultArchive() {
+    return g_activeArchive.load();
+}
@@ -0,0 +1,151 @@
+// result_archive.h
+// Deduplicated session archive (--archive <dir>), replacing the two annotated
+// full-size JPEGs per session in the results folder.
+//
+// Each distinct raw snapshot is stored once under a content key (a 64-bit
+// hash of its pixels and size), together with a small thumbnail. A session
+// is a compact record in the day's index file: ids, the snapshot keys of
+// every view and the detections. Overlays are drawn when a session is read
+// back, so nothing annotated is ever written. A "before" snapshot that is
+// the previous session's "after" of the same view (bit-identical, or equal
+// up to sensor noise on a coarse signature) reuses that snapshot; any other
+// snapshot is only reused when it is bit-identical, so an "after" that
+// differs from its "before" by one small tool is always stored.
+//
+// Layout below <dir>, integers little-endian like .tdrec:
+//
+//   objects/<k0k1>/<key>.jpg, <key>.thumb.jpg   loose snapshot store, or
+//   segments/<YYYY-MM-DD>.seg                   with --archive-segments:
+//       "TDSG" u32 version object*, object := str key, u8 kind (0 snapshot,
+//       1 thumbnail), u32 bytes, JPEG bytes; one file per day, append-only;
+//       a torn last object (crash mid-append) is cut off by open()
+//   index/<YYYY-MM-DD>.tdx
+//       "TDAX" u32 version record*, record := u32 payload_bytes, payload;
+//       a torn last record is cut off by open() like a segment's
+//       payload := str session, str user, i64 wall_ms, u32 n, view*n
+//       view    := str name, str before_key, str after_key,
+//                  detections before, detections after
+//       detections := u32 n, (str cls, f32 conf, i32 x, i32 y, i32 w, i32 h,
+//                     u8 oriented, [f32 cx, f32 cy, f32 w, f32 h, f32 angle])*n
+//   str := u32 bytes, utf-8 bytes
+
+#pragma once
+
+#include "detector.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+struct ResultArchiveConfig {
+    std::string dir;
+    bool segments = false;     // pack each day's snapshots into one segment file
+    int jpegQuality = 92;
+    int thumbnailWidth = 320;
+};
+
+// One camera view of an archived session; single-camera sessions have one
+// view with an empty name.
+struct ArchivedView {
+    std::string name;
+    std::string beforeKey;
+    std::string afterKey;
+    DetectionResult beforeDet;
+    DetectionResult afterDet;
+};
+
+struct ArchivedSession {
+    std::string sessionId;
+    std::string username;
+    int64_t wallTimeMs = 0;
+    std::vector<ArchivedView> views;
+};
+
+class ResultArchive {
+public:
+    explicit ResultArchive(ResultArchiveConfig config);
+    ~ResultArchive();   // prints the dedup summary
+
+    ResultArchive(const ResultArchive&) = delete;
+    ResultArchive& operator=(const ResultArchive&) = delete;
+
+    // Creates the directories, cuts torn tails off the segment and index
+    // files and, in segment mode, indexes the keys already stored. Returns
+    // false (after printing why) if the archive is unusable.
+    bool open();
+
+    // Stores the snapshots that are not in the archive yet and appends the
+    // session record; `session.views[i]` keys are filled in from
+    // `before[i]` / `after[i]`. Safe to call from several sessions at once.
+    bool addSession(ArchivedSession session,
+                    const std::vector<cv::Mat>& before,
+                    const std::vector<cv::Mat>& after);
+
+    struct Stats {
+        uint64_t sessions = 0;
+        uint64_t snapshotsStored = 0;
+        uint64_t snapshotsReused = 0;
+        uint64_t bytesWritten = 0;
+    };
+    Stats stats() const;
+
+    const ResultArchiveConfig& config() const { return config_; }
+
+private:
+    struct Signature {
+        std::string key;
+        cv::Size size;
+        cv::Mat coarse;   // kSignatureSize grey image for near-duplicate matching
+    };
+
+    // Signature of `image` with its key in the archive, storing it first if
+    // it is new. `previous`, if given, is reused when `image` equals it up to
+    // sensor noise.
+    Signature storeSnapshot(const cv::Mat& image, const Signature* previous);
+    bool writeObject(const std::string& key, int kind, const std::vector<uint8_t>& bytes);
+    bool appendIndex(const std::vector<char>& payload);
+
+    ResultArchiveConfig config_;
+    mutable std::mutex mutex_;       // state below
+    std::mutex writeMutex_;          // segment and index appends
+    std::unordered_set<std::string> segmentKeys_;   // segment mode: keys written successfully
+    std::unordered_set<std::string> storing_;       // keys being encoded and written
+    std::map<std::string, Signature> lastAfter_;    // view name -> last session's after
+    Stats stats_;
+};
+
+// 64-bit content key of an image (pixels and size) as 16 hex digits.
+std::string snapshotKey(const cv::Mat& image);
+
+// Looks `sessionId` up in the index files, newest day first.
+bool findArchivedSession(const std::string& dir, const std::string& sessionId, ArchivedSession& out);
+
+// Keys of the full-size snapshots referenced by the index, oldest session
+// first, each once. These are raw camera frames (overlays are never stored),
+// e.g. for INT8 calibration.
+std::vector<std::string> listArchivedSnapshots(const std::string& dir);
+
+// Decodes a stored snapshot (or its thumbnail); empty if it is not found.
+cv::Mat loadArchivedSnapshot(const std::string& dir, const std::string& key, bool thumbnail = false);
+
+// Draws the archived detections onto the stored snapshots of every view.
+// `visBefore` / `visAfter` get one image per view.
+bool renderArchivedSession(const std::string& dir,
+                           const ArchivedSession& session,
+                           std::vector<cv::Mat>& visBefore,
+                           std::vector<cv::Mat>& visAfter);
+
+// --archive-export: renders `sessionId` from the archive in `dir` to
+// "<outDir>/<sessionId>[_<view>]_{before,after}.jpg". Returns the exit code.
+int runArchiveExport(const std::string& dir, const std::string& sessionId, const std::string& outDir);
+
+// Process-wide archive used by processInventorySession() and
+// processMultiViewSession() instead of the annotated JPEGs; nullptr
+// (default) keeps the JPEGs. The caller keeps ownership.
+void setActiveResultArchive(ResultArchive* archive);
+ResultArchive* activeResultArchive();
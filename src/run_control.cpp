@@ -0,0 +1,38 @@
+#include "run_control.h"
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+
+namespace {
+
+std::atomic<bool> g_stopRequested{false};
+
+void handleStopSignal(int) {
+    g_stopRequested.store(true);
+}
+
+}  // namespace
+
+StopSignalScope::StopSignalScope() {
+    g_stopRequested.store(false);
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+}
+
+StopSignalScope::~StopSignalScope() {
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+}
+
+bool StopSignalScope::stopRequested() {
+    return g_stopRequested.load();
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t idx = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
@@ -0,0 +1,25 @@
+// run_control.h
+// Helpers shared by the long-running tools (watch daemon, inference server)
+// and the measurement tools (load generator, bench, daemon summary).
+
+#pragma once
+
+#include <vector>
+
+// Routes SIGINT/SIGTERM to a stop flag for the lifetime of the scope and
+// restores the default handlers afterwards. One scope at a time.
+class StopSignalScope {
+public:
+    StopSignalScope();
+    ~StopSignalScope();
+
+    StopSignalScope(const StopSignalScope&) = delete;
+    StopSignalScope& operator=(const StopSignalScope&) = delete;
+
+    // True once a stop signal arrived since the scope was entered.
+    static bool stopRequested();
+};
+
+// Nearest-rank percentile `p` (0..1) of an ascending-sorted sample; 0 if it
+// is empty.
+double percentile(const std::vector<double>& sorted, double p);
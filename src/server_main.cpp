@@ -0,0 +1,77 @@
+// server_main.cpp
+// Entry point of toolsdetect_server: loads the ONNX model once and serves
+// every cabinet process on this machine.
+
+#include "infer_protocol.h"
+#include "infer_server.h"
+#include "metrics.h"
+#include "yolo_common.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace {
+
+void printUsage(const char* argv0) {
+    std::cout
+        << "Usage: " << argv0 << " [options]\n"
+        << "  --socket <path>       Unix socket to listen on (default: " << kDefaultInferSocketPath << ")\n"
+        << "  --model <file.onnx>   Model path (default: built-in kDefaultModelPath)\n"
+        << "  --backend <name>      Inference backend: ort | opencv (default: first available)\n"
+        << "  --precision <p>       auto | fp32 | int8 (default: auto = <model>.int8.onnx if present)\n"
+        << "  --lighting <mode>     Lighting normalization: off | grayworld | patch:x,y,w,h (default: off)\n"
+        << "  --max-batch <n>       Largest dynamic batch (default: 8)\n"
+        << "  --max-delay-ms <ms>   Longest time a request waits for a batch (default: 2)\n"
+        << "  --metrics-port <n>    Serve Prometheus metrics on 127.0.0.1:<n>/metrics\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    InferServerOptions options;
+    int metricsPort = 0;
+    options.socketPath = kDefaultInferSocketPath;
+    options.modelPath = kDefaultModelPath;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--socket" && hasValue) {
+            options.socketPath = argv[++i];
+        } else if (arg == "--model" && hasValue) {
+            options.modelPath = utf8ToWide(argv[++i]);
+        } else if (arg == "--backend" && hasValue) {
+            options.backend = argv[++i];
+        } else if (arg == "--precision" && hasValue && parseModelPrecision(argv[i + 1], options.precision)) {
+            ++i;
+        } else if (arg == "--lighting" && hasValue) {
+            LightingConfig lighting;
+            if (!parseLightingSpec(argv[++i], lighting)) {
+                std::cerr << "[ERROR] Invalid value for --lighting: " << argv[i] << "\n";
+                return 2;
+            }
+            setLightingNormalization(lighting);
+        } else if (arg == "--max-batch" && hasValue) {
+            options.maxBatchSize = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--max-delay-ms" && hasValue) {
+            options.maxQueueDelayMs = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--metrics-port" && hasValue) {
+            metricsPort = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "[ERROR] Unknown or incomplete option: " << arg << "\n";
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (metricsPort > 0) {
+        metrics::registerProcessMetrics();
+    }
+    metrics::ScopedHttpServer metricsServer(metricsPort);
+    return runInferServer(options);
+}
@@ -0,0 +1,224 @@
+// session_recording.cpp
+
+#include "session_recording.h"
+
+#include "detection_codec.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+constexpr char kRecordingMagic[4] = {'T', 'D', 'R', 'C'};
+constexpr uint32_t kRecordingVersion = 3;   // 2: detections carry the rotated box, 3: frame input size
+constexpr uint32_t kOldestReadableVersion = 2;
+constexpr uint32_t kMaxPayloadBytes = 512u * 1024u * 1024u;   // sanity limit
+constexpr float kObbTolerancePx = 0.5f;    // sameDetections() on rotated boxes
+constexpr float kObbToleranceDeg = 0.1f;
+
+std::atomic<SessionRecorder*> g_activeRecorder{nullptr};
+
+std::vector<uint8_t> encodeLossless(const cv::Mat& image) {
+    std::vector<uint8_t> encoded;
+    // Fast PNG compression: recording must not slow the live loop much.
+    if (!image.empty() && !cv::imencode(".png", image, encoded, {cv::IMWRITE_PNG_COMPRESSION, 1})) {
+        encoded.clear();
+    }
+    return encoded;
+}
+
+}  // namespace
+
+bool SessionRecorder::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out_.open(path, std::ios::binary | std::ios::trunc);
+    if (!out_.is_open()) {
+        std::cerr << "[ERROR] Cannot create recording: " << path << "\n";
+        return false;
+    }
+    out_.write(kRecordingMagic, sizeof(kRecordingMagic));
+    out_.write(reinterpret_cast<const char*>(&kRecordingVersion), sizeof(kRecordingVersion));
+    entries_ = 0;
+    std::cout << "[INFO] Recording session inputs to " << path << "\n";
+    return true;
+}
+
+void SessionRecorder::recordSession(const std::string& sessionId,
+                                    const std::string& username,
+                                    const cv::Mat& before,
+                                    const cv::Mat& after,
+                                    const DetectionResult& beforeDet,
+                                    const DetectionResult& afterDet,
+                                    const StageTimings& stages) {
+    RecordedEntry entry;
+    entry.kind = RecordedEntry::Kind::Session;
+    entry.sessionId = sessionId;
+    entry.username = username;
+    entry.timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    entry.images = {encodeLossless(before), encodeLossless(after)};
+    entry.detections = {beforeDet, afterDet};
+    entry.stages = stages;
+    write(entry);
+}
+
+void SessionRecorder::recordFrame(int64_t frameIndex,
+                                  int64_t positionUs,
+                                  const cv::Mat& frame,
+                                  const DetectionResult& det,
+                                  const StageTimings& stages) {
+    RecordedEntry entry;
+    entry.kind = RecordedEntry::Kind::Frame;
+    entry.frameIndex = frameIndex;
+    entry.inputSize = det.inputSize;
+    entry.timestampUs = positionUs;
+    entry.images = {encodeLossless(frame)};
+    entry.detections = {det};
+    entry.stages = stages;
+    write(entry);
+}
+
+void SessionRecorder::write(const RecordedEntry& entry) {
+    // Encoding happened in the caller; only the file append is serialized.
+    ByteWriter w;
+    if (entry.kind == RecordedEntry::Kind::Session) {
+        w.str(entry.sessionId);
+        w.str(entry.username);
+    } else {
+        w.pod(entry.frameIndex);
+    }
+    w.pod(entry.timestampUs);
+    if (entry.kind == RecordedEntry::Kind::Frame) w.pod(entry.inputSize);
+    w.pod(static_cast<uint32_t>(entry.images.size()));
+    for (const auto& img : entry.images) w.bytes(img.data(), img.size());
+    w.pod(static_cast<uint32_t>(entry.detections.size()));
+    for (const auto& det : entry.detections) writeDetections(w, det);
+    w.pod(static_cast<uint32_t>(entry.stages.size()));
+    for (const auto& stage : entry.stages) {
+        w.str(stage.first);
+        w.pod(static_cast<float>(stage.second));
+    }
+
+    const uint32_t kind = static_cast<uint32_t>(entry.kind);
+    const uint32_t size = static_cast<uint32_t>(w.buffer().size());
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!out_.is_open()) return;
+    out_.write(reinterpret_cast<const char*>(&kind), sizeof(kind));
+    out_.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    out_.write(w.buffer().data(), size);
+    out_.flush();
+    ++entries_;
+}
+
+bool RecordingReader::open(const std::string& path) {
+    in_.open(path, std::ios::binary);
+    if (!in_.is_open()) {
+        std::cerr << "[ERROR] Cannot open recording: " << path << "\n";
+        return false;
+    }
+    char magic[4] = {};
+    uint32_t version = 0;
+    in_.read(magic, sizeof(magic));
+    in_.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if (!in_ || std::memcmp(magic, kRecordingMagic, sizeof(magic)) != 0) {
+        std::cerr << "[ERROR] " << path << " is not a ToolsDetect recording.\n";
+        in_.close();
+        return false;
+    }
+    if (version < kOldestReadableVersion || version > kRecordingVersion) {
+        std::cerr << "[ERROR] Unsupported recording version " << version << " in " << path << "\n";
+        in_.close();
+        return false;
+    }
+    version_ = version;
+    return true;
+}
+
+bool RecordingReader::next(RecordedEntry& entry) {
+    uint32_t kind = 0;
+    uint32_t size = 0;
+    if (!in_.read(reinterpret_cast<char*>(&kind), sizeof(kind))) return false;   // clean EOF
+    if (!in_.read(reinterpret_cast<char*>(&size), sizeof(size)) || size > kMaxPayloadBytes) {
+        std::cerr << "[ERROR] Truncated or corrupt recording header.\n";
+        return false;
+    }
+    std::vector<char> payload(size);
+    if (!in_.read(payload.data(), size)) {
+        std::cerr << "[WARN] Recording ends with a truncated record; ignoring it.\n";
+        return false;
+    }
+
+    entry = RecordedEntry{};
+    ByteReader r(payload);
+    bool ok = true;
+    if (kind == static_cast<uint32_t>(RecordedEntry::Kind::Session)) {
+        entry.kind = RecordedEntry::Kind::Session;
+        ok = r.bytes(entry.sessionId) && r.bytes(entry.username);
+    } else if (kind == static_cast<uint32_t>(RecordedEntry::Kind::Frame)) {
+        entry.kind = RecordedEntry::Kind::Frame;
+        ok = r.pod(entry.frameIndex);
+    } else {
+        std::cerr << "[ERROR] Unknown record kind " << kind << " in recording.\n";
+        return false;
+    }
+
+    uint32_t n = 0;
+    ok = ok && r.pod(entry.timestampUs);
+    // Version 2 frames were all detected at the default input size.
+    if (entry.kind == RecordedEntry::Kind::Frame && version_ >= 3) ok = ok && r.pod(entry.inputSize);
+    ok = ok && r.pod(n);
+    for (uint32_t i = 0; ok && i < n; ++i) {
+        entry.images.emplace_back();
+        ok = r.bytes(entry.images.back());
+    }
+    ok = ok && r.pod(n);
+    for (uint32_t i = 0; ok && i < n; ++i) {
+        entry.detections.emplace_back();
+        ok = readDetections(r, entry.detections.back());
+    }
+    ok = ok && r.pod(n);
+    for (uint32_t i = 0; ok && i < n; ++i) {
+        std::string name;
+        float ms = 0.0f;
+        ok = r.bytes(name) && r.pod(ms);
+        entry.stages.emplace_back(std::move(name), ms);
+    }
+    if (!ok) {
+        std::cerr << "[ERROR] Corrupt record in recording.\n";
+    }
+    return ok;
+}
+
+void setActiveRecorder(SessionRecorder* recorder) {
+    g_activeRecorder.store(recorder);
+}
+
+SessionRecorder* activeRecorder() {
+    return g_activeRecorder.load();
+}
+
+bool sameDetections(const DetectionResult& a, const DetectionResult& b, float confTolerance) {
+    if (a.objects.size() != b.objects.size()) return false;
+    for (size_t i = 0; i < a.objects.size(); ++i) {
+        const auto& x = a.objects[i];
+        const auto& y = b.objects[i];
+        if (x.cls != y.cls || x.bbox != y.bbox || x.oriented != y.oriented ||
+            std::fabs(x.confidence - y.confidence) > confTolerance) {
+            return false;
+        }
+        // Rotated boxes are floats straight from the decoder: allow the last
+        // bits to differ between runs, as for the score.
+        if (x.oriented &&
+            (std::fabs(x.obb.center.x - y.obb.center.x) > kObbTolerancePx ||
+             std::fabs(x.obb.center.y - y.obb.center.y) > kObbTolerancePx ||
+             std::fabs(x.obb.size.width - y.obb.size.width) > kObbTolerancePx ||
+             std::fabs(x.obb.size.height - y.obb.size.height) > kObbTolerancePx ||
+             std::fabs(x.obb.angle - y.obb.angle) > kObbToleranceDeg)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,103 @@
+// session_recording.h
+// Record/replay container for deterministic performance regression runs.
+//
+// A recording (.tdrec) holds, per inventory session or per video frame, the
+// input images (PNG, lossless so a replay sees bit-identical pixels), a
+// timestamp, the detections that were produced and per-stage timings.
+// Layout, all integers little-endian:
+//
+//   file    := "TDRC" u32 version record*
+//   record  := u32 kind, u32 payload_bytes, payload
+//   session := str id, str user, i64 timestamp_us, u32 n, image*n,
+//              u32 n, detections*n, stages
+//   frame   := i64 frame_index, i64 timestamp_us, i32 input_size, u32 n,
+//              image*n, u32 n, detections*n, stages
+//   image   := u32 bytes, encoded bytes
+//   detections := u32 n, detection*n
+//   detection  := str cls, f32 conf, i32 x, i32 y, i32 w, i32 h, u8 oriented,
+//                 [f32 cx, f32 cy, f32 w, f32 h, f32 angle_deg if oriented]
+//   stages  := u32 n, (str name, f32 ms)*n
+//   str     := u32 bytes, utf-8 bytes
+
+#pragma once
+
+#include "detector.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+using StageTimings = std::vector<std::pair<std::string, double>>;   // name -> ms
+
+struct RecordedEntry {
+    enum class Kind : uint32_t { Session = 1, Frame = 2 };
+
+    Kind kind = Kind::Session;
+    std::string sessionId;        // sessions only
+    std::string username;         // sessions only
+    int64_t frameIndex = 0;       // frames only
+    int32_t inputSize = 0;        // frames only: model input side of the detections; 0 = default
+    int64_t timestampUs = 0;      // wall clock (sessions) or stream position (frames)
+    std::vector<std::vector<uint8_t>> images;   // before/after, or the frame
+    std::vector<DetectionResult> detections;    // one per image
+    StageTimings stages;
+};
+
+// Appends entries to a recording. Thread-safe, so concurrent daemon sessions
+// can share one recorder.
+class SessionRecorder {
+public:
+    bool open(const std::string& path);
+    bool isOpen() const { return out_.is_open(); }
+
+    void recordSession(const std::string& sessionId,
+                       const std::string& username,
+                       const cv::Mat& before,
+                       const cv::Mat& after,
+                       const DetectionResult& beforeDet,
+                       const DetectionResult& afterDet,
+                       const StageTimings& stages);
+
+    void recordFrame(int64_t frameIndex,
+                     int64_t positionUs,
+                     const cv::Mat& frame,
+                     const DetectionResult& det,
+                     const StageTimings& stages);
+
+    size_t entriesWritten() const { return entries_; }
+
+private:
+    void write(const RecordedEntry& entry);
+
+    std::mutex mutex_;
+    std::ofstream out_;
+    size_t entries_ = 0;
+};
+
+// Sequential reader; next() returns false at end of file or on a corrupt
+// record (reported on stderr).
+class RecordingReader {
+public:
+    bool open(const std::string& path);
+    bool next(RecordedEntry& entry);
+
+private:
+    std::ifstream in_;
+    uint32_t version_ = 0;
+};
+
+// Process-wide recorder used by processInventorySession() and the video
+// loop; nullptr (default) disables recording.
+void setActiveRecorder(SessionRecorder* recorder);
+SessionRecorder* activeRecorder();
+
+// True if both results contain the same objects in the same order (class and
+// box exact, confidence within `confTolerance`, rotated boxes within half a
+// pixel and 0.1 degree).
+bool sameDetections(const DetectionResult& a, const DetectionResult& b,
+                    float confTolerance = 1e-4f);
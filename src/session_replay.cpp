@@ -0,0 +1,204 @@
+#include "session_replay.h"
+
+#include "inventory_session.h"
+#include "logger.h"
+#include "session_recording.h"
+#include "session_runner.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Per-stage totals for one side (recorded or replayed) of the comparison.
+struct StageTotals {
+    std::map<std::string, double> ms;
+    double totalMs = 0.0;
+    size_t items = 0;
+
+    void add(const StageTimings& stages) {
+        for (const auto& stage : stages) {
+            ms[stage.first] += stage.second;
+            totalMs += stage.second;
+        }
+        ++items;
+    }
+
+    double throughputPerSec() const { return totalMs > 0.0 ? items * 1000.0 / totalMs : 0.0; }
+};
+
+struct ReplayReport {
+    const char* kind = "";
+    StageTotals recorded;
+    StageTotals replayed;
+    size_t mismatches = 0;
+    double wallSec = 0.0;
+};
+
+void reportMismatch(const std::string& what, const DetectionResult& expected,
+                    const DetectionResult& actual, size_t& shown) {
+    constexpr size_t kMaxShown = 10;
+    if (shown++ >= kMaxShown) return;
+    std::cerr << "[WARN] Replay mismatch in " << what << ": recorded "
+              << expected.objects.size() << " object(s), replay produced "
+              << actual.objects.size() << "\n";
+}
+
+void printReport(const ReplayReport& r, Logger& logger) {
+    if (r.replayed.items == 0) return;
+
+    const double recordedRate = r.recorded.throughputPerSec();
+    const double replayRate = r.replayed.throughputPerSec();
+    const double deltaPct = recordedRate > 0.0 ? (replayRate / recordedRate - 1.0) * 100.0 : 0.0;
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "[RESULT] Replayed " << r.replayed.items << " " << r.kind << "(s): "
+              << r.mismatches << " detection mismatch(es)\n"
+              << "[RESULT] Throughput (processing time only): recorded " << recordedRate
+              << "/s, replay " << replayRate << "/s (" << std::showpos << deltaPct
+              << std::noshowpos << "%), replay wall clock " << r.wallSec << " s\n";
+    for (const auto& kv : r.replayed.ms) {
+        auto rec = r.recorded.ms.find(kv.first);
+        const double recMean = rec != r.recorded.ms.end() && r.recorded.items
+                                   ? rec->second / r.recorded.items : 0.0;
+        const double repMean = kv.second / r.replayed.items;
+        std::cout << "  " << std::left << std::setw(14) << kv.first << std::right
+                  << " recorded " << std::setw(9) << recMean << " ms"
+                  << "  replay " << std::setw(9) << repMean << " ms\n";
+    }
+
+    std::ostringstream fields;
+    fields << std::fixed << std::setprecision(3)
+           << "kind=" << r.kind
+           << " items=" << r.replayed.items
+           << " mismatches=" << r.mismatches
+           << " recorded_per_s=" << recordedRate
+           << " replay_per_s=" << replayRate
+           << " delta_pct=" << deltaPct
+           << " wall_s=" << r.wallSec;
+    logger.logPerfSummary("replay", fields.str());
+}
+
+}  // namespace
+
+int runReplay(const std::string& recordingPath,
+              Logger& logger,
+              const std::string& username,
+              const std::string& resultsDir) {
+    RecordingReader reader;
+    if (!reader.open(recordingPath)) {
+        return 1;
+    }
+
+    // Decode everything up front so the replay measures the pipeline, not
+    // PNG decoding.
+    std::vector<RecordedEntry> sessions;
+    std::vector<RecordedEntry> frames;
+    std::vector<std::vector<cv::Mat>> sessionImages;
+    std::vector<cv::Mat> frameImages;
+    RecordedEntry entry;
+    while (reader.next(entry)) {
+        std::vector<cv::Mat> decoded;
+        for (const auto& bytes : entry.images) {
+            decoded.push_back(cv::imdecode(bytes, cv::IMREAD_COLOR));
+        }
+        const size_t expected = entry.kind == RecordedEntry::Kind::Session ? 2 : 1;
+        if (decoded.size() != expected || entry.detections.size() != expected) {
+            std::cerr << "[WARN] Skipping malformed record.\n";
+            continue;
+        }
+        if (entry.kind == RecordedEntry::Kind::Session) {
+            sessionImages.push_back(std::move(decoded));
+            sessions.push_back(std::move(entry));
+        } else {
+            frameImages.push_back(decoded.front());
+            frames.push_back(std::move(entry));
+        }
+        entry = RecordedEntry{};
+    }
+    std::cout << "[INFO] Loaded " << sessions.size() << " session(s) and "
+              << frames.size() << " frame(s) from " << recordingPath << "\n";
+
+    size_t shownMismatches = 0;
+    ReplayReport sessionReport;
+    sessionReport.kind = "session";
+    if (!sessions.empty()) {
+        size_t next = 0;
+        SessionRunOptions options;
+        options.interactive = false;
+        options.source = [&](cv::Mat& before, cv::Mat& after, std::string& sessionId) {
+            if (next >= sessions.size()) return false;
+            before = sessionImages[next][0];
+            after = sessionImages[next][1];
+            sessionId = "replay-" + sessions[next].sessionId;
+            ++next;
+            return true;
+        };
+        options.onResult = [&](const std::string& sessionId, const InventorySessionResult& result) {
+            const RecordedEntry& rec = sessions[next - 1];
+            sessionReport.recorded.add(rec.stages);
+            sessionReport.replayed.add(result.stages);
+            if (!sameDetections(rec.detections[0], result.beforeDet)) {
+                ++sessionReport.mismatches;
+                reportMismatch(sessionId + " (before)", rec.detections[0], result.beforeDet,
+                               shownMismatches);
+            }
+            if (!sameDetections(rec.detections[1], result.afterDet)) {
+                ++sessionReport.mismatches;
+                reportMismatch(sessionId + " (after)", rec.detections[1], result.afterDet,
+                               shownMismatches);
+            }
+        };
+        const auto t_start = Clock::now();
+        runBeforeAfterSessions(logger, username, resultsDir, options);
+        sessionReport.wallSec = std::chrono::duration<double>(Clock::now() - t_start).count();
+    }
+
+    ReplayReport frameReport;
+    frameReport.kind = "frame";
+    if (!frames.empty()) {
+        size_t next = 0;
+        VideoRunOptions options;
+        options.display = false;
+        options.source = [&](cv::Mat& frame, int64_t& positionUs) {
+            if (next >= frames.size()) return false;
+            frame = frameImages[next];
+            positionUs = frames[next].timestampUs;
+            ++next;
+            return true;
+        };
+        // A recording made under --video-budget-ms switched sizes as it went.
+        options.keyframeInputSize = [&]() { return static_cast<int>(frames[next - 1].inputSize); };
+        options.onFrame = [&](int64_t, const DetectionResult& det, const StageTimings& stages) {
+            const RecordedEntry& rec = frames[next - 1];
+            // The live loop also timed drawing; compare like with like.
+            StageTimings recordedStages;
+            for (const auto& stage : rec.stages) {
+                if (stage.first != "draw") recordedStages.push_back(stage);
+            }
+            frameReport.recorded.add(recordedStages);
+            frameReport.replayed.add(stages);
+            if (!sameDetections(rec.detections[0], det)) {
+                ++frameReport.mismatches;
+                reportMismatch("frame " + std::to_string(rec.frameIndex), rec.detections[0], det,
+                               shownMismatches);
+            }
+        };
+        const auto t_start = Clock::now();
+        runVideoDetection(std::string(), options);
+        frameReport.wallSec = std::chrono::duration<double>(Clock::now() - t_start).count();
+    }
+
+    printReport(sessionReport, logger);
+    printReport(frameReport, logger);
+    return sessionReport.mismatches + frameReport.mismatches == 0 ? 0 : 3;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+class Logger;
+
+// Replays a recording made with --record through runBeforeAfterSessions()
+// (session records) and the video loop (frame records), non-interactively
+// and as fast as possible. Detections are compared with the recorded ones
+// and the throughput / per-stage deltas are printed and logged as a PERF
+// line. Returns 0 if every replayed detection matched, 3 on mismatches and
+// 1 if the recording could not be read.
+int runReplay(const std::string& recordingPath,
+              Logger& logger,
+              const std::string& username,
+              const std::string& resultsDir);
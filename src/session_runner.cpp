@@ -1,16 +1,31 @@
 #include "session_runner.h"
 
-#include "alert.h"
+#include "alarm_bus.h"
+#include "cabinet_state.h"
+#include "camera_capture.h"
 #include "detector.h"
 #include "inventory_compare.h"
+#include "inventory_session.h"
 #include "logger.h"
+#include "metrics.h"
 #include "opencv_config.h"
+#include "overlay.h"
+#include "perf_stats.h"
+#include "resolution_controller.h"
+#include "session_recording.h"
+#include "trace.h"
+#include "tracker.h"
+#include "yolo_common.h"
 
 #include <chrono>
 #include <filesystem>
+#include <functional>
 #include <ctime>
 #include <iomanip>
+#include <utility>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -27,55 +42,15 @@
 namespace {
 
 cv::Mat captureBefore() {
+    TD_PERF_SCOPE("session.imread");
     return cv::imread("t1.jpg");
 }
 
 cv::Mat captureAfter() {
+    TD_PERF_SCOPE("session.imread");
     return cv::imread("t2.jpg");
 }
 
-struct DrawOverlayStyle {
-    cv::Scalar color{0, 255, 0};
-    int rectThickness = 2;
-    double fontScale = 1.0;
-    int textThickness = 2;
-};
-
-DrawOverlayStyle makeOverlayStyle(double relativeScale) {
-    DrawOverlayStyle style;
-    style.rectThickness =
-        std::max(1, static_cast<int>(std::round(4.0 * relativeScale)));
-    style.fontScale = 2.5 * relativeScale;
-    style.textThickness =
-        std::max(1, static_cast<int>(std::round(5.0 * relativeScale)));
-    return style;
-}
-
-double computeImageDiagonal(const cv::Mat& image) {
-    if (image.empty()) {
-        return 0.0;
-    }
-    return std::hypot(static_cast<double>(image.cols),
-                      static_cast<double>(image.rows));
-}
-
-void drawDetections(cv::Mat& image,
-                    const DetectionResult& detections,
-                    const DrawOverlayStyle& style) {
-    for (const auto& obj : detections.objects) {
-        cv::rectangle(image, obj.bbox, style.color, style.rectThickness);
-        cv::putText(
-            image,
-            obj.cls + " " + std::to_string(obj.confidence),
-            cv::Point(obj.bbox.x, obj.bbox.y - 5),
-            cv::FONT_HERSHEY_SIMPLEX,
-            style.fontScale,
-            style.color,
-            style.textThickness
-        );
-    }
-}
-
 std::string getCurrentDayString() {
     auto now = std::chrono::system_clock::now();
     std::time_t t  = std::chrono::system_clock::to_time_t(now);
@@ -90,6 +65,68 @@ std::string getCurrentDayString() {
     return oss.str();
 }
 
+// Reports tool count changes in video mode once the tracked per-class
+// counts have held for `settleFrames` frames, so a hand passing in front
+// of the cabinet does not register as a change. Changes also go to the
+// alarm bus under `stream`, which de-duplicates repeats across frames.
+class VideoInventoryWatcher {
+public:
+    VideoInventoryWatcher(int settleFrames, std::string stream)
+        : settleFrames_(settleFrames), stream_(std::move(stream)) {}
+
+    void observe(long long frameIndex, const DetectionResult& tracked) {
+        std::map<std::string, int> counts;
+        for (const auto& obj : tracked.objects) ++counts[obj.cls];
+        if (counts != pendingCounts_) {
+            pendingCounts_ = counts;
+            pending_ = tracked;
+            pendingFrames_ = 0;
+        }
+        if (++pendingFrames_ != settleFrames_) return;
+        if (!haveStable_) {
+            haveStable_ = true;
+        } else if (pendingCounts_ != stableCounts_) {
+            const InventoryDelta delta = compareInventory(stable_, pending_);
+            publishInventoryAlarms(delta, stream_, "");
+            std::cout << "[INFO] Video inventory change at frame " << frameIndex << ":";
+            for (const auto& kv : delta.classCountDiff) {
+                if (kv.second != 0) {
+                    std::cout << " " << kv.first << (kv.second > 0 ? " +" : " ") << kv.second;
+                }
+            }
+            std::cout << "\n";
+        }
+        stable_ = pending_;
+        stableCounts_ = pendingCounts_;
+    }
+
+private:
+    int settleFrames_;
+    std::string stream_;
+    bool haveStable_ = false;
+    DetectionResult stable_;
+    std::map<std::string, int> stableCounts_;
+    DetectionResult pending_;
+    std::map<std::string, int> pendingCounts_;
+    int pendingFrames_ = 0;
+};
+
+// Sharpest frame after `event` from every camera, in camera order; empty if
+// any camera delivered nothing. The grabbers run concurrently, so the
+// cameras' selection windows overlap and N cameras wait about one window.
+std::vector<FrameHandle> selectCameraFrames(const std::vector<CameraGrabber*>& cameras,
+                                            CaptureClock::time_point event) {
+    std::vector<FrameHandle> frames;
+    for (CameraGrabber* camera : cameras) {
+        FrameHandle frame = camera->sharpestAfter(event);
+        if (!frame) {
+            return {};
+        }
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
+
 void runSingleImagePreview() {
     const std::string testImagePath = "t1.jpg";
     cv::Mat testImage = cv::imread(testImagePath);
@@ -158,67 +195,232 @@ std::filesystem::path resolveVideoPath(const std::string& videoPath) {
     return path;  // Fall back to the original relative path for error reporting.
 }
 
-bool runVideoDetection(const std::string& videoPath) {
-#if TOOLSDETECT_HAS_VIDEOIO && TOOLSDETECT_HAS_HIGHGUI
+bool runVideoDetection(const std::string& videoPath, const VideoRunOptions& options) {
     namespace fs = std::filesystem;
 
-    fs::path resolvedPath = resolveVideoPath(videoPath);
-
-    if (!fs::exists(resolvedPath)) {
-        std::cerr << "[ERROR] Video file not found: " << resolvedPath << "\n"
-                  << "[INFO] Current working directory: " << fs::current_path() << "\n"
-                  << "[INFO] If you built with CMake, try '../" << videoPath
-                  << "' from the build directory or use an absolute path.\n";
+#if !TOOLSDETECT_HAS_HIGHGUI
+    if (options.display) {
+        std::cerr << "[ERROR] Video display is unavailable "
+                     "(OpenCV highgui not found at build time).\n";
         return false;
     }
+#endif
 
-    cv::VideoCapture cap(resolvedPath.string());
-    if (!cap.isOpened()) {
-        std::cerr << "[ERROR] Failed to open video: " << resolvedPath << "\n";
+    std::function<bool(cv::Mat&, int64_t&)> source = options.source;
+#if TOOLSDETECT_HAS_VIDEOIO
+    cv::VideoCapture cap;
+    if (!source) {
+        fs::path resolvedPath = resolveVideoPath(videoPath);
+
+        if (!fs::exists(resolvedPath)) {
+            std::cerr << "[ERROR] Video file not found: " << resolvedPath << "\n"
+                      << "[INFO] Current working directory: " << fs::current_path() << "\n"
+                      << "[INFO] If you built with CMake, try '../" << videoPath
+                      << "' from the build directory or use an absolute path.\n";
+            return false;
+        }
+
+        cap.open(resolvedPath.string());
+        if (!cap.isOpened()) {
+            std::cerr << "[ERROR] Failed to open video: " << resolvedPath << "\n";
+            return false;
+        }
+
+        std::cout << "[INFO] Starting video detection on " << resolvedPath
+                  << ". Press 'q' to exit video mode.\n";
+        source = [&cap](cv::Mat& frame, int64_t& positionUs) {
+            positionUs = static_cast<int64_t>(cap.get(cv::CAP_PROP_POS_MSEC) * 1000.0);
+            return cap.read(frame);
+        };
+    }
+#else
+    if (!source) {
+        (void)videoPath;
+        std::cerr << "[ERROR] Video mode is unavailable "
+                     "(OpenCV videoio not found at build time).\n";
         return false;
     }
-
-    std::cout << "[INFO] Starting video detection on " << resolvedPath
-              << ". Press 'q' to exit video mode.\n";
+#endif
 
     const std::string windowName = "Video Detection";
-    cv::namedWindow(windowName, cv::WINDOW_NORMAL);
+#if TOOLSDETECT_HAS_HIGHGUI
+    if (options.display) {
+        cv::namedWindow(windowName, cv::WINDOW_NORMAL);
+    }
+#endif
 
     const DrawOverlayStyle videoStyle = makeOverlayStyle(1.0);
 
-    while (true) {
+    static metrics::Counter& framesTotal = metrics::counter(
+        "toolsdetect_video_frames_total", "Video frames run through detection");
+    static metrics::Gauge& videoFps = metrics::gauge(
+        "toolsdetect_video_fps", "Video detection frames per second (last ~1 s window)");
+    static metrics::Gauge& inputSizeGauge = metrics::gauge(
+        "toolsdetect_input_size_pixels", "Model input size (side length) used for the last video frame");
+    static metrics::Counter& inputSizeSwitches = metrics::counter(
+        "toolsdetect_input_size_switches_total", "Input size changes made by the latency controller");
+    auto fpsWindowStart = std::chrono::steady_clock::now();
+    int fpsWindowFrames = 0;
+    double shownFps = 0.0;
+
+    std::unique_ptr<ResolutionController> resolution;
+    if (options.latencyBudgetMs > 0.0) {
+        if (detectorSupportsDynamicInputSize()) {
+            ResolutionControllerConfig config;
+            config.budgetMs = options.latencyBudgetMs;
+            resolution = std::make_unique<ResolutionController>(config);
+            std::cout << "[INFO] Adaptive input size, budget " << options.latencyBudgetMs
+                      << " ms/frame, starting at " << resolution->currentSize() << "\n";
+        } else {
+            std::cerr << "[WARN] Model has a fixed input size; ignoring the latency budget.\n";
+        }
+    }
+
+    static metrics::Counter& keyframesTotal = metrics::counter(
+        "toolsdetect_video_keyframes_total", "Video frames that ran full inference");
+    const TrackerConfig trackerConfig;
+    std::unique_ptr<MultiObjectTracker> tracker;
+    std::unique_ptr<VideoInventoryWatcher> inventoryWatcher;
+    KeyframeScheduler keyframes(options.trackerStride, options.keyframeMinConfidence);
+    if (options.trackerStride > 0) {
+        tracker = std::make_unique<MultiObjectTracker>(trackerConfig);
+        inventoryWatcher = std::make_unique<VideoInventoryWatcher>(15, "video:" + videoPath);
+        std::cout << "[INFO] Tracking enabled, inference every " << options.trackerStride
+                  << " frames (earlier if track confidence drops below "
+                  << options.keyframeMinConfidence << ")\n";
+    }
+    int lastInputSize = 0;
+
+    for (long long frameIndex = 0;; ++frameIndex) {
+        trace::Span frameSpan("frame", std::to_string(frameIndex));
+        StageTimings stages;
+        auto t_stage = std::chrono::steady_clock::now();
+        auto lap = [&stages, &t_stage](const char* name) {
+            const auto now = std::chrono::steady_clock::now();
+            stages.emplace_back(name, std::chrono::duration<double, std::milli>(now - t_stage).count());
+            t_stage = now;
+        };
+
         cv::Mat frame;
-        if (!cap.read(frame) || frame.empty()) {
+        int64_t positionUs = 0;
+        bool gotFrame = false;
+        {
+            TD_PERF_SCOPE("video.decode");
+            gotFrame = source(frame, positionUs);
+        }
+        if (!gotFrame || frame.empty()) {
             std::cout << "[INFO] Video stream ended.\n";
             break;
         }
+        lap("decode");
+
+        TD_PERF_SCOPE("video.frame");
+        const bool keyframe = !tracker || keyframes.isKeyframe(*tracker);
+        DetectionResult detections;
+        if (keyframe) {
+            int inputSize = resolution ? resolution->currentSize() : 0;
+            if (options.keyframeInputSize) {
+                if (const int forced = options.keyframeInputSize()) inputSize = forced;
+            }
+            if (tracker) {
+                // Weak detections feed the tracker's second association stage.
+                detections = runYoloDetect(frame, inputSize, trackerConfig.lowThreshold);
+            } else {
+                detections = inputSize > 0 ? runYoloDetect(frame, inputSize) : runYoloDetect(frame);
+            }
+            lap("detect");
+            keyframesTotal.inc();
+            if (resolution) {
+                if (resolution->report(stages.back().second)) {
+                    inputSizeSwitches.inc();
+                }
+            }
+            if (detections.inputSize > 0) {
+                lastInputSize = detections.inputSize;
+                inputSizeGauge.set(detections.inputSize);
+            }
+            // Recordings keep raw keyframe detections at the normal threshold
+            // and the input size they were inferred at, so --replay (which
+            // runs plain inference on every recorded frame at that size) can
+            // compare them.
+            if (SessionRecorder* recorder = activeRecorder()) {
+                DetectionResult recorded = detections;
+                recorded.objects.clear();
+                for (const auto& obj : detections.objects) {
+                    if (obj.confidence >= kYoloConfidenceThreshold) recorded.objects.push_back(obj);
+                }
+                recorder->recordFrame(frameIndex, positionUs, frame, recorded, stages);
+            }
+        }
+        if (tracker) {
+            if (keyframe) {
+                tracker->update(detections);
+            } else {
+                tracker->predict();
+            }
+            detections = tracker->trackedObjects();
+            detections.inputSize = lastInputSize;
+            inventoryWatcher->observe(frameIndex, detections);
+            lap(keyframe ? "track_update" : "track_predict");
+        }
 
-        DetectionResult detections = runYoloDetect(frame);
-        cv::Mat vis = frame.clone();
-        drawDetections(vis, detections, videoStyle);
+        cv::Mat vis;
+        if (options.display) {
+            TD_PERF_SCOPE("video.draw");
+            vis = frame.clone();
+            drawDetections(vis, detections, videoStyle);
+            std::ostringstream status;
+            status << "input " << detections.inputSize << "px  " << std::fixed
+                   << std::setprecision(1) << shownFps << " fps";
+            if (resolution) status << "  (budget " << options.latencyBudgetMs << " ms)";
+            if (tracker) status << (keyframe ? "  key" : "  track");
+            drawStatusText(vis, status.str(), videoStyle);
+            lap("draw");
+        }
 
-        cv::imshow(windowName, vis);
-        int key = cv::waitKey(1);
-        if (key == 'q' || key == 'Q' || key == 27) {
-            std::cout << "[INFO] Video detection interrupted by user.\n";
-            break;
+        if (options.onFrame) {
+            options.onFrame(frameIndex, detections, stages);
+        }
+
+        framesTotal.inc();
+        ++fpsWindowFrames;
+        const auto now = std::chrono::steady_clock::now();
+        const double windowSec = std::chrono::duration<double>(now - fpsWindowStart).count();
+        if (windowSec >= 1.0) {
+            shownFps = fpsWindowFrames / windowSec;
+            videoFps.set(shownFps);
+            fpsWindowStart = now;
+            fpsWindowFrames = 0;
+        }
+
+#if TOOLSDETECT_HAS_HIGHGUI
+        if (options.display) {
+            cv::imshow(windowName, vis);
+            int key = cv::waitKey(1);
+            if (key == 'q' || key == 'Q' || key == 27) {
+                std::cout << "[INFO] Video detection interrupted by user.\n";
+                break;
+            }
         }
+#endif
     }
 
-    cv::destroyWindow(windowName);
-    return true;
-#else
-    (void)videoPath;
-    std::cerr << "[ERROR] Video mode is unavailable "
-                 "(OpenCV videoio/highgui not found at build time).\n";
-    return false;
+    videoFps.set(0.0);
+#if TOOLSDETECT_HAS_HIGHGUI
+    if (options.display) {
+        cv::destroyWindow(windowName);
+    }
 #endif
+    return true;
 }
 
 void runBeforeAfterSessions(Logger& logger,
                             const std::string& username,
-                            const std::string& resultsDir) {
-    runSingleImagePreview();
+                            const std::string& resultsDir,
+                            const SessionRunOptions& options) {
+    if (options.interactive) {
+        runSingleImagePreview();
+    }
 
     std::string currentDay = getCurrentDayString();
     int dailyCounter = 0;
@@ -226,19 +428,63 @@ void runBeforeAfterSessions(Logger& logger,
     while (true) {
         std::cout << "\n--- New inventory check session ---\n";
 
-        std::string today = getCurrentDayString();
-        if (today != currentDay) {
-            currentDay = today;
-            dailyCounter = 1;
-        } else {
-            dailyCounter += 1;
+        std::string sessionId;
+        if (!options.source && activeCabinetState()) {
+            // Persisted counter: ids keep counting across restarts.
+            sessionId = activeCabinetState()->nextSessionId(getCurrentDayString());
+        } else if (!options.source) {
+            std::string today = getCurrentDayString();
+            if (today != currentDay) {
+                currentDay = today;
+                dailyCounter = 1;
+            } else {
+                dailyCounter += 1;
+            }
+            sessionId = currentDay + "#" + std::to_string(dailyCounter);
         }
-        std::string sessionId = currentDay + "#" + std::to_string(dailyCounter);
-
-        auto t_start = std::chrono::high_resolution_clock::now();
 
-        cv::Mat img_before = captureBefore();
-        cv::Mat img_after  = captureAfter();
+        auto t_start = std::chrono::steady_clock::now();
+
+        cv::Mat img_before;
+        cv::Mat img_after;
+        // Keep the camera ring slots pinned until the session is processed;
+        // the images below share their pixels.
+        std::vector<FrameHandle> framesBefore;
+        std::vector<FrameHandle> framesAfter;
+        std::vector<cv::Mat> viewsBefore;
+        std::vector<cv::Mat> viewsAfter;
+        if (options.source) {
+            if (!options.source(img_before, img_after, sessionId)) {
+                std::cout << "[INFO] Session source exhausted.\n";
+                break;
+            }
+        } else if (!options.cameras.empty()) {
+            // Door events come from the operator for now; a door sensor would
+            // call sharpestAfter() with its own timestamps.
+            std::string line;
+            std::cout << "Press ENTER when the cabinet door opens: ";
+            if (!std::getline(std::cin, line)) {
+                break;
+            }
+            framesBefore = selectCameraFrames(options.cameras, CaptureClock::now());
+            std::cout << "Press ENTER when the cabinet door closes: ";
+            if (!std::getline(std::cin, line)) {
+                break;
+            }
+            t_start = std::chrono::steady_clock::now();
+            framesAfter = selectCameraFrames(options.cameras, t_start);
+            if (framesBefore.empty() || framesAfter.empty()) {
+                std::cerr << "[ERROR] No camera frame received after the door event.\n";
+                break;
+            }
+            for (const auto& frame : framesBefore) viewsBefore.push_back(frame->image);
+            for (const auto& frame : framesAfter) viewsAfter.push_back(frame->image);
+            img_before = viewsBefore.front();
+            img_after = viewsAfter.front();
+        } else {
+            img_before = captureBefore();
+            img_after  = captureAfter();
+        }
 
         if (img_before.empty() || img_after.empty()) {
             std::cerr << "[ERROR] Can't load before/after images.\n";
@@ -246,70 +492,35 @@ void runBeforeAfterSessions(Logger& logger,
             break;
         }
 
-        DetectionResult det_before = runYoloDetect(img_before);
-        DetectionResult det_after  = runYoloDetect(img_after);
-
-        InventoryDelta delta = compareInventory(det_before, det_after);
-        AlarmInfo alarmInfo = evaluateAlarm(delta);
-        raiseAlarmToConsole(alarmInfo, sessionId, username);
-
-        std::cout << "[INFO] Delta (after - before):\n";
-        for (const auto& kv : delta.classCountDiff) {
-            std::cout << "  " << kv.first << " -> " << kv.second << "\n";
+        InventorySessionResult session =
+            (options.rig && viewsBefore.size() > 1)
+                ? processMultiViewSession(viewsBefore, viewsAfter, *options.rig, sessionId,
+                                          username, logger, resultsDir, t_start)
+                : processInventorySession(img_before, img_after, sessionId, username, logger,
+                                          resultsDir, t_start);
+        if (options.onResult) {
+            options.onResult(sessionId, session);
         }
-
-        auto t_end = std::chrono::high_resolution_clock::now();
-        auto durationMs =
-            std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count();
-
-        std::cout << "[PERF] Session " << sessionId
-                  << " took " << durationMs << " ms\n";
-
-        logger.logInventoryDelta(username, delta, sessionId, durationMs, alarmInfo);
-
-        const double beforeDiag = computeImageDiagonal(img_before);
-        const double afterDiag = computeImageDiagonal(img_after);
-        const double relativeAfterScale =
-            (beforeDiag > 0.0) ? (afterDiag / beforeDiag) : 1.0;
-        const DrawOverlayStyle beforeStyle = makeOverlayStyle(1.0);
-        const DrawOverlayStyle afterStyle = makeOverlayStyle(relativeAfterScale);
-
-        cv::Mat vis_before = img_before.clone();
-        cv::Mat vis_after = img_after.clone();
-        drawDetections(vis_before, det_before, beforeStyle);
-        drawDetections(vis_after, det_after, afterStyle);
-
-        const std::string beforeResultPath = resultsDir + "/" + sessionId + "_before.jpg";
-        const std::string afterResultPath = resultsDir + "/" + sessionId + "_after.jpg";
-        if (cv::imwrite(beforeResultPath, vis_before)) {
-            std::cout << "[INFO] Saved detection visualization to "
-                      << beforeResultPath << "\n";
-        } else {
-            std::cerr << "[ERROR] Failed to write detection visualization to "
-                      << beforeResultPath << "\n";
-        }
-        if (cv::imwrite(afterResultPath, vis_after)) {
-            std::cout << "[INFO] Saved detection visualization to "
-                      << afterResultPath << "\n";
-        } else {
-            std::cerr << "[ERROR] Failed to write detection visualization to "
-                      << afterResultPath << "\n";
+        if (!options.interactive) {
+            continue;
         }
+        const AlarmInfo& alarmInfo = session.alarm;
+        const cv::Mat& vis_before = session.visBefore;
+        const cv::Mat& vis_after = session.visAfter;
 
         std::string afterWindowTitle = "After Snapshot + Detections";
         if (alarmInfo.triggered) {
             afterWindowTitle += " [ALARM!]";
         }
 
-        const int windowWidth = 1920;
-        const int windowHeight = 1080;
-
+        // The previews are rendered at display size already: size the
+        // windows to them so repaints do not rescale.
         cv::namedWindow("Before Snapshot", cv::WINDOW_NORMAL);
-        cv::resizeWindow("Before Snapshot", windowWidth, windowHeight);
+        cv::resizeWindow("Before Snapshot", vis_before.cols, vis_before.rows);
         cv::imshow("Before Snapshot", vis_before);
 
         cv::namedWindow(afterWindowTitle, cv::WINDOW_NORMAL);
-        cv::resizeWindow(afterWindowTitle, windowWidth, windowHeight);
+        cv::resizeWindow(afterWindowTitle, vis_after.cols, vis_after.rows);
         cv::imshow(afterWindowTitle, vis_after);
 
         std::cout << "Press any key in the image window to continue...\n";
@@ -1,19 +1,71 @@
 #pragma once
 
+#include "session_recording.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <vector>
 
+class CameraGrabber;
+struct CameraRig;
 class Logger;
+struct InventorySessionResult;
+
+// Where before/after sessions get their images and how the loop behaves.
+// The defaults keep the original interactive behaviour (t1.jpg / t2.jpg,
+// preview windows, ENTER between rounds); the replay driver supplies its own
+// source and runs non-interactively as fast as possible.
+struct SessionRunOptions {
+    // Fills the next before/after pair and its session id; returns false
+    // when there are no more sessions. Empty = captureBefore()/captureAfter().
+    std::function<bool(cv::Mat& before, cv::Mat& after, std::string& sessionId)> source;
+    // Live cameras (--camera / --cameras) used instead of t1.jpg / t2.jpg
+    // when there is no `source`: the sharpest frame after door open / door
+    // close from each. Several cameras need `rig` (one view per camera, in
+    // the same order) and run as multi-view sessions.
+    std::vector<CameraGrabber*> cameras;
+    const CameraRig* rig = nullptr;
+    bool interactive = true;
+    std::function<void(const std::string& sessionId, const InventorySessionResult& result)> onResult;
+};
+
+// Same idea for the video loop.
+struct VideoRunOptions {
+    // Fills the next frame and its stream position; returns false at the end.
+    // Empty = decode `videoPath` with cv::VideoCapture.
+    std::function<bool(cv::Mat& frame, int64_t& positionUs)> source;
+    bool display = true;   // draw + imshow, 'q' to stop
+    // Per-frame detect latency target. > 0 lets a ResolutionController pick
+    // the model input size (dynamic-shape models only); 0 = fixed size.
+    double latencyBudgetMs = 0.0;
+    // > 0: run inference only every trackerStride-th frame (or when track
+    // confidence decays below keyframeMinConfidence) and report tracked
+    // boxes with stable ids in between. 0 = detect every frame.
+    int trackerStride = 0;
+    float keyframeMinConfidence = 0.3f;
+    // Model input size of the next keyframe, overriding the latency budget
+    // (--replay runs each recorded frame at the size it was recorded with).
+    // Empty, or a result of 0, leaves the choice to the loop.
+    std::function<int()> keyframeInputSize;
+    std::function<void(int64_t frameIndex, const DetectionResult& det,
+                       const StageTimings& stages)> onFrame;
+};
 
 // Ensures the specified directory exists (creates if necessary).
 bool ensureDirectoryExists(const std::string& dir);
 
-// Launches the before/after snapshot workflow (interactive loop).
+// Launches the before/after snapshot workflow (interactive loop by default).
 void runBeforeAfterSessions(Logger& logger,
                             const std::string& username,
-                            const std::string& resultsDir);
+                            const std::string& resultsDir,
+                            const SessionRunOptions& options = SessionRunOptions());
 
 // Streams detections over a video file if the build has videoio/highgui.
 // Tries to resolve relative paths from common working directories (e.g., the
 // CMake build folder) before opening. Returns true if the video stream was
 // opened and processed, false otherwise (e.g., invalid path).
-bool runVideoDetection(const std::string& videoPath);
+bool runVideoDetection(const std::string& videoPath,
+                       const VideoRunOptions& options = VideoRunOptions());
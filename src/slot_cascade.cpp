@@ -0,0 +1,263 @@
+#include "slot_cascade.h"
+
+#include "metrics.h"
+#include "perf_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+constexpr int kThumbSide = 16;
+constexpr int kEdgeThreshold = 24;   // grey-level step counted as an edge
+
+std::atomic<const SlotCascade*> g_activeCascade{nullptr};
+
+SlotSignature computeSignature(const cv::Mat& image, const cv::Rect& rect) {
+    SlotSignature sig;
+    const cv::Rect clipped = rect & cv::Rect(0, 0, image.cols, image.rows);
+    if (clipped.area() == 0) {
+        return sig;
+    }
+    cv::Mat thumb;
+    cv::resize(image(clipped), thumb, cv::Size(kThumbSide, kThumbSide), 0, 0, cv::INTER_AREA);
+    if (thumb.channels() == 1) {
+        cv::cvtColor(thumb, thumb, cv::COLOR_GRAY2BGR);
+    } else if (thumb.channels() == 4) {
+        cv::cvtColor(thumb, thumb, cv::COLOR_BGRA2BGR);
+    }
+
+    int grey[kThumbSide][kThumbSide];
+    const float weight = 1.0f / (kThumbSide * kThumbSide);
+    for (int y = 0; y < kThumbSide; ++y) {
+        const uint8_t* row = thumb.ptr<uint8_t>(y);
+        for (int x = 0; x < kThumbSide; ++x) {
+            const int b = row[3 * x];
+            const int g = row[3 * x + 1];
+            const int r = row[3 * x + 2];
+            sig.colour[(b >> 6) * 16 + (g >> 6) * 4 + (r >> 6)] += weight;
+            grey[y][x] = (b + g + r) / 3;
+        }
+    }
+    int edges = 0;
+    for (int y = 0; y + 1 < kThumbSide; ++y) {
+        for (int x = 0; x + 1 < kThumbSide; ++x) {
+            const int step = std::abs(grey[y][x + 1] - grey[y][x]) + std::abs(grey[y + 1][x] - grey[y][x]);
+            edges += step > kEdgeThreshold ? 1 : 0;
+        }
+    }
+    sig.edgeDensity = static_cast<float>(edges) / ((kThumbSide - 1) * (kThumbSide - 1));
+    return sig;
+}
+
+// 0 for identical signatures; half the histogram L1 distance (0..1) plus the
+// edge density difference (0..1).
+float signatureDistance(const SlotSignature& a, const SlotSignature& b) {
+    float l1 = 0.0f;
+    for (size_t i = 0; i < a.colour.size(); ++i) {
+        l1 += std::abs(a.colour[i] - b.colour[i]);
+    }
+    return 0.5f * l1 + std::abs(a.edgeDensity - b.edgeDensity);
+}
+
+bool sameClass(const std::string& a, const std::string& b) {
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](unsigned char x, unsigned char y) {
+               return std::tolower(x) == std::tolower(y);
+           });
+}
+
+cv::Rect scaleRect(const cv::Rect& r, double sx, double sy) {
+    return cv::Rect(static_cast<int>(std::lround(r.x * sx)), static_cast<int>(std::lround(r.y * sy)),
+                    static_cast<int>(std::lround(r.width * sx)),
+                    static_cast<int>(std::lround(r.height * sy)));
+}
+
+}  // namespace
+
+bool loadToolSlots(const std::string& path, std::vector<ToolSlot>& slots) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "[ERROR] Cannot open slot layout: " << path << "\n";
+        return false;
+    }
+    slots.clear();
+    std::string line;
+    for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+        std::istringstream fields(line);
+        std::vector<std::string> tokens;
+        for (std::string token; fields >> token;) {
+            tokens.push_back(token);
+        }
+        if (tokens.empty() || tokens.front()[0] == '#') {
+            continue;
+        }
+        // The last four tokens are the rectangle; everything before is the name.
+        if (tokens.size() < 5) {
+            std::cerr << "[ERROR] " << path << ":" << lineNo << ": expected '<class> x y w h'\n";
+            return false;
+        }
+        ToolSlot slot;
+        int values[4];
+        try {
+            for (int i = 0; i < 4; ++i) {
+                values[i] = std::stoi(tokens[tokens.size() - 4 + i]);
+            }
+        } catch (const std::exception&) {
+            std::cerr << "[ERROR] " << path << ":" << lineNo << ": invalid slot rectangle\n";
+            return false;
+        }
+        for (size_t i = 0; i + 4 < tokens.size(); ++i) {
+            slot.cls += (i ? " " : "") + tokens[i];
+        }
+        slot.rect = cv::Rect(values[0], values[1], values[2], values[3]);
+        if (slot.rect.width <= 0 || slot.rect.height <= 0) {
+            std::cerr << "[ERROR] " << path << ":" << lineNo << ": empty slot rectangle\n";
+            return false;
+        }
+        slots.push_back(slot);
+    }
+    if (slots.empty()) {
+        std::cerr << "[ERROR] Slot layout defines no slots: " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+SlotCascade::SlotCascade(std::vector<ToolSlot> slots, SlotCascadeConfig config)
+    : slots_(std::move(slots)), config_(config) {}
+
+bool SlotCascade::enroll(const cv::Mat& stocked, const cv::Mat& empty) {
+    if (stocked.empty()) {
+        std::cerr << "[ERROR] Slot enrollment needs a reference image of the stocked board.\n";
+        return false;
+    }
+    enrolledSize_ = stocked.size();
+    stocked_.clear();
+    empty_.clear();
+    for (const auto& slot : slots_) {
+        stocked_.push_back(computeSignature(stocked, slot.rect));
+    }
+    if (!empty.empty()) {
+        const double sx = static_cast<double>(empty.cols) / enrolledSize_.width;
+        const double sy = static_cast<double>(empty.rows) / enrolledSize_.height;
+        for (const auto& slot : slots_) {
+            empty_.push_back(computeSignature(empty, scaleRect(slot.rect, sx, sy)));
+        }
+    }
+    return true;
+}
+
+SlotReading SlotCascade::read(const cv::Mat& image) const {
+    static metrics::Counter& bySignature = metrics::counter(
+        "toolsdetect_slot_decisions_total", "Shadow-board slots decided, by cascade stage",
+        {{"by", "signature"}});
+    static metrics::Counter& byDetector = metrics::counter(
+        "toolsdetect_slot_decisions_total", "Shadow-board slots decided, by cascade stage",
+        {{"by", "detector"}});
+
+    SlotReading reading;
+    reading.states.assign(slots_.size(), SlotState::Empty);
+    if (image.empty() || stocked_.size() != slots_.size()) {
+        return reading;
+    }
+    const double sx = static_cast<double>(image.cols) / enrolledSize_.width;
+    const double sy = static_cast<double>(image.rows) / enrolledSize_.height;
+    const cv::Rect bounds(0, 0, image.cols, image.rows);
+
+    std::vector<size_t> ambiguous;
+    std::vector<cv::Rect> slotRects(slots_.size());
+    {
+        TD_PERF_SCOPE("slots.signature");
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            slotRects[i] = scaleRect(slots_[i].rect, sx, sy) & bounds;
+            const SlotSignature sig = computeSignature(image, slotRects[i]);
+            const float toStocked = signatureDistance(sig, stocked_[i]);
+            bool occupied = false;
+            bool decided = false;
+            if (!empty_.empty()) {
+                const float toEmpty = signatureDistance(sig, empty_[i]);
+                if (toStocked <= config_.occupiedBelow && toStocked < toEmpty) {
+                    occupied = decided = true;
+                } else if (toEmpty <= config_.occupiedBelow && toEmpty < toStocked) {
+                    decided = true;
+                }
+            } else if (toStocked <= config_.occupiedBelow) {
+                occupied = decided = true;
+            } else if (toStocked >= config_.emptyAbove) {
+                decided = true;
+            }
+            if (!decided) {
+                ambiguous.push_back(i);
+                continue;
+            }
+            ++reading.decidedBySignature;
+            if (occupied) {
+                reading.states[i] = SlotState::Occupied;
+                DetectedObject obj;
+                obj.cls = slots_[i].cls;
+                obj.confidence = std::max(0.0f, 1.0f - toStocked);
+                obj.bbox = slotRects[i];
+                reading.detections.objects.push_back(obj);
+            }
+        }
+    }
+    bySignature.inc(static_cast<uint64_t>(reading.decidedBySignature));
+
+    if (ambiguous.empty()) {
+        return reading;
+    }
+
+    TD_PERF_SCOPE("slots.detect");
+    std::vector<cv::Mat> crops;
+    std::vector<cv::Rect> cropRects;
+    for (size_t i : ambiguous) {
+        const cv::Rect& r = slotRects[i];
+        const int padX = static_cast<int>(r.width * config_.cropPadding);
+        const int padY = static_cast<int>(r.height * config_.cropPadding);
+        const cv::Rect crop = cv::Rect(r.x - padX, r.y - padY, r.width + 2 * padX, r.height + 2 * padY) & bounds;
+        cropRects.push_back(crop);
+        crops.push_back(image(crop));
+    }
+    const std::vector<DetectionResult> results = runYoloDetectBatch(crops);
+    for (size_t k = 0; k < ambiguous.size() && k < results.size(); ++k) {
+        const size_t i = ambiguous[k];
+        // Only the slot's own tool counts: the padding can show a neighbour,
+        // which its own slot already accounts for.
+        const DetectedObject* best = nullptr;
+        for (const auto& obj : results[k].objects) {
+            if (sameClass(obj.cls, slots_[i].cls) && (!best || obj.confidence > best->confidence)) {
+                best = &obj;
+            }
+        }
+        ++reading.decidedByDetector;
+        if (best) {
+            reading.states[i] = SlotState::Occupied;
+            DetectedObject obj = *best;
+            obj.cls = slots_[i].cls;
+            obj.bbox = best->bbox + cropRects[k].tl();
+            obj.obb.center += cv::Point2f(cropRects[k].tl());
+            reading.detections.objects.push_back(obj);
+        }
+    }
+    byDetector.inc(static_cast<uint64_t>(reading.decidedByDetector));
+    return reading;
+}
+
+InventoryDelta compareSlotReadings(const SlotReading& before, const SlotReading& after) {
+    return compareInventory(before.detections, after.detections);
+}
+
+void setActiveSlotCascade(const SlotCascade* cascade) {
+    g_activeCascade.store(cascade);
+}
+
+const SlotCascade* activeSlotCascade() {
+    return g_activeCascade.load();
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "detector.h"
+#include "inventory_compare.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <array>
+#include <string>
+#include <vector>
+
+// Slot-occupancy cascade for shadow-board cabinets (--slots).
+//
+// Every tool has a fixed slot (data/tools_config.txt: "<class> x y w h" in
+// the pixels of the enrollment image). At enrollment each slot's crop of a
+// fully stocked board, and optionally of an empty one, is reduced to a tiny
+// signature: a 4x4x4 colour histogram and the edge density of a 16x16
+// thumbnail. A session compares each slot with its references, which takes a
+// few microseconds. Slots that clearly match the stocked or the empty
+// reference are decided on the spot. Only the ambiguous ones (a different
+// tool in the slot, a hand or a shadow) are cropped and sent to YOLO as one
+// batch. The result is a DetectionResult with one object per occupied slot,
+// so compareInventory() / evaluateAlarm() work unchanged.
+
+struct ToolSlot {
+    std::string cls;    // must match a model class name for the YOLO fallback
+    cv::Rect rect;      // enrollment image pixels
+};
+
+// Reads "<class> x y w h" lines; class names may contain spaces. Returns
+// false (after printing the reason) on a malformed line or an empty file.
+bool loadToolSlots(const std::string& path, std::vector<ToolSlot>& slots);
+
+struct SlotCascadeConfig {
+    // Signature distance (0 = identical, ~2 = unrelated) to the stocked
+    // reference at or below which a slot is occupied...
+    float occupiedBelow = 0.20f;
+    // ...and, without an empty reference, at or above which it is empty.
+    float emptyAbove = 0.55f;
+    // Extra context around an ambiguous slot's crop for YOLO, per side.
+    float cropPadding = 0.25f;
+};
+
+struct SlotSignature {
+    std::array<float, 64> colour{};   // normalized 4x4x4 BGR histogram
+    float edgeDensity = 0.0f;
+};
+
+enum class SlotState { Empty, Occupied };
+
+struct SlotReading {
+    DetectionResult detections;        // one object per occupied slot
+    std::vector<SlotState> states;     // per slot, in slot order
+    int decidedBySignature = 0;
+    int decidedByDetector = 0;
+};
+
+class SlotCascade {
+public:
+    explicit SlotCascade(std::vector<ToolSlot> slots, SlotCascadeConfig config = SlotCascadeConfig());
+
+    // Captures the reference signatures. `stocked` shows every tool in its
+    // slot; `empty` (optional) shows the bare board.
+    bool enroll(const cv::Mat& stocked, const cv::Mat& empty = cv::Mat());
+
+    // Reads one snapshot. Images of another size than the enrollment image
+    // have the slot rectangles scaled accordingly. Thread-safe.
+    SlotReading read(const cv::Mat& image) const;
+
+    const std::vector<ToolSlot>& slots() const { return slots_; }
+
+private:
+    std::vector<ToolSlot> slots_;
+    SlotCascadeConfig config_;
+    cv::Size enrolledSize_;
+    std::vector<SlotSignature> stocked_;
+    std::vector<SlotSignature> empty_;   // empty if no empty reference
+};
+
+// Compares two readings the way compareInventory() compares detections.
+InventoryDelta compareSlotReadings(const SlotReading& before, const SlotReading& after);
+
+// Process-wide cascade used by processInventorySession() instead of plain
+// detection; nullptr (default) disables it. The caller keeps ownership.
+void setActiveSlotCascade(const SlotCascade* cascade);
+const SlotCascade* activeSlotCascade();
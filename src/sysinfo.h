@@ -0,0 +1,12 @@
+// sysinfo.h
+// Process resource queries used by the metrics endpoint and PERF logs.
+
+#pragma once
+
+#include <cstdint>
+
+// Resident set size of this process in bytes (0 if unavailable).
+uint64_t currentRssBytes();
+
+// Peak resident set size since process start in bytes (0 if unavailable).
+uint64_t peakRssBytes();
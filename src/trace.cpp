@@ -0,0 +1,359 @@
+// trace.cpp
+// Per-thread SPSC event rings, background JSON writer and ORT profile merge.
+
+#include "trace.h"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <process.h>
+#define TOOLSDETECT_GETPID _getpid
+#else
+#include <unistd.h>
+#define TOOLSDETECT_GETPID getpid
+#endif
+
+namespace trace {
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+constexpr size_t kRingCapacity = 4096;   // events per thread, power of two
+constexpr auto kFlushInterval = std::chrono::milliseconds(100);
+
+struct Event {
+    const char* name = nullptr;
+    char detail[40] = {};
+    uint64_t tsUs = 0;
+    uint64_t durUs = 0;
+};
+
+// Single producer (the owning thread), single consumer (the flusher).
+struct Ring {
+    std::array<Event, kRingCapacity> events;
+    std::atomic<size_t> head{0};   // next slot to write (producer)
+    std::atomic<size_t> tail{0};   // next slot to read (consumer)
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> retired{false};
+    int tid = 0;
+    std::string threadName;        // guarded by State::mutex
+    bool nameWritten = false;      // flusher only
+
+    bool push(const Event& ev) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= kRingCapacity) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        events[h & (kRingCapacity - 1)] = ev;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+struct State {
+    std::mutex mutex;                         // rings list, file, sources
+    std::vector<std::shared_ptr<Ring>> rings;
+    std::map<int, ExternalProfileSource> sources;
+    int runningSource = 0;                    // token whose callback stop() is in, 0 = none
+    std::condition_variable sourceDone;
+    int nextToken = 1;
+    int nextTid = 1;
+
+    std::ofstream out;
+    bool firstEvent = true;
+    uint64_t epochUs = 0;
+    int pid = 0;
+
+    std::thread flusher;
+    std::condition_variable cv;
+    bool stopping = false;
+};
+
+State& state() {
+    static State* s = new State();   // leaked on purpose: used from thread exits
+    return *s;
+}
+
+std::atomic<bool> g_enabled{false};
+std::atomic<bool> g_ortProfiling{false};
+
+uint64_t clockMicros() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now().time_since_epoch()).count());
+}
+
+void appendEscaped(std::string& out, const char* s) {
+    for (; *s; ++s) {
+        const char c = *s;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out += ' ';
+        } else {
+            out += c;
+        }
+    }
+}
+
+// Caller holds State::mutex.
+void writeRaw(State& st, const std::string& json) {
+    if (!st.firstEvent) st.out << ",\n";
+    st.out << json;
+    st.firstEvent = false;
+}
+
+// Drains every ring into the file. Caller holds State::mutex.
+void drainLocked(State& st) {
+    std::string json;
+    for (auto& ring : st.rings) {
+        if (!ring->nameWritten && !ring->threadName.empty()) {
+            json.clear();
+            json += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" + std::to_string(st.pid) +
+                    ",\"tid\":" + std::to_string(ring->tid) + ",\"args\":{\"name\":\"";
+            appendEscaped(json, ring->threadName.c_str());
+            json += "\"}}";
+            writeRaw(st, json);
+            ring->nameWritten = true;
+        }
+
+        const size_t head = ring->head.load(std::memory_order_acquire);
+        size_t tail = ring->tail.load(std::memory_order_relaxed);
+        for (; tail != head; ++tail) {
+            const Event& ev = ring->events[tail & (kRingCapacity - 1)];
+            json.clear();
+            json += "{\"ph\":\"X\",\"name\":\"";
+            appendEscaped(json, ev.name ? ev.name : "?");
+            json += "\",\"pid\":" + std::to_string(st.pid) +
+                    ",\"tid\":" + std::to_string(ring->tid) +
+                    ",\"ts\":" + std::to_string(ev.tsUs) +
+                    ",\"dur\":" + std::to_string(ev.durUs);
+            if (ev.detail[0]) {
+                json += ",\"args\":{\"id\":\"";
+                appendEscaped(json, ev.detail);
+                json += "\"}";
+            }
+            json += "}";
+            writeRaw(st, json);
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+
+    // Forget rings whose thread has exited and which are fully drained.
+    st.rings.erase(std::remove_if(st.rings.begin(), st.rings.end(),
+                                  [](const std::shared_ptr<Ring>& r) {
+                                      return r->retired.load() &&
+                                             r->tail.load() == r->head.load();
+                                  }),
+                   st.rings.end());
+    st.out.flush();
+}
+
+// Rewrites the "ts" of every event in an ORT profile (relative to the ORT
+// profiler start) onto our epoch and appends the events. ORT writes one
+// event object per line inside a JSON array.
+void mergeExternalProfile(State& st, const ExternalProfile& profile) {
+    std::ifstream in(profile.path);
+    if (!in.is_open()) {
+        std::cerr << "[WARN] Cannot open ORT profile " << profile.path << "\n";
+        return;
+    }
+    const int64_t offsetUs = static_cast<int64_t>(profile.startNs / 1000) -
+                             static_cast<int64_t>(st.epochUs);
+    size_t merged = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t begin = line.find('{');
+        size_t end = line.rfind('}');
+        if (begin == std::string::npos || end == std::string::npos || end < begin) continue;
+        std::string ev = line.substr(begin, end - begin + 1);
+
+        size_t key = ev.find("\"ts\"");
+        if (key == std::string::npos) continue;
+        size_t colon = ev.find(':', key);
+        if (colon == std::string::npos) continue;
+        size_t numBegin = ev.find_first_of("-0123456789", colon);
+        size_t numEnd = ev.find_first_not_of("0123456789", numBegin + 1);
+        if (numBegin == std::string::npos || numEnd == std::string::npos) continue;
+        const int64_t ts = std::stoll(ev.substr(numBegin, numEnd - numBegin)) + offsetUs;
+        ev.replace(numBegin, numEnd - numBegin, std::to_string(std::max<int64_t>(0, ts)));
+        writeRaw(st, ev);
+        ++merged;
+    }
+    std::cout << "[INFO] Merged " << merged << " ONNX Runtime profile event(s) from "
+              << profile.path << "\n";
+}
+
+struct RingHolder {
+    std::shared_ptr<Ring> ring;
+
+    Ring& get() {
+        if (!ring) {
+            ring = std::make_shared<Ring>();
+            State& st = state();
+            std::lock_guard<std::mutex> lock(st.mutex);
+            ring->tid = st.nextTid++;
+            if (ring->threadName.empty()) {
+                ring->threadName = "thread-" + std::to_string(ring->tid);
+            }
+            st.rings.push_back(ring);
+        }
+        return *ring;
+    }
+
+    ~RingHolder() {
+        if (ring) ring->retired.store(true);
+    }
+};
+
+thread_local RingHolder t_ring;
+
+}  // namespace
+
+bool start(const std::string& path, bool includeOrtProfile) {
+    State& st = state();
+    std::lock_guard<std::mutex> lock(st.mutex);
+    if (g_enabled.load()) {
+        return false;
+    }
+    st.out.open(path, std::ios::out | std::ios::trunc);
+    if (!st.out.is_open()) {
+        std::cerr << "[ERROR] Cannot open trace file: " << path << "\n";
+        return false;
+    }
+    st.out << "[\n";
+    st.firstEvent = true;
+    st.epochUs = clockMicros();
+    st.pid = static_cast<int>(TOOLSDETECT_GETPID());
+    st.stopping = false;
+    writeRaw(st, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" + std::to_string(st.pid) +
+                 ",\"args\":{\"name\":\"toolsdetect\"}}");
+
+    g_ortProfiling.store(includeOrtProfile);
+    g_enabled.store(true);
+
+    st.flusher = std::thread([&st]() {
+        std::unique_lock<std::mutex> lk(st.mutex);
+        while (!st.cv.wait_for(lk, kFlushInterval, [&st]() { return st.stopping; })) {
+            drainLocked(st);
+        }
+    });
+    std::cout << "[INFO] Tracing to " << path
+              << (includeOrtProfile ? " (with ONNX Runtime profiling)" : "") << "\n";
+    return true;
+}
+
+void stop() {
+    State& st = state();
+    std::vector<int> tokens;
+    {
+        std::lock_guard<std::mutex> lock(st.mutex);
+        if (!g_enabled.load()) return;
+        g_enabled.store(false);
+        st.stopping = true;
+        for (auto& kv : st.sources) tokens.push_back(kv.first);
+    }
+    st.cv.notify_all();
+    if (st.flusher.joinable()) st.flusher.join();
+
+    // Ask external profilers to finish first, outside the lock (they may be
+    // slow to write their file). A source unregistered meanwhile is skipped;
+    // one being called keeps its owner's unregister waiting until it returns.
+    std::vector<ExternalProfile> profiles;
+    for (int token : tokens) {
+        ExternalProfileSource source;
+        {
+            std::lock_guard<std::mutex> lock(st.mutex);
+            auto it = st.sources.find(token);
+            if (it == st.sources.end()) continue;
+            source = it->second;
+            st.runningSource = token;
+        }
+        ExternalProfile p;
+        try {
+            p = source();
+        } catch (const std::exception& e) {
+            std::cerr << "[WARN] External profile failed: " << e.what() << "\n";
+        }
+        {
+            std::lock_guard<std::mutex> lock(st.mutex);
+            st.runningSource = 0;
+        }
+        st.sourceDone.notify_all();
+        if (!p.path.empty()) profiles.push_back(p);
+    }
+
+    std::lock_guard<std::mutex> lock(st.mutex);
+    drainLocked(st);
+    for (const auto& p : profiles) mergeExternalProfile(st, p);
+
+    uint64_t dropped = 0;
+    for (const auto& ring : st.rings) dropped += ring->dropped.load();
+    st.out << "\n]\n";
+    st.out.close();
+    g_ortProfiling.store(false);
+    if (dropped > 0) {
+        std::cerr << "[WARN] Trace dropped " << dropped << " event(s) (ring buffer full).\n";
+    }
+}
+
+bool enabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+bool ortProfilingRequested() {
+    return g_ortProfiling.load(std::memory_order_relaxed);
+}
+
+uint64_t nowMicros() {
+    return clockMicros() - state().epochUs;
+}
+
+void emitComplete(const char* name, const char* detail, uint64_t startUs, uint64_t durUs) {
+    if (!enabled()) return;
+    Event ev;
+    ev.name = name;
+    if (detail && *detail) {
+        std::strncpy(ev.detail, detail, sizeof(ev.detail) - 1);
+    }
+    ev.tsUs = startUs;
+    ev.durUs = durUs;
+    t_ring.get().push(ev);
+}
+
+void setThreadName(const std::string& name) {
+    Ring& ring = t_ring.get();
+    std::lock_guard<std::mutex> lock(state().mutex);
+    ring.threadName = name;
+    ring.nameWritten = false;
+}
+
+int registerExternalProfile(ExternalProfileSource source) {
+    State& st = state();
+    std::lock_guard<std::mutex> lock(st.mutex);
+    const int token = st.nextToken++;
+    st.sources[token] = std::move(source);
+    return token;
+}
+
+void unregisterExternalProfile(int token) {
+    State& st = state();
+    std::unique_lock<std::mutex> lock(st.mutex);
+    st.sources.erase(token);
+    st.sourceDone.wait(lock, [&st, token]() { return st.runningSource != token; });
+}
+
+}  // namespace trace
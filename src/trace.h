@@ -0,0 +1,106 @@
+// trace.h
+// Optional timeline tracing in Chrome Trace Event format (load the file in
+// chrome://tracing or https://ui.perfetto.dev).
+//
+// Every TD_PERF_SCOPE also becomes a span while tracing is on, so the
+// pipeline stages show up without extra annotations. Sessions and video
+// frames add their own spans with an id attached:
+//
+//   trace::Span span("session", sessionId);
+//
+// Events go into a per-thread single-producer/single-consumer ring buffer
+// (no locks on the hot path) and a background thread drains the rings into
+// the output file. If a ring fills up faster than it is drained, the newest
+// events are dropped and counted.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace trace {
+
+// Starts writing to `path`. With `includeOrtProfile`, sessions created
+// afterwards enable ONNX Runtime's own profiler and its events are merged
+// into the same timeline on stop(). Returns false if the file cannot be
+// opened or tracing is already running.
+bool start(const std::string& path, bool includeOrtProfile);
+
+// Flushes everything, merges external profiles and closes the file.
+void stop();
+
+bool enabled();
+bool ortProfilingRequested();
+
+// Microseconds since the trace epoch (high_resolution_clock based, the same
+// clock ONNX Runtime uses for its profiler).
+uint64_t nowMicros();
+
+// Records a complete ("X") event. `name` must be a string literal or
+// otherwise outlive the trace; `detail` is copied (truncated to 39 chars).
+void emitComplete(const char* name, const char* detail, uint64_t startUs, uint64_t durUs);
+
+// Names the calling thread in the timeline.
+void setThreadName(const std::string& name);
+
+// An external profiler whose JSON output should be merged on stop(). The
+// callback returns the profile file path and the profiler's start time in
+// nanoseconds since the high_resolution_clock epoch.
+struct ExternalProfile {
+    std::string path;
+    uint64_t startNs = 0;
+};
+using ExternalProfileSource = std::function<ExternalProfile()>;
+
+// Returns a token for unregisterExternalProfile().
+int registerExternalProfile(ExternalProfileSource source);
+// Once this returns the source is not running and will not be called again,
+// so its owner may be destroyed. Must not be called from the source itself.
+void unregisterExternalProfile(int token);
+
+// Runs a trace for the lifetime of the object (no-op when `path` is empty).
+// Keep it in main() so it stops before static detectors are destroyed.
+class ScopedTrace {
+public:
+    ScopedTrace(const std::string& path, bool includeOrtProfile)
+        : active_(!path.empty() && start(path, includeOrtProfile)) {}
+    ~ScopedTrace() {
+        if (active_) stop();
+    }
+    ScopedTrace(const ScopedTrace&) = delete;
+    ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+private:
+    bool active_;
+};
+
+// RAII span with an optional per-instance detail string (session id, frame
+// number, ...).
+class Span {
+public:
+    explicit Span(const char* name, const std::string& detail = std::string())
+        : name_(name), active_(enabled()) {
+        if (active_) {
+            detail_ = detail;
+            startUs_ = nowMicros();
+        }
+    }
+    ~Span() {
+        if (active_) {
+            emitComplete(name_, detail_.c_str(), startUs_, nowMicros() - startUs_);
+        }
+    }
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* name_;
+    bool active_;
+    std::string detail_;
+    uint64_t startUs_ = 0;
+};
+
+}  // namespace trace
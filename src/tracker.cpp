@@ -0,0 +1,230 @@
+// tracker.cpp
+
+#include "tracker.h"
+
+#include "perf_stats.h"
+
+#include <algorithm>
+#include <tuple>
+
+namespace {
+
+float iou(const cv::Rect2f& a, const cv::Rect2f& b) {
+    const float x1 = std::max(a.x, b.x);
+    const float y1 = std::max(a.y, b.y);
+    const float x2 = std::min(a.x + a.width, b.x + b.width);
+    const float y2 = std::min(a.y + a.height, b.y + b.height);
+    const float inter = std::max(0.0f, x2 - x1) * std::max(0.0f, y2 - y1);
+    const float uni = a.width * a.height + b.width * b.height - inter;
+    return uni > 0.0f ? inter / uni : 0.0f;
+}
+
+// Greedy IoU matching, best pairs first. With the handful of tools in a
+// cabinet this gives the same result as Hungarian assignment in practice.
+std::vector<std::pair<size_t, size_t>> matchByIou(const std::vector<cv::Rect2f>& tracks,
+                                                  const std::vector<cv::Rect2f>& dets,
+                                                  float minIou) {
+    std::vector<std::tuple<float, size_t, size_t>> candidates;
+    for (size_t t = 0; t < tracks.size(); ++t) {
+        for (size_t d = 0; d < dets.size(); ++d) {
+            const float v = iou(tracks[t], dets[d]);
+            if (v >= minIou) candidates.emplace_back(v, t, d);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const auto& a, const auto& b) { return std::get<0>(a) > std::get<0>(b); });
+    std::vector<bool> trackUsed(tracks.size(), false);
+    std::vector<bool> detUsed(dets.size(), false);
+    std::vector<std::pair<size_t, size_t>> matches;
+    for (const auto& c : candidates) {
+        const size_t t = std::get<1>(c);
+        const size_t d = std::get<2>(c);
+        if (trackUsed[t] || detUsed[d]) continue;
+        trackUsed[t] = true;
+        detUsed[d] = true;
+        matches.emplace_back(t, d);
+    }
+    return matches;
+}
+
+}  // namespace
+
+void MultiObjectTracker::KalmanAxis::predict(float q) {
+    x += v;
+    p00 += 2 * p01 + p11 + q;
+    p01 += p11;
+    p11 += q;
+}
+
+void MultiObjectTracker::KalmanAxis::correct(float z, float r) {
+    const float y = z - x;
+    const float s = p00 + r;
+    const float k0 = p00 / s;
+    const float k1 = p01 / s;
+    x += k0 * y;
+    v += k1 * y;
+    p11 -= k1 * p01;
+    p01 -= k0 * p01;
+    p00 -= k0 * p00;
+}
+
+MultiObjectTracker::MultiObjectTracker(TrackerConfig config) : config_(config) {}
+
+void MultiObjectTracker::predictAll() {
+    for (auto& state : states_) {
+        // Noise proportional to the box height, as in SORT/ByteTrack.
+        const float h = std::max(1.0f, state.axes[3].x);
+        const float q = (h / 80.0f) * (h / 80.0f);
+        for (auto& axis : state.axes) axis.predict(q);
+        const float w = std::max(1.0f, state.axes[2].x);
+        const float hh = std::max(1.0f, state.axes[3].x);
+        state.track.box = cv::Rect2f(state.axes[0].x - w / 2, state.axes[1].x - hh / 2, w, hh);
+        state.track.obb.center = cv::Point2f(state.axes[0].x, state.axes[1].x);
+    }
+}
+
+void MultiObjectTracker::correct(TrackState& state, const DetectedObject& det) {
+    const cv::Rect2f box(det.bbox);
+    const float z[4] = {box.x + box.width / 2, box.y + box.height / 2, box.width, box.height};
+    const float r = (box.height / 20.0f) * (box.height / 20.0f);
+    for (int i = 0; i < 4; ++i) state.axes[i].correct(z[i], r);
+    const float w = std::max(1.0f, state.axes[2].x);
+    const float h = std::max(1.0f, state.axes[3].x);
+    state.track.box = cv::Rect2f(state.axes[0].x - w / 2, state.axes[1].x - h / 2, w, h);
+    // The filter runs on the axis-aligned box; the rotated box keeps the
+    // detected size and angle and follows the filtered centre.
+    state.track.oriented = det.oriented;
+    state.track.obb = det.oriented ? det.obb : cv::RotatedRect();
+    state.track.obb.center = cv::Point2f(state.axes[0].x, state.axes[1].x);
+    state.track.confidence = det.confidence;
+    state.track.hits++;
+    state.track.lostKeyframes = 0;
+    if (state.track.hits >= config_.minHits) state.activated = true;
+
+    const int votes = ++state.classVotes[det.cls];
+    if (state.track.cls.empty() || votes > state.classVotes[state.track.cls]) {
+        state.track.cls = det.cls;
+    }
+}
+
+void MultiObjectTracker::update(const DetectionResult& detections) {
+    TD_PERF_SCOPE("tracker.update");
+    predictAll();
+
+    std::vector<const DetectedObject*> high;
+    std::vector<const DetectedObject*> low;
+    for (const auto& obj : detections.objects) {
+        if (obj.confidence >= config_.highThreshold) {
+            high.push_back(&obj);
+        } else if (obj.confidence >= config_.lowThreshold) {
+            low.push_back(&obj);
+        }
+    }
+
+    std::vector<bool> matched(states_.size(), false);
+
+    // Stage 1: confident detections against every track.
+    std::vector<cv::Rect2f> trackBoxes;
+    for (const auto& state : states_) trackBoxes.push_back(state.track.box);
+    std::vector<cv::Rect2f> highBoxes;
+    for (const auto* det : high) highBoxes.push_back(cv::Rect2f(det->bbox));
+    std::vector<bool> highUsed(high.size(), false);
+    for (const auto& m : matchByIou(trackBoxes, highBoxes, config_.matchIou)) {
+        correct(states_[m.first], *high[m.second]);
+        matched[m.first] = true;
+        highUsed[m.second] = true;
+    }
+
+    // Stage 2: weak detections only keep the remaining tracks alive.
+    std::vector<size_t> remaining;
+    std::vector<cv::Rect2f> remainingBoxes;
+    for (size_t i = 0; i < states_.size(); ++i) {
+        if (!matched[i]) {
+            remaining.push_back(i);
+            remainingBoxes.push_back(states_[i].track.box);
+        }
+    }
+    std::vector<cv::Rect2f> lowBoxes;
+    for (const auto* det : low) lowBoxes.push_back(cv::Rect2f(det->bbox));
+    for (const auto& m : matchByIou(remainingBoxes, lowBoxes, config_.matchIou)) {
+        correct(states_[remaining[m.first]], *low[m.second]);
+        matched[remaining[m.first]] = true;
+    }
+
+    for (size_t i = 0; i < states_.size(); ++i) {
+        if (!matched[i]) states_[i].track.lostKeyframes++;
+    }
+    states_.erase(std::remove_if(states_.begin(), states_.end(),
+                                 [this](const TrackState& s) {
+                                     return s.track.lostKeyframes > config_.maxLostKeyframes ||
+                                            (!s.activated && s.track.lostKeyframes > 0);
+                                 }),
+                  states_.end());
+
+    // Unmatched confident detections start new tracks.
+    for (size_t d = 0; d < high.size(); ++d) {
+        if (highUsed[d]) continue;
+        TrackState state;
+        state.track.id = nextId_++;
+        const cv::Rect2f box(high[d]->bbox);
+        const float init[4] = {box.x + box.width / 2, box.y + box.height / 2, box.width, box.height};
+        const float p = (box.height / 10.0f) * (box.height / 10.0f);
+        for (int i = 0; i < 4; ++i) {
+            state.axes[i].x = init[i];
+            state.axes[i].p00 = p;
+            state.axes[i].p11 = p;
+        }
+        correct(state, *high[d]);
+        state.activated = state.activated || firstUpdate_;
+        states_.push_back(std::move(state));
+    }
+    firstUpdate_ = false;
+}
+
+void MultiObjectTracker::predict() {
+    TD_PERF_SCOPE("tracker.predict");
+    predictAll();
+    for (auto& state : states_) state.track.confidence *= config_.confidenceDecay;
+}
+
+bool MultiObjectTracker::isReported(const TrackState& state) const {
+    return state.activated && state.track.lostKeyframes <= config_.graceKeyframes;
+}
+
+DetectionResult MultiObjectTracker::trackedObjects() const {
+    DetectionResult result;
+    for (const auto& state : states_) {
+        if (!isReported(state)) continue;
+        DetectedObject obj;
+        obj.cls = state.track.cls;
+        obj.confidence = state.track.confidence;
+        obj.bbox = cv::Rect(state.track.box);
+        obj.trackId = state.track.id;
+        obj.oriented = state.track.oriented;
+        obj.obb = state.track.obb;
+        result.objects.push_back(obj);
+    }
+    return result;
+}
+
+std::map<std::string, int> MultiObjectTracker::countsByClass() const {
+    std::map<std::string, int> counts;
+    for (const auto& state : states_) {
+        if (isReported(state)) ++counts[state.track.cls];
+    }
+    return counts;
+}
+
+float MultiObjectTracker::minConfidence() const {
+    float minConf = 1.0f;
+    for (const auto& state : states_) {
+        if (isReported(state)) minConf = std::min(minConf, state.track.confidence);
+    }
+    return minConf;
+}
+
+std::vector<Track> MultiObjectTracker::tracks() const {
+    std::vector<Track> out;
+    for (const auto& state : states_) out.push_back(state.track);
+    return out;
+}
@@ -0,0 +1,112 @@
+// tracker.h
+// ByteTrack-style multi-object tracker for video mode.
+//
+// Each track carries a constant-velocity Kalman filter over the box centre
+// and size. Association is by IoU: on a keyframe, high-confidence detections
+// are matched first against all tracks, then low-confidence ones against the
+// tracks that are still unmatched (the ByteTrack trick that keeps occluded
+// tools alive; video mode runs keyframe inference down to lowThreshold for
+// this). Between keyframes the tracker only predicts, and every track's
+// confidence decays, so the caller knows when to spend a new inference.
+// The class of a track is the majority vote of its matched detections, so a
+// single misclassified frame does not change the inventory count.
+
+#pragma once
+
+#include "detector.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+struct TrackerConfig {
+    float highThreshold = 0.5f;    // detections above start / first-match tracks
+    float lowThreshold = 0.1f;     // detections above only extend existing tracks
+    float matchIou = 0.3f;         // minimum IoU for an association
+    int minHits = 2;               // matched keyframes before a track counts
+    int maxLostKeyframes = 3;      // keyframes without a match before removal
+    int graceKeyframes = 1;        // missed keyframes a tool stays counted (brief occlusion)
+    float confidenceDecay = 0.95f; // per predicted (non-key) frame
+};
+
+struct Track {
+    int id = 0;
+    std::string cls;               // majority vote
+    float confidence = 0.0f;       // last detection score, decayed while predicting
+    cv::Rect2f box;
+    int hits = 0;                  // matched keyframes
+    int lostKeyframes = 0;         // consecutive keyframes without a match
+    bool oriented = false;         // last match came from an OBB model
+    cv::RotatedRect obb;           // its rotated box, moved with the filtered centre
+};
+
+class MultiObjectTracker {
+public:
+    explicit MultiObjectTracker(TrackerConfig config = TrackerConfig());
+
+    // Keyframe: predict all tracks to this frame, then associate `detections`.
+    void update(const DetectionResult& detections);
+
+    // Non-keyframe: predict only.
+    void predict();
+
+    // Confirmed tracks (hits >= minHits, at most graceKeyframes unmatched) as a
+    // DetectionResult with trackId set; this is what video mode reports.
+    DetectionResult trackedObjects() const;
+
+    // Tool count per class over trackedObjects().
+    std::map<std::string, int> countsByClass() const;
+
+    // Lowest confidence among confirmed tracks (1 if there are none); a
+    // keyframe is due when this decays below the caller's threshold.
+    float minConfidence() const;
+
+    // All live tracks, including tentative and lost ones.
+    std::vector<Track> tracks() const;
+
+private:
+    struct KalmanAxis {
+        // Constant-velocity filter for one coordinate: state (x, v).
+        float x = 0, v = 0;
+        float p00 = 10, p01 = 0, p11 = 100;
+        void predict(float q);
+        void correct(float z, float r);
+    };
+    struct TrackState {
+        Track track;
+        KalmanAxis axes[4];   // cx, cy, w, h
+        std::map<std::string, int> classVotes;
+        bool activated = false;   // reached minHits (or was born on the first keyframe)
+    };
+
+    void predictAll();
+    void correct(TrackState& state, const DetectedObject& det);
+    bool isReported(const TrackState& state) const;
+
+    TrackerConfig config_;
+    std::vector<TrackState> states_;
+    int nextId_ = 1;
+    bool firstUpdate_ = true;
+};
+
+// Decides which video frames get a full inference: every `stride`-th frame,
+// or earlier when the tracker's confidence has decayed below
+// `minConfidence`. stride <= 1 means every frame.
+class KeyframeScheduler {
+public:
+    KeyframeScheduler(int stride, float minConfidence) : stride_(stride), minConfidence_(minConfidence) {}
+
+    bool isKeyframe(const MultiObjectTracker& tracker) {
+        const bool key = framesSinceKey_ == 0 || stride_ <= 1 || framesSinceKey_ >= stride_ ||
+                         tracker.minConfidence() < minConfidence_;
+        framesSinceKey_ = key ? 1 : framesSinceKey_ + 1;
+        return key;
+    }
+
+private:
+    int stride_;
+    float minConfidence_;
+    int framesSinceKey_ = 0;
+};
@@ -0,0 +1,331 @@
+#include "video_audit.h"
+
+#include "detector.h"
+#include "opencv_config.h"
+#include "perf_stats.h"
+#include "trace.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+#if TOOLSDETECT_HAS_VIDEOIO
+constexpr double kFallbackFps = 30.0;
+// First step back when a seek overshoots; about one GOP of typical footage.
+constexpr int64_t kSeekBackoffFrames = 64;
+
+struct FrameRecord {
+    int64_t frame = 0;
+    DetectionResult detections;
+};
+
+struct SegmentResult {
+    std::vector<FrameRecord> frames;
+    int64_t decoded = 0;
+    bool positioned = true;   // opened and seeked to the start of its range
+    bool done = false;
+};
+
+void auditSegment(const std::string& path, const AuditSegment& segment, int stride, SegmentResult& out) {
+    cv::VideoCapture cap(path);
+    if (!cap.isOpened() || !seekToFrame(cap, path, segment.begin)) {
+        // A range that cannot be reached is as lost as one that cannot be
+        // opened: report it instead of merging it as an empty range.
+        out.positioned = false;
+        return;
+    }
+    cv::Mat frame;
+    for (int64_t index = segment.begin; index < segment.end; ++index) {
+        if (index % stride != 0) {
+            TD_PERF_SCOPE("audit.grab");
+            if (!cap.grab()) {
+                break;
+            }
+            ++out.decoded;
+            continue;
+        }
+        {
+            TD_PERF_SCOPE("audit.decode");
+            if (!cap.read(frame) || frame.empty()) {
+                break;
+            }
+        }
+        ++out.decoded;
+        trace::Span span("audit.frame", std::to_string(index));
+        out.frames.push_back({index, runYoloDetect(frame)});
+    }
+}
+
+void writeDetectionRows(std::ostream& out, const FrameRecord& record, double fps) {
+    const double timeSec = static_cast<double>(record.frame) / fps;
+    if (record.detections.objects.empty()) {
+        // Keep every inferred frame in the log, even when nothing was found.
+        out << record.frame << "," << timeSec << ",,,,,,\n";
+        return;
+    }
+    for (const auto& obj : record.detections.objects) {
+        out << record.frame << "," << timeSec << "," << obj.cls << "," << obj.confidence << ","
+            << obj.bbox.x << "," << obj.bbox.y << "," << obj.bbox.width << "," << obj.bbox.height
+            << "\n";
+    }
+}
+#endif
+
+}  // namespace
+
+std::vector<AuditSegment> planAuditSegments(int64_t totalFrames, int workers, int64_t minFrames) {
+    std::vector<AuditSegment> segments;
+    if (totalFrames <= 0) {
+        segments.push_back({0, std::numeric_limits<int64_t>::max()});
+        return segments;
+    }
+    const int64_t count = std::clamp<int64_t>(totalFrames / std::max<int64_t>(1, minFrames),
+                                              1, static_cast<int64_t>(std::max(1, workers)) * 4);
+    const int64_t length = (totalFrames + count - 1) / count;
+    for (int64_t begin = 0; begin < totalFrames; begin += length) {
+        segments.push_back({begin, begin + length});
+    }
+    segments.back().end = std::numeric_limits<int64_t>::max();
+    return segments;
+}
+
+#if TOOLSDETECT_HAS_VIDEOIO
+bool seekToFrame(cv::VideoCapture& cap, const std::string& path, int64_t target) {
+    if (target == 0) {
+        return true;
+    }
+    int64_t position = -1;
+    for (int64_t back = 0;; back = std::max(kSeekBackoffFrames, back * 2)) {
+        const int64_t request = std::max<int64_t>(0, target - back);
+        cap.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(request));
+        position = static_cast<int64_t>(cap.get(cv::CAP_PROP_POS_FRAMES));
+        if (position >= 0 && position <= target) {
+            break;
+        }
+        if (position < 0 || request == 0) {
+            position = -1;
+            break;
+        }
+    }
+    if (position < 0) {
+        cap.release();
+        if (!cap.open(path)) {
+            return false;
+        }
+        position = 0;
+    }
+    for (; position < target; ++position) {
+        if (!cap.grab()) {
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+void InventoryTimeline::add(int64_t minute, const DetectionResult& detections) {
+    std::map<std::string, int> counts;
+    for (const auto& obj : detections.objects) {
+        ++counts[obj.cls];
+    }
+    Minute& m = minutes_[minute];
+    ++m.frames;
+    for (const auto& [cls, count] : counts) {
+        classes_.insert(cls);
+        ++m.framesWithCount[cls][count];
+    }
+}
+
+int InventoryTimeline::frames(int64_t minute) const {
+    auto it = minutes_.find(minute);
+    return it == minutes_.end() ? 0 : it->second.frames;
+}
+
+int InventoryTimeline::modeCount(int64_t minute, const std::string& cls) const {
+    auto it = minutes_.find(minute);
+    return it == minutes_.end() ? 0 : modeCount(it->second, cls);
+}
+
+bool InventoryTimeline::write(const fs::path& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << "minute,frames";
+    for (const auto& cls : classes_) {
+        out << "," << cls;
+    }
+    out << "\n";
+    for (const auto& [minute, m] : minutes_) {
+        out << minute << "," << m.frames;
+        for (const auto& cls : classes_) {
+            out << "," << modeCount(m, cls);
+        }
+        out << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+int InventoryTimeline::modeCount(const Minute& m, const std::string& cls) {
+    auto it = m.framesWithCount.find(cls);
+    if (it == m.framesWithCount.end()) {
+        return 0;
+    }
+    int bestCount = 0;
+    int bestFrames = m.frames;
+    for (const auto& [count, frames] : it->second) {
+        bestFrames -= frames;   // what remains are the frames with 0
+    }
+    for (const auto& [count, frames] : it->second) {
+        if (frames > bestFrames) {
+            bestCount = count;
+            bestFrames = frames;
+        }
+    }
+    return bestCount;
+}
+
+int runVideoAudit(const VideoAuditOptions& options) {
+#if !TOOLSDETECT_HAS_VIDEOIO
+    std::cerr << "[ERROR] Video audit is unavailable (OpenCV videoio not found at build time).\n";
+    return 1;
+#else
+    std::error_code ec;
+    if (!fs::is_regular_file(options.videoPath, ec)) {
+        std::cerr << "[ERROR] Video file not found: " << options.videoPath << "\n";
+        return 1;
+    }
+
+    int64_t totalFrames = 0;
+    double fps = 0.0;
+    {
+        cv::VideoCapture probe(options.videoPath);
+        if (!probe.isOpened()) {
+            std::cerr << "[ERROR] Failed to open video: " << options.videoPath << "\n";
+            return 1;
+        }
+        totalFrames = static_cast<int64_t>(probe.get(cv::CAP_PROP_FRAME_COUNT));
+        fps = probe.get(cv::CAP_PROP_FPS);
+    }
+    if (!(fps > 0.0)) {
+        std::cerr << "[WARN] Video reports no frame rate; assuming " << kFallbackFps << " fps.\n";
+        fps = kFallbackFps;
+    }
+
+    int workers = options.workers;
+    if (workers <= 0) {
+        workers = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    const int stride = std::max(1, options.frameStride);
+    const auto minFrames = static_cast<int64_t>(fps * std::max(1, options.minSegmentSeconds));
+    const std::vector<AuditSegment> segments = planAuditSegments(totalFrames, workers, minFrames);
+    workers = std::min<int>(workers, static_cast<int>(segments.size()));
+    if (totalFrames <= 0) {
+        std::cerr << "[WARN] Video does not report a frame count; auditing it on one worker.\n";
+    }
+
+    fs::create_directories(options.outDir, ec);
+    const std::string stem = fs::path(options.videoPath).stem().string();
+    const fs::path detectionsPath = fs::path(options.outDir) / (stem + "_detections.csv");
+    const fs::path timelinePath = fs::path(options.outDir) / (stem + "_timeline.csv");
+    std::ofstream detectionsOut(detectionsPath);
+    if (!detectionsOut) {
+        std::cerr << "[ERROR] Cannot write " << detectionsPath << "\n";
+        return 1;
+    }
+    detectionsOut << "frame,time_s,class,confidence,x,y,w,h\n" << std::fixed << std::setprecision(3);
+
+    std::cout << "[INFO] Auditing " << options.videoPath << " (" << totalFrames << " frames @ "
+              << fps << " fps) in " << segments.size() << " segment(s) on " << workers
+              << " worker(s), stride " << stride << "\n";
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<SegmentResult> results(segments.size());
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<size_t> nextSegment{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; ++i) {
+        threads.emplace_back([&, i]() {
+            trace::setThreadName("audit-worker-" + std::to_string(i));
+            for (size_t s = nextSegment++; s < segments.size(); s = nextSegment++) {
+                SegmentResult local;
+                auditSegment(options.videoPath, segments[s], stride, local);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    results[s] = std::move(local);
+                    results[s].done = true;
+                }
+                cv.notify_all();
+            }
+        });
+    }
+
+    // Merge in frame order as segments complete; finished segments are freed
+    // right after they are written.
+    InventoryTimeline timeline;
+    int64_t decoded = 0;
+    int64_t inferred = 0;
+    size_t failedSegments = 0;
+    for (size_t s = 0; s < segments.size(); ++s) {
+        SegmentResult segment;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]() { return results[s].done; });
+            segment = std::move(results[s]);
+            results[s] = SegmentResult();
+        }
+        if (!segment.positioned) {
+            ++failedSegments;
+        }
+        decoded += segment.decoded;
+        inferred += static_cast<int64_t>(segment.frames.size());
+        for (const auto& record : segment.frames) {
+            writeDetectionRows(detectionsOut, record, fps);
+            timeline.add(static_cast<int64_t>(static_cast<double>(record.frame) / fps / 60.0),
+                         record.detections);
+        }
+        std::cout << "[INFO] Audit: " << (s + 1) << "/" << segments.size() << " segments merged, "
+                  << inferred << " frames inferred\n";
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    const double elapsedSec =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const bool wrote = timeline.write(timelinePath) && static_cast<bool>(detectionsOut.flush());
+    if (failedSegments > 0) {
+        std::cerr << "[ERROR] " << failedSegments << " segment(s) could not be opened or seeked to.\n";
+    }
+    if (!wrote) {
+        std::cerr << "[ERROR] Failed to write audit results to " << options.outDir << "\n";
+    }
+
+    const double videoSec = static_cast<double>(decoded) / fps;
+    std::cout << "[RESULT] Audit: " << decoded << " frames (" << inferred << " inferred, "
+              << std::fixed << std::setprecision(1) << videoSec << " s of video) in " << elapsedSec
+              << " s, " << (elapsedSec > 0.0 ? videoSec / elapsedSec : 0.0) << "x real time\n"
+              << "[RESULT] " << detectionsPath.string() << "\n"
+              << "[RESULT] " << timelinePath.string() << "\n";
+    return (wrote && failedSegments == 0) ? 0 : 1;
+#endif
+}
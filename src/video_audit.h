@@ -0,0 +1,89 @@
+#pragma once
+
+#include "detector.h"
+#include "opencv_config.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// Offline audit of recorded cabinet footage (--audit <video>).
+//
+// The video is cut into contiguous frame ranges that worker threads decode
+// and run through detection in parallel, each with its own cv::VideoCapture.
+// A worker seeks to the start of its range once (the FFmpeg backend seeks to
+// the preceding keyframe and decodes forward, so the range starts exactly on
+// its first frame; a backend that overshoots is asked again for an earlier
+// position until it lands on a keyframe before the range) and then reads
+// sequentially. Frames between samples are
+// only grabbed, not converted. No highgui, no real-time pacing.
+//
+// Results are merged back in frame order into
+//   <outDir>/<stem>_detections.csv  frame,time_s,class,confidence,x,y,w,h
+//                                   (one row per box; empty class = none)
+//   <outDir>/<stem>_timeline.csv    minute,frames,<one count column per class>
+// where a timeline count is the per-class tool count seen most often among
+// the sampled frames of that minute.
+struct VideoAuditOptions {
+    std::string videoPath;
+    std::string outDir = "results";
+    int workers = 0;        // 0 = hardware_concurrency()
+    int frameStride = 1;    // run detection on every n-th frame
+    // Shortest range handed to a worker; each range pays one seek (up to a
+    // GOP of extra decoding), so very short ranges waste work.
+    int minSegmentSeconds = 20;
+};
+
+// Returns 0 on success, 1 if the video or one of its ranges cannot be opened
+// or reached, or the outputs cannot be written.
+int runVideoAudit(const VideoAuditOptions& options);
+
+// Frames [begin, end) of the source video.
+struct AuditSegment {
+    int64_t begin = 0;
+    int64_t end = 0;
+};
+
+// About four ranges per worker so a slow range near the end does not leave
+// the other cores idle, but none shorter than `minFrames`. The last range is
+// open-ended: CAP_PROP_FRAME_COUNT is an estimate for many containers, and
+// an unknown count (<= 0) gives one open-ended range.
+std::vector<AuditSegment> planAuditSegments(int64_t totalFrames, int workers, int64_t minFrames);
+
+#if TOOLSDETECT_HAS_VIDEOIO
+// Positions `cap` so the next read() returns frame `target`. Some backends
+// overshoot when the target is not a keyframe; then step the request back
+// (doubling the distance each time) until the capture lands at or before the
+// target, i.e. on an earlier keyframe, and grab forward from there. Only a
+// backend that cannot report its position is reopened from `path` and
+// decoded from the start.
+bool seekToFrame(cv::VideoCapture& cap, const std::string& path, int64_t target);
+#endif
+
+// Per-minute inventory: for each class, the tool count seen in most of the
+// minute's sampled frames (a frame without the class counts as 0; a tie
+// keeps the smaller count).
+class InventoryTimeline {
+public:
+    void add(int64_t minute, const DetectionResult& detections);
+
+    int frames(int64_t minute) const;
+    int modeCount(int64_t minute, const std::string& cls) const;
+
+    // minute,frames,<one count column per class seen>
+    bool write(const std::filesystem::path& path) const;
+
+private:
+    struct Minute {
+        int frames = 0;
+        std::map<std::string, std::map<int, int>> framesWithCount;   // class -> count -> frames
+    };
+
+    static int modeCount(const Minute& m, const std::string& cls);
+
+    std::map<int64_t, Minute> minutes_;
+    std::set<std::string> classes_;
+};
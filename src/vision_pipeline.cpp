@@ -1,4 +1,5 @@
 #include "vision_pipeline.h"
+#include "overlay.h"
 #include <iostream>
 #include <cstdio>
 
@@ -147,14 +148,14 @@ void drawToolDetections(
             b.area
         );
 
-        cv::putText(
+        // 数字与符号的字形已缓存，逐字符贴图，不再每个 blob 调用 putText
+        drawCachedText(
             canvas,
             label,
-            b.box.center + cv::Point2f(5, -5),
-            cv::FONT_HERSHEY_SIMPLEX,
+            cv::Point(static_cast<int>(b.box.center.x) + 5, static_cast<int>(b.box.center.y) - 5),
             0.5,
-            cv::Scalar(0, 255, 255),
-            1
+            1,
+            cv::Scalar(0, 255, 255)
         );
     }
 }
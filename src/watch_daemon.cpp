@@ -0,0 +1,478 @@
+#include "watch_daemon.h"
+
+#include "inventory_session.h"
+#include "logger.h"
+#include "metrics.h"
+#include "perf_stats.h"
+#include "run_control.h"
+#include "trace.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#define TOOLSDETECT_HAS_INOTIFY 1
+#else
+#define TOOLSDETECT_HAS_INOTIFY 0
+#endif
+
+namespace {
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+bool isImageExtension(std::string ext) {
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp";
+}
+
+bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() &&
+           s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// One side (before or after) of a pending pair as seen by the last scan.
+struct WatchedFile {
+    fs::path path;
+    std::uintmax_t size = 0;
+    bool settled = false;   // size unchanged since the previous scan, or
+                            // reported complete by inotify
+};
+
+struct PendingPair {
+    WatchedFile before;
+    WatchedFile after;
+    bool hasBefore = false;
+    bool hasAfter = false;
+};
+
+struct SessionJob {
+    std::string sessionId;
+    fs::path beforePath;
+    fs::path afterPath;
+    Clock::time_point readyAt;
+};
+
+// Tracks the pairs found in the watch folder and hands out each complete pair
+// exactly once. A dispatched id is forgotten once its files have left the
+// folder (moved to processed/ or failed/ by the worker).
+class PairTracker {
+public:
+    void markComplete(const std::string& fileName) { completed_.insert(fileName); }
+
+    void scan(const fs::path& dir) {
+        std::set<std::string> stillPresent;
+        std::error_code ec;
+        for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+            if (!it->is_regular_file(ec) || !isImageExtension(it->path().extension().string())) {
+                continue;
+            }
+            const std::string stem = it->path().stem().string();
+            bool isBefore = endsWith(stem, "_before");
+            bool isAfter = endsWith(stem, "_after");
+            if (!isBefore && !isAfter) {
+                continue;
+            }
+            std::string id = stem.substr(0, stem.size() - (isBefore ? 7 : 6));
+            if (id.empty()) {
+                continue;
+            }
+            if (dispatched_.count(id)) {
+                stillPresent.insert(id);
+                continue;
+            }
+
+            std::uintmax_t size = it->file_size(ec);
+            if (ec) {
+                continue;
+            }
+            PendingPair& pair = pending_[id];
+            WatchedFile& file = isBefore ? pair.before : pair.after;
+            bool& present = isBefore ? pair.hasBefore : pair.hasAfter;
+            const bool sameFile = present && file.path == it->path();
+            const bool reportedComplete =
+                completed_.erase(it->path().filename().string()) > 0;
+            file.settled = reportedComplete ||
+                           (sameFile && file.size == size && size > 0);
+            file.path = it->path();
+            file.size = size;
+            present = true;
+        }
+        completed_.clear();
+        if (ec) {
+            return;   // partial listing: keep every dispatched id
+        }
+        for (auto it = dispatched_.begin(); it != dispatched_.end();) {
+            it = stillPresent.count(*it) ? std::next(it) : dispatched_.erase(it);
+        }
+    }
+
+    std::vector<SessionJob> takeReadyPairs() {
+        std::vector<SessionJob> ready;
+        const auto now = Clock::now();
+        for (auto it = pending_.begin(); it != pending_.end();) {
+            const PendingPair& pair = it->second;
+            if (pair.hasBefore && pair.hasAfter &&
+                pair.before.settled && pair.after.settled) {
+                ready.push_back({it->first, pair.before.path, pair.after.path, now});
+                dispatched_.insert(it->first);
+                it = pending_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return ready;
+    }
+
+    // True while some pair has both sides present but not yet settled.
+    // Orphans (only one side ever dropped) do not count.
+    bool hasPendingPairs() const {
+        for (const auto& kv : pending_) {
+            if (kv.second.hasBefore && kv.second.hasAfter) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    std::map<std::string, PendingPair> pending_;
+    std::set<std::string> dispatched_;
+    std::set<std::string> completed_;
+};
+
+#if TOOLSDETECT_HAS_INOTIFY
+// Thin RAII wrapper over an inotify watch on the folder. Close/move events
+// wake the main loop immediately and mark the file complete.
+class InotifyWatch {
+public:
+    explicit InotifyWatch(const std::string& dir) {
+        fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd_ < 0) {
+            return;
+        }
+        if (inotify_add_watch(fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+    ~InotifyWatch() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+    InotifyWatch(const InotifyWatch&) = delete;
+    InotifyWatch& operator=(const InotifyWatch&) = delete;
+
+    bool valid() const { return fd_ >= 0; }
+
+    // Waits up to `timeoutMs` and reports the names of completed files.
+    void wait(int timeoutMs, PairTracker& tracker) {
+        pollfd pfd{fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, timeoutMs) <= 0 || !(pfd.revents & POLLIN)) {
+            return;
+        }
+        alignas(inotify_event) char buffer[4096];
+        while (true) {
+            ssize_t len = read(fd_, buffer, sizeof(buffer));
+            if (len <= 0) {
+                break;
+            }
+            for (char* p = buffer; p < buffer + len;) {
+                auto* ev = reinterpret_cast<inotify_event*>(p);
+                if (ev->len > 0) {
+                    tracker.markComplete(ev->name);
+                }
+                p += sizeof(inotify_event) + ev->len;
+            }
+        }
+    }
+
+private:
+    int fd_ = -1;
+};
+#endif
+
+// Moves a finished pair into `<watchDir>/<subdir>/` so a restarted daemon
+// does not process it again. Returns false (after a warning) if a file could
+// not be moved; it then stays in the folder and is skipped until restart.
+bool retirePair(const SessionJob& job, const fs::path& watchDir, const char* subdir) {
+    const fs::path target = watchDir / subdir;
+    std::error_code ec;
+    fs::create_directories(target, ec);
+    bool ok = true;
+    for (const fs::path& file : {job.beforePath, job.afterPath}) {
+        const fs::path dest = target / file.filename();
+        fs::remove(dest, ec);   // rename does not replace on Windows
+        fs::rename(file, dest, ec);
+        if (ec) {
+            std::cerr << "[WARN] Session " << job.sessionId << ": cannot move " << file
+                      << " to " << target << ": " << ec.message() << "\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+struct DaemonStats {
+    std::mutex mutex;
+    std::vector<double> latenciesMs;   // ready -> results written
+    int failed = 0;
+};
+
+// Fixed pool of session workers fed from a FIFO.
+class SessionWorkerPool {
+public:
+    SessionWorkerPool(int workers,
+                      const WatchDaemonOptions& options,
+                      Logger& logger,
+                      DaemonStats& stats)
+        : options_(options),
+          logger_(logger),
+          stats_(stats),
+          queueDepth_(metrics::gauge("toolsdetect_session_queue_depth",
+                                     "Headless sessions waiting for a worker")),
+          busyWorkers_(metrics::gauge("toolsdetect_session_workers_busy",
+                                      "Headless session workers currently running")) {
+        for (int i = 0; i < workers; ++i) {
+            threads_.emplace_back([this, i]() {
+                trace::setThreadName("session-worker-" + std::to_string(i));
+                workerLoop();
+            });
+        }
+    }
+
+    ~SessionWorkerPool() { shutdown(false); }
+
+    void submit(SessionJob job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(std::move(job));
+            queueDepth_.set(static_cast<double>(queue_.size()));
+        }
+        cv_.notify_one();
+    }
+
+    bool idle() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queue_.empty() && busy_ == 0;
+    }
+
+    // Stops the workers. With `dropQueued`, jobs not yet started are discarded
+    // and their count returned; in-flight sessions always finish.
+    size_t shutdown(bool dropQueued) {
+        size_t dropped = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                return 0;
+            }
+            stopping_ = true;
+            if (dropQueued) {
+                dropped = queue_.size();
+                queue_.clear();
+                queueDepth_.set(0.0);
+            }
+        }
+        cv_.notify_all();
+        for (auto& t : threads_) {
+            if (t.joinable()) {
+                t.join();
+            }
+        }
+        return dropped;
+    }
+
+private:
+    void workerLoop() {
+        while (true) {
+            SessionJob job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) {
+                    return;
+                }
+                job = std::move(queue_.front());
+                queue_.pop_front();
+                ++busy_;
+                queueDepth_.set(static_cast<double>(queue_.size()));
+                busyWorkers_.set(busy_);
+            }
+            runJob(job);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                --busy_;
+                busyWorkers_.set(busy_);
+            }
+        }
+    }
+
+    void runJob(const SessionJob& job) {
+        cv::Mat before;
+        cv::Mat after;
+        {
+            TD_PERF_SCOPE("session.imread");
+            before = cv::imread(job.beforePath.string());
+            after = cv::imread(job.afterPath.string());
+        }
+        if (before.empty() || after.empty()) {
+            std::cerr << "[ERROR] Session " << job.sessionId
+                      << ": failed to decode " << (before.empty() ? job.beforePath : job.afterPath)
+                      << "\n";
+            static metrics::Counter& failedSessions = metrics::counter(
+                "toolsdetect_session_failures_total", "Headless sessions whose images failed to decode");
+            failedSessions.inc();
+            retirePair(job, options_.watchDir, "failed");
+            std::lock_guard<std::mutex> lock(stats_.mutex);
+            ++stats_.failed;
+            return;
+        }
+
+        processInventorySession(before, after, job.sessionId, options_.username,
+                                logger_, options_.resultsDir, job.readyAt);
+        retirePair(job, options_.watchDir, "processed");
+
+        double latencyMs = std::chrono::duration<double, std::milli>(
+            Clock::now() - job.readyAt).count();
+        std::lock_guard<std::mutex> lock(stats_.mutex);
+        stats_.latenciesMs.push_back(latencyMs);
+    }
+
+    const WatchDaemonOptions& options_;
+    Logger& logger_;
+    DaemonStats& stats_;
+    metrics::Gauge& queueDepth_;
+    metrics::Gauge& busyWorkers_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<SessionJob> queue_;
+    std::vector<std::thread> threads_;
+    int busy_ = 0;
+    bool stopping_ = false;
+};
+
+void reportSummary(DaemonStats& stats, double elapsedSec, size_t dropped, Logger& logger) {
+    std::vector<double> lat;
+    int failed = 0;
+    {
+        std::lock_guard<std::mutex> lock(stats.mutex);
+        lat = stats.latenciesMs;
+        failed = stats.failed;
+    }
+    std::sort(lat.begin(), lat.end());
+    double mean = 0.0;
+    for (double v : lat) mean += v;
+    if (!lat.empty()) mean /= static_cast<double>(lat.size());
+    const double throughput = elapsedSec > 0.0 ? lat.size() / elapsedSec : 0.0;
+
+    std::ostringstream fields;
+    fields << std::fixed << std::setprecision(1)
+           << "sessions=" << lat.size()
+           << " failed=" << failed
+           << " dropped=" << dropped
+           << " elapsed_s=" << elapsedSec
+           << std::setprecision(3) << " throughput_per_s=" << throughput
+           << std::setprecision(1)
+           << " latency_ms_mean=" << mean
+           << " p50=" << percentile(lat, 0.50)
+           << " p95=" << percentile(lat, 0.95)
+           << " p99=" << percentile(lat, 0.99)
+           << " max=" << (lat.empty() ? 0.0 : lat.back());
+    logger.logPerfSummary("daemon", fields.str());
+}
+
+}  // namespace
+
+int runWatchDaemon(const WatchDaemonOptions& options, Logger& logger) {
+    std::error_code ec;
+    if (!fs::is_directory(options.watchDir, ec)) {
+        std::cerr << "[FATAL] Watch directory not found: " << options.watchDir << "\n";
+        return 1;
+    }
+
+    int workers = options.workers;
+    if (workers <= 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    StopSignalScope stopSignals;
+
+    PairTracker tracker;
+    DaemonStats stats;
+    SessionWorkerPool pool(workers, options, logger, stats);
+
+#if TOOLSDETECT_HAS_INOTIFY
+    std::unique_ptr<InotifyWatch> watch;
+    if (!options.forcePolling) {
+        watch = std::make_unique<InotifyWatch>(options.watchDir);
+        if (!watch->valid()) {
+            std::cerr << "[WARN] inotify unavailable, falling back to polling.\n";
+            watch.reset();
+        }
+    }
+    const bool usingInotify = watch != nullptr;
+#else
+    const bool usingInotify = false;
+#endif
+
+    std::cout << "[INFO] Headless mode: watching " << options.watchDir
+              << " (" << (usingInotify ? "inotify" : "polling")
+              << ", " << workers << " worker(s)). Press Ctrl+C to stop.\n";
+
+    const auto t_start = Clock::now();
+    while (!StopSignalScope::stopRequested()) {
+        tracker.scan(options.watchDir);
+        for (auto& job : tracker.takeReadyPairs()) {
+            std::cout << "[INFO] Queued session " << job.sessionId << "\n";
+            pool.submit(std::move(job));
+        }
+
+        if (options.exitWhenIdle && !tracker.hasPendingPairs() && pool.idle()) {
+            break;
+        }
+
+#if TOOLSDETECT_HAS_INOTIFY
+        if (usingInotify) {
+            watch->wait(options.pollIntervalMs, tracker);
+            continue;
+        }
+#endif
+        std::this_thread::sleep_for(std::chrono::milliseconds(options.pollIntervalMs));
+    }
+
+    const bool stopRequested = StopSignalScope::stopRequested();
+    if (stopRequested) {
+        std::cout << "[INFO] Stop requested, finishing in-flight sessions...\n";
+    }
+    size_t dropped = pool.shutdown(stopRequested);
+    const double elapsedSec =
+        std::chrono::duration<double>(Clock::now() - t_start).count();
+
+    reportSummary(stats, elapsedSec, dropped, logger);
+    return 0;
+}
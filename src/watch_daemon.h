@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+class Logger;
+
+// Configuration for the unattended watch-folder mode.
+struct WatchDaemonOptions {
+    std::string watchDir;
+    std::string resultsDir = "results";
+    std::string username = "daemon";
+    int workers = 0;            // 0 = hardware_concurrency()
+    int pollIntervalMs = 500;
+    bool forcePolling = false;
+    bool exitWhenIdle = false;
+};
+
+// Watches `watchDir` for image pairs named "<id>_before.<ext>" and
+// "<id>_after.<ext>" (jpg/jpeg/png/bmp) and runs each pair as an inventory
+// session on a pool of worker threads. Finished pairs are moved to
+// "<watchDir>/processed/" (or "<watchDir>/failed/" when they cannot be
+// decoded), so a restart only picks up new pairs. Uses inotify on Linux and
+// directory polling elsewhere (or when forced). Runs until SIGINT/SIGTERM, or
+// until the folder is drained when `exitWhenIdle` is set, then prints a
+// throughput and latency summary. Never touches highgui. Returns a process exit code.
+int runWatchDaemon(const WatchDaemonOptions& options, Logger& logger);
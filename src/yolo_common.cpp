@@ -0,0 +1,860 @@
+// yolo_common.cpp
+// Runtime-independent YOLO preprocessing, decoding and NMS.
+
+#include "yolo_common.h"
+
+#include "perf_stats.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+float iou(const cv::Rect& a, const cv::Rect& b) {
+    int xx1 = std::max(a.x, b.x);
+    int yy1 = std::max(a.y, b.y);
+    int xx2 = std::min(a.x + a.width, b.x + b.width);
+    int yy2 = std::min(a.y + a.height, b.y + b.height);
+    int w = std::max(0, xx2 - xx1);
+    int h = std::max(0, yy2 - yy1);
+    int inter = w * h;
+    int union_area = a.area() + b.area() - inter;
+    if (union_area <= 0) return 0.0f;
+    return static_cast<float>(inter) / static_cast<float>(union_area);
+}
+
+cv::Rect scale_coords_back(const cv::Rect& box,
+                           int orig_w,
+                           int orig_h,
+                           int input_w,
+                           int input_h) {
+    float r = std::min(static_cast<float>(input_w) / static_cast<float>(orig_w),
+                       static_cast<float>(input_h) / static_cast<float>(orig_h));
+    int new_unpad_w = static_cast<int>(std::round(orig_w * r));
+    int new_unpad_h = static_cast<int>(std::round(orig_h * r));
+    int dw = (input_w - new_unpad_w) / 2;
+    int dh = (input_h - new_unpad_h) / 2;
+
+    float x = static_cast<float>(box.x);
+    float y = static_cast<float>(box.y);
+    float w = static_cast<float>(box.width);
+    float h = static_cast<float>(box.height);
+
+    float x_no_pad = (x - static_cast<float>(dw)) / r;
+    float y_no_pad = (y - static_cast<float>(dh)) / r;
+    float w_no_pad = w / r;
+    float h_no_pad = h / r;
+
+    int x0 = std::max(0, static_cast<int>(std::round(x_no_pad)));
+    int y0 = std::max(0, static_cast<int>(std::round(y_no_pad)));
+    int x1 = std::min(orig_w, static_cast<int>(std::round(x_no_pad + w_no_pad)));
+    int y1 = std::min(orig_h, static_cast<int>(std::round(y_no_pad + h_no_pad)));
+    return cv::Rect(x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0));
+}
+
+// Maps a rotated box from letterboxed model-input coordinates back onto the
+// original image (same transform as scale_coords_back, angle unchanged).
+cv::RotatedRect scale_rotated_back(float cx, float cy, float w, float h, float angle_deg,
+                                   int orig_w, int orig_h, int input_w, int input_h) {
+    float r = std::min(static_cast<float>(input_w) / static_cast<float>(orig_w),
+                       static_cast<float>(input_h) / static_cast<float>(orig_h));
+    int dw = (input_w - static_cast<int>(std::round(orig_w * r))) / 2;
+    int dh = (input_h - static_cast<int>(std::round(orig_h * r))) / 2;
+    return cv::RotatedRect(cv::Point2f((cx - static_cast<float>(dw)) / r,
+                                       (cy - static_cast<float>(dh)) / r),
+                           cv::Size2f(w / r, h / r), angle_deg);
+}
+
+using Quad = std::array<cv::Point2f, 4>;
+
+Quad rotatedCorners(const cv::RotatedRect& rect) {
+    const float rad = rect.angle * 3.14159265358979f / 180.0f;
+    const float c = std::cos(rad);
+    const float s = std::sin(rad);
+    const float hw = rect.size.width * 0.5f;
+    const float hh = rect.size.height * 0.5f;
+    const float xs[4] = {-hw, hw, hw, -hw};
+    const float ys[4] = {-hh, -hh, hh, hh};
+    Quad q;
+    for (int i = 0; i < 4; ++i) {
+        q[i] = cv::Point2f(rect.center.x + c * xs[i] - s * ys[i],
+                           rect.center.y + s * xs[i] + c * ys[i]);
+    }
+    return q;
+}
+
+float signedArea(const cv::Point2f* pts, int n) {
+    float a = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        const cv::Point2f& p = pts[i];
+        const cv::Point2f& q = pts[(i + 1) % n];
+        a += p.x * q.y - q.x * p.y;
+    }
+    return 0.5f * a;
+}
+
+// Area of the intersection of two convex quads: Sutherland-Hodgman clipping
+// of `a` by the four edges of `b`, on fixed-size stack buffers (clipping a
+// convex n-gon by a half-plane adds at most one vertex, so 8 is enough).
+float quadIntersectionArea(const Quad& a, const Quad& b) {
+    cv::Point2f bufA[8];
+    cv::Point2f bufB[8];
+    cv::Point2f* in = bufA;
+    cv::Point2f* out = bufB;
+    int n = 4;
+    std::copy(a.begin(), a.end(), in);
+    const float orient = signedArea(b.data(), 4) >= 0.0f ? 1.0f : -1.0f;
+    for (int e = 0; e < 4 && n > 0; ++e) {
+        const cv::Point2f p0 = b[e];
+        const cv::Point2f p1 = b[(e + 1) % 4];
+        const cv::Point2f edge = p1 - p0;
+        auto side = [&](const cv::Point2f& p) {
+            return orient * (edge.x * (p.y - p0.y) - edge.y * (p.x - p0.x));
+        };
+        int m = 0;
+        for (int i = 0; i < n; ++i) {
+            const cv::Point2f& cur = in[i];
+            const cv::Point2f& next = in[(i + 1) % n];
+            const float sc = side(cur);
+            const float sn = side(next);
+            if (sc >= 0.0f) {
+                out[m++] = cur;
+            }
+            if ((sc >= 0.0f) != (sn >= 0.0f)) {
+                const float t = sc / (sc - sn);
+                out[m++] = cur + (next - cur) * t;
+            }
+        }
+        std::swap(in, out);
+        n = m;
+    }
+    return n >= 3 ? std::abs(signedArea(in, n)) : 0.0f;
+}
+
+float quadIou(const Quad& a, float areaA, const Quad& b, float areaB) {
+    const float inter = quadIntersectionArea(a, b);
+    const float uni = areaA + areaB - inter;
+    return uni > 0.0f ? inter / uni : 0.0f;
+}
+
+// Resizes `img_bgr` with unchanged aspect ratio, centred on `canvas`
+// (CV_8UC3, model input size) and padded with grey 114 like Ultralytics.
+// Returns the image area on the canvas.
+cv::Rect letterboxInto(const cv::Mat& img_bgr, cv::Mat& canvas) {
+    const int input_w = canvas.cols;
+    const int input_h = canvas.rows;
+    int orig_w = img_bgr.cols;
+    int orig_h = img_bgr.rows;
+
+    float r = std::min(static_cast<float>(input_w) / static_cast<float>(orig_w),
+                       static_cast<float>(input_h) / static_cast<float>(orig_h));
+    int new_unpad_w = static_cast<int>(std::round(orig_w * r));
+    int new_unpad_h = static_cast<int>(std::round(orig_h * r));
+    int dw = (input_w - new_unpad_w) / 2;
+    int dh = (input_h - new_unpad_h) / 2;
+
+    canvas.setTo(cv::Scalar(114, 114, 114));
+    const cv::Rect area(dw, dh, new_unpad_w, new_unpad_h);
+    cv::Mat roi = canvas(area);
+    cv::resize(img_bgr, roi, roi.size());
+    return area;
+}
+
+// ---------------- lighting normalization ----------------
+
+constexpr uint8_t kPadValue = 114;
+constexpr float kLightingTargetMean = 0.45f;   // mean brightness after the gamma
+constexpr float kMinGain = 0.6f, kMaxGain = 1.6f;
+constexpr float kMinGamma = 0.6f, kMaxGamma = 1.6f;
+constexpr int kLightingSamples = 64;           // per side of the strided sample grid
+
+std::mutex g_lightingMutex;
+LightingConfig g_lighting;
+
+// Per-channel tables, indexed by the BGR channel of the canvas.
+struct LightingLut {
+    float f[3][256];      // 0..1 tensor values
+    uint8_t u8[3][256];
+};
+
+// Scales the way convertTo(CV_32F, 1.0f / 255.0f) does, so "off" gives the
+// same tensor bits as the plain letterbox did.
+constexpr float kToUnit = 1.0f / 255.0f;
+
+const LightingLut& identityLut() {
+    static const LightingLut lut = [] {
+        LightingLut l;
+        for (int c = 0; c < 3; ++c) {
+            for (int i = 0; i < 256; ++i) {
+                l.f[c][i] = static_cast<float>(i) * kToUnit;
+                l.u8[c][i] = static_cast<uint8_t>(i);
+            }
+        }
+        return l;
+    }();
+    return lut;
+}
+
+// Gains and gamma from a kLightingSamples^2 strided sample of the image area
+// (or the reference patch) of the canvas; a few thousand pixels, so the
+// estimate costs microseconds whatever the source resolution was.
+void buildLightingLut(const cv::Mat& canvas, const cv::Rect& area, const LightingConfig& config,
+                      LightingLut& lut) {
+    cv::Rect region = area;
+    if (config.mode == LightingMode::ReferencePatch) {
+        region = cv::Rect(area.x + static_cast<int>(config.patch.x * area.width),
+                          area.y + static_cast<int>(config.patch.y * area.height),
+                          std::max(1, static_cast<int>(config.patch.width * area.width)),
+                          std::max(1, static_cast<int>(config.patch.height * area.height))) & area;
+    }
+    double sum[3] = {0.0, 0.0, 0.0};
+    size_t count = 0;
+    if (!region.empty()) {
+        const int stepX = std::max(1, region.width / kLightingSamples);
+        const int stepY = std::max(1, region.height / kLightingSamples);
+        for (int y = region.y; y < region.y + region.height; y += stepY) {
+            const uint8_t* row = canvas.ptr<uint8_t>(y);
+            for (int x = region.x; x < region.x + region.width; x += stepX) {
+                sum[0] += row[3 * x];
+                sum[1] += row[3 * x + 1];
+                sum[2] += row[3 * x + 2];
+                ++count;
+            }
+        }
+    }
+    float gain[3] = {1.0f, 1.0f, 1.0f};
+    float gamma = 1.0f;
+    if (count > 0) {
+        const double mean[3] = {sum[0] / count, sum[1] / count, sum[2] / count};
+        const double gray = (mean[0] + mean[1] + mean[2]) / 3.0;
+        for (int c = 0; c < 3; ++c) {
+            if (mean[c] > 1.0) {
+                gain[c] = std::min(kMaxGain, std::max(kMinGain, static_cast<float>(gray / mean[c])));
+            }
+        }
+        const double level = gray / 255.0;
+        if (level > 0.02 && level < 0.98) {
+            gamma = static_cast<float>(std::log(kLightingTargetMean) / std::log(level));
+            gamma = std::min(kMaxGamma, std::max(kMinGamma, gamma));
+        }
+    }
+    for (int c = 0; c < 3; ++c) {
+        for (int i = 0; i < 256; ++i) {
+            const float v = std::pow(std::min(1.0f, gain[c] * static_cast<float>(i) / 255.0f), gamma);
+            lut.f[c][i] = v;
+            lut.u8[c][i] = static_cast<uint8_t>(std::lround(v * 255.0f));
+        }
+    }
+}
+
+// Tables for this canvas: the identity when normalization is off.
+const LightingLut& lightingLutFor(const cv::Mat& canvas, const cv::Rect& area, LightingLut& storage) {
+    const LightingConfig config = lightingNormalization();
+    if (config.mode == LightingMode::Off) return identityLut();
+    TD_PERF_SCOPE("yolo.lighting");
+    buildLightingLut(canvas, area, config, storage);
+    return storage;
+}
+
+// One pass from the BGR canvas to the R, G, B planes of the tensor through
+// `lut`; the padding around `area` keeps its plain grey value.
+template <typename T>
+void canvasToPlanes(const cv::Mat& canvas, const cv::Rect& area, const T (&lut)[3][256], T pad, T* dst) {
+    const int w = canvas.cols;
+    const size_t plane = static_cast<size_t>(w) * static_cast<size_t>(canvas.rows);
+    for (int y = 0; y < canvas.rows; ++y) {
+        T* r = dst + static_cast<size_t>(y) * w;
+        T* g = r + plane;
+        T* b = g + plane;
+        if (y < area.y || y >= area.y + area.height) {
+            std::fill(r, r + w, pad);
+            std::fill(g, g + w, pad);
+            std::fill(b, b + w, pad);
+            continue;
+        }
+        const uint8_t* p = canvas.ptr<uint8_t>(y);
+        const int x0 = area.x;
+        const int x1 = area.x + area.width;
+        std::fill(r, r + x0, pad);
+        std::fill(g, g + x0, pad);
+        std::fill(b, b + x0, pad);
+        for (int x = x0; x < x1; ++x) {
+            b[x] = lut[0][p[3 * x]];
+            g[x] = lut[1][p[3 * x + 1]];
+            r[x] = lut[2][p[3 * x + 2]];
+        }
+        std::fill(r + x1, r + w, pad);
+        std::fill(g + x1, g + w, pad);
+        std::fill(b + x1, b + w, pad);
+    }
+}
+
+
+// Protobuf wire format, just enough to walk an ONNX ModelProto.
+bool readVarint(std::istream& in, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        const int c = in.get();
+        if (c == EOF) return false;
+        value |= static_cast<uint64_t>(c & 0x7f) << shift;
+        if ((c & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+// Skips one field of wire type `wireType`; false on a malformed stream.
+bool skipField(std::istream& in, uint64_t wireType) {
+    uint64_t n = 0;
+    switch (wireType) {
+        case 0: return readVarint(in, n);
+        case 1: return static_cast<bool>(in.seekg(8, std::ios::cur));
+        case 2: return readVarint(in, n) && static_cast<bool>(in.seekg(static_cast<std::streamoff>(n), std::ios::cur));
+        case 5: return static_cast<bool>(in.seekg(4, std::ios::cur));
+        default: return false;
+    }
+}
+
+// StringStringEntryProto {1: key, 2: value}.
+bool parseMetadataEntry(const std::string& entry, std::string& key, std::string& value) {
+    std::istringstream in(entry);
+    uint64_t tag = 0;
+    while (readVarint(in, tag)) {
+        const uint64_t field = tag >> 3;
+        if ((tag & 7) == 2 && (field == 1 || field == 2)) {
+            uint64_t len = 0;
+            if (!readVarint(in, len) || len > entry.size()) return false;
+            std::string text(static_cast<size_t>(len), '\0');
+            if (!in.read(&text[0], static_cast<std::streamsize>(len))) return false;
+            (field == 1 ? key : value) = std::move(text);
+        } else if (!skipField(in, tag & 7)) {
+            return false;
+        }
+    }
+    return true;
+}
+}  // namespace
+
+std::vector<std::string> getDefaultToolClassNames() {
+    return {
+        "Adjustable Wrench",
+        "Combination Wrench",
+        "Double Box-end Wrench",
+        "Double Open-end Wrench",
+        "Hammer",
+        "Level",
+        "Mallet",
+        "Nuts",
+        "Pipe Wrench",
+        "Pliers",
+        "Pliers Wrench",
+        "Screw",
+        "Screwdriver",
+        "Single Open-end Wrench",
+        "Tape Measure",
+        "washer"
+    };
+}
+
+std::wstring utf8ToWide(const std::string& utf8) {
+    constexpr char32_t kReplacement = 0xFFFD;
+    std::wstring out;
+    out.reserve(utf8.size());
+    auto put = [&out](char32_t cp) {
+        if (sizeof(wchar_t) == 2 && cp > 0xFFFF) {
+            cp -= 0x10000;
+            out.push_back(static_cast<wchar_t>(0xD800 + (cp >> 10)));
+            out.push_back(static_cast<wchar_t>(0xDC00 + (cp & 0x3FF)));
+        } else {
+            out.push_back(static_cast<wchar_t>(cp));
+        }
+    };
+    for (size_t i = 0; i < utf8.size();) {
+        const auto lead = static_cast<unsigned char>(utf8[i]);
+        const int extra = lead < 0x80 ? 0
+                          : (lead >> 5) == 0x6 ? 1
+                          : (lead >> 4) == 0xE ? 2
+                          : (lead >> 3) == 0x1E ? 3
+                                                : -1;   // stray continuation or invalid lead byte
+        if (extra < 0 || i + static_cast<size_t>(extra) >= utf8.size()) {
+            put(kReplacement);
+            ++i;
+            continue;
+        }
+        char32_t cp = extra == 0 ? lead : lead & (0x3F >> extra);
+        bool valid = true;
+        for (int k = 1; k <= extra; ++k) {
+            const auto cont = static_cast<unsigned char>(utf8[i + k]);
+            if ((cont & 0xC0) != 0x80) {
+                valid = false;
+                break;
+            }
+            cp = (cp << 6) | (cont & 0x3F);
+        }
+        // Overlong forms, surrogates and values past U+10FFFF are invalid.
+        static const char32_t kMinForLength[] = {0, 0x80, 0x800, 0x10000};
+        if (!valid || cp < kMinForLength[extra] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            put(kReplacement);
+            ++i;
+            continue;
+        }
+        put(cp);
+        i += static_cast<size_t>(extra) + 1;
+    }
+    return out;
+}
+
+std::string wideToUtf8(const std::wstring& wide) {
+    std::string out;
+    out.reserve(wide.size());
+    for (size_t i = 0; i < wide.size(); ++i) {
+        char32_t cp = static_cast<char32_t>(wide[i]);
+        if (sizeof(wchar_t) == 2 && cp >= 0xD800 && cp <= 0xDBFF && i + 1 < wide.size() &&
+            wide[i + 1] >= 0xDC00 && wide[i + 1] <= 0xDFFF) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (static_cast<char32_t>(wide[++i]) - 0xDC00);
+        } else if ((cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) {
+            cp = 0xFFFD;
+        }
+        if (cp < 0x80) {
+            out.push_back(static_cast<char>(cp));
+        } else if (cp < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else if (cp < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+    return out;
+}
+
+bool readOnnxMetadata(const std::string& modelPath, const std::string& key, std::string& value) {
+    constexpr uint64_t kMetadataPropsField = 14;          // ModelProto.metadata_props
+    constexpr uint64_t kMaxEntryBytes = 1024 * 1024;
+    std::ifstream in(modelPath, std::ios::binary);
+    uint64_t tag = 0;
+    while (in && readVarint(in, tag)) {
+        if ((tag >> 3) != kMetadataPropsField || (tag & 7) != 2) {
+            if (!skipField(in, tag & 7)) return false;
+            continue;
+        }
+        uint64_t len = 0;
+        if (!readVarint(in, len) || len > kMaxEntryBytes) return false;
+        std::string entry(static_cast<size_t>(len), '\0');
+        if (len > 0 && !in.read(&entry[0], static_cast<std::streamsize>(len))) return false;
+        std::string entryKey;
+        std::string entryValue;
+        if (parseMetadataEntry(entry, entryKey, entryValue) && entryKey == key) {
+            value = entryValue;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<int> nms(const std::vector<YoloResult>& dets, float iou_threshold) {
+    TD_PERF_SCOPE("yolo.nms");
+    std::vector<int> idxs;
+    if (dets.empty()) return idxs;
+    std::vector<int> order(dets.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = static_cast<int>(i);
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return dets[a].score > dets[b].score;
+    });
+
+    std::vector<char> suppressed(dets.size(), 0);
+    for (size_t oi = 0; oi < order.size(); ++oi) {
+        int i = order[oi];
+        if (suppressed[i]) continue;
+        idxs.push_back(i);
+        for (size_t oj = oi + 1; oj < order.size(); ++oj) {
+            int j = order[oj];
+            if (suppressed[j]) continue;
+            if (iou(dets[i].box, dets[j].box) > iou_threshold) {
+                suppressed[j] = 1;
+            }
+        }
+    }
+    return idxs;
+}
+
+float rotatedIou(const cv::RotatedRect& a, const cv::RotatedRect& b) {
+    return quadIou(rotatedCorners(a), a.size.width * a.size.height,
+                   rotatedCorners(b), b.size.width * b.size.height);
+}
+
+std::vector<int> nmsRotated(const std::vector<YoloResult>& dets, float iou_threshold) {
+    TD_PERF_SCOPE("yolo.nms_rotated");
+    std::vector<int> idxs;
+    if (dets.empty()) return idxs;
+    const size_t n = dets.size();
+    std::vector<int> order(n);
+    for (size_t i = 0; i < n; ++i) {
+        order[i] = static_cast<int>(i);
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return dets[a].score > dets[b].score;
+    });
+
+    // Corners, areas and axis-aligned bounds once per box, laid out in score
+    // order so the overlap pass below walks contiguous arrays.
+    std::vector<Quad> quads(n);
+    std::vector<float> areas(n), x1(n), y1(n), x2(n), y2(n);
+    for (size_t k = 0; k < n; ++k) {
+        const cv::RotatedRect& r = dets[order[k]].obb;
+        quads[k] = rotatedCorners(r);
+        areas[k] = r.size.width * r.size.height;
+        x1[k] = x2[k] = quads[k][0].x;
+        y1[k] = y2[k] = quads[k][0].y;
+        for (int c = 1; c < 4; ++c) {
+            x1[k] = std::min(x1[k], quads[k][c].x);
+            y1[k] = std::min(y1[k], quads[k][c].y);
+            x2[k] = std::max(x2[k], quads[k][c].x);
+            y2[k] = std::max(y2[k], quads[k][c].y);
+        }
+    }
+
+    std::vector<uint8_t> suppressed(n, 0);
+    std::vector<uint8_t> overlaps(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        if (suppressed[i]) continue;
+        idxs.push_back(order[i]);
+        const float ax1 = x1[i], ay1 = y1[i], ax2 = x2[i], ay2 = y2[i];
+        // No branches in here, so the compiler vectorizes it.
+        for (size_t j = i + 1; j < n; ++j) {
+            overlaps[j] = static_cast<uint8_t>((x1[j] < ax2) & (x2[j] > ax1) &
+                                               (y1[j] < ay2) & (y2[j] > ay1) &
+                                               (suppressed[j] == 0));
+        }
+        for (size_t j = i + 1; j < n; ++j) {
+            if (overlaps[j] && quadIou(quads[i], areas[i], quads[j], areas[j]) > iou_threshold) {
+                suppressed[j] = 1;
+            }
+        }
+    }
+    return idxs;
+}
+
+void preprocessLetterbox(const cv::Mat& img_bgr,
+                         float* dst,
+                         int input_w,
+                         int input_h) {
+    if (img_bgr.empty()) return;
+
+    cv::Mat canvas(input_h, input_w, CV_8UC3);
+    const cv::Rect area = letterboxInto(img_bgr, canvas);
+    // Swap to RGB, scale to 0..1, normalize lighting and split into planes in
+    // a single table-driven pass.
+    LightingLut storage;
+    const LightingLut& lut = lightingLutFor(canvas, area, storage);
+    canvasToPlanes(canvas, area, lut.f, static_cast<float>(kPadValue) * kToUnit, dst);
+}
+
+void preprocessLetterboxU8(const cv::Mat& img_bgr,
+                           uint8_t* dst,
+                           int input_w,
+                           int input_h,
+                           TensorLayout layout) {
+    if (img_bgr.empty()) return;
+    const bool normalize = lightingNormalization().mode != LightingMode::Off;
+
+    if (layout == TensorLayout::NHWC) {
+        // The tensor is an interleaved image already: letterbox straight into
+        // it and swap to RGB in place.
+        cv::Mat canvas(input_h, input_w, CV_8UC3, dst);
+        const cv::Rect area = letterboxInto(img_bgr, canvas);
+        if (!normalize) {
+            cv::cvtColor(canvas, canvas, cv::COLOR_BGR2RGB);
+            return;
+        }
+        LightingLut storage;
+        const LightingLut& lut = lightingLutFor(canvas, area, storage);
+        // The grey padding reads the same in BGR and RGB.
+        for (int y = area.y; y < area.y + area.height; ++y) {
+            uint8_t* p = canvas.ptr<uint8_t>(y);
+            for (int x = area.x; x < area.x + area.width; ++x) {
+                const uint8_t b = lut.u8[0][p[3 * x]];
+                p[3 * x + 1] = lut.u8[1][p[3 * x + 1]];
+                p[3 * x] = lut.u8[2][p[3 * x + 2]];
+                p[3 * x + 2] = b;
+            }
+        }
+        return;
+    }
+
+    cv::Mat canvas(input_h, input_w, CV_8UC3);
+    const cv::Rect area = letterboxInto(img_bgr, canvas);
+    if (normalize) {
+        LightingLut storage;
+        const LightingLut& lut = lightingLutFor(canvas, area, storage);
+        canvasToPlanes(canvas, area, lut.u8, kPadValue, dst);
+        return;
+    }
+    // BGR interleaved -> R, G, B planes of the tensor in one pass.
+    const size_t plane = static_cast<size_t>(input_w) * static_cast<size_t>(input_h);
+    cv::Mat planes[3] = {
+        cv::Mat(input_h, input_w, CV_8UC1, dst),
+        cv::Mat(input_h, input_w, CV_8UC1, dst + plane),
+        cv::Mat(input_h, input_w, CV_8UC1, dst + 2 * plane),
+    };
+    const int from_to[] = {2, 0, 1, 1, 0, 2};
+    cv::mixChannels(&canvas, 1, planes, 3, from_to, 3);
+}
+
+bool parseLightingSpec(const std::string& spec, LightingConfig& out) {
+    LightingConfig config;
+    if (spec == "off") {
+        config.mode = LightingMode::Off;
+    } else if (spec == "grayworld") {
+        config.mode = LightingMode::GrayWorld;
+    } else if (spec.rfind("patch:", 0) == 0) {
+        std::istringstream ss(spec.substr(6));
+        char c1 = 0, c2 = 0, c3 = 0;
+        float x = 0, y = 0, w = 0, h = 0;
+        if (!(ss >> x >> c1 >> y >> c2 >> w >> c3 >> h) || c1 != ',' || c2 != ',' || c3 != ',' ||
+            x < 0.0f || y < 0.0f || w <= 0.0f || h <= 0.0f || x + w > 1.0f || y + h > 1.0f) {
+            return false;
+        }
+        config.mode = LightingMode::ReferencePatch;
+        config.patch = cv::Rect2f(x, y, w, h);
+    } else {
+        return false;
+    }
+    out = config;
+    return true;
+}
+
+std::string describeLighting(const LightingConfig& config) {
+    switch (config.mode) {
+    case LightingMode::Off:
+        return "off";
+    case LightingMode::GrayWorld:
+        return "grayworld";
+    case LightingMode::ReferencePatch: {
+        std::ostringstream ss;
+        ss << "patch:" << config.patch.x << "," << config.patch.y << "," << config.patch.width << ","
+           << config.patch.height;
+        return ss.str();
+    }
+    }
+    return "off";
+}
+
+void setLightingNormalization(const LightingConfig& config) {
+    std::lock_guard<std::mutex> lock(g_lightingMutex);
+    g_lighting = config;
+}
+
+LightingConfig lightingNormalization() {
+    std::lock_guard<std::mutex> lock(g_lightingMutex);
+    return g_lighting;
+}
+
+void preprocess(const cv::Mat& img_bgr,
+                std::vector<float>& out_tensor,
+                int input_w,
+                int input_h) {
+    if (img_bgr.empty()) return;
+    out_tensor.resize(3 * static_cast<size_t>(input_w) * static_cast<size_t>(input_h));
+    preprocessLetterbox(img_bgr, out_tensor.data(), input_w, input_h);
+}
+
+std::vector<YoloResult> decodeYoloOutput(const float* out_data,
+                                         int64_t rows,
+                                         int64_t cols,
+                                         size_t num_classes,
+                                         float conf_thresh,
+                                         int orig_w,
+                                         int orig_h,
+                                         int input_w,
+                                         int input_h,
+                                         YoloHead head) {
+    TD_PERF_SCOPE("yolo.decode");
+    int64_t num_det = rows;
+    int64_t elem_len = cols;
+
+    bool transposed_output = false;
+    if (elem_len > num_det) {
+        // Ultralytics YOLOv8/11 exported ONNX uses [1, attrs, points].
+        transposed_output = true;
+        std::swap(num_det, elem_len);
+    }
+
+    int64_t expected_plain = 4 + static_cast<int64_t>(num_classes);
+    int64_t expected_with_obj = 5 + static_cast<int64_t>(num_classes);
+    bool has_objectness = (elem_len == expected_with_obj);
+    bool plain_layout = (elem_len == expected_plain);
+    if (!has_objectness && !plain_layout) {
+        // Fall back to whichever layout elem_len resembles more.
+        has_objectness = (elem_len > expected_plain);
+        plain_layout = !has_objectness;
+    }
+    const bool oriented = (head == YoloHead::Obb);
+    if (oriented) {
+        has_objectness = false;
+    }
+    int cls_offset = has_objectness ? 5 : 4;
+    // OBB heads carry the angle after the class scores.
+    int64_t cls_end = oriented ? std::min<int64_t>(elem_len - 1, cls_offset + static_cast<int64_t>(num_classes))
+                               : elem_len;
+
+    auto read_attr = [&](int attr_idx, int det_idx) -> float {
+        if (transposed_output) {
+            return out_data[attr_idx * num_det + det_idx];
+        }
+        return out_data[det_idx * elem_len + attr_idx];
+    };
+
+    enum class BoxEncoding { XYWH, XYXY };
+    auto infer_box_encoding = [&](int64_t max_check) -> BoxEncoding {
+        int64_t sample_count = std::min<int64_t>(num_det, max_check);
+        if (sample_count <= 0) {
+            return BoxEncoding::XYWH;
+        }
+        int xyxy_votes = 0;
+        for (int64_t i = 0; i < sample_count; ++i) {
+            float x0 = read_attr(0, static_cast<int>(i));
+            float y0 = read_attr(1, static_cast<int>(i));
+            float x1 = read_attr(2, static_cast<int>(i));
+            float y1 = read_attr(3, static_cast<int>(i));
+            if (x1 >= x0 && y1 >= y0) {
+                xyxy_votes++;
+            }
+        }
+        if (xyxy_votes * 2 >= sample_count) {
+            return BoxEncoding::XYXY;
+        }
+        return BoxEncoding::XYWH;
+    };
+    BoxEncoding box_encoding = oriented ? BoxEncoding::XYWH : infer_box_encoding(64);
+
+    std::vector<YoloResult> candidates;
+    candidates.reserve(static_cast<size_t>(num_det));
+
+    for (int64_t i = 0; i < num_det; ++i) {
+        float raw0 = read_attr(0, static_cast<int>(i));
+        float raw1 = read_attr(1, static_cast<int>(i));
+        float raw2 = read_attr(2, static_cast<int>(i));
+        float raw3 = read_attr(3, static_cast<int>(i));
+        float obj_conf = has_objectness ? read_attr(4, static_cast<int>(i)) : 1.0f;
+
+        float best_class_conf = 0.0f;
+        int best_class_id = -1;
+        for (int64_t c = cls_offset; c < cls_end; ++c) {
+            float cls_conf = read_attr(static_cast<int>(c), static_cast<int>(i));
+            if (cls_conf > best_class_conf) {
+                best_class_conf = cls_conf;
+                best_class_id = static_cast<int>(c - cls_offset);
+            }
+        }
+
+        float final_conf = obj_conf * best_class_conf;
+        if (final_conf < conf_thresh) continue;
+
+        if (oriented) {
+            const float angle = read_attr(static_cast<int>(cls_end), static_cast<int>(i));
+            if (raw2 <= 0.0f || raw3 <= 0.0f) {
+                continue;
+            }
+            YoloResult r;
+            r.class_id = best_class_id;
+            r.score = final_conf;
+            r.oriented = true;
+            r.obb = scale_rotated_back(raw0, raw1, raw2, raw3, angle * 180.0f / 3.14159265358979f,
+                                       orig_w, orig_h, input_w, input_h);
+            const Quad q = rotatedCorners(r.obb);
+            float bx1 = q[0].x, by1 = q[0].y, bx2 = bx1, by2 = by1;
+            for (const auto& p : q) {
+                bx1 = std::min(bx1, p.x);
+                by1 = std::min(by1, p.y);
+                bx2 = std::max(bx2, p.x);
+                by2 = std::max(by2, p.y);
+            }
+            const int left = std::max(0, static_cast<int>(std::floor(bx1)));
+            const int top = std::max(0, static_cast<int>(std::floor(by1)));
+            const int right = std::min(orig_w, static_cast<int>(std::ceil(bx2)));
+            const int bottom = std::min(orig_h, static_cast<int>(std::ceil(by2)));
+            r.box = cv::Rect(left, top, std::max(0, right - left), std::max(0, bottom - top));
+            candidates.push_back(r);
+            continue;
+        }
+
+        cv::Rect box;
+        if (box_encoding == BoxEncoding::XYXY) {
+            float x0 = raw0;
+            float y0 = raw1;
+            float x1 = raw2;
+            float y1 = raw3;
+            if (x1 <= x0 || y1 <= y0) {
+                continue;
+            }
+            box = cv::Rect(
+                static_cast<int>(std::round(x0)),
+                static_cast<int>(std::round(y0)),
+                static_cast<int>(std::round(x1 - x0)),
+                static_cast<int>(std::round(y1 - y0))
+            );
+        } else {
+            float cx = raw0;
+            float cy = raw1;
+            float w  = raw2;
+            float h  = raw3;
+            float x = cx - w * 0.5f;
+            float y = cy - h * 0.5f;
+            box = cv::Rect(
+                static_cast<int>(std::round(x)),
+                static_cast<int>(std::round(y)),
+                static_cast<int>(std::round(w)),
+                static_cast<int>(std::round(h))
+            );
+        }
+
+        cv::Rect box_orig = scale_coords_back(box, orig_w, orig_h, input_w, input_h);
+
+        YoloResult r;
+        r.class_id = best_class_id;
+        r.score = final_conf;
+        r.box = box_orig;
+        candidates.push_back(r);
+    }
+
+    return candidates;
+}
+
+std::vector<YoloResult> postprocessYoloOutput(const float* out_data,
+                                              int64_t rows,
+                                              int64_t cols,
+                                              size_t num_classes,
+                                              float conf_thresh,
+                                              float nms_thresh,
+                                              int orig_w,
+                                              int orig_h,
+                                              int input_w,
+                                              int input_h,
+                                              YoloHead head) {
+    std::vector<YoloResult> candidates = decodeYoloOutput(
+        out_data, rows, cols, num_classes, conf_thresh,
+        orig_w, orig_h, input_w, input_h, head);
+
+    std::vector<int> keep = head == YoloHead::Obb ? nmsRotated(candidates, nms_thresh)
+                                                  : nms(candidates, nms_thresh);
+    std::vector<YoloResult> results;
+    results.reserve(keep.size());
+    for (int idx : keep) {
+        results.push_back(candidates[idx]);
+    }
+    return results;
+}
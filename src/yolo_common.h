@@ -0,0 +1,136 @@
+// yolo_common.h
+// Runtime-independent parts of the YOLO pipeline: default configuration,
+// letterbox preprocessing, output decoding and NMS. Nothing here depends on
+// ONNX Runtime, so clients and tools can use it without linking ORT.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Default model/runtime configuration.
+inline constexpr int kYoloInputWidth  = 640;
+inline constexpr int kYoloInputHeight = 640;
+inline constexpr float kYoloConfidenceThreshold = 0.50f; // 0.25f
+inline constexpr float kYoloNmsThreshold        = 0.45f;
+inline const std::wstring kDefaultModelPath =
+    L"F:\\ultralytics-main\\ToolsDetect\\train35\\weights\\best.onnx";
+
+struct YoloResult {
+    int class_id = -1;
+    float score = 0.0f;
+    cv::Rect box;               // axis-aligned; for OBB models the bounds of `obb`
+    bool oriented = false;      // `obb` is valid (YOLO-OBB model)
+    cv::RotatedRect obb;        // angle in degrees, like cv::minAreaRect
+};
+
+// Output head of the exported model. Detect: [cx,cy,w,h,(obj),classes...];
+// Obb (Ultralytics task=obb): [cx,cy,w,h,classes...,angle] with the angle in
+// radians. Both have the same attribute count as a detect head with
+// objectness, so the head has to come from the model metadata.
+enum class YoloHead { Detect, Obb };
+
+// Model paths are std::wstring (ORT's path type on Windows); everywhere else
+// paths are UTF-8 std::string. wchar_t is UTF-16 on Windows and UTF-32
+// elsewhere. Invalid sequences become U+FFFD instead of being truncated.
+std::wstring utf8ToWide(const std::string& utf8);
+std::string wideToUtf8(const std::wstring& wide);
+
+// Looks up `key` in the metadata_props of an ONNX model file without a
+// protobuf dependency (only the top-level fields are scanned; the graph is
+// skipped). Runtimes without a metadata API use it to find the head, e.g.
+// "task" == "obb". False if the file cannot be read or has no such key.
+bool readOnnxMetadata(const std::string& modelPath, const std::string& key, std::string& value);
+
+// Returns the dataset class-name list (ToolsDetect).
+std::vector<std::string> getDefaultToolClassNames();
+
+// Letterboxes `img_bgr` to input_w x input_h and writes normalized RGB planes
+// (CHW, 0..1) to `dst`, which must hold 3 * input_w * input_h floats.
+void preprocessLetterbox(const cv::Mat& img_bgr,
+                         float* dst,
+                         int input_w,
+                         int input_h);
+
+// Lighting normalization fused into the letterbox pass (--lighting). Per-
+// channel gains (gray world, or a neutral reference patch) and a gamma that
+// brings the mean brightness to a fixed target are estimated from a strided
+// sample of the letterboxed image and applied through lookup tables while
+// the tensor is written, so there is no extra full-image pass.
+enum class LightingMode { Off, GrayWorld, ReferencePatch };
+
+struct LightingConfig {
+    LightingMode mode = LightingMode::Off;
+    // ReferencePatch: a grey or white reference in the cabinet, in 0..1
+    // coordinates of the original image.
+    cv::Rect2f patch;
+};
+
+// "off", "grayworld" or "patch:x,y,w,h" (0..1 image coordinates).
+bool parseLightingSpec(const std::string& spec, LightingConfig& out);
+std::string describeLighting(const LightingConfig& config);
+
+// Process-wide setting used by every preprocess*() call; off by default.
+void setLightingNormalization(const LightingConfig& config);
+LightingConfig lightingNormalization();
+
+enum class TensorLayout { NCHW, NHWC };
+
+// Same letterbox for models that take uint8 RGB input and normalize inside
+// the graph (tools/wrap_uint8_input.py): writes raw bytes in `layout`, a
+// quarter of the float tensor and no conversion pass. `dst` must hold
+// 3 * input_w * input_h bytes.
+void preprocessLetterboxU8(const cv::Mat& img_bgr,
+                           uint8_t* dst,
+                           int input_w,
+                           int input_h,
+                           TensorLayout layout);
+
+// Vector convenience wrapper around preprocessLetterbox().
+void preprocess(const cv::Mat& img_bgr,
+                std::vector<float>& out_tensor,
+                int input_w,
+                int input_h);
+
+// Decodes one image's raw YOLO output into boxes in original-image
+// coordinates (before NMS). `rows`/`cols` are the two trailing output dims;
+// both [N, attrs] and the Ultralytics [attrs, N] layouts are accepted.
+std::vector<YoloResult> decodeYoloOutput(const float* out_data,
+                                         int64_t rows,
+                                         int64_t cols,
+                                         size_t num_classes,
+                                         float conf_thresh,
+                                         int orig_w,
+                                         int orig_h,
+                                         int input_w,
+                                         int input_h,
+                                         YoloHead head = YoloHead::Detect);
+
+// Class-agnostic greedy NMS. Returns indices of the kept detections.
+std::vector<int> nms(const std::vector<YoloResult>& dets, float iou_threshold);
+
+// Intersection over union of two rotated rectangles (convex polygon
+// clipping; exact for rectangles).
+float rotatedIou(const cv::RotatedRect& a, const cv::RotatedRect& b);
+
+// nms() on the `obb` of each detection. Pairs whose axis-aligned bounds do
+// not overlap are rejected in a branch-free pass over all remaining
+// candidates before any polygon clipping, so diagonal tools lying side by
+// side are no longer suppressed by their overlapping bounding boxes.
+std::vector<int> nmsRotated(const std::vector<YoloResult>& dets, float iou_threshold);
+
+// decodeYoloOutput() followed by nms() (nmsRotated() for YoloHead::Obb).
+std::vector<YoloResult> postprocessYoloOutput(const float* out_data,
+                                              int64_t rows,
+                                              int64_t cols,
+                                              size_t num_classes,
+                                              float conf_thresh,
+                                              float nms_thresh,
+                                              int orig_w,
+                                              int orig_h,
+                                              int input_w,
+                                              int input_h,
+                                              YoloHead head = YoloHead::Detect);
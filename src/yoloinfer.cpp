@@ -1,155 +1,120 @@
 // yoloinfer.cpp
 // ONNX Runtime + OpenCV YOLO inference helper.
 
+#include "detector_backend.h"
+
+#if TOOLSDETECT_HAS_ONNXRUNTIME
+
 #include "yoloinfer.h"
 
+#include "metrics.h"
+#include "perf_stats.h"
+#include "sysinfo.h"
+#include "trace.h"
+
 #include <algorithm>
 #include <array>
-#include <cmath>
-#include <cstring>
+#include <chrono>
+#include <filesystem>
 #include <iostream>
-#include <limits>
+#include <mutex>
 #include <stdexcept>
 #include <utility>
 
 namespace {
 
-float iou(const cv::Rect& a, const cv::Rect& b) {
-    int xx1 = std::max(a.x, b.x);
-    int yy1 = std::max(a.y, b.y);
-    int xx2 = std::min(a.x + a.width, b.x + b.width);
-    int yy2 = std::min(a.y + a.height, b.y + b.height);
-    int w = std::max(0, xx2 - xx1);
-    int h = std::max(0, yy2 - yy1);
-    int inter = w * h;
-    int union_area = a.area() + b.area() - inter;
-    if (union_area <= 0) return 0.0f;
-    return static_cast<float>(inter) / static_cast<float>(union_area);
+// ORTCHAR_T is wchar_t on Windows and char elsewhere.
+std::basic_string<ORTCHAR_T> toOrtString(const std::wstring& s) {
+#if defined(_WIN32)
+    return s;
+#else
+    return wideToUtf8(s);
+#endif
 }
 
-std::vector<int> nms(const std::vector<YoloResult>& dets, float iou_threshold) {
-    std::vector<int> idxs;
-    if (dets.empty()) return idxs;
-    std::vector<int> order(dets.size());
-    for (size_t i = 0; i < order.size(); ++i) {
-        order[i] = static_cast<int>(i);
-    }
-    std::sort(order.begin(), order.end(), [&](int a, int b) {
-        return dets[a].score > dets[b].score;
-    });
-
-    std::vector<char> suppressed(dets.size(), 0);
-    for (size_t oi = 0; oi < order.size(); ++oi) {
-        int i = order[oi];
-        if (suppressed[i]) continue;
-        idxs.push_back(i);
-        for (size_t oj = oi + 1; oj < order.size(); ++oj) {
-            int j = order[oj];
-            if (suppressed[j]) continue;
-            if (iou(dets[i].box, dets[j].box) > iou_threshold) {
-                suppressed[j] = 1;
-            }
-        }
-    }
-    return idxs;
+// One Env per process, as ORT recommends; allocators registered on it are
+// shared by every session that opts in with session.use_env_allocators.
+Ort::Env& processEnv() {
+    static Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "yoloinfer");
+    return env;
 }
 
-void preprocess(const cv::Mat& img_bgr,
-                std::vector<float>& out_tensor,
-                int input_w,
-                int input_h) {
-    if (img_bgr.empty()) return;
-
-    int orig_w = img_bgr.cols;
-    int orig_h = img_bgr.rows;
-
-    float r = std::min(static_cast<float>(input_w) / static_cast<float>(orig_w),
-                       static_cast<float>(input_h) / static_cast<float>(orig_h));
-    int new_unpad_w = static_cast<int>(std::round(orig_w * r));
-    int new_unpad_h = static_cast<int>(std::round(orig_h * r));
-
-    cv::Mat resized;
-    cv::resize(img_bgr, resized, cv::Size(new_unpad_w, new_unpad_h));
-
-    cv::Mat canvas(input_h, input_w, CV_8UC3, cv::Scalar(114, 114, 114));
-    int dw = (input_w - new_unpad_w) / 2;
-    int dh = (input_h - new_unpad_h) / 2;
-    resized.copyTo(canvas(cv::Rect(dw, dh, new_unpad_w, new_unpad_h)));
-
-    cv::Mat img_rgb;
-    cv::cvtColor(canvas, img_rgb, cv::COLOR_BGR2RGB);
-    img_rgb.convertTo(img_rgb, CV_32F, 1.0f / 255.0f);
+// Registers the shared CPU arena for low-memory sessions once per process.
+// It grows by exactly what is requested instead of doubling, and together
+// with the per-run shrinkage (see inferBatchAtSize) drops back to what the
+// model needs between sessions.
+void registerSharedArena(Ort::Env& env) {
+    static std::once_flag once;
+    std::call_once(once, [&env]() {
+        const Ort::MemoryInfo cpu = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+        const int kSameAsRequested = 1;
+        Ort::ArenaCfg arena(0 /* no hard limit */, kSameAsRequested, -1, -1);
+        env.CreateAndRegisterAllocator(cpu, arena);
+    });
+}
 
-    std::vector<cv::Mat> channels(3);
-    cv::split(img_rgb, channels);
+std::filesystem::path fsPath(const std::wstring& path) {
+    return std::filesystem::u8path(wideToUtf8(path));
+}
 
-    size_t img_size = static_cast<size_t>(input_w) * static_cast<size_t>(input_h);
-    out_tensor.resize(3 * img_size);
-    for (int c = 0; c < 3; ++c) {
-        float* dst = out_tensor.data() + c * img_size;
-        std::memcpy(dst, channels[c].data, img_size * sizeof(float));
+// ORT only uses a mapped model in place (session.use_ort_model_bytes_directly)
+// when it is in ORT format; a .onnx mapping is still parsed into private
+// tensors. Low-memory mode therefore converts x.onnx to x.ort next to it
+// once, and reuses it while it is newer than the source. Falls back to the
+// .onnx model when the conversion fails (e.g. a read-only model directory).
+std::wstring lowMemoryModelPath(Ort::Env& env, const std::wstring& modelPath) {
+    namespace fs = std::filesystem;
+    const std::wstring kOnnx = L".onnx";
+    if (modelPath.size() <= kOnnx.size() ||
+        modelPath.compare(modelPath.size() - kOnnx.size(), kOnnx.size(), kOnnx) != 0) {
+        return modelPath;   // already .ort (or something ORT detects itself)
+    }
+    const std::wstring ortPath = modelPath.substr(0, modelPath.size() - kOnnx.size()) + L".ort";
+
+    std::error_code ec;
+    const auto onnxTime = fs::last_write_time(fsPath(modelPath), ec);
+    if (ec) return modelPath;
+    const auto ortTime = fs::last_write_time(fsPath(ortPath), ec);
+    if (!ec && ortTime >= onnxTime) return ortPath;
+
+    const std::wstring tmpPath = ortPath + L".tmp" +
+        std::to_wstring(std::chrono::steady_clock::now().time_since_epoch().count());
+    try {
+        TD_PERF_SCOPE("model.ort_convert");
+        Ort::SessionOptions options;
+        options.SetIntraOpNumThreads(1);
+        // Extended, not all: the saved graph must stay hardware-independent.
+        options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+        options.SetOptimizedModelFilePath(toOrtString(tmpPath).c_str());
+        options.AddConfigEntry("session.save_model_format", "ORT");
+        const auto source = toOrtString(modelPath);
+        Ort::Session converter(env, source.c_str(), options);   // writes tmpPath
+        fs::rename(fsPath(tmpPath), fsPath(ortPath));
+        std::cerr << "[INFO] Converted the model to ORT format for low-memory mode: "
+                  << wideToUtf8(ortPath) << "\n";
+        return ortPath;
+    } catch (const std::exception& e) {
+        fs::remove(fsPath(tmpPath), ec);
+        std::cerr << "[WARN] Could not convert " << wideToUtf8(modelPath)
+                  << " to ORT format (" << e.what() << "); its weights will not be shared\n";
+        return modelPath;
     }
 }
 
-cv::Rect scale_coords_back(const cv::Rect& box,
-                           int orig_w,
-                           int orig_h,
-                           int input_w,
-                           int input_h) {
-    float r = std::min(static_cast<float>(input_w) / static_cast<float>(orig_w),
-                       static_cast<float>(input_h) / static_cast<float>(orig_h));
-    int new_unpad_w = static_cast<int>(std::round(orig_w * r));
-    int new_unpad_h = static_cast<int>(std::round(orig_h * r));
-    int dw = (input_w - new_unpad_w) / 2;
-    int dh = (input_h - new_unpad_h) / 2;
-
-    float x = static_cast<float>(box.x);
-    float y = static_cast<float>(box.y);
-    float w = static_cast<float>(box.width);
-    float h = static_cast<float>(box.height);
-
-    float x_no_pad = (x - static_cast<float>(dw)) / r;
-    float y_no_pad = (y - static_cast<float>(dh)) / r;
-    float w_no_pad = w / r;
-    float h_no_pad = h / r;
-
-    int x0 = std::max(0, static_cast<int>(std::round(x_no_pad)));
-    int y0 = std::max(0, static_cast<int>(std::round(y_no_pad)));
-    int x1 = std::min(orig_w, static_cast<int>(std::round(x_no_pad + w_no_pad)));
-    int y1 = std::min(orig_h, static_cast<int>(std::round(y_no_pad + h_no_pad)));
-    return cv::Rect(x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0));
+double toMiB(uint64_t bytes) {
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
 }
 
 }  // namespace
 
-std::vector<std::string> getDefaultToolClassNames() {
-    return {
-        "Adjustable Wrench",
-        "Combination Wrench",
-        "Double Box-end Wrench",
-        "Double Open-end Wrench",
-        "Hammer",
-        "Level",
-        "Mallet",
-        "Nuts",
-        "Pipe Wrench",
-        "Pliers",
-        "Pliers Wrench",
-        "Screw",
-        "Screwdriver",
-        "Single Open-end Wrench",
-        "Tape Measure",
-        "washer"
-    };
-}
-
 YoloInfer::YoloInfer(const std::wstring& model_path,
                      int input_w,
                      int input_h,
                      float conf_thresh,
                      float nms_thresh,
-                     std::vector<std::string> class_names)
-    : env_(ORT_LOGGING_LEVEL_WARNING, "yoloinfer"),
+                     std::vector<std::string> class_names,
+                     bool low_memory)
+    : env_(processEnv()),
       session_(nullptr),
       allocator_(std::make_unique<Ort::AllocatorWithDefaultOptions>()),
       input_w_(input_w),
@@ -157,12 +122,42 @@ YoloInfer::YoloInfer(const std::wstring& model_path,
       conf_thresh_(conf_thresh),
       nms_thresh_(nms_thresh),
       class_names_(std::move(class_names)),
-      model_path_(model_path) {
+      model_path_(model_path),
+      low_memory_(low_memory) {
+    const auto t_load = std::chrono::steady_clock::now();
     Ort::SessionOptions session_options;
     session_options.SetIntraOpNumThreads(2);
     session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
 
-    session_ = std::make_unique<Ort::Session>(env_, model_path_.c_str(), session_options);
+    // In --trace-ort mode ORT's own per-operator profile (including its
+    // intra-op thread pool) is merged into the trace when tracing stops.
+    const bool profiling = trace::ortProfilingRequested();
+    if (profiling) {
+        session_options.EnableProfiling(toOrtString(L"toolsdetect_ort").c_str());
+    }
+
+    if (low_memory_) {
+        // ORT-format models run straight from the mapping, so the weight
+        // pages stay shared, clean and evictable.
+        const std::wstring load_path = lowMemoryModelPath(env_, model_path_);
+        if (!model_map_.open(wideToUtf8(load_path))) {
+            throw std::runtime_error("Failed to map the model file.");
+        }
+        session_options.AddConfigEntry("session.use_ort_model_bytes_directly", "1");
+        session_options.AddConfigEntry("session.use_ort_model_bytes_for_initializers", "1");
+        // Planned activation buffers: one allocation per run instead of one
+        // per tensor. ORT keeps a plan per input shape: one for a fixed-size
+        // model, and for a dynamic-shape one driven by --video-budget-ms one
+        // per size on the controller's short ladder (four by default), each
+        // built on the first run at that size.
+        session_options.EnableMemPattern();
+        registerSharedArena(env_);
+        session_options.AddConfigEntry("session.use_env_allocators", "1");
+        session_ = std::make_unique<Ort::Session>(env_, model_map_.data(), model_map_.size(), session_options);
+    } else {
+        const auto ort_model_path = toOrtString(model_path_);
+        session_ = std::make_unique<Ort::Session>(env_, ort_model_path.c_str(), session_options);
+    }
 
     size_t in_count = session_->GetInputCount();
     if (in_count == 0) {
@@ -176,9 +171,80 @@ YoloInfer::YoloInfer(const std::wstring& model_path,
     }
     output_name_ = session_->GetOutputNameAllocated(0, *allocator_).get();
 
+    Ort::TypeInfo in_type_info = session_->GetInputTypeInfo(0);
+    auto in_tensor_info = in_type_info.GetTensorTypeAndShapeInfo();
+    std::vector<int64_t> input_shape = in_tensor_info.GetShape();
+    dynamic_batch_ = !input_shape.empty() && input_shape[0] < 0;
+
+    switch (in_tensor_info.GetElementType()) {
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+        uint8_input_ = false;
+        break;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+        uint8_input_ = true;
+        break;
+    default:
+        throw std::runtime_error("Unsupported model input type (expected float32 or uint8).");
+    }
+    // [N,H,W,3] vs [N,3,H,W]; only uint8 models exported by
+    // wrap_uint8_input.py --layout nhwc use the former.
+    if (input_shape.size() == 4 && input_shape[3] == 3 && input_shape[1] != 3) {
+        if (!uint8_input_) {
+            throw std::runtime_error("NHWC float input is not supported; use NCHW or a uint8 wrapper.");
+        }
+        input_layout_ = TensorLayout::NHWC;
+    }
+    if (input_shape.size() == 4) {
+        const int64_t h = input_shape[input_layout_ == TensorLayout::NHWC ? 1 : 2];
+        const int64_t w = input_shape[input_layout_ == TensorLayout::NHWC ? 2 : 3];
+        dynamic_input_size_ = h < 0 && w < 0;
+        // A fixed-size export knows its size better than the caller.
+        if (h > 0 && w > 0) {
+            input_h_ = static_cast<int>(h);
+            input_w_ = static_cast<int>(w);
+        }
+    }
+
     Ort::TypeInfo out_type_info = session_->GetOutputTypeInfo(0);
     auto tensor_info = out_type_info.GetTensorTypeAndShapeInfo();
     output_shape_ = tensor_info.GetShape();
+
+    // Ultralytics writes the task into the ONNX metadata; an OBB head is
+    // indistinguishable from a detect head with objectness by shape alone.
+    Ort::ModelMetadata metadata = session_->GetModelMetadata();
+    auto task = metadata.LookupCustomMetadataMapAllocated("task", *allocator_);
+    if (task && std::string(task.get()) == "obb") {
+        head_ = YoloHead::Obb;
+    }
+
+    metrics::gauge("toolsdetect_model_load_seconds", "Time to create the last ONNX Runtime session")
+        .set(std::chrono::duration<double>(std::chrono::steady_clock::now() - t_load).count());
+    if (uint8_input_) {
+        std::cerr << "[INFO] Model takes uint8 "
+                  << (input_layout_ == TensorLayout::NHWC ? "NHWC" : "NCHW") << " input\n";
+    }
+    if (head_ == YoloHead::Obb) {
+        std::cerr << "[INFO] Model is an oriented-box (OBB) export\n";
+    }
+    std::cerr << "[INFO] Model loaded" << (low_memory_ ? " (low-memory mode)" : "") << ", RSS "
+              << toMiB(currentRssBytes()) << " MiB, peak " << toMiB(peakRssBytes()) << " MiB\n";
+
+    // Last, so a constructor that throws leaves no callback behind; the
+    // destructor unregisters it, waiting out a trace::stop() in progress.
+    if (profiling) {
+        profile_token_ = trace::registerExternalProfile([this]() {
+            trace::ExternalProfile profile;
+            profile.startNs = session_->GetProfilingStartTimeNs();
+            profile.path = session_->EndProfilingAllocated(*allocator_).get();
+            return profile;
+        });
+    }
+}
+
+YoloInfer::~YoloInfer() {
+    if (profile_token_ != 0) {
+        trace::unregisterExternalProfile(profile_token_);
+    }
 }
 
 std::vector<YoloResult> YoloInfer::infer(const std::string& image_path) {
@@ -190,183 +256,113 @@ std::vector<YoloResult> YoloInfer::infer(const std::string& image_path) {
     return infer(img);
 }
 
-std::vector<YoloResult> YoloInfer::infer(const cv::Mat& image) {
-    if (image.empty()) return {};
+std::vector<std::vector<YoloResult>> YoloInfer::inferBatch(const std::vector<cv::Mat>& images) {
+    return inferBatchAtSize(images, 0);
+}
 
-    int orig_w = image.cols;
-    int orig_h = image.rows;
+std::vector<std::vector<YoloResult>> YoloInfer::inferBatchAtSize(const std::vector<cv::Mat>& images,
+                                                                 int inputSize) {
+    std::vector<std::vector<YoloResult>> results(images.size());
+    int input_w = input_w_;
+    int input_h = input_h_;
+    if (inputSize > 0 && dynamic_input_size_ && inputSize % 32 == 0) {
+        input_w = inputSize;
+        input_h = inputSize;
+    }
 
-    std::vector<float> input_tensor_values;
-    preprocess(image, input_tensor_values, input_w_, input_h_);
-    std::array<int64_t, 4> input_shape = {1, 3, input_h_, input_w_};
+    // Only non-empty images go to the model; empty ones keep an empty result.
+    std::vector<size_t> valid;
+    valid.reserve(images.size());
+    for (size_t i = 0; i < images.size(); ++i) {
+        if (!images[i].empty()) valid.push_back(i);
+    }
+    if (valid.empty()) return results;
 
-    Ort::MemoryInfo mem_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-    Ort::Value input_tensor = Ort::Value::CreateTensor<float>(
-        mem_info,
-        input_tensor_values.data(),
-        input_tensor_values.size(),
-        input_shape.data(),
-        input_shape.size()
-    );
+    const size_t per_image = 3 * static_cast<size_t>(input_w) * static_cast<size_t>(input_h);
+    const size_t run_batch = dynamic_batch_ ? valid.size() : 1;
 
+    Ort::MemoryInfo mem_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
     const char* input_names[] = { input_name_.c_str() };
     const char* output_names[] = { output_name_.c_str() };
-
-    auto output_tensors = session_->Run(Ort::RunOptions{ nullptr },
-                                        input_names, &input_tensor, 1,
-                                        output_names, 1);
-    if (output_tensors.empty()) return {};
-
-    auto& out_tensor = output_tensors[0];
-    auto out_info = out_tensor.GetTensorTypeAndShapeInfo();
-    std::vector<int64_t> shape = out_info.GetShape();
-
-    if (shape.size() != 3) {
-        if (shape.size() == 2) {
-            shape.insert(shape.begin(), 1);
-        } else {
-            throw std::runtime_error("Unexpected output tensor shape rank (expected 3).");
-        }
-    }
-
-    int64_t num_det = shape[1];
-    int64_t elem_len = shape[2];
-
-    bool transposed_output = false;
-    if (elem_len > num_det) {
-        // Ultralytics YOLOv8/11 exported ONNX uses [1, attrs, points].
-        transposed_output = true;
-        std::swap(num_det, elem_len);
+    Ort::RunOptions run_options{ nullptr };
+    if (low_memory_) {
+        // Return the arena chunks this run freed to the OS.
+        run_options = Ort::RunOptions();
+        run_options.AddConfigEntry("memory.enable_memory_arena_shrinkage", "cpu:0");
     }
-
-    int64_t expected_plain = 4 + static_cast<int64_t>(class_names_.size());
-    int64_t expected_with_obj = 5 + static_cast<int64_t>(class_names_.size());
-    bool has_objectness = (elem_len == expected_with_obj);
-    bool plain_layout = (elem_len == expected_plain);
-    if (!has_objectness && !plain_layout) {
-        // Fall back to whichever layout elem_len resembles more.
-        has_objectness = (elem_len > expected_plain);
-        plain_layout = !has_objectness;
+    // Only one of the two buffers is used, depending on the model input type.
+    std::vector<float> input_tensor_values;
+    std::vector<uint8_t> input_tensor_bytes;
+    if (uint8_input_) {
+        input_tensor_bytes.resize(run_batch * per_image);
+    } else {
+        input_tensor_values.resize(run_batch * per_image);
     }
-    int cls_offset = has_objectness ? 5 : 4;
 
-    float* out_data = out_tensor.GetTensorMutableData<float>();
-
-    auto read_attr = [&](int attr_idx, int det_idx) -> float {
-        if (transposed_output) {
-            return out_data[attr_idx * num_det + det_idx];
-        }
-        return out_data[det_idx * elem_len + attr_idx];
-    };
-
-    enum class BoxEncoding { XYWH, XYXY };
-    auto infer_box_encoding = [&](int64_t max_check) -> BoxEncoding {
-        int64_t sample_count = std::min<int64_t>(num_det, max_check);
-        if (sample_count <= 0) {
-            return BoxEncoding::XYWH;
-        }
-        int xyxy_votes = 0;
-        for (int64_t i = 0; i < sample_count; ++i) {
-            float x0 = read_attr(0, static_cast<int>(i));
-            float y0 = read_attr(1, static_cast<int>(i));
-            float x1 = read_attr(2, static_cast<int>(i));
-            float y1 = read_attr(3, static_cast<int>(i));
-            if (x1 >= x0 && y1 >= y0) {
-                xyxy_votes++;
+    for (size_t start = 0; start < valid.size(); start += run_batch) {
+        const size_t count = std::min(run_batch, valid.size() - start);
+        for (size_t b = 0; b < count; ++b) {
+            TD_PERF_SCOPE("yolo.preprocess");
+            if (uint8_input_) {
+                preprocessLetterboxU8(images[valid[start + b]],
+                                      input_tensor_bytes.data() + b * per_image,
+                                      input_w, input_h, input_layout_);
+            } else {
+                preprocessLetterbox(images[valid[start + b]],
+                                    input_tensor_values.data() + b * per_image,
+                                    input_w, input_h);
             }
         }
-        if (xyxy_votes * 2 >= sample_count) {
-            return BoxEncoding::XYXY;
+
+        std::array<int64_t, 4> input_shape = {static_cast<int64_t>(count), 3, input_h, input_w};
+        if (input_layout_ == TensorLayout::NHWC) {
+            input_shape = {static_cast<int64_t>(count), input_h, input_w, 3};
         }
-        return BoxEncoding::XYWH;
-    };
-    BoxEncoding box_encoding = infer_box_encoding(64);
-
-    std::vector<YoloResult> candidates;
-    candidates.reserve(static_cast<size_t>(num_det));
-
-    for (int64_t i = 0; i < num_det; ++i) {
-        float raw0 = read_attr(0, static_cast<int>(i));
-        float raw1 = read_attr(1, static_cast<int>(i));
-        float raw2 = read_attr(2, static_cast<int>(i));
-        float raw3 = read_attr(3, static_cast<int>(i));
-        float obj_conf = has_objectness ? read_attr(4, static_cast<int>(i)) : 1.0f;
-
-        float best_class_conf = 0.0f;
-        int best_class_id = -1;
-        for (int64_t c = cls_offset; c < elem_len; ++c) {
-            float cls_conf = read_attr(static_cast<int>(c), static_cast<int>(i));
-            if (cls_conf > best_class_conf) {
-                best_class_conf = cls_conf;
-                best_class_id = static_cast<int>(c - cls_offset);
-            }
+        Ort::Value input_tensor = uint8_input_
+            ? Ort::Value::CreateTensor<uint8_t>(mem_info, input_tensor_bytes.data(), count * per_image,
+                                                input_shape.data(), input_shape.size())
+            : Ort::Value::CreateTensor<float>(mem_info, input_tensor_values.data(), count * per_image,
+                                              input_shape.data(), input_shape.size());
+
+        std::vector<Ort::Value> output_tensors;
+        {
+            TD_PERF_SCOPE("yolo.session_run");
+            output_tensors = session_->Run(run_options,
+                                           input_names, &input_tensor, 1,
+                                           output_names, 1);
         }
+        if (output_tensors.empty()) continue;
+
+        auto& out_tensor = output_tensors[0];
+        auto out_info = out_tensor.GetTensorTypeAndShapeInfo();
+        std::vector<int64_t> shape = out_info.GetShape();
 
-        float final_conf = obj_conf * best_class_conf;
-        if (final_conf < conf_thresh_) continue;
-
-        cv::Rect box;
-        if (box_encoding == BoxEncoding::XYXY) {
-            float x0 = raw0;
-            float y0 = raw1;
-            float x1 = raw2;
-            float y1 = raw3;
-            if (x1 <= x0 || y1 <= y0) {
-                continue;
+        if (shape.size() != 3) {
+            if (shape.size() == 2) {
+                shape.insert(shape.begin(), 1);
+            } else {
+                throw std::runtime_error("Unexpected output tensor shape rank (expected 3).");
             }
-            box = cv::Rect(
-                static_cast<int>(std::round(x0)),
-                static_cast<int>(std::round(y0)),
-                static_cast<int>(std::round(x1 - x0)),
-                static_cast<int>(std::round(y1 - y0))
-            );
-        } else {
-            float cx = raw0;
-            float cy = raw1;
-            float w  = raw2;
-            float h  = raw3;
-            float x = cx - w * 0.5f;
-            float y = cy - h * 0.5f;
-            box = cv::Rect(
-                static_cast<int>(std::round(x)),
-                static_cast<int>(std::round(y)),
-                static_cast<int>(std::round(w)),
-                static_cast<int>(std::round(h))
-            );
         }
 
-        cv::Rect box_orig = scale_coords_back(box, orig_w, orig_h, input_w_, input_h_);
-
-        YoloResult r;
-        r.class_id = best_class_id;
-        r.score = final_conf;
-        r.box = box_orig;
-        candidates.push_back(r);
-    }
-
-    std::vector<int> keep = nms(candidates, nms_thresh_);
-    std::vector<YoloResult> results;
-    results.reserve(keep.size());
-    for (int idx : keep) {
-        results.push_back(candidates[idx]);
+        const float* out_data = out_tensor.GetTensorMutableData<float>();
+        const size_t per_output = static_cast<size_t>(shape[1] * shape[2]);
+        for (size_t b = 0; b < count; ++b) {
+            const cv::Mat& image = images[valid[start + b]];
+            results[valid[start + b]] = postprocessYoloOutput(
+                out_data + b * per_output, shape[1], shape[2],
+                class_names_.size(), conf_thresh_, nms_thresh_,
+                image.cols, image.rows, input_w, input_h, head_);
+        }
     }
     return results;
 }
 
-std::string YoloInfer::classNameOrDefault(int class_id) const {
-    if (class_id >= 0 && class_id < static_cast<int>(class_names_.size())) {
-        return class_names_[class_id];
-    }
-    return "class_" + std::to_string(class_id);
-}
-
 #ifdef YOLOINFER_DEMO_MAIN
 int main(int argc, char** argv) {
     std::wstring model_path = kDefaultModelPath;
     if (argc > 1) {
-        std::string arg1 = argv[1];
-        std::wstring warg(arg1.begin(), arg1.end());
-        model_path = warg;
+        model_path = utf8ToWide(argv[1]);   // a byte-wise copy mangles non-ASCII paths
     }
 
     YoloInfer infer(model_path);
@@ -392,3 +388,5 @@ int main(int argc, char** argv) {
     return 0;
 }
 #endif
+
+#endif  // TOOLSDETECT_HAS_ONNXRUNTIME
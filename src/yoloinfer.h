@@ -1,9 +1,14 @@
 // yoloinfer.h
-// Bridges the ONNX Runtime based YOLO inference implementation so that other
-// modules (detector/main) can trigger real model inference.
+// ONNX Runtime implementation of DetectorBackend ("ort"). Only include this
+// where TOOLSDETECT_HAS_ONNXRUNTIME is set; everything else should go
+// through detector_backend.h.
 
 #pragma once
 
+#include "detector_backend.h"
+#include "mapped_file.h"
+#include "yolo_common.h"
+
 #include <onnxruntime_cxx_api.h>
 #include <opencv2/opencv.hpp>
 
@@ -11,24 +16,7 @@
 #include <string>
 #include <vector>
 
-// Default model/runtime configuration.
-inline constexpr int kYoloInputWidth  = 640;
-inline constexpr int kYoloInputHeight = 640;
-inline constexpr float kYoloConfidenceThreshold = 0.50f; // 0.25f
-inline constexpr float kYoloNmsThreshold        = 0.45f;
-inline const std::wstring kDefaultModelPath =
-    L"F:\\ultralytics-main\\ToolsDetect\\train35\\weights\\best.onnx";
-
-struct YoloResult {
-    int class_id = -1;
-    float score = 0.0f;
-    cv::Rect box;
-};
-
-// Returns the dataset class-name list (ToolsDetect).
-std::vector<std::string> getDefaultToolClassNames();
-
-class YoloInfer {
+class YoloInfer : public DetectorBackend {
 public:
     explicit YoloInfer(
         const std::wstring& model_path = kDefaultModelPath,
@@ -36,26 +24,56 @@ public:
         int input_h = kYoloInputHeight,
         float conf_thresh = kYoloConfidenceThreshold,
         float nms_thresh = kYoloNmsThreshold,
-        std::vector<std::string> class_names = getDefaultToolClassNames()
+        std::vector<std::string> class_names = getDefaultToolClassNames(),
+        bool low_memory = false   // see DetectorConfig::lowMemory
     );
 
+    const char* name() const override { return "ort"; }
+
     // Run inference on an already-loaded image.
-    std::vector<YoloResult> infer(const cv::Mat& image);
+    using DetectorBackend::infer;
 
     // Convenience overload that reads from disk before inference.
     std::vector<YoloResult> infer(const std::string& image_path);
 
-    const std::vector<std::string>& classNames() const { return class_names_; }
-    std::string classNameOrDefault(int class_id) const;
+    // Runs several images through the model. Models exported with a dynamic
+    // batch dimension get a single Session::Run over an [N,3,H,W] tensor;
+    // fixed batch-1 models fall back to one Run per image. Results are
+    // returned in input order.
+    std::vector<std::vector<YoloResult>> inferBatch(const std::vector<cv::Mat>& images) override;
+
+    bool supportsDynamicBatch() const override { return dynamic_batch_; }
+    bool supportsDynamicInputSize() const override { return dynamic_input_size_; }
+    int defaultInputSize() const override { return input_w_; }
+
+    std::vector<std::vector<YoloResult>> inferBatchAtSize(const std::vector<cv::Mat>& images,
+                                                          int inputSize) override;
+
+    // Input format detected at load time: float (normalized on the CPU) or
+    // uint8 with normalization folded into the graph.
+    bool uint8Input() const { return uint8_input_; }
+    TensorLayout inputLayout() const { return input_layout_; }
+
+    ~YoloInfer() override;
+    YoloInfer(const YoloInfer&) = delete;
+    YoloInfer& operator=(const YoloInfer&) = delete;
+
+    const std::vector<std::string>& classNames() const override { return class_names_; }
 
 private:
-    Ort::Env env_;
+    Ort::Env& env_;               // process-wide, shared by all sessions
+    MappedFile model_map_;        // low-memory mode; must outlive session_
     std::unique_ptr<Ort::Session> session_;
     std::unique_ptr<Ort::AllocatorWithDefaultOptions> allocator_;
 
     std::string input_name_;
     std::string output_name_;
     std::vector<int64_t> output_shape_;
+    bool dynamic_batch_ = false;
+    bool dynamic_input_size_ = false;   // symbolic H/W dims
+    bool uint8_input_ = false;
+    TensorLayout input_layout_ = TensorLayout::NCHW;
+    YoloHead head_ = YoloHead::Detect;   // from the "task" model metadata
 
     int input_w_;
     int input_h_;
@@ -63,4 +81,6 @@ private:
     float nms_thresh_;
     std::vector<std::string> class_names_;
     std::wstring model_path_;
+    bool low_memory_ = false;
+    int profile_token_ = 0;   // trace::registerExternalProfile() token, 0 = none
 };
@@ -0,0 +1,268 @@
+#include "alarm_bus.h"
+
+#include "test_util.h"
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct Delivered {
+    std::mutex mutex;
+    std::vector<AlarmEvent> events;
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return events.size();
+    }
+    AlarmEvent at(size_t i) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return events.at(i);
+    }
+};
+
+class RecordingSink : public AlarmSink {
+public:
+    explicit RecordingSink(Delivered& out) : out_(out) {}
+    std::string describe() const override { return "recording"; }
+    void deliver(const AlarmEvent& event) override {
+        std::lock_guard<std::mutex> lock(out_.mutex);
+        out_.events.push_back(event);
+    }
+
+private:
+    Delivered& out_;
+};
+
+AlarmEvent eventOf(const std::string& stream, const std::string& cls, int diff) {
+    AlarmEvent event;
+    event.stream = stream;
+    AlarmChange change;
+    change.cls = cls;
+    change.diff = diff;
+    event.changes.push_back(change);
+    return event;
+}
+
+DetectedObject det(const std::string& cls, float confidence, const cv::Rect& box) {
+    DetectedObject obj;
+    obj.cls = cls;
+    obj.confidence = confidence;
+    obj.bbox = box;
+    return obj;
+}
+
+template <typename Pred>
+bool waitFor(Pred pred, std::chrono::milliseconds timeout = std::chrono::milliseconds(2000)) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+}  // namespace
+
+TD_TEST(alarm_event_json_lists_every_change) {
+    AlarmEvent event = eventOf("s\"1", "pliers", -1);
+    event.username = "bob";
+    event.changes[0].box = cv::Rect(1, 2, 3, 4);
+    AlarmChange added;
+    added.cls = "tape";
+    added.diff = 2;
+    event.changes.push_back(added);
+    event.wallTimeMs = 42;
+    TD_CHECK_EQ(alarmEventJson(event),
+                std::string("{\"stream\":\"s\\\"1\",\"user\":\"bob\",\"changes\":["
+                            "{\"class\":\"pliers\",\"kind\":\"missing\",\"diff\":-1,\"box\":[1,2,3,4]},"
+                            "{\"class\":\"tape\",\"kind\":\"added\",\"diff\":2,\"box\":[0,0,0,0]}],"
+                            "\"time_ms\":42}\n"));
+}
+
+TD_TEST(alarm_bus_sends_one_event_per_session) {
+    InventoryDelta delta;
+    delta.classCountDiff = {{"wrench", -1}, {"pliers", 0}, {"hammer", 1}};
+    delta.beforeDet.objects = {det("wrench", 0.6f, cv::Rect(0, 0, 10, 10)),
+                               det("wrench", 0.9f, cv::Rect(50, 0, 10, 10))};
+    delta.afterDet.objects = {det("hammer", 0.8f, cv::Rect(100, 0, 20, 20))};
+    TD_CHECK(!publishInventoryAlarms(delta, "s1", "bob"));   // no bus yet
+
+    Delivered delivered;
+    AlarmBus bus;
+    bus.addSink(std::make_unique<RecordingSink>(delivered));
+    bus.start();
+    setActiveAlarmBus(&bus);
+    TD_CHECK(publishInventoryAlarms(delta, "s1", "bob"));
+    InventoryDelta unchanged;
+    unchanged.classCountDiff = {{"pliers", 0}};
+    TD_CHECK(publishInventoryAlarms(unchanged, "s2", "bob"));
+    bus.stop();
+    setActiveAlarmBus(nullptr);
+
+    TD_CHECK_EQ(delivered.size(), 1u);
+    if (delivered.size() != 1) return;
+    const AlarmEvent event = delivered.at(0);
+    TD_CHECK_EQ(event.stream, std::string("s1"));
+    TD_CHECK_EQ(event.changes.size(), 2u);
+    if (event.changes.size() != 2) return;
+    TD_CHECK_EQ(event.changes[0].cls, std::string("hammer"));
+    TD_CHECK(event.changes[0].box == cv::Rect(100, 0, 20, 20));   // where it appeared
+    TD_CHECK_EQ(event.changes[1].cls, std::string("wrench"));
+    TD_CHECK_EQ(event.changes[1].diff, -1);
+    TD_CHECK(event.changes[1].box == cv::Rect(50, 0, 10, 10));    // most confident before
+}
+
+TD_TEST(alarm_bus_debounces_and_deduplicates_per_stream) {
+    AlarmBusConfig config;
+    config.debounce = std::chrono::milliseconds(100);
+    config.dedupeWindow = std::chrono::milliseconds(2000);
+    Delivered delivered;
+    AlarmBus bus(config);
+    bus.addSink(std::make_unique<RecordingSink>(delivered));
+    bus.start();
+
+    TD_CHECK(bus.publish(eventOf("video:0", "pliers", -1)));
+    TD_CHECK(waitFor([&]() { return delivered.size() == 1; }));   // the first is never delayed
+    // Within the debounce window: held, and only the latest survives.
+    TD_CHECK(bus.publish(eventOf("video:0", "pliers", -2)));
+    TD_CHECK(bus.publish(eventOf("video:0", "pliers", -3)));
+    // Another stream is not held back by it.
+    TD_CHECK(bus.publish(eventOf("video:1", "pliers", -2)));
+    TD_CHECK(waitFor([&]() { return delivered.size() == 2; }));
+    TD_CHECK_EQ(delivered.at(1).stream, std::string("video:1"));
+    TD_CHECK(waitFor([&]() { return delivered.size() == 3; }));
+    TD_CHECK_EQ(delivered.at(2).changes.at(0).diff, -3);
+
+    // The same change reported again is dropped within the dedupe window.
+    std::this_thread::sleep_for(config.debounce + std::chrono::milliseconds(20));
+    TD_CHECK(bus.publish(eventOf("video:0", "pliers", -3)));
+    bus.stop();
+    TD_CHECK_EQ(delivered.size(), 3u);
+}
+
+TD_TEST(alarm_ring_drops_when_full) {
+    AlarmBusConfig config;
+    config.capacity = 2;
+    Delivered delivered;
+    AlarmBus bus(config);
+    bus.addSink(std::make_unique<RecordingSink>(delivered));
+    // Not started yet: nothing drains the ring.
+    TD_CHECK(bus.publish(eventOf("s1", "pliers", -1)));
+    TD_CHECK(bus.publish(eventOf("s2", "pliers", -1)));
+    TD_CHECK(!bus.publish(eventOf("s3", "pliers", -1)));
+    bus.start();
+    bus.stop();
+    TD_CHECK_EQ(delivered.size(), 2u);
+    if (delivered.size() == 2) {
+        TD_CHECK_EQ(delivered.at(0).stream, std::string("s1"));
+        TD_CHECK_EQ(delivered.at(1).stream, std::string("s2"));
+    }
+    // Slots are reused once drained.
+    bus.start();
+    TD_CHECK(bus.publish(eventOf("s4", "pliers", -1)));
+    TD_CHECK(bus.publish(eventOf("s5", "pliers", -1)));
+    bus.stop();
+    TD_CHECK_EQ(delivered.size(), 4u);
+}
+
+TD_TEST(inventory_alarms_report_a_full_ring) {
+    AlarmBusConfig config;
+    config.capacity = 2;
+    AlarmBus bus(config);
+    setActiveAlarmBus(&bus);
+    InventoryDelta delta;
+    delta.classCountDiff["pliers"] = -1;
+    // Not started: the third session finds the ring full and must fall back
+    // to the console.
+    TD_CHECK(publishInventoryAlarms(delta, "s1", "tester"));
+    TD_CHECK(publishInventoryAlarms(delta, "s2", "tester"));
+    TD_CHECK(!publishInventoryAlarms(delta, "s3", "tester"));
+    // Nothing changed: nothing to publish, nothing lost.
+    TD_CHECK(publishInventoryAlarms(InventoryDelta(), "s4", "tester"));
+    setActiveAlarmBus(nullptr);
+    TD_CHECK(!publishInventoryAlarms(delta, "s5", "tester"));
+}
+
+#if !defined(_WIN32)
+TD_TEST(alarm_unix_socket_sends_off_the_dispatcher_thread) {
+    tdtest::TempDir dir("alarm_unix");
+    const std::string path = dir.file("alarms.sock");
+    const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path.c_str());
+    TD_CHECK(::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    TD_CHECK(::listen(listener, 4) == 0);
+
+    std::unique_ptr<AlarmSink> sink = createAlarmSink("unix:" + path);
+    TD_CHECK(sink != nullptr);
+    if (!sink) {
+        ::close(listener);
+        return;
+    }
+    // A reader that never reads: far more than the socket buffer holds is
+    // queued without blocking deliver().
+    AlarmEvent big = eventOf("s1", "pliers", -1);
+    big.username.assign(64 * 1024, 'u');
+    const auto before = std::chrono::steady_clock::now();
+    for (int i = 0; i < 32; ++i) sink->deliver(big);
+    TD_CHECK(std::chrono::steady_clock::now() - before < std::chrono::milliseconds(200));
+
+    const int conn = ::accept(listener, nullptr, nullptr);
+    TD_CHECK(conn >= 0);
+    std::string line;
+    char c;
+    while (conn >= 0 && ::read(conn, &c, 1) == 1 && c != '\n') line += c;
+    TD_CHECK(line.find("\"class\":\"pliers\"") != std::string::npos);
+    if (conn >= 0) ::close(conn);
+    ::close(listener);
+    sink.reset();   // the send timeout bounds the shutdown
+}
+
+TD_TEST(alarm_webhook_posts_off_the_dispatcher_thread) {
+    const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    TD_CHECK(::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    TD_CHECK(::listen(listener, 4) == 0);
+    TD_CHECK(::getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len) == 0);
+    const int port = ntohs(addr.sin_port);
+
+    std::unique_ptr<AlarmSink> sink = createAlarmSink("webhook:" + std::to_string(port) + "/alarms");
+    TD_CHECK(sink != nullptr);
+    if (!sink) {
+        ::close(listener);
+        return;
+    }
+    // Nobody accepts yet: deliver() only queues.
+    const auto before = std::chrono::steady_clock::now();
+    sink->deliver(eventOf("s1", "pliers", -1));
+    TD_CHECK(std::chrono::steady_clock::now() - before < std::chrono::milliseconds(100));
+
+    const int conn = ::accept(listener, nullptr, nullptr);
+    TD_CHECK(conn >= 0);
+    std::string request;
+    char buf[512];
+    ssize_t n;
+    while (conn >= 0 && (n = ::read(conn, buf, sizeof(buf))) > 0) request.append(buf, static_cast<size_t>(n));
+    if (conn >= 0) ::close(conn);
+    ::close(listener);
+    sink.reset();
+
+    TD_CHECK_EQ(request.rfind("POST /alarms HTTP/1.0\r\n", 0), 0u);
+    TD_CHECK(request.find("\"class\":\"pliers\"") != std::string::npos);
+}
+#endif
@@ -0,0 +1,112 @@
+#include "cabinet_state.h"
+
+#include "test_util.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+DetectionResult tools(int pliers) {
+    DetectionResult det;
+    for (int i = 0; i < pliers; ++i) {
+        DetectedObject obj;
+        obj.cls = "pliers";
+        obj.confidence = 0.9f;
+        obj.bbox = cv::Rect(10 + 50 * i, 10, 40, 40);
+        det.objects.push_back(obj);
+    }
+    return det;
+}
+
+std::string readAll(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Flips one payload byte of the slot holding sequence `sequence`; the slot
+// size is in the header, the header takes what the two slots leave.
+void damageSlot(const std::string& path, uint64_t sequence) {
+    std::string bytes = readAll(path);
+    uint32_t slotBytes = 0;
+    std::memcpy(&slotBytes, bytes.data() + 8, sizeof(slotBytes));
+    const size_t headerBytes = bytes.size() - 2 * size_t(slotBytes);
+    for (int slot = 0; slot < 2; ++slot) {
+        const size_t at = headerBytes + slot * size_t(slotBytes);
+        uint64_t seq = 0;
+        std::memcpy(&seq, bytes.data() + at, sizeof(seq));
+        if (seq == sequence) bytes[at + 16 + 3] ^= 0x5A;
+    }
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << bytes;
+}
+
+}  // namespace
+
+TD_TEST(cabinet_state_falls_back_to_the_other_slot) {
+    tdtest::TempDir dir("cabinet_state");
+    const std::string path = dir.file("cabinet.state");
+    {
+        CabinetStateStore store;
+        TD_CHECK(store.open(path));
+        const std::string first = store.nextSessionId("2025-11-16");
+        TD_CHECK_EQ(first, std::string("2025-11-16#1"));
+        store.commitSession(first, tools(3), cv::Mat());
+        const std::string second = store.nextSessionId("2025-11-16");
+        store.commitSession(second, tools(2), cv::Mat());
+    }
+    {
+        CabinetStateStore store;
+        TD_CHECK(store.open(path));
+        const CabinetState state = store.snapshot();
+        TD_CHECK_EQ(state.sessionId, std::string("2025-11-16#2"));
+        TD_CHECK_EQ(state.dailyCounter, 2);   // persisted by the commit
+        TD_CHECK_EQ(state.afterDet.objects.size(), 2u);
+    }
+
+    // One flush per session: each commit is a slot, sequences 1 and 2. A
+    // torn newest slot fails its CRC and the previous commit is restored.
+    damageSlot(path, 2);
+    {
+        CabinetStateStore store;
+        TD_CHECK(store.open(path));
+        const CabinetState state = store.snapshot();
+        TD_CHECK_EQ(state.sessionId, std::string("2025-11-16#1"));
+        TD_CHECK_EQ(state.counts.count("pliers") ? state.counts.at("pliers") : 0, 3);
+        TD_CHECK_EQ(store.nextSessionId("2025-11-16"), std::string("2025-11-16#2"));
+    }
+
+    // An id whose session never committed (nor logged) was not persisted;
+    // with both slots damaged the cabinet starts empty.
+    damageSlot(path, 1);
+    CabinetStateStore store;
+    TD_CHECK(store.open(path));
+    TD_CHECK(store.snapshot().sessionId.empty());
+}
+
+TD_TEST(cabinet_state_keeps_the_newest_session) {
+    tdtest::TempDir dir("cabinet_state_order");
+    const std::string path = dir.file("cabinet.state");
+    CabinetStateStore store;
+    TD_CHECK(store.open(path));
+    store.commitSession("2025-11-16#3", tools(1), cv::Mat());
+    store.commitSession("2025-11-16#2", tools(4), cv::Mat());   // finished late
+    TD_CHECK(store.snapshot().sessionId == "2025-11-16#3");
+    store.commitSession("2025-11-17#1", tools(2), cv::Mat());
+    const CabinetState state = store.snapshot();
+    TD_CHECK_EQ(state.sessionId, std::string("2025-11-17#1"));
+    TD_CHECK_EQ(state.afterDet.objects.size(), 2u);
+
+    // The file is locked while a store has it open.
+    CabinetStateStore other;
+    TD_CHECK(!other.open(path));
+}
+
+TD_TEST(cabinet_state_leaves_foreign_files_alone) {
+    tdtest::TempDir dir("cabinet_state_foreign");
+    const std::string path = dir.file("inventory.csv");
+    std::ofstream(path, std::ios::binary) << "time,user,class,diff\n";
+    CabinetStateStore store;
+    TD_CHECK(!store.open(path));
+    TD_CHECK_EQ(readAll(path), std::string("time,user,class,diff\n"));
+}
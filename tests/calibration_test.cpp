@@ -0,0 +1,99 @@
+#include "calibration.h"
+
+#include "result_archive.h"
+#include "session_recording.h"
+#include "test_util.h"
+
+#include <fstream>
+
+namespace {
+
+cv::Mat scene(int shade) {
+    cv::Mat img(48, 64, CV_8UC3, cv::Scalar(shade, shade, shade));
+    cv::rectangle(img, cv::Rect(shade % 40, 8, 16, 24), cv::Scalar(255 - shade, 40, shade), -1);
+    return img;
+}
+
+std::vector<std::string> manifestLabels(const std::string& dir) {
+    std::ifstream in(dir + "/manifest.txt");
+    std::vector<std::string> labels;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        labels.push_back(line.substr(line.find(' ') + 1));
+    }
+    return labels;
+}
+
+}  // namespace
+
+TD_TEST(calibration_samples_archive_snapshots) {
+    tdtest::TempDir dir("calib_archive");
+    const std::string archiveDir = dir.file("archive");
+    {
+        ResultArchive archive(ResultArchiveConfig{archiveDir});
+        TD_CHECK(archive.open());
+        for (int i = 0; i < 3; ++i) {
+            ArchivedSession session;
+            session.sessionId = "S" + std::to_string(i);
+            session.views.resize(1);
+            TD_CHECK(archive.addSession(session, {scene(20 + 60 * i)}, {scene(50 + 60 * i)}));
+        }
+    }
+    const auto keys = listArchivedSnapshots(archiveDir);
+    TD_CHECK_EQ(keys.size(), 6u);
+
+    CalibrationOptions options;
+    options.sources = {archiveDir};
+    options.outDir = dir.file("calib");
+    options.inputWidth = 32;
+    options.inputHeight = 32;
+    TD_CHECK_EQ(runCalibrationDump(options), 0);
+
+    const auto labels = manifestLabels(options.outDir);
+    TD_CHECK_EQ(labels.size(), 6u);
+    for (size_t i = 0; i < labels.size() && i < keys.size(); ++i) {
+        // Oldest session first, straight from the snapshot store.
+        TD_CHECK_EQ(labels[i], archiveDir + "#" + keys[i]);
+    }
+    std::error_code ec;
+    TD_CHECK(std::filesystem::file_size(options.outDir + "/calib_00000.npy", ec) ==
+             128u + 3u * 32u * 32u * sizeof(float));
+}
+
+TD_TEST(calibration_drops_duplicates_and_caps_samples) {
+    tdtest::TempDir dir("calib_recording");
+    const std::string recording = dir.file("run.tdrec");
+    {
+        SessionRecorder recorder;
+        TD_CHECK(recorder.open(recording));
+        for (int i = 0; i < 6; ++i) {
+            // Each frame twice in a row: the repeat is a duplicate.
+            recorder.recordFrame(2 * i, 0, scene(30 * i), DetectionResult(), {});
+            recorder.recordFrame(2 * i + 1, 0, scene(30 * i), DetectionResult(), {});
+        }
+    }
+    CalibrationOptions options;
+    options.sources = {recording};
+    options.outDir = dir.file("calib");
+    options.inputWidth = 32;
+    options.inputHeight = 32;
+    options.maxSamples = 3;
+    TD_CHECK_EQ(runCalibrationDump(options), 0);
+    const auto labels = manifestLabels(options.outDir);
+    TD_CHECK_EQ(labels.size(), 3u);
+    // Evenly spaced over the six distinct frames: records 0, 4 and 8.
+    if (labels.size() == 3) {
+        TD_CHECK_EQ(labels[0], recording + "#0/0");
+        TD_CHECK_EQ(labels[1], recording + "#4/0");
+        TD_CHECK_EQ(labels[2], recording + "#8/0");
+    }
+}
+
+TD_TEST(calibration_fails_without_images) {
+    tdtest::TempDir dir("calib_empty");
+    CalibrationOptions options;
+    options.sources = {dir.file("missing.tdrec")};
+    options.outDir = dir.file("calib");
+    TD_CHECK_EQ(runCalibrationDump(options), 1);
+}
@@ -0,0 +1,114 @@
+#include "camera_capture.h"
+
+#include "test_util.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+// Paced fake camera: flat grey frames, except that frame number `sharpAt`
+// (counted from 0) has a high-contrast grid.
+class FakeSource : public FrameSource {
+public:
+    std::string describe() const override { return "fake camera"; }
+    bool open() override { return true; }
+    bool read(cv::Mat& frame) override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        const int n = frames_++;
+        frame.create(64, 64, CV_8UC3);
+        frame.setTo(cv::Scalar(128, 128, 128));
+        if (n == sharpAt.load()) {
+            for (int y = 0; y < 64; y += 8) {
+                for (int x = (y / 8) % 2 * 8; x < 64; x += 16) {
+                    cv::rectangle(frame, cv::Rect(x, y, 8, 8), cv::Scalar(255, 255, 255), -1);
+                }
+            }
+        }
+        return true;
+    }
+    int frames() const { return frames_.load(); }
+
+    std::atomic<int> sharpAt{-1};
+
+private:
+    std::atomic<int> frames_{0};
+};
+
+template <typename Pred>
+bool waitFor(Pred pred, std::chrono::milliseconds timeout = std::chrono::milliseconds(2000)) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+}  // namespace
+
+TD_TEST(camera_latest_frame_advances) {
+    CameraGrabber grabber(std::make_unique<FakeSource>());
+    TD_CHECK(grabber.latest() == nullptr);
+    TD_CHECK(grabber.start());
+    TD_CHECK(waitFor([&]() { return grabber.framesCaptured() >= 2; }));
+    const FrameHandle first = grabber.latest();
+    TD_CHECK(first != nullptr);
+    if (!first) return;
+    const uint64_t seq = first->sequence;
+    TD_CHECK(seq >= 1);
+    TD_CHECK(waitFor([&]() { return grabber.latest()->sequence > seq + 2; }));
+    // A held handle pins its slot: the grabber never overwrites it.
+    TD_CHECK_EQ(first->sequence, seq);
+    TD_CHECK_EQ(first->image.cols, 64);
+    grabber.stop();
+    TD_CHECK_EQ(grabber.framesDropped(), 0u);
+}
+
+TD_TEST(camera_pinned_slots_survive_a_small_ring) {
+    CameraConfig config;
+    config.ringSize = 3;
+    CameraGrabber grabber(std::make_unique<FakeSource>(), config);
+    TD_CHECK(grabber.start());
+    TD_CHECK(waitFor([&]() { return grabber.latest() != nullptr; }));
+    const FrameHandle a = grabber.latest();
+    const uint64_t seqA = a->sequence;
+    TD_CHECK(waitFor([&]() { return grabber.latest()->sequence > seqA; }));
+    const FrameHandle b = grabber.latest();
+    const uint64_t seqB = b->sequence;
+
+    // Two of three slots are held; capture goes on through the third.
+    TD_CHECK(waitFor([&]() { return grabber.framesCaptured() >= seqB + 5; }));
+    TD_CHECK_EQ(a->sequence, seqA);
+    TD_CHECK_EQ(b->sequence, seqB);
+    grabber.stop();
+    TD_CHECK_EQ(grabber.framesDropped(), 0u);
+}
+
+TD_TEST(camera_picks_sharpest_frame_after_event) {
+    auto source = std::make_unique<FakeSource>();
+    FakeSource* fake = source.get();
+    CameraConfig config;
+    config.selectWindow = std::chrono::milliseconds(50);   // ~10 frames, inside the 16-slot ring
+    CameraGrabber grabber(std::move(source), config);
+    TD_CHECK(grabber.start());
+    TD_CHECK(waitFor([&]() { return grabber.framesCaptured() >= 3; }));
+
+    const auto event = CaptureClock::now();
+    fake->sharpAt.store(fake->frames() + 3);   // a few blurry frames first
+    const FrameHandle chosen = grabber.sharpestAfter(event);
+    TD_CHECK(chosen != nullptr);
+    if (!chosen) return;
+    TD_CHECK(chosen->timestamp >= event);
+    TD_CHECK(chosen->sharpness > 1000.0);
+    grabber.stop();
+}
+
+TD_TEST(camera_selection_without_frames_times_out) {
+    CameraGrabber grabber(std::make_unique<FakeSource>());
+    // Not started: nothing arrives, so the wait gives up after the timeout.
+    const auto before = std::chrono::steady_clock::now();
+    TD_CHECK(grabber.sharpestAfter(CaptureClock::now(), std::chrono::milliseconds(50)) == nullptr);
+    TD_CHECK(std::chrono::steady_clock::now() - before >= std::chrono::milliseconds(50));
+}
@@ -0,0 +1,84 @@
+#include "camera_rig.h"
+
+#include "test_util.h"
+
+#include <fstream>
+
+namespace {
+
+DetectedObject det(const std::string& cls, float confidence, const cv::Rect& box) {
+    DetectedObject obj;
+    obj.cls = cls;
+    obj.confidence = confidence;
+    obj.bbox = box;
+    return obj;
+}
+
+void writeFile(const std::string& path, const std::string& text) {
+    std::ofstream out(path);
+    out << text;
+}
+
+}  // namespace
+
+TD_TEST(camera_rig_parses_views) {
+    tdtest::TempDir dir("rig");
+    const std::string path = dir.file("rig.txt");
+    writeFile(path,
+              "# name source homography\n"
+              "left /dev/video0\n"
+              "\n"
+              "right /dev/video2  1 0 100  0 1 0  0 0 1   # shifted 100 px\n");
+    CameraRig rig;
+    TD_CHECK(loadCameraRig(path, rig));
+    TD_CHECK_EQ(rig.views.size(), 2u);
+    if (rig.views.size() != 2) return;
+    TD_CHECK_EQ(rig.views[0].name, std::string("left"));
+    TD_CHECK_EQ(rig.views[0].source, std::string("/dev/video0"));
+    TD_CHECK_EQ(rig.views[0].toCabinet[0], 1.0);
+    TD_CHECK_EQ(rig.views[0].toCabinet[2], 0.0);
+    TD_CHECK_EQ(rig.views[1].toCabinet[2], 100.0);
+
+    writeFile(path, "left /dev/video0 1 0 0 0 1\n");
+    TD_CHECK(!loadCameraRig(path, rig));   // partial homography
+    writeFile(path, "left\n");
+    TD_CHECK(!loadCameraRig(path, rig));   // no source
+    writeFile(path, "# nothing\n");
+    TD_CHECK(!loadCameraRig(path, rig));
+    TD_CHECK(!loadCameraRig(dir.file("missing.txt"), rig));
+}
+
+TD_TEST(camera_rig_fuses_overlapping_views) {
+    CameraRig rig;
+    rig.views.resize(2);
+    rig.views[1].toCabinet = {1, 0, 100, 0, 1, 0, 0, 0, 1};   // right camera sees x - 100
+
+    DetectionResult left;
+    left.objects.push_back(det("pliers", 0.7f, cv::Rect(200, 50, 40, 80)));
+    left.objects.push_back(det("wrench", 0.9f, cv::Rect(10, 10, 30, 30)));
+    DetectionResult right;
+    right.objects.push_back(det("pliers", 0.8f, cv::Rect(102, 50, 40, 80)));   // same tool
+    right.objects.push_back(det("hammer", 0.6f, cv::Rect(100, 50, 40, 80)));   // other class, same place
+
+    const DetectionResult fused = fuseViews({left, right}, rig);
+    TD_CHECK_EQ(fused.objects.size(), 3u);
+    int pliers = 0;
+    for (const auto& obj : fused.objects) {
+        if (obj.cls != "pliers") continue;
+        ++pliers;
+        TD_CHECK_NEAR(obj.confidence, 0.8, 1e-6);   // the more confident view wins
+        TD_CHECK_EQ(obj.bbox.x, 202);               // in cabinet-plane units
+    }
+    TD_CHECK_EQ(pliers, 1);
+}
+
+TD_TEST(camera_rig_keeps_neighbours_from_one_view) {
+    CameraRig rig;
+    rig.views.resize(2);
+    DetectionResult left;
+    // Two adjacent tools of one kind overlap a little: NMS kept both.
+    left.objects.push_back(det("wrench", 0.9f, cv::Rect(0, 0, 40, 80)));
+    left.objects.push_back(det("wrench", 0.8f, cv::Rect(20, 0, 40, 80)));
+    const DetectionResult fused = fuseViews({left, DetectionResult()}, rig);
+    TD_CHECK_EQ(fused.objects.size(), 2u);
+}
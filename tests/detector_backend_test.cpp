@@ -0,0 +1,110 @@
+#include "detector_backend.h"
+
+#include "fake_backend.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+bool throwsRuntimeError(const std::function<void()>& fn) {
+    try {
+        fn();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+TD_TEST(model_precision_parsing_and_int8_sibling) {
+    ModelPrecision p = ModelPrecision::Fp32;
+    TD_CHECK(parseModelPrecision("auto", p) && p == ModelPrecision::Auto);
+    TD_CHECK(parseModelPrecision("int8", p) && p == ModelPrecision::Int8);
+    TD_CHECK(parseModelPrecision("fp32", p) && p == ModelPrecision::Fp32);
+    TD_CHECK(!parseModelPrecision("fp16", p));
+    TD_CHECK(int8ModelPathFor(L"dir/best.onnx") == L"dir/best.int8.onnx");
+    TD_CHECK(int8ModelPathFor(L"dir/best") == L"dir/best.int8.onnx");
+}
+
+TD_TEST(backend_factory_rejects_unknown_and_missing_backends) {
+    TD_CHECK(throwsRuntimeError([]() { createDetectorBackend("no-such-backend"); }));
+#if !TOOLSDETECT_HAS_ONNXRUNTIME
+    TD_CHECK(throwsRuntimeError([]() { createDetectorBackend("ort"); }));
+#endif
+#if !TOOLSDETECT_HAS_DNN
+    TD_CHECK(throwsRuntimeError([]() { createDetectorBackend("opencv"); }));
+#endif
+}
+
+TD_TEST(backend_factory_creates_registered_backends) {
+    std::wstring seenPath;
+    TD_CHECK(!registerDetectorBackend("ort", [](const DetectorConfig&) { return nullptr; }));
+    TD_CHECK(!registerDetectorBackend("", [](const DetectorConfig&) { return nullptr; }));
+    TD_CHECK(registerDetectorBackend("test-factory", [&seenPath](const DetectorConfig& config) {
+        seenPath = config.modelPath;
+        return std::make_unique<tdtest::FakeBackend>(tdtest::wholeImageDetector(1),
+                                                     std::vector<std::string>{"a", "b"});
+    }));
+    const auto names = availableDetectorBackends();
+    TD_CHECK(std::find(names.begin(), names.end(), "test-factory") != names.end());
+
+    DetectorConfig config;
+    config.modelPath = L"model.onnx";
+    auto backend = createDetectorBackend("test-factory", config);
+    TD_CHECK(seenPath == L"model.onnx");
+    TD_CHECK_EQ(std::string(backend->name()), std::string("fake"));
+    TD_CHECK_EQ(backend->classNameOrDefault(1), std::string("b"));
+    TD_CHECK_EQ(backend->classNameOrDefault(7), std::string("class_7"));
+
+    const cv::Mat img(8, 16, CV_8UC3, cv::Scalar(0, 0, 0));
+    const auto dets = backend->infer(img);
+    TD_CHECK_EQ(dets.size(), 1u);
+    TD_CHECK(dets.at(0).box == cv::Rect(0, 0, 16, 8));
+    TD_CHECK(backend->infer(cv::Mat()).empty());
+
+    // A factory that returns nothing counts as a failed load.
+    TD_CHECK(registerDetectorBackend("test-factory", [](const DetectorConfig&) { return nullptr; }));
+    TD_CHECK(throwsRuntimeError([]() { createDetectorBackend("test-factory"); }));
+}
+
+TD_TEST(backend_factory_resolves_int8_request) {
+    tdtest::TempDir dir("backend_int8");
+    TD_CHECK(registerDetectorBackend("test-int8", [](const DetectorConfig& config) {
+        // Report the resolved path through the class list.
+        return std::make_unique<tdtest::FakeBackend>(
+            tdtest::wholeImageDetector(0),
+            std::vector<std::string>{std::filesystem::path(config.modelPath).filename().string()});
+    }));
+    DetectorConfig config;
+    config.modelPath = std::filesystem::path(dir.file("best.onnx")).wstring();
+    config.precision = ModelPrecision::Int8;
+    TD_CHECK(throwsRuntimeError([&]() { createDetectorBackend("test-int8", config); }));
+
+    std::ofstream(dir.file("best.int8.onnx")) << "q";
+    auto int8 = createDetectorBackend("test-int8", config);
+    TD_CHECK_EQ(int8->classNames().at(0), std::string("best.int8.onnx"));
+    config.precision = ModelPrecision::Fp32;
+    auto fp32 = createDetectorBackend("test-int8", config);
+    TD_CHECK_EQ(fp32->classNames().at(0), std::string("best.onnx"));
+}
+
+TD_TEST(resolved_model_path_matches_what_each_backend_loads) {
+    tdtest::TempDir dir("backend_resolved");
+    DetectorConfig config;
+    config.modelPath = utf8ToWide(dir.file("best.onnx"));
+    const std::wstring int8Path = int8ModelPathFor(config.modelPath);
+    TD_CHECK(resolvedModelPath("ort", config) == config.modelPath);
+
+    std::ofstream(dir.file("best.int8.onnx")) << "q";
+    // Auto picks the INT8 sibling for ort only.
+    TD_CHECK(resolvedModelPath("ort", config) == int8Path);
+    TD_CHECK(resolvedModelPath("opencv", config) == config.modelPath);
+    config.precision = ModelPrecision::Int8;
+    TD_CHECK(resolvedModelPath("opencv", config) == int8Path);
+    config.precision = ModelPrecision::Fp32;
+    TD_CHECK(resolvedModelPath("ort", config) == config.modelPath);
+}
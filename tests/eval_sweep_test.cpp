@@ -0,0 +1,169 @@
+#include "eval_sweep.h"
+
+#include "test_util.h"
+
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+LabelledBox truthBox(int classId, float x, float y) {
+    LabelledBox box;
+    box.class_id = classId;
+    box.box = cv::Rect2f(x, y, 40.0f, 40.0f);
+    return box;
+}
+
+YoloResult candidate(int classId, float score, int x, int y) {
+    YoloResult r;
+    r.class_id = classId;
+    r.score = score;
+    r.box = cv::Rect(x, y, 40, 40);
+    return r;
+}
+
+CachedImage image(const std::string& path,
+                  std::vector<LabelledBox> truth,
+                  std::vector<YoloResult> candidates) {
+    CachedImage out;
+    out.imagePath = path;
+    out.width = 640;
+    out.height = 480;
+    out.truth = std::move(truth);
+    out.candidates = std::move(candidates);   // already in descending score
+    return out;
+}
+
+}  // namespace
+
+TD_TEST(eval_range_values_do_not_drift) {
+    Range range;
+    TD_CHECK(parseRange("0.10:0.90:0.05", range));
+    const std::vector<float> values = range.values();
+    TD_CHECK_EQ(values.size(), 17u);
+    TD_CHECK_NEAR(values.back(), 0.90, 1e-5);
+    TD_CHECK(parseRange("0.25", range));
+    TD_CHECK(range.values() == std::vector<float>({0.25f}));
+    TD_CHECK(!parseRange("0.5:0.4:0.05", range));
+    TD_CHECK(!parseRange("0.5:1.5:0.1", range));
+    TD_CHECK(!parseRange("0.1-0.5", range));
+}
+
+TD_TEST(eval_cache_round_trip) {
+    tdtest::TempDir dir("eval_cache");
+    const std::string modelPath = dir.file("best.onnx");
+    std::ofstream(modelPath, std::ios::binary) << "model v1";
+
+    CandidateCache cache;
+    cache.labelsDir = "labels";
+    TD_CHECK(stampModelFile(modelPath, cache.model));
+    TD_CHECK_EQ(cache.model.size, 8u);
+    cache.minConf = 0.05f;
+    cache.lighting = "grayworld";
+    cache.classNames = {"pliers", "wrench"};
+    YoloResult rotated = candidate(1, 0.7f, 5, 6);
+    rotated.oriented = true;
+    rotated.obb = cv::RotatedRect(cv::Point2f(25, 26), cv::Size2f(50, 10), 30.0f);
+    cache.images.push_back(image("a_before.jpg", {truthBox(0, 1.5f, 2.5f)}, {candidate(0, 0.9f, 1, 2), rotated}));
+    cache.images.push_back(image("a_after.jpg", {}, {}));
+
+    const std::string path = dir.file("eval.tdeval");
+    TD_CHECK(writeCandidateCache(path, cache));
+    CandidateCache loaded;
+    TD_CHECK(readCandidateCache(path, loaded));
+    TD_CHECK(loaded.model == cache.model);
+    TD_CHECK_EQ(loaded.labelsDir, cache.labelsDir);
+    TD_CHECK_EQ(loaded.lighting, cache.lighting);
+    TD_CHECK_NEAR(loaded.minConf, 0.05, 1e-7);
+    TD_CHECK(loaded.classNames == cache.classNames);
+    TD_CHECK_EQ(loaded.images.size(), 2u);
+    if (loaded.images.size() != 2 || loaded.images[0].candidates.size() != 2) return;
+    const CachedImage& first = loaded.images[0];
+    TD_CHECK_EQ(first.width, 640);
+    TD_CHECK_NEAR(first.truth.at(0).box.x, 1.5, 1e-6);
+    TD_CHECK(first.candidates[0].box == cv::Rect(1, 2, 40, 40));
+    TD_CHECK(!first.candidates[0].oriented);
+    TD_CHECK(first.candidates[1].oriented);
+    TD_CHECK_NEAR(first.candidates[1].obb.angle, 30.0, 1e-6);
+    TD_CHECK(loaded.images[1].candidates.empty());
+
+    // A truncated file is rejected rather than half read.
+    std::ifstream in(path, std::ios::binary);
+    const std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << bytes.substr(0, bytes.size() - 3);
+    TD_CHECK(!readCandidateCache(path, loaded));
+}
+
+TD_TEST(eval_model_stamp_tracks_the_file) {
+    tdtest::TempDir dir("eval_stamp");
+    const std::string modelPath = dir.file("best.onnx");
+    std::ofstream(modelPath, std::ios::binary) << "model v1";
+    ModelStamp before;
+    TD_CHECK(stampModelFile(modelPath, before));
+    ModelStamp same;
+    TD_CHECK(stampModelFile(modelPath, same));
+    TD_CHECK(same == before);
+
+    std::ofstream(modelPath, std::ios::binary | std::ios::trunc) << "retrained model";
+    ModelStamp after;
+    TD_CHECK(stampModelFile(modelPath, after));
+    TD_CHECK(after != before);
+    TD_CHECK(!stampModelFile(dir.file("missing.onnx"), after));
+}
+
+TD_TEST(eval_sessions_pair_before_and_after) {
+    std::vector<CachedImage> images = {image("d/2_after.jpg", {}, {}), image("d/1_before.jpg", {}, {}),
+                                       image("d/2_before.jpg", {}, {}), image("d/1_after.jpg", {}, {}),
+                                       image("d/3_before.jpg", {}, {})};
+    const auto sessions = findSessions(images);
+    TD_CHECK((sessions == std::vector<std::pair<size_t, size_t>>{{1, 3}, {2, 0}}));
+
+    // Without pairs, neighbours form the sessions.
+    images = {image("a.jpg", {}, {}), image("b.jpg", {}, {}), image("c.jpg", {}, {})};
+    TD_CHECK((findSessions(images) == std::vector<std::pair<size_t, size_t>>{{0, 1}, {1, 2}}));
+}
+
+TD_TEST(eval_sweep_scores_a_setting) {
+    CandidateCache cache;
+    // Before: two pliers (0) and a wrench (1). The model also proposes a
+    // duplicate of the first pliers and a weak false wrench.
+    cache.images.push_back(image("s_before.jpg",
+                                 {truthBox(0, 0, 0), truthBox(0, 100, 0), truthBox(1, 200, 0)},
+                                 {candidate(0, 0.9f, 0, 0), candidate(0, 0.85f, 2, 1), candidate(1, 0.8f, 200, 0),
+                                  candidate(0, 0.6f, 100, 0), candidate(1, 0.2f, 300, 0)}));
+    // After: one pliers was taken.
+    cache.images.push_back(image("s_after.jpg",
+                                 {truthBox(0, 0, 0), truthBox(1, 200, 0)},
+                                 {candidate(0, 0.9f, 0, 0), candidate(1, 0.8f, 200, 0)}));
+    const auto sessions = findSessions(cache.images);
+    TD_CHECK_EQ(sessions.size(), 1u);
+    std::vector<ClassCounts> truthCounts;
+    for (const auto& img : cache.images) truthCounts.push_back(countPerClass(img.truth));
+
+    TD_CHECK_EQ(applyThresholds(cache.images[0].candidates, 0.5f, 0.45f).size(), 3u);   // duplicate suppressed
+    TD_CHECK_EQ(applyThresholds(cache.images[0].candidates, 0.5f, 1.0f).size(), 4u);    // NMS off
+    TD_CHECK_EQ(applyThresholds(cache.images[0].candidates, 0.95f, 0.45f).size(), 0u);
+
+    const SweepResult good = evaluateSetting(cache, sessions, truthCounts, 0.5f, 0.45f, 0.5f);
+    TD_CHECK_NEAR(good.precision, 1.0, 1e-9);
+    TD_CHECK_NEAR(good.recall, 1.0, 1e-9);
+    TD_CHECK_NEAR(good.f1, 1.0, 1e-9);
+    TD_CHECK_NEAR(good.countRate, 1.0, 1e-9);
+    TD_CHECK_NEAR(good.deltaRate, 1.0, 1e-9);
+
+    // Too high a cut misses the third pliers: its count and the delta are wrong.
+    const SweepResult strict = evaluateSetting(cache, sessions, truthCounts, 0.7f, 0.45f, 0.5f);
+    TD_CHECK_NEAR(strict.precision, 1.0, 1e-9);
+    TD_CHECK_NEAR(strict.recall, 4.0 / 5.0, 1e-9);
+    TD_CHECK_NEAR(strict.countRate, 0.5, 1e-9);
+    TD_CHECK_NEAR(strict.deltaRate, 0.0, 1e-9);
+
+    // Without NMS the duplicate is a false positive.
+    const SweepResult noNms = evaluateSetting(cache, sessions, truthCounts, 0.1f, 1.0f, 0.5f);
+    TD_CHECK_NEAR(noNms.precision, 5.0 / 7.0, 1e-9);
+    TD_CHECK_EQ(noNms.perClass.at(0).falsePositives, 1u);
+    TD_CHECK_EQ(noNms.perClass.at(1).falsePositives, 1u);
+
+    const ClassCounts delta = countDelta(truthCounts[0], truthCounts[1]);
+    TD_CHECK((delta == ClassCounts{{0, -1}}));
+}
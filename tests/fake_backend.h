@@ -0,0 +1,65 @@
+// fake_backend.h
+// Scriptable DetectorBackend for tests that need a model without ONNX
+// Runtime or a model file. Register it under a name with
+// registerFakeBackend() and select it like a real backend.
+
+#pragma once
+
+#include "detector_backend.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tdtest {
+
+class FakeBackend : public DetectorBackend {
+public:
+    using DetectFn = std::function<std::vector<YoloResult>(const cv::Mat&)>;
+
+    FakeBackend(DetectFn detect, std::vector<std::string> classNames, bool dynamicBatch = true)
+        : detect_(std::move(detect)), classNames_(std::move(classNames)), dynamicBatch_(dynamicBatch) {}
+
+    const char* name() const override { return "fake"; }
+    bool supportsDynamicBatch() const override { return dynamicBatch_; }
+    const std::vector<std::string>& classNames() const override { return classNames_; }
+
+    std::vector<std::vector<YoloResult>> inferBatch(const std::vector<cv::Mat>& images) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batchSizes_.push_back(images.size());
+        }
+        std::vector<std::vector<YoloResult>> out;
+        for (const auto& img : images) {
+            out.push_back(img.empty() ? std::vector<YoloResult>() : detect_(img));
+        }
+        return out;
+    }
+
+    std::vector<size_t> batchSizes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return batchSizes_;
+    }
+
+private:
+    DetectFn detect_;
+    std::vector<std::string> classNames_;
+    bool dynamicBatch_;
+    mutable std::mutex mutex_;
+    std::vector<size_t> batchSizes_;
+};
+
+// One detection of class `classId` covering the whole image.
+inline FakeBackend::DetectFn wholeImageDetector(int classId, float score = 0.9f) {
+    return [classId, score](const cv::Mat& img) {
+        YoloResult r;
+        r.class_id = classId;
+        r.score = score;
+        r.box = cv::Rect(0, 0, img.cols, img.rows);
+        return std::vector<YoloResult>{r};
+    };
+}
+
+}  // namespace tdtest
@@ -0,0 +1,119 @@
+#include "infer_server.h"
+
+#include "fake_backend.h"
+#include "infer_client.h"
+#include "infer_protocol.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <thread>
+
+#if TOOLSDETECT_HAS_INFER_SERVER
+
+namespace {
+
+std::shared_ptr<tdtest::FakeBackend> g_serverBackend;
+
+bool connectWithRetry(InferClient& client, const std::string& socketPath) {
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        if (std::filesystem::exists(socketPath) && client.connect(socketPath)) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return false;
+}
+
+// The server owns its backend; forward to a shared instance so the test can
+// look at the batches afterwards.
+class ForwardingBackend : public DetectorBackend {
+public:
+    explicit ForwardingBackend(std::shared_ptr<tdtest::FakeBackend> target) : target_(std::move(target)) {}
+    const char* name() const override { return target_->name(); }
+    bool supportsDynamicBatch() const override { return true; }
+    const std::vector<std::string>& classNames() const override { return target_->classNames(); }
+    std::vector<std::vector<YoloResult>> inferBatch(const std::vector<cv::Mat>& images) override {
+        return target_->inferBatch(images);
+    }
+
+private:
+    std::shared_ptr<tdtest::FakeBackend> target_;
+};
+
+}  // namespace
+
+TD_TEST(infer_server_batches_concurrent_clients) {
+    tdtest::TempDir dir("infer_server");
+    // An OBB-style result, so the rotated box has to survive the wire too.
+    auto detect = [](const cv::Mat& img) {
+        auto dets = tdtest::wholeImageDetector(2, 0.75f)(img);
+        dets[0].oriented = true;
+        dets[0].obb = cv::RotatedRect(cv::Point2f(img.cols / 2.0f, img.rows / 2.0f),
+                                      cv::Size2f(img.cols * 0.5f, img.rows * 0.25f), 15.0f);
+        return dets;
+    };
+    g_serverBackend = std::make_shared<tdtest::FakeBackend>(detect, std::vector<std::string>{"a", "b", "c"});
+    TD_CHECK(registerDetectorBackend("test-server", [](const DetectorConfig&) {
+        return std::make_unique<ForwardingBackend>(g_serverBackend);
+    }));
+
+    InferServerOptions options;
+    options.socketPath = dir.file("server.sock");
+    options.backend = "test-server";
+    options.maxBatchSize = 4;
+    options.maxQueueDelayMs = 500.0;   // generous, so the four requests meet
+    int serverExit = -1;
+    std::thread server([&]() { serverExit = runInferServer(options); });
+
+    constexpr int kClients = 4;
+    std::vector<std::thread> clients;
+    std::vector<int> ok(kClients, 0);
+    std::vector<uint32_t> batchSizes(kClients, 0);
+    for (int i = 0; i < kClients; ++i) {
+        clients.emplace_back([&, i]() {
+            InferClient client;
+            if (!connectWithRetry(client, options.socketPath)) return;
+            const cv::Mat image(40 + i, 60 + i, CV_8UC3, cv::Scalar(i, i, i));
+            bool detectOk = false;
+            InferServerTiming timing;
+            const auto dets = client.detect(image, &detectOk, &timing);
+            ok[i] = detectOk && dets.size() == 1 && dets[0].class_id == 2 &&
+                    std::fabs(dets[0].score - 0.75f) < 1e-6f &&
+                    dets[0].box == cv::Rect(0, 0, image.cols, image.rows) && dets[0].oriented &&
+                    std::fabs(dets[0].obb.angle - 15.0f) < 1e-6f &&
+                    std::fabs(dets[0].obb.size.width - image.cols * 0.5f) < 1e-6f &&
+                    std::fabs(dets[0].obb.center.y - image.rows / 2.0f) < 1e-6f;
+            batchSizes[i] = timing.batchSize;
+        });
+    }
+    for (auto& c : clients) c.join();
+
+    std::raise(SIGTERM);   // the server's StopSignalScope is installed by now
+    server.join();
+    TD_CHECK_EQ(serverExit, 0);
+
+    for (int i = 0; i < kClients; ++i) TD_CHECK_EQ(ok[i], 1);
+    const auto batches = g_serverBackend->batchSizes();
+    size_t served = 0;
+    for (size_t b : batches) {
+        TD_CHECK(b >= 1 && b <= 4);
+        served += b;
+    }
+    TD_CHECK_EQ(served, static_cast<size_t>(kClients));
+    // Concurrent requests shared at least one model call.
+    TD_CHECK(batches.size() < static_cast<size_t>(kClients));
+    TD_CHECK(*std::max_element(batchSizes.begin(), batchSizes.end()) > 1u);
+    TD_CHECK(!std::filesystem::exists(options.socketPath));
+    g_serverBackend.reset();
+}
+
+TD_TEST(infer_server_fails_cleanly_without_backend) {
+    tdtest::TempDir dir("infer_server_missing");
+    InferServerOptions options;
+    options.socketPath = dir.file("server.sock");
+    options.backend = "no-such-backend";
+    TD_CHECK_EQ(runInferServer(options), 1);
+    TD_CHECK(!std::filesystem::exists(options.socketPath));
+}
+
+#endif
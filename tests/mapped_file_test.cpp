@@ -0,0 +1,65 @@
+#include "mapped_file.h"
+
+#include "test_util.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+std::string readAll(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+}  // namespace
+
+TD_TEST(mapped_file_reads_a_utf8_path) {
+    tdtest::TempDir dir("mapped_file");
+    const std::string path = dir.file("\xE6\xA8\xA1\xE5\x9E\x8B.ort");   // 模型.ort
+    std::ofstream(path, std::ios::binary) << "weights";
+
+    MappedFile map;
+    TD_CHECK(map.open(path));
+    TD_CHECK_EQ(map.size(), 7u);
+    TD_CHECK(map.isOpen());
+    TD_CHECK(map.mutableData() == nullptr);   // read-only
+    if (map.isOpen()) {
+        TD_CHECK_EQ(std::string(static_cast<const char*>(map.data()), map.size()), std::string("weights"));
+    }
+    map.close();
+    TD_CHECK(!map.isOpen());
+
+    std::ofstream(dir.file("empty.onnx"), std::ios::binary);
+    TD_CHECK(!map.open(dir.file("empty.onnx")));
+    TD_CHECK(!map.open(dir.file("missing.onnx")));
+}
+
+TD_TEST(mapped_file_writes_through_to_disk) {
+    tdtest::TempDir dir("mapped_file_rw");
+    const std::string path = dir.file("state.bin");
+    {
+        MappedFile map;
+        TD_CHECK(map.openWritable(path, 16));
+        TD_CHECK_EQ(map.size(), 16u);
+        if (!map.mutableData()) return;
+        std::memcpy(map.mutableData(), "abcd", 4);
+        TD_CHECK(map.flush(0, 4));
+    }
+    const std::string bytes = readAll(path);
+    TD_CHECK_EQ(bytes.size(), 16u);
+    TD_CHECK_EQ(bytes.substr(0, 4), std::string("abcd"));
+    TD_CHECK_EQ(bytes[15], '\0');
+
+    // Reopening keeps the content and grows the file with zeros.
+    MappedFile map;
+    TD_CHECK(map.openWritable(path, 32));
+    TD_CHECK_EQ(std::string(static_cast<const char*>(map.data()), 4), std::string("abcd"));
+    // A second writer is locked out until the first closes.
+    MappedFile other;
+    TD_CHECK(!other.openWritable(path, 32));
+    map.close();
+    TD_CHECK_EQ(readAll(path).size(), 32u);
+    TD_CHECK(other.openWritable(path, 32));
+}
@@ -0,0 +1,48 @@
+#include "metrics.h"
+
+#include "test_util.h"
+
+TD_TEST(metrics_series_are_shared_by_name_and_labels) {
+    metrics::Counter& a = metrics::counter("test_requests_total", "Test requests", {{"kind", "a"}});
+    metrics::Counter& again = metrics::counter("test_requests_total", "Test requests", {{"kind", "a"}});
+    metrics::Counter& b = metrics::counter("test_requests_total", "Test requests", {{"kind", "b"}});
+    TD_CHECK(&a == &again);
+    TD_CHECK(&a != &b);
+
+    // Same name with another type: a detached dummy, not the counter.
+    metrics::Gauge& clash = metrics::gauge("test_requests_total", "Test requests");
+    clash.set(5.0);
+    TD_CHECK_EQ(a.value(), 0u);
+}
+
+TD_TEST(metrics_render_prometheus_text) {
+    metrics::counter("test_render_total", "Rendered \"things\"", {{"class", "wrench\n\"x\""}}).inc(3);
+    metrics::gauge("test_render_gauge", "A gauge").set(1.5);
+    metrics::Histogram& h = metrics::histogram("test_render_seconds", "Latency", {0.1, 1.0});
+    h.observe(0.05);
+    h.observe(0.5);
+    h.observe(7.0);
+
+    const std::string text = metrics::renderPrometheus();
+    TD_CHECK(text.find("# TYPE test_render_total counter\n") != std::string::npos);
+    TD_CHECK(text.find("test_render_total{class=\"wrench\\n\\\"x\\\"\"} 3\n") != std::string::npos);
+    TD_CHECK(text.find("test_render_gauge 1.5\n") != std::string::npos);
+    TD_CHECK(text.find("# TYPE test_render_seconds histogram\n") != std::string::npos);
+    TD_CHECK(text.find("test_render_seconds_bucket{le=\"0.1\"} 1\n") != std::string::npos);
+    TD_CHECK(text.find("test_render_seconds_bucket{le=\"1\"} 2\n") != std::string::npos);
+    TD_CHECK(text.find("test_render_seconds_bucket{le=\"+Inf\"} 3\n") != std::string::npos);
+    TD_CHECK(text.find("test_render_seconds_sum 7.55\n") != std::string::npos);
+    TD_CHECK(text.find("test_render_seconds_count 3\n") != std::string::npos);
+}
+
+TD_TEST(metrics_callback_gauge_runs_outside_registry_lock) {
+    // A callback that registers a metric itself would deadlock if scrapes
+    // held the registry lock while evaluating it.
+    metrics::callbackGauge("test_callback_value", "Callback gauge", []() {
+        metrics::counter("test_callback_calls_total", "Callback calls").inc();
+        return 42.0;
+    });
+    const std::string text = metrics::renderPrometheus();
+    TD_CHECK(text.find("test_callback_value 42\n") != std::string::npos);
+    TD_CHECK_EQ(metrics::counter("test_callback_calls_total", "Callback calls").value(), 1u);
+}
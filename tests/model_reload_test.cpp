@@ -0,0 +1,71 @@
+#include "detector.h"
+
+#include "detector_backend.h"
+#include "fake_backend.h"
+#include "test_util.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+void writeModel(const std::string& path, const std::string& content) {
+    // Replaced with a rename, as setModelHotReload() asks for.
+    std::ofstream(path + ".tmp", std::ios::binary) << content;
+    std::filesystem::rename(path + ".tmp", path);
+}
+
+// The class name of the single whole-image detection: the content of the
+// model file the current backend was built from.
+std::string loadedModel() {
+    const cv::Mat frame(64, 64, CV_8UC3, cv::Scalar(0, 0, 0));
+    const DetectionResult result = runYoloDetect(frame);
+    return result.objects.empty() ? std::string() : result.objects.front().cls;
+}
+
+bool waitForModel(const std::string& content) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+    while (loadedModel() != content) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+}  // namespace
+
+// The only test that configures the process-wide detector.
+TD_TEST(model_hot_reload_watches_the_loaded_int8_file) {
+    tdtest::TempDir dir("model_reload");
+    writeModel(dir.file("best.onnx"), "fp32 v1");
+    writeModel(dir.file("best.int8.onnx"), "int8 v1");
+    TD_CHECK(registerDetectorBackend("test-reload", [](const DetectorConfig& config) {
+        std::ifstream in(std::filesystem::u8path(wideToUtf8(config.modelPath)), std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (content.empty()) throw std::runtime_error("truncated model");
+        return std::make_unique<tdtest::FakeBackend>(tdtest::wholeImageDetector(0),
+                                                     std::vector<std::string>{content});
+    }));
+    setDetectorBackend("test-reload");
+    setLocalModelPath(dir.file("best.onnx"));
+    TD_CHECK(setModelPrecision("int8"));
+    setModelHotReload(10);
+    TD_CHECK(waitForModel("int8 v1"));
+    // Let the watcher take its first look before anything changes.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // The configured FP32 file is not what runs: replacing the INT8 file is
+    // what has to trigger the reload.
+    writeModel(dir.file("best.int8.onnx"), "int8 v2");
+    TD_CHECK(waitForModel("int8 v2"));
+
+    // A model that fails to load is rejected and the current one stays.
+    writeModel(dir.file("best.int8.onnx"), "");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    TD_CHECK_EQ(loadedModel(), std::string("int8 v2"));
+    setModelHotReload(0);
+}
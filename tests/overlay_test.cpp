@@ -0,0 +1,80 @@
+#include "overlay.h"
+
+#include "test_util.h"
+
+#include <cstdlib>
+
+namespace {
+
+// Bounding box of the non-black pixels of a CV_8UC3 image.
+cv::Rect inked(const cv::Mat& image) {
+    int left = image.cols, right = -1, top = image.rows, bottom = -1;
+    for (int y = 0; y < image.rows; ++y) {
+        const uint8_t* row = image.ptr<uint8_t>(y);
+        for (int x = 0; x < image.cols; ++x) {
+            if (row[3 * x] | row[3 * x + 1] | row[3 * x + 2]) {
+                left = std::min(left, x);
+                right = std::max(right, x);
+                top = std::min(top, y);
+                bottom = std::max(bottom, y);
+            }
+        }
+    }
+    return right < 0 ? cv::Rect() : cv::Rect(left, top, right - left + 1, bottom - top + 1);
+}
+
+}  // namespace
+
+TD_TEST(cached_text_lines_up_with_put_text) {
+    const std::string text = "#12 wrench 0.87";
+    const cv::Point origin(20, 80);
+    const cv::Scalar green(0, 255, 0);
+    for (int thickness : {1, 2, 5}) {
+        const double fontScale = 0.5 * thickness;
+        cv::Mat expected = cv::Mat::zeros(120, 1200, CV_8UC3);
+        cv::Mat cached = cv::Mat::zeros(120, 1200, CV_8UC3);
+        cv::putText(expected, text, origin, cv::FONT_HERSHEY_SIMPLEX, fontScale, green, thickness);
+        const cv::Point pen = drawCachedText(cached, text, origin, fontScale, thickness, green);
+
+        // The pen moves by the glyph widths; getTextSize adds the stroke
+        // once. Per-character pixel rounding may add up to half a pixel each.
+        int baseline = 0;
+        const int width = cv::getTextSize(text, cv::FONT_HERSHEY_SIMPLEX, fontScale, thickness, &baseline).width;
+        const int slack = static_cast<int>(text.size()) / 2 + 1;
+        TD_CHECK_EQ(pen.y, origin.y);
+        TD_CHECK(std::abs(pen.x - origin.x - (width - thickness)) <= slack);
+
+        const cv::Rect a = inked(expected);
+        const cv::Rect b = inked(cached);
+        TD_CHECK(std::abs(a.x - b.x) <= 1);
+        TD_CHECK(std::abs(a.br().x - b.br().x) <= slack);
+        TD_CHECK(std::abs(a.y - b.y) <= 1);
+    }
+}
+
+TD_TEST(fitted_render_shrinks_and_scales_the_boxes) {
+    cv::Mat image = cv::Mat::zeros(2000, 4000, CV_8UC3);
+    DetectionResult detections;
+    DetectedObject obj;
+    obj.cls = "pliers";
+    obj.confidence = 0.9f;
+    obj.bbox = cv::Rect(1000, 800, 400, 200);
+    detections.objects.push_back(obj);
+
+    // Fits 1920x1080 at the 4000-wide image's aspect: scale 0.48.
+    const cv::Mat fitted = renderDetectionsFitted(image, detections, kPreviewSize);
+    TD_CHECK_EQ(fitted.cols, 1920);
+    TD_CHECK_EQ(fitted.rows, 960);
+    TD_CHECK_EQ(cv::countNonZero(image.reshape(1)), 0);   // the source is untouched
+
+    // The box corner lands at the scaled position (480, 384).
+    const cv::Vec3b corner = fitted.at<cv::Vec3b>(384, 480);
+    TD_CHECK_EQ(int(corner[1]), 255);
+    TD_CHECK_EQ(int(fitted.at<cv::Vec3b>(384 + 40, 480 + 40)[1]), 0);   // inside stays clear
+
+    // Never enlarged.
+    const cv::Mat small = cv::Mat::zeros(100, 200, CV_8UC3);
+    const cv::Mat kept = renderDetectionsFitted(small, DetectionResult(), kPreviewSize);
+    TD_CHECK_EQ(kept.cols, 200);
+    TD_CHECK_EQ(kept.rows, 100);
+}
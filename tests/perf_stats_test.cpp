@@ -0,0 +1,85 @@
+#include "perf_stats.h"
+
+#include "test_util.h"
+
+#include <thread>
+
+namespace {
+
+const perf::StageSummary* findStage(const std::vector<perf::StageSummary>& stages, const std::string& name) {
+    for (const auto& s : stages) {
+        if (s.name == name) return &s;
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+TD_TEST(perf_stage_ids_are_stable) {
+    const int a = perf::registerStage("test.stable_a");
+    const int b = perf::registerStage("test.stable_b");
+    TD_CHECK(a >= 0);
+    TD_CHECK(b >= 0);
+    TD_CHECK(a != b);
+    TD_CHECK_EQ(perf::registerStage("test.stable_a"), a);
+}
+
+TD_TEST(perf_percentiles_within_bucket_precision) {
+    perf::reset();
+    const int id = perf::registerStage("test.percentiles");
+    // 1..100 ms, one sample each.
+    for (int ms = 1; ms <= 100; ++ms) perf::record(id, static_cast<uint64_t>(ms) * 1000000ull);
+
+    const auto* s = findStage(perf::snapshot(), "test.percentiles");
+    TD_CHECK(s != nullptr);
+    if (!s) return;
+    TD_CHECK_EQ(s->count, 100u);
+    TD_CHECK_NEAR(s->meanMs, 50.5, 1e-9);
+    TD_CHECK_NEAR(s->maxMs, 100.0, 1e-9);
+    // Log-linear buckets keep ~3% relative error.
+    TD_CHECK_NEAR(s->p50Ms, 50.0, 50.0 * 0.04);
+    TD_CHECK_NEAR(s->p95Ms, 95.0, 95.0 * 0.04);
+    TD_CHECK_NEAR(s->p99Ms, 99.0, 99.0 * 0.04);
+    TD_CHECK(s->p99Ms <= s->maxMs);
+}
+
+TD_TEST(perf_snapshot_merges_exited_threads) {
+    perf::reset();
+    const int id = perf::registerStage("test.threads");
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; ++t) {
+        workers.emplace_back([id]() {
+            for (int i = 0; i < 250; ++i) perf::record(id, 2000000);   // 2 ms
+        });
+    }
+    for (auto& w : workers) w.join();
+    perf::record(id, 4000000);   // a live thread (this one) as well
+
+    const auto* s = findStage(perf::snapshot(), "test.threads");
+    TD_CHECK(s != nullptr);
+    if (!s) return;
+    TD_CHECK_EQ(s->count, 1001u);
+    TD_CHECK_NEAR(s->maxMs, 4.0, 1e-9);
+    TD_CHECK_NEAR(s->p50Ms, 2.0, 2.0 * 0.04);
+
+    perf::reset();
+    TD_CHECK(findStage(perf::snapshot(), "test.threads") == nullptr);
+}
+
+TD_TEST(perf_scope_records_only_when_enabled) {
+    perf::reset();
+    perf::setEnabled(false);
+    {
+        TD_PERF_SCOPE("test.scope");
+    }
+    TD_CHECK(findStage(perf::snapshot(), "test.scope") == nullptr);
+
+    perf::setEnabled(true);
+    {
+        TD_PERF_SCOPE("test.scope");
+    }
+    perf::setEnabled(false);
+    const auto* s = findStage(perf::snapshot(), "test.scope");
+    TD_CHECK(s != nullptr);
+    if (s) TD_CHECK_EQ(s->count, 1u);
+}
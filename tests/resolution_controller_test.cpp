@@ -0,0 +1,77 @@
+#include "resolution_controller.h"
+
+#include "test_util.h"
+
+namespace {
+
+// Simulated model: latency proportional to pixel area, `msAt640` at 640.
+double modelLatency(int size, double msAt640) {
+    const double r = size / 640.0;
+    return msAt640 * r * r;
+}
+
+}  // namespace
+
+TD_TEST(resolution_starts_at_closest_ladder_size) {
+    ResolutionControllerConfig config;
+    config.initialSize = 600;
+    TD_CHECK_EQ(ResolutionController(config).currentSize(), 640);
+    config.initialSize = 100;
+    TD_CHECK_EQ(ResolutionController(config).currentSize(), 320);
+    config.sizes = {960, 320};   // unsorted input is sorted
+    config.initialSize = 900;
+    TD_CHECK_EQ(ResolutionController(config).currentSize(), 960);
+    config.sizes.clear();
+    TD_CHECK_EQ(ResolutionController(config).currentSize(), 640);
+}
+
+TD_TEST(resolution_steps_down_when_over_budget) {
+    ResolutionControllerConfig config;
+    config.budgetMs = 100.0;
+    config.cooldownFrames = 5;
+    ResolutionController controller(config);
+    // 640 costs 160 ms: first report is over budget, and the initial state
+    // has no cooldown pending.
+    TD_CHECK(controller.report(modelLatency(640, 160.0)));
+    TD_CHECK_EQ(controller.currentSize(), 480);
+    // The estimate was rescaled to the new size (160 * (480/640)^2 = 90).
+    TD_CHECK_NEAR(controller.smoothedLatencyMs(), 90.0, 1e-9);
+    // 480 costs 90 ms: within budget, and 640 would not fit, so it stays.
+    for (int i = 0; i < 50; ++i) {
+        TD_CHECK(!controller.report(modelLatency(480, 160.0)));
+    }
+    TD_CHECK_EQ(controller.currentSize(), 480);
+    TD_CHECK_EQ(controller.switches(), 1);
+}
+
+TD_TEST(resolution_steps_up_with_headroom_after_cooldown) {
+    ResolutionControllerConfig config;
+    config.budgetMs = 100.0;
+    config.cooldownFrames = 10;
+    config.initialSize = 320;
+    ResolutionController controller(config);
+    // A fast model: 640 costs 40 ms, so 960 (90 ms) exceeds 75% headroom.
+    std::vector<int> switchFrames;
+    for (int frame = 0; frame < 100; ++frame) {
+        if (controller.report(modelLatency(controller.currentSize(), 40.0))) switchFrames.push_back(frame);
+    }
+    TD_CHECK_EQ(controller.currentSize(), 640);
+    TD_CHECK_EQ(switchFrames.size(), 2u);
+    if (switchFrames.size() == 2) {
+        TD_CHECK_EQ(switchFrames[0], 0);
+        TD_CHECK(switchFrames[1] - switchFrames[0] >= config.cooldownFrames);
+    }
+}
+
+TD_TEST(resolution_does_not_flap_on_noise) {
+    ResolutionControllerConfig config;
+    config.budgetMs = 100.0;
+    config.cooldownFrames = 15;
+    ResolutionController controller(config);
+    // 640 at 95 ms +- 10 ms: spikes above budget are smoothed away.
+    for (int frame = 0; frame < 300; ++frame) {
+        controller.report(95.0 + ((frame % 2) ? 10.0 : -10.0));
+    }
+    TD_CHECK_EQ(controller.currentSize(), 640);
+    TD_CHECK_EQ(controller.switches(), 0);
+}
@@ -0,0 +1,113 @@
+#include "result_archive.h"
+
+#include "test_util.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// A textured board, the same on every call, with one low-contrast "tool";
+// `noise` shifts every pixel as sensor noise would between two frames of
+// the same scene.
+cv::Mat board(bool withTool, int noise = 0) {
+    const cv::Rect tool(150, 80, 10, 10);
+    cv::Mat image(180, 320, CV_8UC3);
+    for (int y = 0; y < image.rows; ++y) {
+        uint8_t* row = image.ptr<uint8_t>(y);
+        for (int x = 0; x < image.cols; ++x) {
+            int value = 100 + (x * 7 + y * 13) % 40 + noise;
+            if (withTool && tool.contains(cv::Point(x, y))) value -= 5;
+            for (int c = 0; c < 3; ++c) row[x * 3 + c] = static_cast<uint8_t>(value);
+        }
+    }
+    return image;
+}
+
+ArchivedSession session(const std::string& id) {
+    ArchivedSession s;
+    s.sessionId = id;
+    s.username = "tester";
+    s.views.resize(1);
+    return s;
+}
+
+void appendBytes(const fs::path& path, const std::string& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    out << bytes;
+}
+
+fs::path onlyFile(const fs::path& dir) {
+    fs::path found;
+    for (const auto& entry : fs::directory_iterator(dir)) found = entry.path();
+    return found;
+}
+
+}  // namespace
+
+TD_TEST(archive_reuses_exact_snapshots_and_a_before_that_is_the_last_after) {
+    tdtest::TempDir dir("archive_dedup");
+    ResultArchiveConfig config;
+    config.dir = dir.path().string();
+    config.segments = true;
+    ResultArchive archive(config);
+    TD_CHECK(archive.open());
+
+    // The after differs from the before by one small tool only: well inside
+    // the near-duplicate tolerance, so it must still be stored.
+    const cv::Mat stocked = board(true);
+    const cv::Mat taken = board(false);
+    TD_CHECK(archive.addSession(session("s1"), {stocked}, {taken}));
+    // The next before is the last after up to noise: reused.
+    TD_CHECK(archive.addSession(session("s2"), {board(false, 1)}, {stocked}));
+
+    ArchivedSession s1;
+    ArchivedSession s2;
+    TD_CHECK(findArchivedSession(config.dir, "s1", s1));
+    TD_CHECK(findArchivedSession(config.dir, "s2", s2));
+    if (s1.views.size() != 1 || s2.views.size() != 1) return;
+    TD_CHECK(s1.views[0].beforeKey != s1.views[0].afterKey);
+    TD_CHECK_EQ(s2.views[0].beforeKey, s1.views[0].afterKey);
+    TD_CHECK_EQ(s2.views[0].afterKey, s1.views[0].beforeKey);   // bit-identical
+
+    const ResultArchive::Stats stats = archive.stats();
+    TD_CHECK_EQ(stats.snapshotsStored, 2u);
+    TD_CHECK_EQ(stats.snapshotsReused, 2u);
+    TD_CHECK(!loadArchivedSnapshot(config.dir, s2.views[0].beforeKey).empty());
+}
+
+TD_TEST(archive_open_cuts_torn_tails) {
+    tdtest::TempDir dir("archive_torn");
+    ResultArchiveConfig config;
+    config.dir = dir.path().string();
+    config.segments = true;
+    {
+        ResultArchive archive(config);
+        TD_CHECK(archive.open());
+        TD_CHECK(archive.addSession(session("s1"), {board(true)}, {board(false)}));
+    }
+    const fs::path segment = onlyFile(dir.path() / "segments");
+    const fs::path index = onlyFile(dir.path() / "index");
+    const uintmax_t segmentSize = fs::file_size(segment);
+    const uintmax_t indexSize = fs::file_size(index);
+    // A crash mid-append: an object header promising more bytes than follow,
+    // and half of a record length.
+    appendBytes(segment, std::string("\x10\x00\x00\x00", 4) + "0123456789abcdef" + std::string("\x00\xff\xff\x00\x00", 5) + "jp");
+    appendBytes(index, std::string("\x40\x00", 2));
+
+    ResultArchive archive(config);
+    TD_CHECK(archive.open());
+    TD_CHECK_EQ(fs::file_size(segment), segmentSize);
+    TD_CHECK_EQ(fs::file_size(index), indexSize);
+
+    // Appends after the cut are readable again.
+    TD_CHECK(archive.addSession(session("s2"), {board(false)}, {board(true, 40)}));
+    ArchivedSession s2;
+    TD_CHECK(findArchivedSession(config.dir, "s2", s2));
+    if (s2.views.size() != 1) return;
+    TD_CHECK_EQ(archive.stats().snapshotsStored, 1u);   // the before was stored before the crash
+    TD_CHECK(!loadArchivedSnapshot(config.dir, s2.views[0].afterKey).empty());
+    TD_CHECK(!loadArchivedSnapshot(config.dir, s2.views[0].beforeKey).empty());
+}
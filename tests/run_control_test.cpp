@@ -0,0 +1,26 @@
+#include "run_control.h"
+
+#include "test_util.h"
+
+#include <csignal>
+
+TD_TEST(percentile_nearest_rank) {
+    TD_CHECK_EQ(percentile({}, 0.5), 0.0);
+    TD_CHECK_EQ(percentile({7.0}, 0.99), 7.0);
+    const std::vector<double> sorted = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    TD_CHECK_EQ(percentile(sorted, 0.0), 1.0);
+    TD_CHECK_EQ(percentile(sorted, 0.5), 6.0);   // index 4.5 rounds up
+    TD_CHECK_EQ(percentile(sorted, 1.0), 10.0);
+    TD_CHECK_EQ(percentile(sorted, 2.0), 10.0);  // clamped
+}
+
+TD_TEST(stop_signal_scope_sets_flag) {
+    {
+        StopSignalScope scope;
+        TD_CHECK(!StopSignalScope::stopRequested());
+        std::raise(SIGTERM);
+        TD_CHECK(StopSignalScope::stopRequested());
+    }
+    StopSignalScope again;   // a new scope starts cleared
+    TD_CHECK(!StopSignalScope::stopRequested());
+}
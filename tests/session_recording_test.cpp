@@ -0,0 +1,175 @@
+#include "session_recording.h"
+
+#include "test_util.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+DetectionResult makeDetections() {
+    DetectionResult det;
+    DetectedObject a;
+    a.cls = "wrench";
+    a.confidence = 0.91f;
+    a.bbox = cv::Rect(10, 20, 30, 40);
+    DetectedObject b;
+    b.cls = "pliers";
+    b.confidence = 0.55f;
+    b.bbox = cv::Rect(100, 5, 12, 64);
+    b.oriented = true;   // from an OBB model
+    b.obb = cv::RotatedRect(cv::Point2f(106.0f, 37.0f), cv::Size2f(62.5f, 8.25f), 80.0f);
+    det.objects = {a, b};
+    return det;
+}
+
+cv::Mat makeImage(int seed) {
+    cv::Mat img(24, 32, CV_8UC3);
+    for (int y = 0; y < img.rows; ++y) {
+        for (int x = 0; x < img.cols; ++x) {
+            img.at<cv::Vec3b>(y, x) = cv::Vec3b(static_cast<uchar>(x * 7 + seed),
+                                                static_cast<uchar>(y * 5 + seed),
+                                                static_cast<uchar>((x ^ y) + seed));
+        }
+    }
+    return img;
+}
+
+}  // namespace
+
+TD_TEST(recording_round_trips_sessions_and_frames) {
+    tdtest::TempDir dir("recording");
+    const std::string path = dir.file("run.tdrec");
+    const DetectionResult det = makeDetections();
+    const cv::Mat before = makeImage(0);
+    const cv::Mat after = makeImage(9);
+    {
+        SessionRecorder recorder;
+        TD_CHECK(recorder.open(path));
+        recorder.recordSession("S-1", "alice", before, after, det, DetectionResult(),
+                               {{"before_detect", 12.5}, {"after_detect", 11.0}});
+        DetectionResult keyframe = det;
+        keyframe.inputSize = 480;   // picked by the latency controller
+        recorder.recordFrame(42, 1400000, after, keyframe, {{"frame", 3.25}});
+        TD_CHECK_EQ(recorder.entriesWritten(), 2u);
+    }
+
+    RecordingReader reader;
+    TD_CHECK(reader.open(path));
+    RecordedEntry entry;
+    TD_CHECK(reader.next(entry));
+    TD_CHECK(entry.kind == RecordedEntry::Kind::Session);
+    TD_CHECK_EQ(entry.sessionId, std::string("S-1"));
+    TD_CHECK_EQ(entry.username, std::string("alice"));
+    TD_CHECK_EQ(entry.images.size(), 2u);
+    TD_CHECK_EQ(entry.detections.size(), 2u);
+    TD_CHECK(sameDetections(entry.detections[0], det));
+    TD_CHECK(!entry.detections[0].objects.at(0).oriented);
+    TD_CHECK(entry.detections[0].objects.at(1).oriented);
+    TD_CHECK_EQ(entry.detections[0].objects.at(1).obb.size.height, 8.25f);
+    TD_CHECK(entry.detections[1].objects.empty());
+    TD_CHECK_EQ(entry.stages.size(), 2u);
+    TD_CHECK_EQ(entry.stages[0].first, std::string("before_detect"));
+    TD_CHECK_NEAR(entry.stages[0].second, 12.5, 1e-6);
+    // Lossless: the replayed pixels are the recorded ones.
+    const cv::Mat decoded = cv::imdecode(entry.images[1], cv::IMREAD_COLOR);
+    TD_CHECK_EQ(cv::norm(decoded, after, cv::NORM_INF), 0.0);
+
+    TD_CHECK(reader.next(entry));
+    TD_CHECK(entry.kind == RecordedEntry::Kind::Frame);
+    TD_CHECK_EQ(entry.frameIndex, 42);
+    TD_CHECK_EQ(entry.timestampUs, 1400000);
+    TD_CHECK_EQ(entry.inputSize, 480);
+    TD_CHECK(sameDetections(entry.detections.at(0), det));
+    TD_CHECK(!reader.next(entry));   // clean end of file
+}
+
+TD_TEST(recording_reads_version_2_frames) {
+    tdtest::TempDir dir("recording_v2");
+    const std::string path = dir.file("run.tdrec");
+    {
+        SessionRecorder recorder;
+        TD_CHECK(recorder.open(path));
+        recorder.recordFrame(7, 280000, makeImage(3), makeDetections(), {});
+    }
+    // Rewrite as version 2: no input size after the frame timestamp.
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    const uint32_t version = 2;
+    bytes.replace(4, 4, reinterpret_cast<const char*>(&version), 4);
+    uint32_t payload = 0;
+    std::memcpy(&payload, bytes.data() + 12, 4);
+    payload -= 4;
+    bytes.replace(12, 4, reinterpret_cast<const char*>(&payload), 4);
+    bytes.erase(16 + 16, 4);
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << bytes;
+
+    RecordingReader reader;
+    TD_CHECK(reader.open(path));
+    RecordedEntry entry;
+    TD_CHECK(reader.next(entry));
+    TD_CHECK_EQ(entry.frameIndex, 7);
+    TD_CHECK_EQ(entry.timestampUs, 280000);
+    TD_CHECK_EQ(entry.inputSize, 0);
+    TD_CHECK(sameDetections(entry.detections.at(0), makeDetections()));
+}
+
+TD_TEST(recording_ignores_truncated_tail) {
+    tdtest::TempDir dir("recording_torn");
+    const std::string path = dir.file("run.tdrec");
+    {
+        SessionRecorder recorder;
+        TD_CHECK(recorder.open(path));
+        recorder.recordFrame(1, 0, makeImage(1), makeDetections(), {});
+        recorder.recordFrame(2, 40000, makeImage(2), makeDetections(), {});
+    }
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 10);
+
+    RecordingReader reader;
+    TD_CHECK(reader.open(path));
+    RecordedEntry entry;
+    TD_CHECK(reader.next(entry));
+    TD_CHECK_EQ(entry.frameIndex, 1);
+    TD_CHECK(!reader.next(entry));
+}
+
+TD_TEST(recording_rejects_foreign_files) {
+    tdtest::TempDir dir("recording_bad");
+    const std::string path = dir.file("not_a_recording.bin");
+    std::ofstream(path, std::ios::binary) << "PNG?garbage";
+    RecordingReader reader;
+    TD_CHECK(!reader.open(path));
+    TD_CHECK(!reader.open(dir.file("missing.tdrec")));
+}
+
+TD_TEST(same_detections_compares_class_box_confidence_and_obb) {
+    const DetectionResult a = makeDetections();
+    DetectionResult b = a;
+    TD_CHECK(sameDetections(a, b));
+    b.objects[0].confidence += 5e-5f;
+    TD_CHECK(sameDetections(a, b));
+    b.objects[0].confidence += 1e-3f;
+    TD_CHECK(!sameDetections(a, b));
+    b = a;
+    b.objects[1].bbox.x += 1;
+    TD_CHECK(!sameDetections(a, b));
+    b = a;
+    std::swap(b.objects[0], b.objects[1]);
+    TD_CHECK(!sameDetections(a, b));
+    b.objects.pop_back();
+    TD_CHECK(!sameDetections(a, b));
+
+    b = a;
+    b.objects[1].obb.angle += 0.05f;
+    TD_CHECK(sameDetections(a, b));
+    b.objects[1].obb.angle += 1.0f;   // same bounds, different rotation
+    TD_CHECK(!sameDetections(a, b));
+    b = a;
+    b.objects[1].oriented = false;
+    TD_CHECK(!sameDetections(a, b));
+}
@@ -0,0 +1,108 @@
+#include "slot_cascade.h"
+
+#include "test_util.h"
+
+#include <fstream>
+
+namespace {
+
+const cv::Rect kPliersSlot(10, 10, 40, 40);
+const cv::Rect kWrenchSlot(110, 10, 40, 40);
+
+cv::Mat bareBoard() {
+    return cv::Mat(100, 200, CV_8UC3, cv::Scalar(128, 128, 128));
+}
+
+// A striped, coloured "tool" filling the slot.
+void drawTool(cv::Mat& board, const cv::Rect& slot, const cv::Scalar& colour) {
+    cv::rectangle(board, slot, colour, -1);
+    for (int y = slot.y; y < slot.y + slot.height; y += 8) {
+        cv::rectangle(board, cv::Rect(slot.x, y, slot.width, 3), cv::Scalar(255, 255, 255), -1);
+    }
+}
+
+cv::Mat stockedBoard() {
+    cv::Mat board = bareBoard();
+    drawTool(board, kPliersSlot, cv::Scalar(0, 0, 200));
+    drawTool(board, kWrenchSlot, cv::Scalar(200, 0, 0));
+    return board;
+}
+
+SlotCascade makeCascade() {
+    return SlotCascade({{"pliers", kPliersSlot}, {"wrench", kWrenchSlot}});
+}
+
+}  // namespace
+
+TD_TEST(slot_layout_parses_multiword_classes) {
+    tdtest::TempDir dir("slots");
+    const std::string path = dir.file("tools_config.txt");
+    {
+        std::ofstream out(path);
+        out << "# class x y w h\n"
+            << "pliers 10 10 40 40\n"
+            << "\n"
+            << "torque wrench 110 10 40 40\n";
+    }
+    std::vector<ToolSlot> slots;
+    TD_CHECK(loadToolSlots(path, slots));
+    TD_CHECK_EQ(slots.size(), 2u);
+    if (slots.size() == 2) {
+        TD_CHECK_EQ(slots[1].cls, std::string("torque wrench"));
+        TD_CHECK(slots[1].rect == kWrenchSlot);
+    }
+
+    {
+        std::ofstream out(path);
+        out << "pliers 10 10 40\n";
+    }
+    TD_CHECK(!loadToolSlots(path, slots));
+    {
+        std::ofstream out(path);
+        out << "pliers 10 10 0 40\n";
+    }
+    TD_CHECK(!loadToolSlots(path, slots));
+}
+
+TD_TEST(slot_cascade_decides_clear_slots_without_the_detector) {
+    SlotCascade cascade = makeCascade();
+    TD_CHECK(cascade.enroll(stockedBoard(), bareBoard()));
+
+    const SlotReading before = cascade.read(stockedBoard());
+    TD_CHECK_EQ(before.decidedBySignature, 2);
+    TD_CHECK_EQ(before.decidedByDetector, 0);
+    TD_CHECK_EQ(before.detections.objects.size(), 2u);
+
+    cv::Mat taken = bareBoard();
+    drawTool(taken, kWrenchSlot, cv::Scalar(200, 0, 0));
+    const SlotReading after = cascade.read(taken);
+    TD_CHECK_EQ(after.decidedBySignature, 2);
+    TD_CHECK(after.states == std::vector<SlotState>({SlotState::Empty, SlotState::Occupied}));
+
+    const InventoryDelta delta = compareSlotReadings(before, after);
+    TD_CHECK_EQ(delta.classCountDiff.at("pliers"), -1);
+    TD_CHECK_EQ(delta.classCountDiff.count("wrench") ? delta.classCountDiff.at("wrench") : 0, 0);
+}
+
+TD_TEST(slot_cascade_scales_slots_and_works_without_empty_reference) {
+    SlotCascade cascade = makeCascade();
+    TD_CHECK(cascade.enroll(stockedBoard()));
+
+    // Twice the enrollment resolution: slot rectangles scale with it.
+    cv::Mat large;
+    cv::resize(stockedBoard(), large, cv::Size(400, 200), 0, 0, cv::INTER_NEAREST);
+    const SlotReading stocked = cascade.read(large);
+    TD_CHECK_EQ(stocked.decidedBySignature, 2);
+    TD_CHECK_EQ(stocked.detections.objects.size(), 2u);
+    if (!stocked.detections.objects.empty()) {
+        TD_CHECK(stocked.detections.objects[0].bbox == cv::Rect(20, 20, 80, 80));
+    }
+
+    // A bare slot is far enough from the stocked reference to be empty.
+    const SlotReading bare = cascade.read(bareBoard());
+    TD_CHECK_EQ(bare.decidedBySignature, 2);
+    TD_CHECK(bare.detections.objects.empty());
+
+    // Not enrolled yet: nothing is read.
+    TD_CHECK(makeCascade().read(stockedBoard()).detections.objects.empty());
+}
@@ -0,0 +1,63 @@
+// test_main.cpp
+// toolsdetect_unit_tests: runs every TD_TEST, or only those whose name
+// contains one of the command-line arguments.
+
+#include "test_util.h"
+
+#include <atomic>
+#include <chrono>
+#include <system_error>
+
+namespace tdtest {
+
+std::vector<TestCase>& registry() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+int& currentFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+TempDir::TempDir(const std::string& name) {
+    static std::atomic<int> counter{0};
+    const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    path_ = std::filesystem::temp_directory_path() /
+            ("toolsdetect_test_" + name + "_" + std::to_string(stamp) + "_" +
+             std::to_string(counter.fetch_add(1)));
+    std::filesystem::create_directories(path_);
+}
+
+TempDir::~TempDir() {
+    std::error_code ec;
+    std::filesystem::remove_all(path_, ec);
+}
+
+}  // namespace tdtest
+
+int main(int argc, char** argv) {
+    int failedTests = 0;
+    int ran = 0;
+    for (const auto& test : tdtest::registry()) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc && !selected; ++i) {
+            selected = std::string(test.name).find(argv[i]) != std::string::npos;
+        }
+        if (!selected) {
+            continue;
+        }
+        ++ran;
+        tdtest::currentFailures() = 0;
+        try {
+            test.body();
+        } catch (const std::exception& ex) {
+            tdtest::reportFailure(__FILE__, __LINE__, std::string("exception: ") + ex.what());
+        }
+        const bool ok = tdtest::currentFailures() == 0;
+        std::cout << (ok ? "[ OK ] " : "[FAIL] ") << test.name << "\n";
+        failedTests += ok ? 0 : 1;
+    }
+    std::cout << ran - failedTests << "/" << ran << " tests passed\n";
+    return failedTests;
+}
@@ -0,0 +1,91 @@
+// test_util.h
+// Minimal self-registering test harness for toolsdetect_unit_tests (no
+// external framework, like the bench target). A test is a function body
+// declared with TD_TEST; failed checks are counted and reported, and the
+// process exit code is the number of failed tests.
+
+#pragma once
+
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace tdtest {
+
+struct TestCase {
+    const char* name;
+    std::function<void()> body;
+};
+
+std::vector<TestCase>& registry();
+int& currentFailures();
+
+struct Registrar {
+    Registrar(const char* name, std::function<void()> body) {
+        registry().push_back({name, std::move(body)});
+    }
+};
+
+inline void reportFailure(const char* file, int line, const std::string& what) {
+    ++currentFailures();
+    std::cerr << "  " << file << ":" << line << ": " << what << "\n";
+}
+
+// Fresh, empty directory under the system temp folder, removed by the
+// destructor.
+class TempDir {
+public:
+    explicit TempDir(const std::string& name);
+    ~TempDir();
+
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    const std::filesystem::path& path() const { return path_; }
+    std::string file(const std::string& name) const { return (path_ / name).string(); }
+
+private:
+    std::filesystem::path path_;
+};
+
+}  // namespace tdtest
+
+#define TD_TEST_CONCAT2(a, b) a##b
+#define TD_TEST_CONCAT(a, b) TD_TEST_CONCAT2(a, b)
+
+#define TD_TEST(name)                                                              \
+    static void TD_TEST_CONCAT(tdTest_, name)();                                   \
+    static ::tdtest::Registrar TD_TEST_CONCAT(tdTestReg_, name)(                    \
+        #name, &TD_TEST_CONCAT(tdTest_, name));                                    \
+    static void TD_TEST_CONCAT(tdTest_, name)()
+
+#define TD_CHECK(cond)                                                             \
+    do {                                                                           \
+        if (!(cond)) ::tdtest::reportFailure(__FILE__, __LINE__, "CHECK(" #cond ")"); \
+    } while (0)
+
+#define TD_CHECK_EQ(a, b)                                                          \
+    do {                                                                           \
+        const auto& tdA_ = (a);                                                    \
+        const auto& tdB_ = (b);                                                    \
+        if (!(tdA_ == tdB_)) {                                                     \
+            std::ostringstream tdMsg_;                                             \
+            tdMsg_ << "CHECK_EQ(" #a ", " #b "): " << tdA_ << " vs " << tdB_;      \
+            ::tdtest::reportFailure(__FILE__, __LINE__, tdMsg_.str());             \
+        }                                                                          \
+    } while (0)
+
+#define TD_CHECK_NEAR(a, b, eps)                                                   \
+    do {                                                                           \
+        const double tdA_ = static_cast<double>(a);                                \
+        const double tdB_ = static_cast<double>(b);                                \
+        if (!(std::fabs(tdA_ - tdB_) <= (eps))) {                                  \
+            std::ostringstream tdMsg_;                                             \
+            tdMsg_ << "CHECK_NEAR(" #a ", " #b "): " << tdA_ << " vs " << tdB_;    \
+            ::tdtest::reportFailure(__FILE__, __LINE__, tdMsg_.str());             \
+        }                                                                          \
+    } while (0)
@@ -0,0 +1,144 @@
+#include "trace.h"
+
+#include "test_util.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+namespace {
+
+std::string readAll(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+size_t countOf(const std::string& text, const std::string& needle) {
+    size_t n = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) ++n;
+    return n;
+}
+
+// "ts" of the first event named `name`, or -1.
+double tsOf(const std::string& json, const std::string& name) {
+    const std::string key = "\"name\":\"" + name + "\",\"ts\":";
+    const size_t pos = json.find(key);
+    return pos == std::string::npos ? -1.0 : std::stod(json.substr(pos + key.size()));
+}
+
+}  // namespace
+
+TD_TEST(trace_writes_chrome_json) {
+    tdtest::TempDir dir("trace");
+    const std::string path = dir.file("timeline.json");
+
+    TD_CHECK(!trace::enabled());
+    TD_CHECK(trace::start(path, false));
+    TD_CHECK(trace::enabled());
+    TD_CHECK(!trace::start(path, false));   // already running
+
+    std::thread worker([]() {
+        trace::setThreadName("worker \"1\"");
+        trace::Span span("test.session", "id-42");
+    });
+    worker.join();
+    trace::emitComplete("test.manual", nullptr, 10, 5);
+    trace::stop();
+    TD_CHECK(!trace::enabled());
+
+    const std::string json = readAll(path);
+    TD_CHECK_EQ(json.substr(0, 1), std::string("["));
+    TD_CHECK(json.find("\n]\n") != std::string::npos);
+    TD_CHECK(json.find("\"name\":\"process_name\"") != std::string::npos);
+    TD_CHECK(json.find("\"args\":{\"name\":\"worker \\\"1\\\"\"}") != std::string::npos);
+    TD_CHECK(json.find("\"name\":\"test.session\"") != std::string::npos);
+    TD_CHECK(json.find("\"args\":{\"id\":\"id-42\"}") != std::string::npos);
+    TD_CHECK(json.find("\"name\":\"test.manual\"") != std::string::npos);
+    TD_CHECK(json.find("\"ts\":10,\"dur\":5") != std::string::npos);
+}
+
+TD_TEST(trace_ignores_events_while_stopped) {
+    tdtest::TempDir dir("trace_off");
+    trace::emitComplete("test.before", nullptr, 0, 1);
+    const std::string path = dir.file("timeline.json");
+    TD_CHECK(trace::start(path, false));
+    trace::stop();
+    trace::emitComplete("test.after", nullptr, 0, 1);
+    const std::string json = readAll(path);
+    TD_CHECK(json.find("test.before") == std::string::npos);
+    TD_CHECK(json.find("test.after") == std::string::npos);
+}
+
+TD_TEST(trace_merges_external_profile_on_epoch) {
+    tdtest::TempDir dir("trace_ort");
+    const std::string profilePath = dir.file("ort_profile.json");
+    const std::string path = dir.file("timeline.json");
+
+    TD_CHECK(trace::start(path, true));
+    TD_CHECK(trace::ortProfilingRequested());
+    // The external profiler started 1000 us after the trace epoch.
+    const uint64_t startNs = (static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                  std::chrono::high_resolution_clock::now().time_since_epoch()).count()) -
+                              trace::nowMicros() + 1000) * 1000;
+    {
+        std::ofstream out(profilePath);
+        out << "[\n"
+            << "{\"cat\":\"Node\",\"name\":\"conv1\",\"ts\":250,\"dur\":7},\n"
+            << "{\"cat\":\"Node\",\"name\":\"conv2\",\"ts\":500,\"dur\":3}\n"
+            << "]\n";
+    }
+    int calls = 0;
+    const int token = trace::registerExternalProfile([&]() {
+        ++calls;
+        return trace::ExternalProfile{profilePath, startNs};
+    });
+    const int unused = trace::registerExternalProfile([&]() {
+        ++calls;
+        return trace::ExternalProfile{};
+    });
+    trace::unregisterExternalProfile(unused);
+    trace::stop();
+    trace::unregisterExternalProfile(token);
+
+    TD_CHECK_EQ(calls, 1);
+    TD_CHECK(!trace::ortProfilingRequested());
+    const std::string json = readAll(path);
+    TD_CHECK_EQ(countOf(json, "\"cat\":\"Node\""), 2u);
+    // Rebased by the 1000 us offset (give or take a clock tick between the
+    // two reads above).
+    TD_CHECK_NEAR(tsOf(json, "conv1"), 1250.0, 2.0);
+    TD_CHECK_NEAR(tsOf(json, "conv2"), 1500.0, 2.0);
+}
+
+TD_TEST(trace_unregister_waits_for_a_running_profile) {
+    tdtest::TempDir dir("trace_unregister");
+    TD_CHECK(trace::start(dir.file("timeline.json"), true));
+    std::atomic<bool> entered{false};
+    std::atomic<bool> finished{false};
+    const int token = trace::registerExternalProfile([&]() {
+        entered.store(true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        finished.store(true);
+        return trace::ExternalProfile{};
+    });
+    std::thread stopper([]() { trace::stop(); });
+    while (!entered.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    // The owner goes away mid-callback: unregister must not return before it.
+    trace::unregisterExternalProfile(token);
+    TD_CHECK(finished.load());
+    stopper.join();
+
+    // A source unregistered before stop() is never called.
+    TD_CHECK(trace::start(dir.file("timeline2.json"), true));
+    int calls = 0;
+    const int gone = trace::registerExternalProfile([&]() {
+        ++calls;
+        return trace::ExternalProfile{};
+    });
+    trace::unregisterExternalProfile(gone);
+    trace::stop();
+    TD_CHECK_EQ(calls, 0);
+}
@@ -0,0 +1,164 @@
+#include "tracker.h"
+
+#include "test_util.h"
+
+namespace {
+
+DetectedObject det(const std::string& cls, float confidence, int x, int y, int w = 40, int h = 80) {
+    DetectedObject obj;
+    obj.cls = cls;
+    obj.confidence = confidence;
+    obj.bbox = cv::Rect(x, y, w, h);
+    return obj;
+}
+
+DetectionResult frameOf(std::vector<DetectedObject> objects) {
+    DetectionResult result;
+    result.objects = std::move(objects);
+    return result;
+}
+
+const DetectedObject* findTrack(const DetectionResult& result, int trackId) {
+    for (const auto& obj : result.objects) {
+        if (obj.trackId == trackId) return &obj;
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+TD_TEST(tracker_keeps_ids_across_keyframes) {
+    MultiObjectTracker tracker;
+    tracker.update(frameOf({det("pliers", 0.9f, 100, 100), det("wrench", 0.8f, 400, 100)}));
+    const DetectionResult first = tracker.trackedObjects();
+    TD_CHECK_EQ(first.objects.size(), 2u);   // first keyframe counts immediately
+
+    for (int step = 1; step <= 3; ++step) {
+        tracker.update(frameOf({det("pliers", 0.9f, 100 + 4 * step, 100),
+                                det("wrench", 0.8f, 400 - 4 * step, 100)}));
+    }
+    const DetectionResult later = tracker.trackedObjects();
+    TD_CHECK_EQ(later.objects.size(), 2u);
+    for (const auto& obj : first.objects) {
+        const DetectedObject* same = findTrack(later, obj.trackId);
+        TD_CHECK(same != nullptr);
+        if (same) TD_CHECK_EQ(same->cls, obj.cls);
+    }
+    TD_CHECK_EQ(tracker.countsByClass().at("pliers"), 1);
+}
+
+TD_TEST(tracker_low_scores_only_extend_tracks) {
+    MultiObjectTracker tracker;
+    tracker.update(frameOf({det("pliers", 0.9f, 100, 100)}));
+    const int id = tracker.trackedObjects().objects.at(0).trackId;
+
+    // An occluded tool scores 0.3: it keeps its track, but a weak box
+    // elsewhere does not start a new one.
+    for (int i = 0; i < 4; ++i) {
+        tracker.update(frameOf({det("pliers", 0.3f, 102, 100), det("wrench", 0.3f, 500, 300)}));
+    }
+    const auto tracks = tracker.tracks();
+    TD_CHECK_EQ(tracks.size(), 1u);
+    TD_CHECK_EQ(tracks.at(0).id, id);
+    TD_CHECK_EQ(tracks.at(0).lostKeyframes, 0);
+    TD_CHECK_NEAR(tracks.at(0).confidence, 0.3, 1e-6);
+
+    // Below lowThreshold the detection is ignored entirely.
+    tracker.update(frameOf({det("pliers", 0.05f, 102, 100)}));
+    const int lost = tracker.tracks().at(0).lostKeyframes;
+    TD_CHECK_EQ(lost, 1);
+}
+
+TD_TEST(tracker_class_is_majority_vote) {
+    MultiObjectTracker tracker;
+    tracker.update(frameOf({det("pliers", 0.9f, 100, 100)}));
+    tracker.update(frameOf({det("wrench", 0.9f, 100, 100)}));
+    const std::string tied = tracker.tracks().at(0).cls;
+    TD_CHECK_EQ(tied, std::string("pliers"));   // a tie keeps the old class
+    tracker.update(frameOf({det("wrench", 0.9f, 100, 100)}));
+    const DetectionResult result = tracker.trackedObjects();
+    TD_CHECK_EQ(result.objects.size(), 1u);
+    if (!result.objects.empty()) TD_CHECK_EQ(result.objects[0].cls, std::string("wrench"));
+}
+
+TD_TEST(tracker_drops_lost_and_tentative_tracks) {
+    TrackerConfig config;
+    MultiObjectTracker tracker(config);
+    tracker.update(frameOf({det("pliers", 0.9f, 100, 100)}));
+
+    // Grace period: still counted after one missed keyframe, not after two.
+    tracker.update(frameOf({}));
+    TD_CHECK_EQ(tracker.trackedObjects().objects.size(), 1u);
+    tracker.update(frameOf({}));
+    TD_CHECK(tracker.trackedObjects().objects.empty());
+    while (tracker.tracks().at(0).lostKeyframes < config.maxLostKeyframes) tracker.update(frameOf({}));
+    TD_CHECK_EQ(tracker.tracks().size(), 1u);
+    tracker.update(frameOf({}));
+    TD_CHECK(tracker.tracks().empty());
+
+    // After the first keyframe a new track needs minHits before it counts,
+    // and a tentative track dies on its first miss.
+    tracker.update(frameOf({det("wrench", 0.9f, 300, 100)}));
+    TD_CHECK(tracker.trackedObjects().objects.empty());
+    TD_CHECK_EQ(tracker.tracks().size(), 1u);
+    tracker.update(frameOf({}));
+    TD_CHECK(tracker.tracks().empty());
+}
+
+TD_TEST(tracker_decays_confidence_between_keyframes) {
+    TrackerConfig config;
+    MultiObjectTracker tracker(config);
+    TD_CHECK_NEAR(tracker.minConfidence(), 1.0, 1e-9);
+    tracker.update(frameOf({det("pliers", 0.8f, 100, 100)}));
+    tracker.predict();
+    tracker.predict();
+    TD_CHECK_NEAR(tracker.minConfidence(), 0.8 * config.confidenceDecay * config.confidenceDecay, 1e-5);
+    // A static tool stays where it was.
+    const cv::Rect box = tracker.trackedObjects().objects.at(0).bbox;
+    TD_CHECK(std::abs(box.x - 100) <= 1 && std::abs(box.y - 100) <= 1);
+}
+
+TD_TEST(tracker_carries_oriented_boxes) {
+    DetectedObject rotated = det("screwdriver", 0.9f, 80, 120, 80, 40);
+    rotated.oriented = true;
+    rotated.obb = cv::RotatedRect(cv::Point2f(120, 140), cv::Size2f(90, 20), 30.0f);
+
+    MultiObjectTracker tracker;
+    tracker.update(frameOf({rotated}));
+    tracker.predict();
+    const DetectionResult result = tracker.trackedObjects();
+    TD_CHECK_EQ(result.objects.size(), 1u);
+    if (result.objects.empty()) return;
+    const DetectedObject& obj = result.objects[0];
+    TD_CHECK(obj.oriented);
+    TD_CHECK_NEAR(obj.obb.angle, 30.0, 1e-6);
+    TD_CHECK_NEAR(obj.obb.size.width, 90.0, 1e-6);
+    TD_CHECK_NEAR(obj.obb.size.height, 20.0, 1e-6);
+    TD_CHECK_NEAR(obj.obb.center.x, 120.0, 1.0);
+    TD_CHECK_NEAR(obj.obb.center.y, 140.0, 1.0);
+
+    // An axis-aligned match clears the flag again.
+    tracker.update(frameOf({det("screwdriver", 0.9f, 80, 120, 80, 40)}));
+    TD_CHECK(!tracker.trackedObjects().objects.at(0).oriented);
+}
+
+TD_TEST(keyframe_scheduler_stride_and_confidence) {
+    MultiObjectTracker tracker;
+    KeyframeScheduler every3(3, 0.3f);
+    std::vector<bool> keys;
+    for (int i = 0; i < 7; ++i) keys.push_back(every3.isKeyframe(tracker));
+    TD_CHECK(keys == std::vector<bool>({true, false, false, true, false, false, true}));
+
+    // A decayed track forces the next frame to be a keyframe.
+    tracker.update(frameOf({det("pliers", 0.9f, 100, 100)}));
+    tracker.update(frameOf({det("pliers", 0.31f, 100, 100)}));
+    KeyframeScheduler scheduler(10, 0.3f);
+    TD_CHECK(scheduler.isKeyframe(tracker));
+    TD_CHECK(!scheduler.isKeyframe(tracker));
+    tracker.predict();   // 0.31 * 0.95 < 0.3
+    TD_CHECK(scheduler.isKeyframe(tracker));
+
+    KeyframeScheduler always(1, 0.0f);
+    TD_CHECK(always.isKeyframe(tracker));
+    TD_CHECK(always.isKeyframe(tracker));
+}
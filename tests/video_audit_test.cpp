@@ -0,0 +1,147 @@
+#include "video_audit.h"
+
+#include "test_util.h"
+
+#include <limits>
+
+namespace {
+
+constexpr int64_t kOpenEnd = std::numeric_limits<int64_t>::max();
+
+DetectionResult toolsOf(int wrenches) {
+    DetectionResult result;
+    for (int i = 0; i < wrenches; ++i) {
+        DetectedObject obj;
+        obj.cls = "wrench";
+        obj.confidence = 0.9f;
+        obj.bbox = cv::Rect(10 + 50 * i, 10, 40, 40);
+        result.objects.push_back(obj);
+    }
+    return result;
+}
+
+#if TOOLSDETECT_HAS_VIDEOIO
+// A capture whose seeks land on the next keyframe at or after the request,
+// as some backends do, or that cannot report its position at all.
+class FakeCapture : public cv::VideoCapture {
+public:
+    FakeCapture(int64_t keyframeEvery, bool reportsPosition)
+        : keyframeEvery_(keyframeEvery), reportsPosition_(reportsPosition) {}
+
+    bool open(const std::string&, int = 0) override {
+        ++opens;
+        position = 0;
+        return true;
+    }
+    bool isOpened() const override { return true; }
+    bool grab() override {
+        ++position;
+        ++grabs;
+        return true;
+    }
+    bool set(int prop, double value) override {
+        if (prop != cv::CAP_PROP_POS_FRAMES) return false;
+        const auto request = static_cast<int64_t>(value);
+        position = (request + keyframeEvery_ - 1) / keyframeEvery_ * keyframeEvery_;
+        return true;
+    }
+    double get(int prop) const override {
+        if (prop != cv::CAP_PROP_POS_FRAMES || !reportsPosition_) return -1;
+        return static_cast<double>(position);
+    }
+    void release() override {}
+
+    int64_t position = 0;
+    int grabs = 0;
+    int opens = 0;
+
+private:
+    int64_t keyframeEvery_;
+    bool reportsPosition_;
+};
+#endif
+
+}  // namespace
+
+TD_TEST(audit_segments_split_evenly_and_leave_the_last_open) {
+    // 2 workers -> at most 8 ranges; 800 frames split into 100 each.
+    const std::vector<AuditSegment> even = planAuditSegments(800, 2, 50);
+    TD_CHECK_EQ(even.size(), 8u);
+    for (size_t i = 0; i + 1 < even.size(); ++i) {
+        TD_CHECK_EQ(even[i].begin, static_cast<int64_t>(100 * i));
+        TD_CHECK_EQ(even[i].end, even[i + 1].begin);
+    }
+    TD_CHECK_EQ(even.back().begin, int64_t(700));
+    TD_CHECK_EQ(even.back().end, kOpenEnd);   // the frame count is an estimate
+
+    // A remainder goes to the last range; none is shorter than minFrames.
+    const std::vector<AuditSegment> remainder = planAuditSegments(250, 8, 100);
+    TD_CHECK_EQ(remainder.size(), 2u);
+    TD_CHECK_EQ(remainder[0].begin, int64_t(0));
+    TD_CHECK_EQ(remainder[0].end, int64_t(125));
+    TD_CHECK_EQ(remainder[1].begin, int64_t(125));
+    TD_CHECK_EQ(remainder[1].end, kOpenEnd);
+
+    const std::vector<AuditSegment> odd = planAuditSegments(10, 1, 1);
+    TD_CHECK_EQ(odd.size(), 4u);   // ceil(10 / 4) = 3 frames per range
+    TD_CHECK_EQ(odd[3].begin, int64_t(9));
+
+    // Shorter than one range, or an unknown count: one open-ended range.
+    const std::vector<AuditSegment> tiny = planAuditSegments(30, 4, 100);
+    TD_CHECK_EQ(tiny.size(), 1u);
+    TD_CHECK_EQ(tiny[0].end, kOpenEnd);
+    const std::vector<AuditSegment> unknown = planAuditSegments(0, 4, 100);
+    TD_CHECK_EQ(unknown.size(), 1u);
+    TD_CHECK_EQ(unknown[0].begin, int64_t(0));
+    TD_CHECK_EQ(unknown[0].end, kOpenEnd);
+}
+
+TD_TEST(inventory_timeline_counts_frames_without_detections_as_zero) {
+    InventoryTimeline timeline;
+    // Minute 0: two frames with one wrench, three with none -> 0.
+    timeline.add(0, toolsOf(1));
+    timeline.add(0, toolsOf(1));
+    for (int i = 0; i < 3; ++i) timeline.add(0, DetectionResult());
+    // Minute 1: mostly two wrenches, one frame missed one of them.
+    timeline.add(1, toolsOf(2));
+    timeline.add(1, toolsOf(1));
+    timeline.add(1, toolsOf(2));
+    // Minute 2: a tie between 0 and 3 keeps the smaller count.
+    timeline.add(2, toolsOf(3));
+    timeline.add(2, DetectionResult());
+
+    TD_CHECK_EQ(timeline.frames(0), 5);
+    TD_CHECK_EQ(timeline.modeCount(0, "wrench"), 0);
+    TD_CHECK_EQ(timeline.frames(1), 3);
+    TD_CHECK_EQ(timeline.modeCount(1, "wrench"), 2);
+    TD_CHECK_EQ(timeline.modeCount(2, "wrench"), 0);
+    TD_CHECK_EQ(timeline.modeCount(1, "pliers"), 0);
+    TD_CHECK_EQ(timeline.frames(7), 0);
+
+    tdtest::TempDir dir("inventory_timeline");
+    TD_CHECK(timeline.write(dir.file("inventory.csv")));
+}
+
+#if TOOLSDETECT_HAS_VIDEOIO
+TD_TEST(seek_backs_off_to_an_earlier_keyframe) {
+    // Keyframes every 100 frames: a request for 250 lands on 300, so the
+    // seek steps back until it lands on 200 and grabs 50 frames forward.
+    FakeCapture cap(100, true);
+    TD_CHECK(seekToFrame(cap, "clip.mp4", 250));
+    TD_CHECK_EQ(cap.position, int64_t(250));
+    TD_CHECK_EQ(cap.grabs, 50);
+    TD_CHECK_EQ(cap.opens, 0);
+
+    // Exactly on a keyframe: no grabs.
+    FakeCapture exact(100, true);
+    TD_CHECK(seekToFrame(exact, "clip.mp4", 300));
+    TD_CHECK_EQ(exact.grabs, 0);
+
+    // No position reported: reopened and decoded from the start.
+    FakeCapture blind(100, false);
+    TD_CHECK(seekToFrame(blind, "clip.mp4", 40));
+    TD_CHECK_EQ(blind.opens, 1);
+    TD_CHECK_EQ(blind.grabs, 40);
+    TD_CHECK_EQ(blind.position, int64_t(40));
+}
+#endif
@@ -0,0 +1,51 @@
+#include "watch_daemon.h"
+
+#include "logger.h"
+#include "test_util.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+void writeGarbage(const std::string& path) {
+    std::ofstream(path, std::ios::binary) << "not an image";
+}
+
+WatchDaemonOptions drainOptions(const tdtest::TempDir& dir) {
+    WatchDaemonOptions options;
+    options.watchDir = dir.file("inbox");
+    options.resultsDir = dir.file("results");
+    options.workers = 1;
+    options.pollIntervalMs = 10;
+    options.forcePolling = true;
+    options.exitWhenIdle = true;
+    return options;
+}
+
+}  // namespace
+
+TD_TEST(watch_daemon_retires_pairs_and_skips_them_after_restart) {
+    tdtest::TempDir dir("watch");
+    fs::create_directories(dir.path() / "inbox");
+    fs::create_directories(dir.path() / "results");
+    writeGarbage(dir.file("inbox/s1_before.jpg"));
+    writeGarbage(dir.file("inbox/s1_after.jpg"));
+    writeGarbage(dir.file("inbox/orphan_before.jpg"));
+    Logger logger(dir.file("log.txt"));
+
+    TD_CHECK_EQ(runWatchDaemon(drainOptions(dir), logger), 0);
+    // Undecodable pair: moved aside, not left for the next run.
+    TD_CHECK(fs::exists(dir.path() / "inbox/failed/s1_before.jpg"));
+    TD_CHECK(fs::exists(dir.path() / "inbox/failed/s1_after.jpg"));
+    TD_CHECK(!fs::exists(dir.path() / "inbox/s1_before.jpg"));
+    TD_CHECK(fs::exists(dir.path() / "inbox/orphan_before.jpg"));
+
+    // A restart finds nothing new; the retired pair is not touched again.
+    const auto stamp = fs::last_write_time(dir.path() / "inbox/failed/s1_before.jpg");
+    TD_CHECK_EQ(runWatchDaemon(drainOptions(dir), logger), 0);
+    TD_CHECK(fs::last_write_time(dir.path() / "inbox/failed/s1_before.jpg") == stamp);
+    TD_CHECK(fs::exists(dir.path() / "inbox/orphan_before.jpg"));
+}
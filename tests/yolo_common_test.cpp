@@ -0,0 +1,288 @@
+#include "yolo_common.h"
+
+#include "test_util.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+
+namespace {
+
+YoloResult orientedDet(float score, float cx, float cy, float w, float h, float angle) {
+    YoloResult r;
+    r.class_id = 0;
+    r.score = score;
+    r.oriented = true;
+    r.obb = cv::RotatedRect(cv::Point2f(cx, cy), cv::Size2f(w, h), angle);
+    r.box = r.obb.boundingRect();
+    return r;
+}
+
+// Protobuf helpers for a hand-made ONNX ModelProto.
+void putVarint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+void putBytes(std::string& out, int field, const std::string& bytes) {
+    putVarint(out, (static_cast<uint64_t>(field) << 3) | 2);
+    putVarint(out, bytes.size());
+    out += bytes;
+}
+
+std::string metadataEntry(const std::string& key, const std::string& value) {
+    std::string entry;
+    putBytes(entry, 1, key);
+    putBytes(entry, 2, value);
+    return entry;
+}
+
+// A wide BGR gradient: letterboxed into a square input it leaves grey
+// padding bands above and below.
+cv::Mat gradientImage(int w, int h) {
+    cv::Mat image(h, w, CV_8UC3);
+    for (int y = 0; y < h; ++y) {
+        uint8_t* p = image.ptr<uint8_t>(y);
+        for (int x = 0; x < w; ++x) {
+            p[3 * x] = static_cast<uint8_t>(40 + (x * 3) % 200);
+            p[3 * x + 1] = static_cast<uint8_t>(90 + (y * 5) % 150);
+            p[3 * x + 2] = static_cast<uint8_t>(10 + (x + y) % 240);
+        }
+    }
+    return image;
+}
+
+// A textured scene under a warm light: every pixel is a grey level scaled
+// by (0.7, 1.0, 1.3) in B, G, R.
+cv::Mat warmImage(int w, int h) {
+    cv::Mat image(h, w, CV_8UC3);
+    for (int y = 0; y < h; ++y) {
+        uint8_t* p = image.ptr<uint8_t>(y);
+        for (int x = 0; x < w; ++x) {
+            const int level = 60 + (x * 5 + y * 3) % 120;
+            p[3 * x] = static_cast<uint8_t>(level * 7 / 10);
+            p[3 * x + 1] = static_cast<uint8_t>(level);
+            p[3 * x + 2] = static_cast<uint8_t>(level * 13 / 10);
+        }
+    }
+    return image;
+}
+
+// Sets the process-wide lighting mode for one test and turns it off again.
+struct LightingScope {
+    explicit LightingScope(const LightingConfig& config) { setLightingNormalization(config); }
+    ~LightingScope() { setLightingNormalization(LightingConfig()); }
+};
+
+// Mean of each channel of a 0..1 or 0..255 tensor, in tensor (RGB) order.
+template <typename T>
+std::array<double, 3> channelMeans(const std::vector<T>& tensor, size_t plane, TensorLayout layout) {
+    std::array<double, 3> mean{};
+    for (int c = 0; c < 3; ++c) {
+        for (size_t i = 0; i < plane; ++i) {
+            mean[c] += layout == TensorLayout::NCHW ? tensor[c * plane + i] : tensor[i * 3 + c];
+        }
+        mean[c] /= static_cast<double>(plane);
+    }
+    return mean;
+}
+
+double spread(const std::array<double, 3>& mean) {
+    return *std::max_element(mean.begin(), mean.end()) - *std::min_element(mean.begin(), mean.end());
+}
+
+}  // namespace
+
+TD_TEST(rotated_iou_of_rectangles) {
+    const cv::RotatedRect a(cv::Point2f(50, 50), cv::Size2f(100, 10), 0.0f);
+    TD_CHECK_NEAR(rotatedIou(a, a), 1.0, 1e-5);
+    // The same rectangle described a quarter turn later.
+    TD_CHECK_NEAR(rotatedIou(a, cv::RotatedRect(cv::Point2f(50, 50), cv::Size2f(10, 100), 90.0f)), 1.0, 1e-4);
+    // A cross: 10x10 overlap of two 100x10 bars.
+    const cv::RotatedRect cross(cv::Point2f(50, 50), cv::Size2f(100, 10), 90.0f);
+    TD_CHECK_NEAR(rotatedIou(a, cross), 100.0 / 1900.0, 1e-4);
+    TD_CHECK_NEAR(rotatedIou(a, cv::RotatedRect(cv::Point2f(300, 50), cv::Size2f(100, 10), 0.0f)), 0.0, 1e-9);
+    // Half shifted along its length: 50x10 of 100x10 each.
+    TD_CHECK_NEAR(rotatedIou(a, cv::RotatedRect(cv::Point2f(100, 50), cv::Size2f(100, 10), 0.0f)), 500.0 / 1500.0, 1e-4);
+}
+
+TD_TEST(rotated_nms_keeps_parallel_diagonal_tools) {
+    // Two thin tools lying side by side at 45 degrees: their axis-aligned
+    // bounds overlap heavily, the rotated boxes do not.
+    std::vector<YoloResult> dets = {
+        orientedDet(0.9f, 100, 100, 200, 12, 45.0f),
+        orientedDet(0.8f, 115, 85, 200, 12, 45.0f),
+    };
+    TD_CHECK(rotatedIou(dets[0].obb, dets[1].obb) < 0.05f);
+    TD_CHECK_EQ(nms(dets, 0.45f).size(), 1u);
+    TD_CHECK_EQ(nmsRotated(dets, 0.45f).size(), 2u);
+
+    // A near-duplicate of the first is suppressed; the best score wins.
+    dets.push_back(orientedDet(0.95f, 101, 101, 198, 12, 46.0f));
+    const std::vector<int> keep = nmsRotated(dets, 0.45f);
+    TD_CHECK_EQ(keep.size(), 2u);
+    if (keep.size() == 2) {
+        TD_CHECK_EQ(keep[0], 2);
+        TD_CHECK_EQ(keep[1], 1);
+    }
+    TD_CHECK(nmsRotated({}, 0.45f).empty());
+}
+
+TD_TEST(axis_aligned_nms_is_greedy_by_score) {
+    std::vector<YoloResult> dets(3);
+    dets[0].score = 0.6f;
+    dets[0].box = cv::Rect(0, 0, 100, 100);
+    dets[1].score = 0.9f;
+    dets[1].box = cv::Rect(10, 10, 100, 100);
+    dets[2].score = 0.7f;
+    dets[2].box = cv::Rect(300, 0, 50, 50);
+    const std::vector<int> keep = nms(dets, 0.45f);
+    TD_CHECK(keep == std::vector<int>({1, 2}));
+}
+
+TD_TEST(onnx_metadata_lookup_skips_the_graph) {
+    tdtest::TempDir dir("onnx_meta");
+    std::string model;
+    putVarint(model, (1 << 3) | 0);   // ir_version = 8
+    putVarint(model, 8);
+    putBytes(model, 2, "pytorch");    // producer_name
+    putBytes(model, 7, std::string(5000, '\x07'));   // graph: opaque bytes
+    putBytes(model, 14, metadataEntry("stride", "32"));
+    putBytes(model, 14, metadataEntry("task", "obb"));
+    const std::string path = dir.file("model.onnx");
+    std::ofstream(path, std::ios::binary) << model;
+
+    std::string value;
+    TD_CHECK(readOnnxMetadata(path, "task", value));
+    TD_CHECK_EQ(value, std::string("obb"));
+    TD_CHECK(readOnnxMetadata(path, "stride", value));
+    TD_CHECK_EQ(value, std::string("32"));
+    TD_CHECK(!readOnnxMetadata(path, "names", value));
+    TD_CHECK(!readOnnxMetadata(dir.file("missing.onnx"), "task", value));
+
+    // A truncated file is not misread.
+    std::ofstream(path, std::ios::binary) << model.substr(0, model.size() - 4);
+    TD_CHECK(!readOnnxMetadata(path, "task", value));
+}
+
+TD_TEST(utf8_and_wide_paths_round_trip) {
+    const std::string utf8 = "models/\xE5\xB7\xA5\xE5\x85\xB7/tools \xF0\x9F\x94\xA7.onnx";   // 工具, U+1F527
+    const std::wstring wide = utf8ToWide(utf8);
+    TD_CHECK(wide.substr(0, 7) == L"models/");
+    TD_CHECK(wide[7] == static_cast<wchar_t>(0x5DE5));
+    TD_CHECK_EQ(wideToUtf8(wide), utf8);
+    TD_CHECK(utf8ToWide("plain.onnx") == L"plain.onnx");
+    TD_CHECK(utf8ToWide("").empty());
+
+    // Each byte of a truncated sequence becomes U+FFFD; what follows survives.
+    const std::wstring broken = utf8ToWide("a\xE5\xB7" "b");
+    TD_CHECK(broken == std::wstring({L'a', wchar_t(0xFFFD), wchar_t(0xFFFD), L'b'}));
+}
+
+TD_TEST(uint8_input_matches_the_float_tensor) {
+    const int w = 32, h = 32;
+    const size_t plane = static_cast<size_t>(w) * h;
+    const cv::Mat image = gradientImage(64, 30);
+    std::vector<float> f;
+    preprocess(image, f, w, h);
+    std::vector<uint8_t> nchw(3 * plane);
+    std::vector<uint8_t> nhwc(3 * plane);
+    preprocessLetterboxU8(image, nchw.data(), w, h, TensorLayout::NCHW);
+    preprocessLetterboxU8(image, nhwc.data(), w, h, TensorLayout::NHWC);
+
+    int mismatches = 0;
+    for (int c = 0; c < 3; ++c) {
+        for (size_t i = 0; i < plane; ++i) {
+            const long expect = std::lround(f[c * plane + i] * 255.0f);
+            if (nchw[c * plane + i] != expect || nhwc[i * 3 + c] != expect) ++mismatches;
+        }
+    }
+    TD_CHECK_EQ(mismatches, 0);
+    // Row 0 is letterbox padding: plain grey in every channel of both layouts.
+    TD_CHECK_EQ(int(nchw[0]), 114);
+    TD_CHECK_EQ(int(nchw[2 * plane]), 114);
+    TD_CHECK_EQ(int(nhwc[1]), 114);
+    TD_CHECK_NEAR(f[plane], 114.0 / 255.0, 1e-6);
+}
+
+TD_TEST(lighting_off_keeps_the_plain_letterbox_tensor) {
+    // Before lighting normalization the float tensor was the RGB canvas
+    // through convertTo(CV_32F, 1.0f / 255.0f); "off" must keep those bits.
+    const int w = 32, h = 32;
+    const size_t plane = static_cast<size_t>(w) * h;
+    const cv::Mat image = gradientImage(64, 30);
+    std::vector<float> f;
+    preprocess(image, f, w, h);
+    std::vector<uint8_t> rgb(3 * plane);
+    preprocessLetterboxU8(image, rgb.data(), w, h, TensorLayout::NHWC);
+
+    int mismatches = 0;
+    for (int c = 0; c < 3; ++c) {
+        for (size_t i = 0; i < plane; ++i) {
+            if (f[c * plane + i] != static_cast<float>(rgb[i * 3 + c]) * (1.0f / 255.0f)) ++mismatches;
+        }
+    }
+    TD_CHECK_EQ(mismatches, 0);
+}
+
+TD_TEST(gray_world_neutralizes_a_colour_cast) {
+    const int w = 64, h = 64;
+    const size_t plane = static_cast<size_t>(w) * h;
+    const cv::Mat image = warmImage(w, h);   // fills the input: no padding
+    std::vector<float> f;
+    std::vector<uint8_t> nchw(3 * plane);
+    std::vector<uint8_t> nhwc(3 * plane);
+    preprocess(image, f, w, h);
+    TD_CHECK(spread(channelMeans(f, plane, TensorLayout::NCHW)) > 0.15);
+
+    LightingConfig config;
+    config.mode = LightingMode::GrayWorld;
+    LightingScope scope(config);
+    preprocess(image, f, w, h);
+    preprocessLetterboxU8(image, nchw.data(), w, h, TensorLayout::NCHW);
+    preprocessLetterboxU8(image, nhwc.data(), w, h, TensorLayout::NHWC);
+    TD_CHECK(spread(channelMeans(f, plane, TensorLayout::NCHW)) < 0.01);
+    TD_CHECK(spread(channelMeans(nchw, plane, TensorLayout::NCHW)) < 2.5);
+    TD_CHECK(spread(channelMeans(nhwc, plane, TensorLayout::NHWC)) < 2.5);
+    // Both layouts come from the same tables.
+    int mismatches = 0;
+    for (int c = 0; c < 3; ++c) {
+        for (size_t i = 0; i < plane; ++i) {
+            if (nchw[c * plane + i] != nhwc[i * 3 + c]) ++mismatches;
+        }
+    }
+    TD_CHECK_EQ(mismatches, 0);
+
+    // The letterbox padding keeps its plain grey.
+    const cv::Mat wide = gradientImage(64, 30);
+    preprocessLetterboxU8(wide, nchw.data(), w, h, TensorLayout::NCHW);
+    preprocessLetterboxU8(wide, nhwc.data(), w, h, TensorLayout::NHWC);
+    TD_CHECK_EQ(int(nchw[2 * plane]), 114);
+    TD_CHECK_EQ(int(nhwc[0]), 114);
+}
+
+TD_TEST(reference_patch_makes_the_patch_neutral) {
+    // A grey card under the warm light in the left quarter, a red scene in
+    // the rest: gray world would follow the scene, the patch only the card.
+    const int w = 64, h = 64;
+    const size_t plane = static_cast<size_t>(w) * h;
+    cv::Mat image(h, w, CV_8UC3, cv::Scalar(40, 80, 200));
+    image(cv::Rect(0, 0, w / 4, h)).setTo(cv::Scalar(70, 100, 140));
+    LightingConfig config;
+    TD_CHECK(parseLightingSpec("patch:0,0,0.25,1", config));
+    LightingScope scope(config);
+
+    std::vector<float> f;
+    std::vector<uint8_t> nhwc(3 * plane);
+    preprocess(image, f, w, h);
+    preprocessLetterboxU8(image, nhwc.data(), w, h, TensorLayout::NHWC);
+    const size_t card = static_cast<size_t>(h / 2) * w + 4;
+    TD_CHECK_NEAR(f[card], f[plane + card], 0.01);
+    TD_CHECK_NEAR(f[2 * plane + card], f[plane + card], 0.01);
+    TD_CHECK(std::abs(int(nhwc[card * 3]) - int(nhwc[card * 3 + 1])) <= 2);
+    TD_CHECK(std::abs(int(nhwc[card * 3 + 2]) - int(nhwc[card * 3 + 1])) <= 2);
+    TD_CHECK(f[card + w / 2] > f[2 * plane + card + w / 2]);   // the scene stays red
+}
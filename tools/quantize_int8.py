@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Static INT8 (QDQ) quantization of the ToolsDetect YOLO model.
+
+Input is the calibration folder written by ``toolsdetect_test --calibrate``:
+``calib_*.npy`` float32 [1,3,H,W] tensors that went through the same
+letterbox preprocessing as inference. The output goes next to the FP32 model
+as ``<name>.int8.onnx``, which the ort backend picks up automatically
+(``--precision auto``).
+
+    pip install onnxruntime onnx numpy
+    toolsdetect_test --calibrate calib --calib-from session.tdrec
+    python tools/quantize_int8.py --model best.onnx --calib calib
+
+Then check accuracy and speed on a labelled folder:
+
+    toolsdetect_bench --model best.onnx --labels labelled/ --filter macro/quant
+"""
+
+import argparse
+import glob
+import os
+import sys
+
+import numpy as np
+
+try:
+    from onnxruntime.quantization import (CalibrationDataReader, CalibrationMethod,
+                                          QuantFormat, QuantType, quantize_static)
+    from onnxruntime.quantization.shape_inference import quant_pre_process
+except ImportError:
+    sys.exit("onnxruntime is required: pip install onnxruntime onnx numpy")
+
+
+class NpyFolderReader(CalibrationDataReader):
+    """Feeds calib_*.npy tensors one by one to the calibrator."""
+
+    def __init__(self, folder, input_name):
+        self.paths = sorted(glob.glob(os.path.join(folder, "calib_*.npy")))
+        self.input_name = input_name
+        self.index = 0
+
+    def get_next(self):
+        if self.index >= len(self.paths):
+            return None
+        tensor = np.load(self.paths[self.index]).astype(np.float32)
+        self.index += 1
+        return {self.input_name: tensor}
+
+    def rewind(self):
+        self.index = 0
+
+
+def int8_path_for(model_path):
+    base = model_path[:-5] if model_path.endswith(".onnx") else model_path
+    return base + ".int8.onnx"
+
+
+def model_input_name(model_path):
+    import onnx
+    model = onnx.load(model_path, load_external_data=False)
+    initializers = {init.name for init in model.graph.initializer}
+    for inp in model.graph.input:
+        if inp.name not in initializers:
+            return inp.name
+    raise RuntimeError("model has no graph input")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--model", required=True, help="FP32 ONNX model")
+    parser.add_argument("--calib", required=True, help="folder written by --calibrate")
+    parser.add_argument("--out", help="output path (default: <model>.int8.onnx)")
+    parser.add_argument("--method", choices=["minmax", "entropy", "percentile"],
+                        default="percentile",
+                        help="activation range estimation (default: percentile)")
+    parser.add_argument("--per-tensor", action="store_true",
+                        help="per-tensor weight scales instead of per-channel")
+    parser.add_argument("--exclude", nargs="*", default=[],
+                        help="node names to keep in FP32 (e.g. the detection head)")
+    args = parser.parse_args()
+
+    reader = NpyFolderReader(args.calib, model_input_name(args.model))
+    if not reader.paths:
+        sys.exit("no calib_*.npy files in " + args.calib)
+    out_path = args.out or int8_path_for(args.model)
+
+    # Shape inference + graph cleanup first; the quantizer places QDQ pairs
+    # more precisely on the optimized graph.
+    prepared = out_path + ".prep.onnx"
+    quant_pre_process(args.model, prepared)
+
+    methods = {
+        "minmax": CalibrationMethod.MinMax,
+        "entropy": CalibrationMethod.Entropy,
+        "percentile": CalibrationMethod.Percentile,
+    }
+    print("[INFO] Calibrating with %d samples (%s)" % (len(reader.paths), args.method))
+    try:
+        quantize_static(
+            prepared,
+            out_path,
+            reader,
+            quant_format=QuantFormat.QDQ,
+            activation_type=QuantType.QUInt8,
+            weight_type=QuantType.QInt8,
+            per_channel=not args.per_tensor,
+            calibrate_method=methods[args.method],
+            nodes_to_exclude=args.exclude,
+        )
+    finally:
+        if os.path.exists(prepared):
+            os.remove(prepared)
+    print("[INFO] Wrote " + out_path)
+
+
+if __name__ == "__main__":
+    main()
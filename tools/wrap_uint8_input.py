@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Give an exported YOLO model a uint8 input with normalization in the graph.
+
+The wrapped model takes raw RGB bytes (what the letterbox produces anyway)
+and starts with Cast -> Mul(1/255) (plus a Transpose for NHWC) in front of
+the original network. YoloInfer detects the uint8 input at load time and
+skips the float conversion pass; the input tensor shrinks to a quarter.
+
+    pip install onnx
+    python tools/wrap_uint8_input.py --model best.onnx                 # best.u8.onnx, NCHW
+    python tools/wrap_uint8_input.py --model best.onnx --layout nhwc
+
+Works the same on a QDQ model from quantize_int8.py (best.int8.onnx ->
+best.int8.u8.onnx); --precision / the .int8.onnx lookup then need --model to
+name the wrapped file explicitly.
+"""
+
+import argparse
+import copy
+import sys
+
+try:
+    import onnx
+    from onnx import TensorProto, helper
+except ImportError:
+    sys.exit("onnx is required: pip install onnx")
+
+
+def wrapped_path_for(model_path):
+    base = model_path[:-5] if model_path.endswith(".onnx") else model_path
+    return base + ".u8.onnx"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--model", required=True, help="float32-input ONNX model")
+    parser.add_argument("--out", help="output path (default: <model>.u8.onnx)")
+    parser.add_argument("--layout", choices=["nchw", "nhwc"], default="nchw",
+                        help="layout of the new uint8 input (default: nchw)")
+    args = parser.parse_args()
+
+    model = onnx.load(args.model)
+    graph = model.graph
+    initializers = {init.name for init in graph.initializer}
+    inputs = [inp for inp in graph.input if inp.name not in initializers]
+    if len(inputs) != 1:
+        sys.exit("expected exactly one graph input, found %d" % len(inputs))
+    old_input = inputs[0]
+    tensor_type = old_input.type.tensor_type
+    if tensor_type.elem_type != TensorProto.FLOAT:
+        sys.exit("input %s is not float32; already wrapped?" % old_input.name)
+
+    # Keep symbolic/fixed dims of the original [N,3,H,W] input.
+    dims = [d.dim_param if d.HasField("dim_param") else d.dim_value
+            for d in tensor_type.shape.dim]
+    if len(dims) != 4 or dims[1] != 3:
+        sys.exit("expected an [N,3,H,W] input, got %s" % dims)
+    new_dims = dims if args.layout == "nchw" else [dims[0], dims[2], dims[3], 3]
+
+    name = old_input.name
+    raw_name = name + "_u8"
+    nodes = []
+    chw = raw_name
+    if args.layout == "nhwc":
+        chw = name + "_u8_nchw"
+        nodes.append(helper.make_node("Transpose", [raw_name], [chw], perm=[0, 3, 1, 2],
+                                      name="u8_input_transpose"))
+    nodes.append(helper.make_node("Cast", [chw], [name + "_f32"], to=TensorProto.FLOAT,
+                                  name="u8_input_cast"))
+    scale = helper.make_tensor(name + "_scale", TensorProto.FLOAT, [], [1.0 / 255.0])
+    graph.initializer.append(scale)
+    # The Mul writes the original input name, so the rest of the graph is untouched.
+    nodes.append(helper.make_node("Mul", [name + "_f32", scale.name], [name],
+                                  name="u8_input_scale"))
+
+    # Copies: the originals are detached when the repeated fields are cleared.
+    other_inputs = [copy.deepcopy(inp) for inp in graph.input if inp.name != name]
+    del graph.input[:]
+    graph.input.extend([helper.make_tensor_value_info(raw_name, TensorProto.UINT8, new_dims)] +
+                       other_inputs)
+    old_nodes = [copy.deepcopy(node) for node in graph.node]
+    del graph.node[:]
+    graph.node.extend(nodes + old_nodes)
+
+    onnx.checker.check_model(model)
+    out_path = args.out or wrapped_path_for(args.model)
+    onnx.save(model, out_path)
+    print("[INFO] Wrote %s (uint8 %s input '%s')" % (out_path, args.layout.upper(), raw_name))
+
+
+if __name__ == "__main__":
+    main()